@@ -0,0 +1,87 @@
+// Compares the native SIMD base64 encoder (cu_base64_encode) with
+// dart:convert's base64Encode on buffers of screenshot sizes. Both sides
+// end with a Dart String, as a request body needs one.
+//
+// Build the native library first (see README), then:
+//   dart run benchmark/base64_benchmark.dart [path/to/libnutdart.so]
+
+// ignore_for_file: avoid_print
+
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart' as ffi;
+import 'package:nutdart/nutdart_bindings_generated.dart';
+
+const _sizes = {
+  'small JPEG': 40 * 1024,
+  'full HD JPEG': 350 * 1024,
+  'large PNG': 4 * 1024 * 1024,
+};
+
+String _defaultLibrary() {
+  if (Platform.isMacOS) return 'nutdart.framework/nutdart';
+  if (Platform.isWindows) return 'nutdart.dll';
+  return 'libnutdart.so';
+}
+
+/// Average microseconds per call of [body], after a warm-up.
+double _time(void Function() body) {
+  for (var i = 0; i < 3; i++) {
+    body();
+  }
+  var iterations = 0;
+  final watch = Stopwatch()..start();
+  while (watch.elapsedMilliseconds < 500) {
+    body();
+    iterations++;
+  }
+  return watch.elapsedMicroseconds / iterations;
+}
+
+void main(List<String> args) {
+  final bindings = NutdartBindings(
+    DynamicLibrary.open(args.isNotEmpty ? args.first : _defaultLibrary()),
+  );
+  final random = Random(1);
+
+  for (final entry in _sizes.entries) {
+    final size = entry.value;
+    final bytes = Uint8List(size);
+    for (var i = 0; i < size; i++) {
+      bytes[i] = random.nextInt(256);
+    }
+
+    // The native side starts from native memory, as a capture leaves it
+    final length = 4 * ((size + 2) ~/ 3);
+    final src = ffi.malloc<Uint8>(size);
+    final out = ffi.malloc<Char>(length);
+    src.asTypedList(size).setAll(0, bytes);
+    try {
+      String encodeNative() {
+        bindings.cu_base64_encode(src, size, out);
+        return String.fromCharCodes(out.cast<Uint8>().asTypedList(length));
+      }
+
+      if (encodeNative() != base64Encode(bytes)) {
+        print('${entry.key}: native output differs from dart:convert');
+        exitCode = 1;
+        continue;
+      }
+      final dart = _time(() => base64Encode(bytes));
+      final native = _time(encodeNative);
+      print(
+        '${entry.key.padRight(13)} ${(size / 1024).round().toString().padLeft(5)} KB  '
+        'dart:convert ${dart.toStringAsFixed(0).padLeft(6)} us  '
+        'native ${native.toStringAsFixed(0).padLeft(6)} us  '
+        '${(dart / native).toStringAsFixed(1)}x',
+      );
+    } finally {
+      ffi.malloc.free(src);
+      ffi.malloc.free(out);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+// Measures what CapturedFrame saves over copying raw frames into Dart.
+//
+// The first part needs no display: for native buffers of common screen sizes
+// it compares copying into a Dart Uint8List (what Screen.capture does for
+// raw frames) with viewing the native memory (what CapturedFrame.pixels
+// does). The copy time includes the garbage collections the copies cause;
+// the heap column is what the copies add to the Dart heap per second.
+//
+// The second part captures the real screen both ways, if the native library
+// loads and a display is available.
+//
+// Build the native library first (see README), then:
+//   LD_LIBRARY_PATH=build dart run benchmark/captured_frame_benchmark.dart
+
+// ignore_for_file: avoid_print
+
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart' as ffi;
+import 'package:nutdart/nutdart.dart';
+
+const _frames = {
+  '1080p': 1920 * 1080 * 4,
+  '1440p': 2560 * 1440 * 4,
+  '4K': 3840 * 2160 * 4,
+};
+
+/// Average microseconds per call of [body], after a warm-up.
+double _time(void Function() body) {
+  for (var i = 0; i < 3; i++) {
+    body();
+  }
+  var iterations = 0;
+  final watch = Stopwatch()..start();
+  while (watch.elapsedMilliseconds < 1000) {
+    body();
+    iterations++;
+  }
+  return watch.elapsedMicroseconds / iterations;
+}
+
+String _us(double us) => '${us.toStringAsFixed(1).padLeft(8)} us';
+
+void main() {
+  var checksum = 0;
+
+  for (final entry in _frames.entries) {
+    final size = entry.value;
+    final native = ffi.malloc<Uint8>(size);
+    native.asTypedList(size).fillRange(0, size, 7);
+    try {
+      // Touch the last byte so neither side can skip its work
+      final copy = _time(() {
+        final bytes = Uint8List.fromList(native.asTypedList(size));
+        checksum += bytes[size - 1];
+      });
+      final view = _time(() {
+        final bytes = native.asTypedList(size);
+        checksum += bytes[size - 1];
+      });
+      final heapPerSecond = size / (copy / 1e6) / (1024 * 1024);
+      print(
+        '${entry.key.padRight(6)} ${(size / (1024 * 1024)).toStringAsFixed(1).padLeft(5)} MB  '
+        'copy ${_us(copy)} (${heapPerSecond.toStringAsFixed(0)} MB/s onto the heap)  '
+        'view ${_us(view)}',
+      );
+    } finally {
+      ffi.malloc.free(native);
+    }
+  }
+
+  if (!Nutdart.isAvailable) {
+    print('native library not loaded; skipping screen captures');
+    return;
+  }
+  final probe = Screen.captureFrame();
+  if (probe == null) {
+    print('screen capture unavailable; skipping screen captures');
+    return;
+  }
+  final label = '${probe.width}x${probe.height}';
+  probe.dispose();
+
+  final rssBefore = ProcessInfo.maxRss;
+  final framed = _time(() {
+    final frame = Screen.captureFrame()!;
+    checksum += frame.pixels[0];
+    frame.dispose();
+  });
+  final rssFramed = ProcessInfo.maxRss;
+  final copied = _time(() {
+    final bytes = Screen.capture()!;
+    checksum += bytes[0];
+  });
+  final rssCopied = ProcessInfo.maxRss;
+  print('screen $label');
+  print('  Screen.captureFrame ${_us(framed)}  peak RSS +${(rssFramed - rssBefore) >> 20} MB');
+  print('  Screen.capture      ${_us(copied)}  peak RSS +${(rssCopied - rssFramed) >> 20} MB');
+
+  if (checksum == -1) print(checksum);
+}
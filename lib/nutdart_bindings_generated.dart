@@ -268,6 +268,7 @@ class NutdartBindings {
   /// JPEG screenshot functions with resizing
   /// maxSmallDim/maxLargeDim: -1 means no limit
   /// quality: 0-100 (JPEG quality)
+  /// filter: one of CU_RESIZE_*; ignored on macOS, where ScreenCaptureKit scales
   /// outSize: pointer to receive the size of the returned JPEG data
   ffi.Pointer<ffi.Uint8> cu_screen_capture_region_jpeg(
     int x,
@@ -277,6 +278,7 @@ class NutdartBindings {
     int maxSmallDim,
     int maxLargeDim,
     int quality,
+    int filter,
     ffi.Pointer<ffi.Int64> outSize,
   ) {
     return _cu_screen_capture_region_jpeg(
@@ -287,6 +289,7 @@ class NutdartBindings {
       maxSmallDim,
       maxLargeDim,
       quality,
+      filter,
       outSize,
     );
   }
@@ -301,48 +304,1238 @@ class NutdartBindings {
               ffi.Int32,
               ffi.Int32,
               ffi.Int32,
+              ffi.Int32,
               ffi.Pointer<ffi.Int64>)>>('cu_screen_capture_region_jpeg');
   late final _cu_screen_capture_region_jpeg =
       _cu_screen_capture_region_jpegPtr.asFunction<
           ffi.Pointer<ffi.Uint8> Function(
-              int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+              int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_full_jpeg(
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_full_jpeg(
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_full_jpegPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int32,
+              ffi.Int32, ffi.Pointer<ffi.Int64>)>>('cu_screen_capture_full_jpeg');
+  late final _cu_screen_capture_full_jpeg =
+      _cu_screen_capture_full_jpegPtr.asFunction<
+          ffi.Pointer<ffi.Uint8> Function(
+              int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  void cu_screen_free_jpeg(
+    ffi.Pointer<ffi.Uint8> data,
+  ) {
+    return _cu_screen_free_jpeg(
+      data,
+    );
+  }
+
+  late final _cu_screen_free_jpegPtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Uint8>)>>(
+          'cu_screen_free_jpeg');
+  late final _cu_screen_free_jpeg = _cu_screen_free_jpegPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Uint8>)>();
+
+  /// Same as cu_screen_capture_*_jpeg, but at the highest quality whose JPEG
+  /// fits in maxBytes, written to outQuality. The frame is grabbed and resized
+  /// once and re-encoded at most twice, guided by the sizes of earlier frames.
+  /// Return NULL, with quality -1, if nothing fits even at quality 10, and
+  /// always on macOS. Free with cu_screen_free_jpeg.
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_region_jpeg_budget(
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int maxBytes,
+    int filter,
+    ffi.Pointer<ffi.Int32> outQuality,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_region_jpeg_budget(
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      maxBytes,
+      filter,
+      outQuality,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_region_jpeg_budgetPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int64, ffi.Int32, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_region_jpeg_budget');
+  late final _cu_screen_capture_region_jpeg_budget = _cu_screen_capture_region_jpeg_budgetPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_full_jpeg_budget(
+    int maxSmallDim,
+    int maxLargeDim,
+    int maxBytes,
+    int filter,
+    ffi.Pointer<ffi.Int32> outQuality,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_full_jpeg_budget(
+      maxSmallDim,
+      maxLargeDim,
+      maxBytes,
+      filter,
+      outQuality,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_full_jpeg_budgetPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int64, ffi.Int32, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_full_jpeg_budget');
+  late final _cu_screen_capture_full_jpeg_budget = _cu_screen_capture_full_jpeg_budgetPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>();
+
+  /// Lossless PNG screenshots, resized like the JPEG functions. Frames of at
+  /// most 256 colours become palette images, which keeps text sharp and small.
+  /// Free with cu_screen_free_png.
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_region_png(
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_region_png(
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_region_pngPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_region_png');
+  late final _cu_screen_capture_region_png = _cu_screen_capture_region_pngPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_full_png(
+    int maxSmallDim,
+    int maxLargeDim,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_full_png(
+      maxSmallDim,
+      maxLargeDim,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_full_pngPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_full_png');
+  late final _cu_screen_capture_full_png = _cu_screen_capture_full_pngPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  void cu_screen_free_png(
+    ffi.Pointer<ffi.Uint8> data,
+  ) {
+    return _cu_screen_free_png(
+      data,
+    );
+  }
+
+  late final _cu_screen_free_pngPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Uint8>)>>(
+      'cu_screen_free_png');
+  late final _cu_screen_free_png = _cu_screen_free_pngPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Uint8>)>();
+
+  /// WebP screenshots, resized like the JPEG functions. Needs libwebp at build
+  /// time; without it cu_screen_webp_available returns 0 and captures return
+  /// NULL. For lossy output quality works as for JPEG; with lossless set it is
+  /// the compression effort (0 fastest, 100 smallest). Free with
+  /// cu_screen_free_webp.
+  int cu_screen_webp_available() {
+    return _cu_screen_webp_available();
+  }
+
+  late final _cu_screen_webp_availablePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function()>>(
+      'cu_screen_webp_available');
+  late final _cu_screen_webp_available = _cu_screen_webp_availablePtr
+      .asFunction<int Function()>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_region_webp(
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int lossless,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_region_webp(
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      lossless,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_region_webpPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_region_webp');
+  late final _cu_screen_capture_region_webp = _cu_screen_capture_region_webpPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_full_webp(
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int lossless,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_full_webp(
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      lossless,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_full_webpPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_full_webp');
+  late final _cu_screen_capture_full_webp = _cu_screen_capture_full_webpPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  void cu_screen_free_webp(
+    ffi.Pointer<ffi.Uint8> data,
+  ) {
+    return _cu_screen_free_webp(
+      data,
+    );
+  }
+
+  late final _cu_screen_free_webpPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Uint8>)>>(
+      'cu_screen_free_webp');
+  late final _cu_screen_free_webp = _cu_screen_free_webpPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Uint8>)>();
+
+  /// Grabs the region once and encodes it once per output, so every output
+  /// shows the same moment. Each distinct size is resized once, from the
+  /// nearest larger one, and outputs are encoded in parallel. JPEG outputs are
+  /// empty on macOS. Returns the number of outputs encoded, or -1 if the grab
+  /// failed. Free the data with cu_screen_free_outputs.
+  int cu_screen_capture_region_multi(
+    int x,
+    int y,
+    int width,
+    int height,
+    ffi.Pointer<CUCaptureOutput> outputs,
+    int count,
+  ) {
+    return _cu_screen_capture_region_multi(
+      x,
+      y,
+      width,
+      height,
+      outputs,
+      count,
+    );
+  }
+
+  late final _cu_screen_capture_region_multiPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Pointer<CUCaptureOutput>, ffi.Int32)>>(
+      'cu_screen_capture_region_multi');
+  late final _cu_screen_capture_region_multi = _cu_screen_capture_region_multiPtr
+      .asFunction<int Function(int, int, int, int, ffi.Pointer<CUCaptureOutput>, int)>();
+
+  int cu_screen_capture_full_multi(
+    ffi.Pointer<CUCaptureOutput> outputs,
+    int count,
+  ) {
+    return _cu_screen_capture_full_multi(
+      outputs,
+      count,
+    );
+  }
+
+  late final _cu_screen_capture_full_multiPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUCaptureOutput>, ffi.Int32)>>(
+      'cu_screen_capture_full_multi');
+  late final _cu_screen_capture_full_multi = _cu_screen_capture_full_multiPtr
+      .asFunction<int Function(ffi.Pointer<CUCaptureOutput>, int)>();
+
+  void cu_screen_free_outputs(
+    ffi.Pointer<CUCaptureOutput> outputs,
+    int count,
+  ) {
+    return _cu_screen_free_outputs(
+      outputs,
+      count,
+    );
+  }
+
+  late final _cu_screen_free_outputsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUCaptureOutput>, ffi.Int32)>>(
+      'cu_screen_free_outputs');
+  late final _cu_screen_free_outputs = _cu_screen_free_outputsPtr
+      .asFunction<void Function(ffi.Pointer<CUCaptureOutput>, int)>();
+
+  /// Base64 screenshots, ready to paste into a JSON request. Captures like the
+  /// function for `format` (CU_FORMAT_*; quality is unused for PNG), then
+  /// writes the base64 with SIMD, behind "data:image/...;base64," if dataUri
+  /// is set. Returns a NUL-terminated string and its length in outLength, or
+  /// NULL on failure. Free with cu_screen_free_base64. Except on macOS, JPEG
+  /// goes through one shared encoder, so the JPEG itself is never allocated;
+  /// like cu_jpeg_encoder_capture_region it skips the JPEG cache.
+  ffi.Pointer<ffi.Char> cu_screen_capture_region_base64(
+    int x,
+    int y,
+    int width,
+    int height,
+    int format,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    int dataUri,
+    ffi.Pointer<ffi.Int64> outLength,
+  ) {
+    return _cu_screen_capture_region_base64(
+      x,
+      y,
+      width,
+      height,
+      format,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      dataUri,
+      outLength,
+    );
+  }
+
+  late final _cu_screen_capture_region_base64Ptr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_region_base64');
+  late final _cu_screen_capture_region_base64 = _cu_screen_capture_region_base64Ptr
+      .asFunction<ffi.Pointer<ffi.Char> Function(int, int, int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  ffi.Pointer<ffi.Char> cu_screen_capture_full_base64(
+    int format,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    int dataUri,
+    ffi.Pointer<ffi.Int64> outLength,
+  ) {
+    return _cu_screen_capture_full_base64(
+      format,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      dataUri,
+      outLength,
+    );
+  }
+
+  late final _cu_screen_capture_full_base64Ptr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_full_base64');
+  late final _cu_screen_capture_full_base64 = _cu_screen_capture_full_base64Ptr
+      .asFunction<ffi.Pointer<ffi.Char> Function(int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  void cu_screen_free_base64(
+    ffi.Pointer<ffi.Char> data,
+  ) {
+    return _cu_screen_free_base64(
+      data,
+    );
+  }
+
+  late final _cu_screen_free_base64Ptr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Char>)>>(
+      'cu_screen_free_base64');
+  late final _cu_screen_free_base64 = _cu_screen_free_base64Ptr
+      .asFunction<void Function(ffi.Pointer<ffi.Char>)>();
+
+  /// Writes the base64 of size bytes to out, which must hold 4 * ((size + 2) / 3)
+  /// characters (no NUL is added). Returns that length, or -1 on bad arguments.
+  int cu_base64_encode(
+    ffi.Pointer<ffi.Uint8> data,
+    int size,
+    ffi.Pointer<ffi.Char> out,
+  ) {
+    return _cu_base64_encode(
+      data,
+      size,
+      out,
+    );
+  }
+
+  late final _cu_base64_encodePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int64 Function(ffi.Pointer<ffi.Uint8>, ffi.Int64, ffi.Pointer<ffi.Char>)>>(
+      'cu_base64_encode');
+  late final _cu_base64_encode = _cu_base64_encodePtr
+      .asFunction<int Function(ffi.Pointer<ffi.Uint8>, int, ffi.Pointer<ffi.Char>)>();
+
+  /// Writes up to maxMonitors monitors, primary first, and returns the total
+  /// number of monitors (may exceed maxMonitors), or -1 on error
+  int cu_screen_get_monitors(
+    ffi.Pointer<CUMonitor> outMonitors,
+    int maxMonitors,
+  ) {
+    return _cu_screen_get_monitors(
+      outMonitors,
+      maxMonitors,
+    );
+  }
+
+  late final _cu_screen_get_monitorsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUMonitor>, ffi.Int32)>>(
+      'cu_screen_get_monitors');
+  late final _cu_screen_get_monitors = _cu_screen_get_monitorsPtr
+      .asFunction<int Function(ffi.Pointer<CUMonitor>, int)>();
+
+  /// Captures one monitor by index (as ordered by cu_screen_get_monitors)
+  ffi.Pointer<CUBitmap> cu_screen_capture_monitor(
+    int index,
+  ) {
+    return _cu_screen_capture_monitor(
+      index,
+    );
+  }
+
+  late final _cu_screen_capture_monitorPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUBitmap> Function(ffi.Int32)>>(
+      'cu_screen_capture_monitor');
+  late final _cu_screen_capture_monitor = _cu_screen_capture_monitorPtr
+      .asFunction<ffi.Pointer<CUBitmap> Function(int)>();
+
+  ffi.Pointer<ffi.Uint8> cu_screen_capture_monitor_jpeg(
+    int index,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_screen_capture_monitor_jpeg(
+      index,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_screen_capture_monitor_jpegPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_capture_monitor_jpeg');
+  late final _cu_screen_capture_monitor_jpeg = _cu_screen_capture_monitor_jpegPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// Captures every monitor as its own JPEG, encoding them in parallel.
+  /// Returns the number of results written, or -1 on failure.
+  int cu_screen_capture_all_monitors_jpeg(
+    ffi.Pointer<CUMonitorJpeg> outResults,
+    int maxResults,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+  ) {
+    return _cu_screen_capture_all_monitors_jpeg(
+      outResults,
+      maxResults,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+    );
+  }
+
+  late final _cu_screen_capture_all_monitors_jpegPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUMonitorJpeg>, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32)>>(
+      'cu_screen_capture_all_monitors_jpeg');
+  late final _cu_screen_capture_all_monitors_jpeg = _cu_screen_capture_all_monitors_jpegPtr
+      .asFunction<int Function(ffi.Pointer<CUMonitorJpeg>, int, int, int, int, int)>();
+
+  /// JPEG capture cache (Linux)
+  /// Repeated JPEG captures with the same region, maxSmallDim, maxLargeDim,
+  /// quality and filter return the previous bytes while the screen is unchanged (checked
+  /// with damage tracking when running, a frame hash otherwise). On by default.
+  void cu_screen_jpeg_cache_set_enabled(
+    int enabled,
+  ) {
+    return _cu_screen_jpeg_cache_set_enabled(
+      enabled,
+    );
+  }
+
+  late final _cu_screen_jpeg_cache_set_enabledPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Int32)>>(
+      'cu_screen_jpeg_cache_set_enabled');
+  late final _cu_screen_jpeg_cache_set_enabled = _cu_screen_jpeg_cache_set_enabledPtr
+      .asFunction<void Function(int)>();
+
+  /// Drops cached JPEGs and resets the counters
+  void cu_screen_jpeg_cache_clear() {
+    return _cu_screen_jpeg_cache_clear();
+  }
+
+  late final _cu_screen_jpeg_cache_clearPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function()>>(
+      'cu_screen_jpeg_cache_clear');
+  late final _cu_screen_jpeg_cache_clear = _cu_screen_jpeg_cache_clearPtr
+      .asFunction<void Function()>();
+
+  void cu_screen_jpeg_cache_get_stats(
+    ffi.Pointer<ffi.Int64> hits,
+    ffi.Pointer<ffi.Int64> misses,
+  ) {
+    return _cu_screen_jpeg_cache_get_stats(
+      hits,
+      misses,
+    );
+  }
+
+  late final _cu_screen_jpeg_cache_get_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Int64>, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_jpeg_cache_get_stats');
+  late final _cu_screen_jpeg_cache_get_stats = _cu_screen_jpeg_cache_get_statsPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Int64>, ffi.Pointer<ffi.Int64>)>();
+
+  /// JPEG encoding threads (Linux)
+  /// Threads that resize and encode one JPEG. 1 (the default) keeps the work on
+  /// the calling thread; 0 uses one per CPU core. With more, large images are
+  /// encoded as strips joined with restart markers.
+  void cu_screen_jpeg_set_threads(
+    int threads,
+  ) {
+    return _cu_screen_jpeg_set_threads(
+      threads,
+    );
+  }
+
+  late final _cu_screen_jpeg_set_threadsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Int32)>>(
+      'cu_screen_jpeg_set_threads');
+  late final _cu_screen_jpeg_set_threads = _cu_screen_jpeg_set_threadsPtr
+      .asFunction<void Function(int)>();
+
+  int cu_screen_jpeg_get_threads() {
+    return _cu_screen_jpeg_get_threads();
+  }
+
+  late final _cu_screen_jpeg_get_threadsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function()>>(
+      'cu_screen_jpeg_get_threads');
+  late final _cu_screen_jpeg_get_threads = _cu_screen_jpeg_get_threadsPtr
+      .asFunction<int Function()>();
+
+  /// Reusable JPEG encoders
+  /// An encoder keeps its capture buffer, libjpeg compressor, tables, resize
+  /// buffers and output buffer between captures, so repeated screenshots of
+  /// the same size make no large allocations (Linux; Windows keeps only the
+  /// capture and output buffers). It bypasses the JPEG capture cache. Use from
+  /// one thread at a time.
+  /// cu_jpeg_encoder_create: returns NULL on failure
+  ffi.Pointer<CUJpegEncoder> cu_jpeg_encoder_create() {
+    return _cu_jpeg_encoder_create();
+  }
+
+  late final _cu_jpeg_encoder_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUJpegEncoder> Function()>>(
+      'cu_jpeg_encoder_create');
+  late final _cu_jpeg_encoder_create = _cu_jpeg_encoder_createPtr
+      .asFunction<ffi.Pointer<CUJpegEncoder> Function()>();
+
+  void cu_jpeg_encoder_destroy(
+    ffi.Pointer<CUJpegEncoder> encoder,
+  ) {
+    return _cu_jpeg_encoder_destroy(
+      encoder,
+    );
+  }
+
+  late final _cu_jpeg_encoder_destroyPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUJpegEncoder>)>>(
+      'cu_jpeg_encoder_destroy');
+  late final _cu_jpeg_encoder_destroy = _cu_jpeg_encoder_destroyPtr
+      .asFunction<void Function(ffi.Pointer<CUJpegEncoder>)>();
+
+  /// Captures and encodes like cu_screen_capture_region_jpeg (width or height
+  /// <= 0 captures the whole screen). The bytes belong to the encoder and stay
+  /// valid until its next capture or destruction; don't free them.
+  ffi.Pointer<ffi.Uint8> cu_jpeg_encoder_capture_region(
+    ffi.Pointer<CUJpegEncoder> encoder,
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_jpeg_encoder_capture_region(
+      encoder,
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      outSize,
+    );
+  }
+
+  late final _cu_jpeg_encoder_capture_regionPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUJpegEncoder>, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_jpeg_encoder_capture_region');
+  late final _cu_jpeg_encoder_capture_region = _cu_jpeg_encoder_capture_regionPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUJpegEncoder>, int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// Same, but libjpeg writes straight into the caller's buffer (Linux; other
+  /// platforms copy into it). Returns the JPEG's size, or -1 on failure. A size
+  /// above capacity means the buffer was too small; the encoder then holds the
+  /// JPEG, and cu_jpeg_encoder_copy_last fetches it without capturing again.
+  int cu_jpeg_encoder_capture_region_into(
+    ffi.Pointer<CUJpegEncoder> encoder,
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int quality,
+    int filter,
+    ffi.Pointer<ffi.Uint8> buffer,
+    int capacity,
+  ) {
+    return _cu_jpeg_encoder_capture_region_into(
+      encoder,
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      quality,
+      filter,
+      buffer,
+      capacity,
+    );
+  }
+
+  late final _cu_jpeg_encoder_capture_region_intoPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int64 Function(ffi.Pointer<CUJpegEncoder>, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Uint8>, ffi.Int64)>>(
+      'cu_jpeg_encoder_capture_region_into');
+  late final _cu_jpeg_encoder_capture_region_into = _cu_jpeg_encoder_capture_region_intoPtr
+      .asFunction<int Function(ffi.Pointer<CUJpegEncoder>, int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Uint8>, int)>();
+
+  /// Copies the last JPEG the encoder holds (see above) into buffer. Returns its
+  /// size, copying nothing if above capacity, or -1 if the encoder holds none.
+  int cu_jpeg_encoder_copy_last(
+    ffi.Pointer<CUJpegEncoder> encoder,
+    ffi.Pointer<ffi.Uint8> buffer,
+    int capacity,
+  ) {
+    return _cu_jpeg_encoder_copy_last(
+      encoder,
+      buffer,
+      capacity,
+    );
+  }
+
+  late final _cu_jpeg_encoder_copy_lastPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int64 Function(ffi.Pointer<CUJpegEncoder>, ffi.Pointer<ffi.Uint8>, ffi.Int64)>>(
+      'cu_jpeg_encoder_copy_last');
+  late final _cu_jpeg_encoder_copy_last = _cu_jpeg_encoder_copy_lastPtr
+      .asFunction<int Function(ffi.Pointer<CUJpegEncoder>, ffi.Pointer<ffi.Uint8>, int)>();
+
+  /// Captures like cu_screen_capture_region_jpeg_budget, learning from this
+  /// encoder's earlier frames only. The bytes belong to the encoder, as with
+  /// cu_jpeg_encoder_capture_region. Returns NULL on macOS.
+  ffi.Pointer<ffi.Uint8> cu_jpeg_encoder_capture_region_budget(
+    ffi.Pointer<CUJpegEncoder> encoder,
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int maxBytes,
+    int filter,
+    ffi.Pointer<ffi.Int32> outQuality,
+    ffi.Pointer<ffi.Int64> outSize,
+  ) {
+    return _cu_jpeg_encoder_capture_region_budget(
+      encoder,
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      maxBytes,
+      filter,
+      outQuality,
+      outSize,
+    );
+  }
+
+  late final _cu_jpeg_encoder_capture_region_budgetPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUJpegEncoder>, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int64, ffi.Int32, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>>(
+      'cu_jpeg_encoder_capture_region_budget');
+  late final _cu_jpeg_encoder_capture_region_budget = _cu_jpeg_encoder_capture_region_budgetPtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUJpegEncoder>, int, int, int, int, int, int, int, int, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int64>)>();
+
+  /// Width or height <= 0 plans for the whole screen. Returns NULL on failure
+  ffi.Pointer<CUCapturePlan> cu_capture_plan_create(
+    int x,
+    int y,
+    int width,
+    int height,
+    int maxSmallDim,
+    int maxLargeDim,
+    int filter,
+  ) {
+    return _cu_capture_plan_create(
+      x,
+      y,
+      width,
+      height,
+      maxSmallDim,
+      maxLargeDim,
+      filter,
+    );
+  }
+
+  late final _cu_capture_plan_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUCapturePlan> Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32, ffi.Int32)>>(
+      'cu_capture_plan_create');
+  late final _cu_capture_plan_create = _cu_capture_plan_createPtr
+      .asFunction<ffi.Pointer<CUCapturePlan> Function(int, int, int, int, int, int, int)>();
+
+  void cu_capture_plan_destroy(
+    ffi.Pointer<CUCapturePlan> plan,
+  ) {
+    return _cu_capture_plan_destroy(
+      plan,
+    );
+  }
+
+  late final _cu_capture_plan_destroyPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUCapturePlan>)>>(
+      'cu_capture_plan_destroy');
+  late final _cu_capture_plan_destroy = _cu_capture_plan_destroyPtr
+      .asFunction<void Function(ffi.Pointer<CUCapturePlan>)>();
 
-  ffi.Pointer<ffi.Uint8> cu_screen_capture_full_jpeg(
-    int maxSmallDim,
-    int maxLargeDim,
+  /// The size of every image the plan produces
+  CUSize cu_capture_plan_get_image_size(
+    ffi.Pointer<CUCapturePlan> plan,
+  ) {
+    return _cu_capture_plan_get_image_size(
+      plan,
+    );
+  }
+
+  late final _cu_capture_plan_get_image_sizePtr = _lookup<
+      ffi.NativeFunction<
+          CUSize Function(ffi.Pointer<CUCapturePlan>)>>(
+      'cu_capture_plan_get_image_size');
+  late final _cu_capture_plan_get_image_size = _cu_capture_plan_get_image_sizePtr
+      .asFunction<CUSize Function(ffi.Pointer<CUCapturePlan>)>();
+
+  CUCoordinateTransform cu_capture_plan_get_transform(
+    ffi.Pointer<CUCapturePlan> plan,
+  ) {
+    return _cu_capture_plan_get_transform(
+      plan,
+    );
+  }
+
+  late final _cu_capture_plan_get_transformPtr = _lookup<
+      ffi.NativeFunction<
+          CUCoordinateTransform Function(ffi.Pointer<CUCapturePlan>)>>(
+      'cu_capture_plan_get_transform');
+  late final _cu_capture_plan_get_transform = _cu_capture_plan_get_transformPtr
+      .asFunction<CUCoordinateTransform Function(ffi.Pointer<CUCapturePlan>)>();
+
+  /// Maps a point between the plan's images and the screen, rounding to the
+  /// nearest pixel
+  CUPoint cu_capture_plan_to_screen(
+    ffi.Pointer<CUCapturePlan> plan,
+    double imageX,
+    double imageY,
+  ) {
+    return _cu_capture_plan_to_screen(
+      plan,
+      imageX,
+      imageY,
+    );
+  }
+
+  late final _cu_capture_plan_to_screenPtr = _lookup<
+      ffi.NativeFunction<
+          CUPoint Function(ffi.Pointer<CUCapturePlan>, ffi.Double, ffi.Double)>>(
+      'cu_capture_plan_to_screen');
+  late final _cu_capture_plan_to_screen = _cu_capture_plan_to_screenPtr
+      .asFunction<CUPoint Function(ffi.Pointer<CUCapturePlan>, double, double)>();
+
+  CUPoint cu_capture_plan_to_image(
+    ffi.Pointer<CUCapturePlan> plan,
+    double screenX,
+    double screenY,
+  ) {
+    return _cu_capture_plan_to_image(
+      plan,
+      screenX,
+      screenY,
+    );
+  }
+
+  late final _cu_capture_plan_to_imagePtr = _lookup<
+      ffi.NativeFunction<
+          CUPoint Function(ffi.Pointer<CUCapturePlan>, ffi.Double, ffi.Double)>>(
+      'cu_capture_plan_to_image');
+  late final _cu_capture_plan_to_image = _cu_capture_plan_to_imagePtr
+      .asFunction<CUPoint Function(ffi.Pointer<CUCapturePlan>, double, double)>();
+
+  /// Captures and encodes a frame as format (CU_FORMAT_*) at quality, which PNG
+  /// ignores. The bytes belong to the plan and stay valid until its next
+  /// capture or destruction; don't free them. JPEG returns NULL on macOS.
+  ffi.Pointer<ffi.Uint8> cu_capture_plan_capture(
+    ffi.Pointer<CUCapturePlan> plan,
+    int format,
     int quality,
     ffi.Pointer<ffi.Int64> outSize,
   ) {
-    return _cu_screen_capture_full_jpeg(
-      maxSmallDim,
-      maxLargeDim,
+    return _cu_capture_plan_capture(
+      plan,
+      format,
       quality,
       outSize,
     );
   }
 
-  late final _cu_screen_capture_full_jpegPtr = _lookup<
+  late final _cu_capture_plan_capturePtr = _lookup<
       ffi.NativeFunction<
-          ffi.Pointer<ffi.Uint8> Function(ffi.Int32, ffi.Int32, ffi.Int32,
-              ffi.Pointer<ffi.Int64>)>>('cu_screen_capture_full_jpeg');
-  late final _cu_screen_capture_full_jpeg =
-      _cu_screen_capture_full_jpegPtr.asFunction<
-          ffi.Pointer<ffi.Uint8> Function(
-              int, int, int, ffi.Pointer<ffi.Int64>)>();
+          ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUCapturePlan>, ffi.Int32, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_capture_plan_capture');
+  late final _cu_capture_plan_capture = _cu_capture_plan_capturePtr
+      .asFunction<ffi.Pointer<ffi.Uint8> Function(ffi.Pointer<CUCapturePlan>, int, int, ffi.Pointer<ffi.Int64>)>();
 
-  void cu_screen_free_jpeg(
-    ffi.Pointer<ffi.Uint8> data,
+  /// Damage tracking (X11 with the XDamage extension; unavailable elsewhere)
+  /// A background thread counts screen updates as frames. Callers remember the
+  /// sequence number of their last capture and ask what changed since then.
+  /// cu_screen_damage_start: returns 1 if tracking is active, 0 if unavailable
+  int cu_screen_damage_start() {
+    return _cu_screen_damage_start();
+  }
+
+  late final _cu_screen_damage_startPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function()>>(
+      'cu_screen_damage_start');
+  late final _cu_screen_damage_start = _cu_screen_damage_startPtr
+      .asFunction<int Function()>();
+
+  void cu_screen_damage_stop() {
+    return _cu_screen_damage_stop();
+  }
+
+  late final _cu_screen_damage_stopPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function()>>(
+      'cu_screen_damage_stop');
+  late final _cu_screen_damage_stop = _cu_screen_damage_stopPtr
+      .asFunction<void Function()>();
+
+  /// Returns the current frame sequence number, or -1 if not tracking
+  int cu_screen_get_frame_sequence() {
+    return _cu_screen_get_frame_sequence();
+  }
+
+  late final _cu_screen_get_frame_sequencePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int64 Function()>>(
+      'cu_screen_get_frame_sequence');
+  late final _cu_screen_get_frame_sequence = _cu_screen_get_frame_sequencePtr
+      .asFunction<int Function()>();
+
+  /// Writes the regions changed after sinceSequence, merged into at most
+  /// maxRects rectangles, and returns how many were written (0 = unchanged).
+  /// If sinceSequence is too old the whole screen is reported. With maxRects 0
+  /// nothing is written and 1 means "something changed".
+  /// outSequence (optional) receives the sequence the result is current to.
+  /// Returns -1 if not tracking.
+  int cu_screen_get_dirty_rects(
+    int sinceSequence,
+    ffi.Pointer<CURect> outRects,
+    int maxRects,
+    ffi.Pointer<ffi.Int64> outSequence,
   ) {
-    return _cu_screen_free_jpeg(
-      data,
+    return _cu_screen_get_dirty_rects(
+      sinceSequence,
+      outRects,
+      maxRects,
+      outSequence,
     );
   }
 
-  late final _cu_screen_free_jpegPtr =
-      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Uint8>)>>(
-          'cu_screen_free_jpeg');
-  late final _cu_screen_free_jpeg = _cu_screen_free_jpegPtr
-      .asFunction<void Function(ffi.Pointer<ffi.Uint8>)>();
+  late final _cu_screen_get_dirty_rectsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Int64, ffi.Pointer<CURect>, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_get_dirty_rects');
+  late final _cu_screen_get_dirty_rects = _cu_screen_get_dirty_rectsPtr
+      .asFunction<int Function(int, ffi.Pointer<CURect>, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// tileSize: tile edge in pixels, 0 for the default (32). Returns NULL on failure
+  ffi.Pointer<CUFrameDiffer> cu_frame_differ_create(
+    int tileSize,
+  ) {
+    return _cu_frame_differ_create(
+      tileSize,
+    );
+  }
+
+  late final _cu_frame_differ_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUFrameDiffer> Function(ffi.Int32)>>(
+      'cu_frame_differ_create');
+  late final _cu_frame_differ_create = _cu_frame_differ_createPtr
+      .asFunction<ffi.Pointer<CUFrameDiffer> Function(int)>();
+
+  void cu_frame_differ_destroy(
+    ffi.Pointer<CUFrameDiffer> differ,
+  ) {
+    return _cu_frame_differ_destroy(
+      differ,
+    );
+  }
+
+  late final _cu_frame_differ_destroyPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUFrameDiffer>)>>(
+      'cu_frame_differ_destroy');
+  late final _cu_frame_differ_destroy = _cu_frame_differ_destroyPtr
+      .asFunction<void Function(ffi.Pointer<CUFrameDiffer>)>();
+
+  /// Forgets the previous frame; the next comparison reports everything changed
+  void cu_frame_differ_reset(
+    ffi.Pointer<CUFrameDiffer> differ,
+  ) {
+    return _cu_frame_differ_reset(
+      differ,
+    );
+  }
+
+  late final _cu_frame_differ_resetPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUFrameDiffer>)>>(
+      'cu_frame_differ_reset');
+  late final _cu_frame_differ_reset = _cu_frame_differ_resetPtr
+      .asFunction<void Function(ffi.Pointer<CUFrameDiffer>)>();
+
+  /// Compares bitmap with the previous frame and remembers it. Changed tiles are
+  /// merged into at most maxRects rectangles (bitmap coordinates); returns how
+  /// many were written (0 = unchanged). The first frame, or one of a different
+  /// size, is reported whole. With maxRects 0 nothing is written and 1 means
+  /// "something changed". outChangedPixels (optional) receives the changed area.
+  /// Returns -1 on failure.
+  int cu_frame_differ_compare(
+    ffi.Pointer<CUFrameDiffer> differ,
+    ffi.Pointer<CUBitmap> bitmap,
+    ffi.Pointer<CURect> outRects,
+    int maxRects,
+    ffi.Pointer<ffi.Int64> outChangedPixels,
+  ) {
+    return _cu_frame_differ_compare(
+      differ,
+      bitmap,
+      outRects,
+      maxRects,
+      outChangedPixels,
+    );
+  }
+
+  late final _cu_frame_differ_comparePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUFrameDiffer>, ffi.Pointer<CUBitmap>, ffi.Pointer<CURect>, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_frame_differ_compare');
+  late final _cu_frame_differ_compare = _cu_frame_differ_comparePtr
+      .asFunction<int Function(ffi.Pointer<CUFrameDiffer>, ffi.Pointer<CUBitmap>, ffi.Pointer<CURect>, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// Captures a region (or the full screen) and compares it as above.
+  /// Rectangles are relative to the captured area. Returns -1 if capture fails.
+  int cu_frame_differ_capture_region(
+    ffi.Pointer<CUFrameDiffer> differ,
+    int x,
+    int y,
+    int width,
+    int height,
+    ffi.Pointer<CURect> outRects,
+    int maxRects,
+    ffi.Pointer<ffi.Int64> outChangedPixels,
+  ) {
+    return _cu_frame_differ_capture_region(
+      differ,
+      x,
+      y,
+      width,
+      height,
+      outRects,
+      maxRects,
+      outChangedPixels,
+    );
+  }
+
+  late final _cu_frame_differ_capture_regionPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUFrameDiffer>, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Pointer<CURect>, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_frame_differ_capture_region');
+  late final _cu_frame_differ_capture_region = _cu_frame_differ_capture_regionPtr
+      .asFunction<int Function(ffi.Pointer<CUFrameDiffer>, int, int, int, int, ffi.Pointer<CURect>, int, ffi.Pointer<ffi.Int64>)>();
+
+  int cu_frame_differ_capture_full(
+    ffi.Pointer<CUFrameDiffer> differ,
+    ffi.Pointer<CURect> outRects,
+    int maxRects,
+    ffi.Pointer<ffi.Int64> outChangedPixels,
+  ) {
+    return _cu_frame_differ_capture_full(
+      differ,
+      outRects,
+      maxRects,
+      outChangedPixels,
+    );
+  }
+
+  late final _cu_frame_differ_capture_fullPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<CUFrameDiffer>, ffi.Pointer<CURect>, ffi.Int32, ffi.Pointer<ffi.Int64>)>>(
+      'cu_frame_differ_capture_full');
+  late final _cu_frame_differ_capture_full = _cu_frame_differ_capture_fullPtr
+      .asFunction<int Function(ffi.Pointer<CUFrameDiffer>, ffi.Pointer<CURect>, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// Waits until nothing in the region has changed for quietMs, or timeoutMs
+  /// passes. Uses damage tracking when it is running, otherwise repeated
+  /// captures compared tile by tile. width or height <= 0 means the full screen.
+  /// Returns 1 once stable, 0 on timeout, -1 if the region can't be captured.
+  /// outElapsedMs (optional) receives the time spent waiting.
+  int cu_screen_wait_stable(
+    int x,
+    int y,
+    int width,
+    int height,
+    int quietMs,
+    int timeoutMs,
+    ffi.Pointer<ffi.Int64> outElapsedMs,
+  ) {
+    return _cu_screen_wait_stable(
+      x,
+      y,
+      width,
+      height,
+      quietMs,
+      timeoutMs,
+      outElapsedMs,
+    );
+  }
+
+  late final _cu_screen_wait_stablePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Int64, ffi.Pointer<ffi.Int64>)>>(
+      'cu_screen_wait_stable');
+  late final _cu_screen_wait_stable = _cu_screen_wait_stablePtr
+      .asFunction<int Function(int, int, int, int, int, int, ffi.Pointer<ffi.Int64>)>();
+
+  /// Returns NULL if the session can't be started
+  ffi.Pointer<CUCaptureSession> cu_capture_session_start(
+    ffi.Pointer<CUCaptureSessionConfig> config,
+  ) {
+    return _cu_capture_session_start(
+      config,
+    );
+  }
+
+  late final _cu_capture_session_startPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUCaptureSession> Function(ffi.Pointer<CUCaptureSessionConfig>)>>(
+      'cu_capture_session_start');
+  late final _cu_capture_session_start = _cu_capture_session_startPtr
+      .asFunction<ffi.Pointer<CUCaptureSession> Function(ffi.Pointer<CUCaptureSessionConfig>)>();
+
+  /// Stops capturing. Frames not yet released stay valid until released.
+  void cu_capture_session_stop(
+    ffi.Pointer<CUCaptureSession> session,
+  ) {
+    return _cu_capture_session_stop(
+      session,
+    );
+  }
+
+  late final _cu_capture_session_stopPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUCaptureSession>)>>(
+      'cu_capture_session_stop');
+  late final _cu_capture_session_stop = _cu_capture_session_stopPtr
+      .asFunction<void Function(ffi.Pointer<CUCaptureSession>)>();
+
+  /// Borrows the newest frame; NULL if nothing has been captured yet
+  ffi.Pointer<CUCaptureFrame> cu_capture_session_latest(
+    ffi.Pointer<CUCaptureSession> session,
+  ) {
+    return _cu_capture_session_latest(
+      session,
+    );
+  }
+
+  late final _cu_capture_session_latestPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUCaptureFrame> Function(ffi.Pointer<CUCaptureSession>)>>(
+      'cu_capture_session_latest');
+  late final _cu_capture_session_latest = _cu_capture_session_latestPtr
+      .asFunction<ffi.Pointer<CUCaptureFrame> Function(ffi.Pointer<CUCaptureSession>)>();
+
+  /// Borrows the first frame newer than afterSequence, waiting up to timeoutMs.
+  /// Returns NULL on timeout or once the session is stopped.
+  ffi.Pointer<CUCaptureFrame> cu_capture_session_next(
+    ffi.Pointer<CUCaptureSession> session,
+    int afterSequence,
+    int timeoutMs,
+  ) {
+    return _cu_capture_session_next(
+      session,
+      afterSequence,
+      timeoutMs,
+    );
+  }
+
+  late final _cu_capture_session_nextPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<CUCaptureFrame> Function(ffi.Pointer<CUCaptureSession>, ffi.Int64, ffi.Int32)>>(
+      'cu_capture_session_next');
+  late final _cu_capture_session_next = _cu_capture_session_nextPtr
+      .asFunction<ffi.Pointer<CUCaptureFrame> Function(ffi.Pointer<CUCaptureSession>, int, int)>();
+
+  void cu_capture_session_release_frame(
+    ffi.Pointer<CUCaptureSession> session,
+    ffi.Pointer<CUCaptureFrame> frame,
+  ) {
+    return _cu_capture_session_release_frame(
+      session,
+      frame,
+    );
+  }
+
+  late final _cu_capture_session_release_framePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUCaptureSession>, ffi.Pointer<CUCaptureFrame>)>>(
+      'cu_capture_session_release_frame');
+  late final _cu_capture_session_release_frame = _cu_capture_session_release_framePtr
+      .asFunction<void Function(ffi.Pointer<CUCaptureSession>, ffi.Pointer<CUCaptureFrame>)>();
+
+  void cu_capture_session_get_stats(
+    ffi.Pointer<CUCaptureSession> session,
+    ffi.Pointer<CUCaptureSessionStats> outStats,
+  ) {
+    return _cu_capture_session_get_stats(
+      session,
+      outStats,
+    );
+  }
+
+  late final _cu_capture_session_get_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<CUCaptureSession>, ffi.Pointer<CUCaptureSessionStats>)>>(
+      'cu_capture_session_get_stats');
+  late final _cu_capture_session_get_stats = _cu_capture_session_get_statsPtr
+      .asFunction<void Function(ffi.Pointer<CUCaptureSession>, ffi.Pointer<CUCaptureSessionStats>)>();
 
   /// Utility functions
   void cu_sleep_ms(
@@ -406,8 +1599,189 @@ final class CUBitmap extends ffi.Struct {
   external int bytesPerPixel;
 }
 
+/// Screen rectangle (damage/dirty regions)
+final class CURect extends ffi.Struct {
+  @ffi.Int64()
+  external int x;
+
+  @ffi.Int64()
+  external int y;
+
+  @ffi.Int64()
+  external int width;
+
+  @ffi.Int64()
+  external int height;
+}
+
+/// Frame differ (all platforms)
+/// Splits each capture into tiles, hashes them and compares the hashes with
+/// the previous capture given to the same differ. Use one differ per consumer;
+/// a differ is not thread-safe.
+final class CUFrameDiffer extends ffi.Opaque {}
+
+/// Continuous capture sessions
+/// A native thread grabs a region at a fixed interval into a ring of reused
+/// frames. Frames are borrowed without copying and must be released.
+final class CUCaptureSessionConfig extends ffi.Struct {
+  @ffi.Int64()
+  external int x;
+
+  @ffi.Int64()
+  external int y;
+
+  @ffi.Int64()
+  external int width;
+
+  @ffi.Int64()
+  external int height;
+
+  @ffi.Int32()
+  external int intervalMs;
+
+  @ffi.Int32()
+  external int ringSize;
+
+  @ffi.Int32()
+  external int encodeJpeg;
+
+  @ffi.Int32()
+  external int maxSmallDim;
+
+  @ffi.Int32()
+  external int maxLargeDim;
+
+  @ffi.Int32()
+  external int quality;
+
+  @ffi.Int32()
+  external int filter;
+}
+
+final class CUCaptureFrame extends ffi.Struct {
+  @ffi.Int64()
+  external int sequence;
+
+  @ffi.Int64()
+  external int timestampUs;
+
+  external CUBitmap bitmap;
+
+  external ffi.Pointer<ffi.Uint8> jpeg;
+
+  @ffi.Int64()
+  external int jpegSize;
+}
+
+final class CUCaptureSessionStats extends ffi.Struct {
+  @ffi.Int64()
+  external int captured;
+
+  @ffi.Int64()
+  external int dropped;
+
+  @ffi.Int64()
+  external int late;
+
+  @ffi.Int64()
+  external int failed;
+}
+
+final class CUCaptureSession extends ffi.Opaque {}
+
+final class CUJpegEncoder extends ffi.Opaque {}
+
+final class CUCapturePlan extends ffi.Opaque {}
+
+/// Monitors
+final class CUMonitor extends ffi.Struct {
+  @ffi.Int64()
+  external int x;
+
+  @ffi.Int64()
+  external int y;
+
+  @ffi.Int64()
+  external int width;
+
+  @ffi.Int64()
+  external int height;
+
+  @ffi.Int32()
+  external int primary;
+}
+
+final class CUMonitorJpeg extends ffi.Struct {
+  external CUMonitor monitor;
+
+  external ffi.Pointer<ffi.Uint8> jpeg;
+
+  @ffi.Int64()
+  external int size;
+}
+
+final class CUCaptureOutput extends ffi.Struct {
+  @ffi.Int32()
+  external int format;
+
+  @ffi.Int32()
+  external int maxSmallDim;
+
+  @ffi.Int32()
+  external int maxLargeDim;
+
+  @ffi.Int32()
+  external int quality;
+
+  @ffi.Int32()
+  external int filter;
+
+  external ffi.Pointer<ffi.Uint8> data;
+
+  @ffi.Int64()
+  external int size;
+
+  @ffi.Int64()
+  external int width;
+
+  @ffi.Int64()
+  external int height;
+}
+
+/// Maps screen coordinates to image coordinates, pixel centre to pixel centre:
+/// imageX = (screenX - originX + 0.5) * scaleX - 0.5, and likewise for y.
+final class CUCoordinateTransform extends ffi.Struct {
+  @ffi.Double()
+  external double scaleX;
+
+  @ffi.Double()
+  external double scaleY;
+
+  @ffi.Double()
+  external double originX;
+
+  @ffi.Double()
+  external double originY;
+}
+
 const int CU_MOUSE_LEFT = 1;
 
 const int CU_MOUSE_MIDDLE = 2;
 
 const int CU_MOUSE_RIGHT = 3;
+
+const int CU_RESIZE_BILINEAR = 0;
+
+const int CU_RESIZE_AREA = 1;
+
+const int CU_RESIZE_LANCZOS3 = 2;
+
+const int CU_FORMAT_JPEG = 0;
+
+const int CU_FORMAT_PNG = 1;
+
+const int CU_FORMAT_WEBP = 2;
+
+const int CU_FORMAT_WEBP_LOSSLESS = 3;
+
+const int CU_MAX_CAPTURE_OUTPUTS = 16;
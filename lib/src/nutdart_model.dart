@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 // Basic geometry helpers ----------------------------------------------------
 class Point {
   final int x;
@@ -23,6 +25,236 @@ class Size {
   bool operator ==(Object other) => other is Size && other.width == width && other.height == height;
 }
 
+class Rect {
+  final int x;
+  final int y;
+  final int width;
+  final int height;
+  const Rect(this.x, this.y, this.width, this.height);
+  @override
+  String toString() => 'Rect($x, $y, $width, $height)';
+  @override
+  int get hashCode => Object.hash(x, y, width, height);
+  @override
+  bool operator ==(Object other) =>
+      other is Rect && other.x == x && other.y == y && other.width == width && other.height == height;
+}
+
+/// Regions of the screen that changed since a given frame sequence.
+class ScreenChanges {
+  /// Frame sequence these changes are current to; pass it to the next query.
+  final int sequence;
+  final List<Rect> rects;
+  const ScreenChanges(this.sequence, this.rects);
+  bool get isEmpty => rects.isEmpty;
+  @override
+  String toString() => 'ScreenChanges($sequence, $rects)';
+}
+
+/// How captures are scaled to fit `maxSmallDimension`/`maxLargeDimension`.
+/// Ignored on macOS, where ScreenCaptureKit does the scaling.
+enum ResizeFilter {
+  /// Fastest, but drops thin lines and text strokes when shrinking a lot.
+  bilinear,
+
+  /// Averages every pixel an output pixel covers; best for downscaling.
+  area,
+
+  /// Sharpest, and the slowest.
+  lanczos3;
+}
+
+/// A physical monitor, in screen coordinates.
+class Monitor {
+  final Rect bounds;
+  final bool primary;
+  const Monitor(this.bounds, {this.primary = false});
+  @override
+  String toString() => 'Monitor($bounds${primary ? ', primary' : ''})';
+  @override
+  int get hashCode => Object.hash(bounds, primary);
+  @override
+  bool operator ==(Object other) =>
+      other is Monitor && other.bounds == bounds && other.primary == primary;
+}
+
+/// JPEG of one monitor from [Screen.captureAllMonitors].
+class MonitorCapture {
+  final Monitor monitor;
+
+  /// Null if encoding this monitor failed.
+  final Uint8List? jpeg;
+  const MonitorCapture(this.monitor, this.jpeg);
+  @override
+  String toString() => 'MonitorCapture($monitor, ${jpeg?.length ?? 0} bytes)';
+}
+
+/// A JPEG encoded at the highest quality that fit a byte budget.
+class BudgetCapture {
+  final Uint8List jpeg;
+
+  /// The JPEG quality the encoder settled on.
+  final int quality;
+  const BudgetCapture(this.jpeg, this.quality);
+  @override
+  String toString() => 'BudgetCapture(${jpeg.length} bytes, quality $quality)';
+}
+
+/// Image formats for [Screen.captureOutputs].
+enum CaptureFormat {
+  jpeg,
+  png,
+  webp,
+
+  /// Lossless WebP; the spec's quality is the compression effort.
+  webpLossless;
+}
+
+/// One encoding requested from [Screen.captureOutputs].
+class CaptureOutputSpec {
+  final CaptureFormat format;
+  final int? maxSmallDimension;
+  final int? maxLargeDimension;
+
+  /// JPEG and WebP quality (0-100); compression effort for lossless WebP.
+  /// Unused for PNG.
+  final int quality;
+  final ResizeFilter filter;
+  const CaptureOutputSpec(
+    this.format, {
+    this.maxSmallDimension,
+    this.maxLargeDimension,
+    this.quality = 80,
+    this.filter = ResizeFilter.area,
+  });
+  @override
+  String toString() => 'CaptureOutputSpec(${format.name}, quality $quality)';
+}
+
+/// One image from [Screen.captureOutputs].
+class CaptureOutput {
+  final CaptureOutputSpec spec;
+
+  /// Null if this encoding failed (or isn't available, e.g. WebP without
+  /// libwebp, or JPEG on macOS).
+  final Uint8List? data;
+
+  /// Size of the image after resizing.
+  final int width;
+  final int height;
+  const CaptureOutput(this.spec, this.data, this.width, this.height);
+  @override
+  String toString() =>
+      'CaptureOutput(${spec.format.name}, ${width}x$height, ${data?.length ?? 0} bytes)';
+}
+
+/// Maps between screen coordinates and the coordinates of a [CapturePlan]'s
+/// images, pixel centre to pixel centre, e.g. to turn a point picked in a
+/// resized screenshot back into the screen point to click.
+class CoordinateTransform {
+  /// Image pixels per screen pixel.
+  final double scaleX;
+  final double scaleY;
+
+  /// Screen position of the captured region's top-left corner.
+  final double originX;
+  final double originY;
+  const CoordinateTransform(this.scaleX, this.scaleY, this.originX, this.originY);
+
+  /// The screen pixel nearest to the image point ([x], [y]).
+  Point toScreen(num x, num y) => Point(
+        ((x + 0.5) / scaleX - 0.5 + originX).round(),
+        ((y + 0.5) / scaleY - 0.5 + originY).round(),
+      );
+
+  /// The image pixel nearest to the screen point ([x], [y]).
+  Point toImage(num x, num y) => Point(
+        ((x - originX + 0.5) * scaleX - 0.5).round(),
+        ((y - originY + 0.5) * scaleY - 0.5).round(),
+      );
+  @override
+  String toString() => 'CoordinateTransform(scale $scaleX x $scaleY, origin $originX, $originY)';
+}
+
+/// Result of comparing a capture with the previous one given to a
+/// [FrameDiffer].
+class FrameChanges {
+  /// Changed tiles merged into bounding rectangles, relative to the capture.
+  final List<Rect> rects;
+
+  /// Area of the changed tiles, in pixels.
+  final int changedPixels;
+  const FrameChanges(this.rects, this.changedPixels);
+  bool get isEmpty => rects.isEmpty;
+  @override
+  String toString() => 'FrameChanges($rects, changedPixels: $changedPixels)';
+}
+
+/// Outcome of [Screen.waitUntilStable].
+class StableWait {
+  /// False if the timeout passed while the screen was still changing.
+  final bool stable;
+  final Duration elapsed;
+  const StableWait(this.stable, this.elapsed);
+  @override
+  String toString() => 'StableWait(stable: $stable, elapsed: $elapsed)';
+}
+
+/// A frame from a [CaptureSession].
+class SessionFrame {
+  /// 1 for the session's first frame, increasing by one per capture.
+  final int sequence;
+
+  /// Monotonic clock reading when the grab started.
+  final Duration timestamp;
+  final int width;
+  final int height;
+
+  /// Encoded frame, when the session encodes JPEG.
+  final Uint8List? jpeg;
+
+  /// Raw pixels (rows of [bytewidth] bytes), when the session doesn't.
+  final Uint8List? pixels;
+  final int bytewidth;
+  const SessionFrame(
+    this.sequence,
+    this.timestamp,
+    this.width,
+    this.height, {
+    this.jpeg,
+    this.pixels,
+    this.bytewidth = 0,
+  });
+  @override
+  String toString() => 'SessionFrame($sequence, ${width}x$height)';
+}
+
+/// Counters of a [CaptureSession].
+class CaptureSessionStats {
+  final int captured;
+
+  /// Frames overwritten before anyone took them.
+  final int dropped;
+
+  /// Capture ticks skipped because a grab overran the interval.
+  final int late;
+  final int failed;
+  const CaptureSessionStats(this.captured, this.dropped, this.late, this.failed);
+  @override
+  String toString() =>
+      'CaptureSessionStats(captured: $captured, dropped: $dropped, late: $late, failed: $failed)';
+}
+
+/// Hit/miss counters of the native JPEG capture cache.
+class CaptureCacheStats {
+  final int hits;
+  final int misses;
+  const CaptureCacheStats(this.hits, this.misses);
+  double get hitRate => hits + misses == 0 ? 0 : hits / (hits + misses);
+  @override
+  String toString() => 'CaptureCacheStats(hits: $hits, misses: $misses)';
+}
+
 class Color {
   final int r;
   final int g;
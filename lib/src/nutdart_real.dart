@@ -79,6 +79,31 @@ int _mouseButtonValue(MouseButton button) {
   }
 }
 
+// Helper to get the native value for a resize filter
+int _captureFormatValue(CaptureFormat format) {
+  switch (format) {
+    case CaptureFormat.jpeg:
+      return CU_FORMAT_JPEG;
+    case CaptureFormat.png:
+      return CU_FORMAT_PNG;
+    case CaptureFormat.webp:
+      return CU_FORMAT_WEBP;
+    case CaptureFormat.webpLossless:
+      return CU_FORMAT_WEBP_LOSSLESS;
+  }
+}
+
+int _resizeFilterValue(ResizeFilter filter) {
+  switch (filter) {
+    case ResizeFilter.bilinear:
+      return CU_RESIZE_BILINEAR;
+    case ResizeFilter.area:
+      return CU_RESIZE_AREA;
+    case ResizeFilter.lanczos3:
+      return CU_RESIZE_LANCZOS3;
+  }
+}
+
 /// Mouse operations
 class Mouse {
   Mouse._();
@@ -325,11 +350,14 @@ class Screen {
     return Size(size.width, size.height);
   }
 
-  /// Capture entire screen
+  /// Capture entire screen. With a dimension limit the capture is scaled
+  /// down with [filter] and returned as JPEG. On Wayland without
+  /// wlr-screencopy, grim does the scaling for the default [ResizeFilter.area].
   static Uint8List? capture({
     int? maxSmallDimension,
     int? maxLargeDimension,
     int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
   }) {
     _tryInit();
     if (_bindings == null) return null;
@@ -337,6 +365,7 @@ class Screen {
       maxSmallDimension: maxSmallDimension,
       maxLargeDimension: maxLargeDimension,
       quality: quality,
+      filter: filter,
     );
   }
 
@@ -349,6 +378,7 @@ class Screen {
     int? maxSmallDimension,
     int? maxLargeDimension,
     int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
   }) {
     _tryInit();
     if (_bindings == null) return null;
@@ -360,9 +390,530 @@ class Screen {
       maxSmallDimension: maxSmallDimension,
       maxLargeDimension: maxLargeDimension,
       quality: quality,
+      filter: filter,
+    );
+  }
+
+  /// Capture [region] (default: the whole screen) as raw pixels without
+  /// copying them into Dart: the frame's [CapturedFrame.pixels] is a view of
+  /// the native capture. Null on failure, and on macOS when ScreenCaptureKit
+  /// and the fallback both fail.
+  static CapturedFrame? captureFrame({Rect? region}) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final bitmap = region != null
+        ? _bindings!.cu_screen_capture_region(region.x, region.y, region.width, region.height)
+        : _bindings!.cu_screen_capture_full();
+    return CapturedFrame._wrap(bitmap);
+  }
+
+  // Serves captureInto. Dart statics are per isolate, so it is never used
+  // from two threads at once; it lives as long as the isolate.
+  static JpegEncoder? _intoEncoder;
+
+  /// Capture [region] (default: the whole screen) as JPEG into [buffer],
+  /// resized like [capture]. Returns a view of the buffer (see
+  /// [JpegBuffer.bytes]), or null on failure. A frame that doesn't fit grows
+  /// the buffer and is copied in without capturing again. Like
+  /// [JpegEncoder.captureInto], which this uses, it skips the capture cache.
+  static Uint8List? captureInto(
+    JpegBuffer buffer, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final encoder = _intoEncoder ??= JpegEncoder.create();
+    return encoder?.captureInto(
+      buffer,
+      region: region,
+      maxSmallDimension: maxSmallDimension,
+      maxLargeDimension: maxLargeDimension,
+      quality: quality,
+      filter: filter,
+    );
+  }
+
+  /// Capture [region] (default: the whole screen) as JPEG, resized like
+  /// [capture], at the highest quality that keeps it within [maxBytes]. The
+  /// quality is found with at most three encodes of the resized frame, and
+  /// a model of earlier frames usually makes the first one close. Null if
+  /// nothing fits even at quality 10, and always on macOS.
+  static BudgetCapture? captureWithinBudget(
+    int maxBytes, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final qualityPtr = ffi.malloc<Int32>();
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final jpegPtr = region == null
+          ? _bindings!.cu_screen_capture_full_jpeg_budget(
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              maxBytes,
+              _resizeFilterValue(filter),
+              qualityPtr,
+              sizePtr,
+            )
+          : _bindings!.cu_screen_capture_region_jpeg_budget(
+              region.x,
+              region.y,
+              region.width,
+              region.height,
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              maxBytes,
+              _resizeFilterValue(filter),
+              qualityPtr,
+              sizePtr,
+            );
+      if (jpegPtr == nullptr) return null;
+      final data = Uint8List.fromList(jpegPtr.asTypedList(sizePtr.value));
+      _bindings!.cu_screen_free_jpeg(jpegPtr);
+      return BudgetCapture(data, qualityPtr.value);
+    } finally {
+      ffi.malloc.free(qualityPtr);
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  /// Capture [region] (default: the whole screen) as a lossless PNG, resized
+  /// like [capture]. Text stays sharp, and frames of at most 256 colours
+  /// (terminals, most UI) come out as small palette images; photographic
+  /// content is better sent as JPEG.
+  static Uint8List? capturePng({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final pngPtr = region == null
+          ? _bindings!.cu_screen_capture_full_png(
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              _resizeFilterValue(filter),
+              sizePtr,
+            )
+          : _bindings!.cu_screen_capture_region_png(
+              region.x,
+              region.y,
+              region.width,
+              region.height,
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              _resizeFilterValue(filter),
+              sizePtr,
+            );
+      if (pngPtr == nullptr) return null;
+      final data = Uint8List.fromList(pngPtr.asTypedList(sizePtr.value));
+      _bindings!.cu_screen_free_png(pngPtr);
+      return data;
+    } finally {
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  /// Whether this build can encode WebP (it needs libwebp when the native
+  /// library is built). Without it [captureWebp] returns null.
+  static bool get isWebpAvailable {
+    _tryInit();
+    if (_bindings == null) return false;
+    return _bindings!.cu_screen_webp_available() != 0;
+  }
+
+  /// Capture [region] (default: the whole screen) as WebP, resized like
+  /// [capture]. Lossy WebP is typically a fifth smaller than a JPEG of the
+  /// same [quality], at a much higher encode cost. With [lossless], [quality]
+  /// is the compression effort instead (0 fastest, 100 smallest). Returns
+  /// null if WebP is not available (see [isWebpAvailable]).
+  static Uint8List? captureWebp({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    bool lossless = false,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final webpPtr = region == null
+          ? _bindings!.cu_screen_capture_full_webp(
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              quality,
+              lossless ? 1 : 0,
+              _resizeFilterValue(filter),
+              sizePtr,
+            )
+          : _bindings!.cu_screen_capture_region_webp(
+              region.x,
+              region.y,
+              region.width,
+              region.height,
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              quality,
+              lossless ? 1 : 0,
+              _resizeFilterValue(filter),
+              sizePtr,
+            );
+      if (webpPtr == nullptr) return null;
+      final data = Uint8List.fromList(webpPtr.asTypedList(sizePtr.value));
+      _bindings!.cu_screen_free_webp(webpPtr);
+      return data;
+    } finally {
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  /// Grab [region] (default: the whole screen) once and encode it once per
+  /// spec, e.g. a full-size lossless image for a log and a small JPEG for a
+  /// model, both of the same moment. Sizes are resized once each, from the
+  /// nearest larger one, and the encodes run in parallel. At most
+  /// [maxCaptureOutputs] specs are encoded; any more come back empty.
+  /// Returns null if the grab failed.
+  static List<CaptureOutput>? captureOutputs(
+    List<CaptureOutputSpec> specs, {
+    Rect? region,
+  }) {
+    _tryInit();
+    if (_bindings == null || specs.isEmpty) return null;
+    final outputsPtr = ffi.malloc<CUCaptureOutput>(specs.length);
+    try {
+      for (var i = 0; i < specs.length; i++) {
+        final spec = specs[i];
+        outputsPtr[i]
+          ..format = _captureFormatValue(spec.format)
+          ..maxSmallDim = spec.maxSmallDimension ?? -1
+          ..maxLargeDim = spec.maxLargeDimension ?? -1
+          ..quality = spec.quality
+          ..filter = _resizeFilterValue(spec.filter);
+      }
+      final encoded = region == null
+          ? _bindings!.cu_screen_capture_full_multi(outputsPtr, specs.length)
+          : _bindings!.cu_screen_capture_region_multi(
+              region.x,
+              region.y,
+              region.width,
+              region.height,
+              outputsPtr,
+              specs.length,
+            );
+      if (encoded < 0) return null;
+      final outputs = <CaptureOutput>[];
+      for (var i = 0; i < specs.length; i++) {
+        final output = outputsPtr[i];
+        outputs.add(
+          CaptureOutput(
+            specs[i],
+            output.data == nullptr
+                ? null
+                : Uint8List.fromList(output.data.asTypedList(output.size)),
+            output.width,
+            output.height,
+          ),
+        );
+      }
+      _bindings!.cu_screen_free_outputs(outputsPtr, specs.length);
+      return outputs;
+    } finally {
+      ffi.malloc.free(outputsPtr);
+    }
+  }
+
+  /// Most specs [captureOutputs] encodes in one call.
+  static const int maxCaptureOutputs = CU_MAX_CAPTURE_OUTPUTS;
+
+  /// Capture [region] (default: the whole screen) in [format] and return it
+  /// as base64, ready for a JSON request, or as a `data:` URI with
+  /// [dataUri]. The base64 is written natively with SIMD, so the image is
+  /// never copied into Dart or encoded on this isolate; only the final
+  /// string is. Other parameters work as for [capture], [capturePng] and
+  /// [captureWebp]; [quality] is ignored for PNG. Except on macOS, JPEG is
+  /// encoded like [JpegEncoder.capture], so it skips the capture cache.
+  static String? captureBase64({
+    Rect? region,
+    CaptureFormat format = CaptureFormat.jpeg,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+    bool dataUri = false,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final lengthPtr = ffi.malloc<Int64>();
+    try {
+      final base64Ptr = region == null
+          ? _bindings!.cu_screen_capture_full_base64(
+              _captureFormatValue(format),
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              quality,
+              _resizeFilterValue(filter),
+              dataUri ? 1 : 0,
+              lengthPtr,
+            )
+          : _bindings!.cu_screen_capture_region_base64(
+              region.x,
+              region.y,
+              region.width,
+              region.height,
+              _captureFormatValue(format),
+              maxSmallDimension ?? -1,
+              maxLargeDimension ?? -1,
+              quality,
+              _resizeFilterValue(filter),
+              dataUri ? 1 : 0,
+              lengthPtr,
+            );
+      if (base64Ptr == nullptr) return null;
+      // Base64 is ASCII, so each byte is one code unit
+      final text = String.fromCharCodes(
+        base64Ptr.cast<Uint8>().asTypedList(lengthPtr.value),
+      );
+      _bindings!.cu_screen_free_base64(base64Ptr);
+      return text;
+    } finally {
+      ffi.malloc.free(lengthPtr);
+    }
+  }
+
+  /// Monitors, primary first.
+  static List<Monitor> getMonitors() {
+    _tryInit();
+    if (_bindings == null) return const [];
+    const maxMonitors = 16;
+    final monitorsPtr = ffi.malloc<CUMonitor>(maxMonitors);
+    try {
+      final count = _bindings!.cu_screen_get_monitors(monitorsPtr, maxMonitors);
+      return [
+        for (var i = 0; i < count && i < maxMonitors; i++)
+          Monitor(
+            Rect(
+              monitorsPtr[i].x,
+              monitorsPtr[i].y,
+              monitorsPtr[i].width,
+              monitorsPtr[i].height,
+            ),
+            primary: monitorsPtr[i].primary != 0,
+          ),
+      ];
+    } finally {
+      ffi.malloc.free(monitorsPtr);
+    }
+  }
+
+  /// Capture one monitor, by index into [getMonitors].
+  static Uint8List? captureMonitor(
+    int index, {
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    final monitors = getMonitors();
+    if (index < 0 || index >= monitors.length) return null;
+    final bounds = monitors[index].bounds;
+    return captureRegion(
+      bounds.x,
+      bounds.y,
+      bounds.width,
+      bounds.height,
+      maxSmallDimension: maxSmallDimension,
+      maxLargeDimension: maxLargeDimension,
+      quality: quality,
+      filter: filter,
     );
   }
 
+  /// Capture every monitor as its own JPEG. The screen is grabbed once and
+  /// the monitors are encoded in parallel on native threads.
+  static List<MonitorCapture> captureAllMonitors({
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return const [];
+    const maxMonitors = 16;
+    final resultsPtr = ffi.malloc<CUMonitorJpeg>(maxMonitors);
+    try {
+      final count = _bindings!.cu_screen_capture_all_monitors_jpeg(
+        resultsPtr,
+        maxMonitors,
+        maxSmallDimension ?? -1,
+        maxLargeDimension ?? -1,
+        quality,
+        _resizeFilterValue(filter),
+      );
+      final captures = <MonitorCapture>[];
+      for (var i = 0; i < count; i++) {
+        final result = resultsPtr[i];
+        final m = result.monitor;
+        Uint8List? jpeg;
+        if (result.jpeg != nullptr) {
+          jpeg = Uint8List.fromList(result.jpeg.asTypedList(result.size));
+          _bindings!.cu_screen_free_jpeg(result.jpeg);
+        }
+        captures.add(
+          MonitorCapture(
+            Monitor(Rect(m.x, m.y, m.width, m.height), primary: m.primary != 0),
+            jpeg,
+          ),
+        );
+      }
+      return captures;
+    } finally {
+      ffi.malloc.free(resultsPtr);
+    }
+  }
+
+  /// Enable or disable the native JPEG capture cache (Linux, on by default).
+  ///
+  /// While enabled, a repeated JPEG capture with the same region and
+  /// encoding parameters returns the previous bytes if the screen hasn't
+  /// changed, without re-encoding.
+  static void setCaptureCacheEnabled(bool enabled) {
+    _tryInit();
+    _bindings?.cu_screen_jpeg_cache_set_enabled(enabled ? 1 : 0);
+  }
+
+  /// Drop cached captures and reset the cache counters.
+  static void clearCaptureCache() {
+    _tryInit();
+    _bindings?.cu_screen_jpeg_cache_clear();
+  }
+
+  /// Hit/miss counters of the JPEG capture cache.
+  static CaptureCacheStats get captureCacheStats {
+    _tryInit();
+    if (_bindings == null) return const CaptureCacheStats(0, 0);
+    final hitsPtr = ffi.malloc<Int64>();
+    final missesPtr = ffi.malloc<Int64>();
+    try {
+      _bindings!.cu_screen_jpeg_cache_get_stats(hitsPtr, missesPtr);
+      return CaptureCacheStats(hitsPtr.value, missesPtr.value);
+    } finally {
+      ffi.malloc.free(hitsPtr);
+      ffi.malloc.free(missesPtr);
+    }
+  }
+
+  /// Threads that resize and encode one JPEG capture (Linux). 1, the
+  /// default, keeps the work on the calling thread; 0 uses one per CPU core.
+  static int get encodeThreads {
+    _tryInit();
+    return _bindings?.cu_screen_jpeg_get_threads() ?? 1;
+  }
+
+  static set encodeThreads(int threads) {
+    _tryInit();
+    _bindings?.cu_screen_jpeg_set_threads(threads);
+  }
+
+  /// Start tracking which parts of the screen change (X11 only).
+  ///
+  /// Returns false where tracking is unavailable; callers should then treat
+  /// every capture as changed.
+  static bool startChangeTracking() {
+    _tryInit();
+    if (_bindings == null) return false;
+    return _bindings!.cu_screen_damage_start() != 0;
+  }
+
+  /// Stop tracking screen changes.
+  static void stopChangeTracking() {
+    _tryInit();
+    _bindings?.cu_screen_damage_stop();
+  }
+
+  /// Current frame sequence number, or null if not tracking.
+  static int? get frameSequence {
+    _tryInit();
+    if (_bindings == null) return null;
+    final sequence = _bindings!.cu_screen_get_frame_sequence();
+    return sequence < 0 ? null : sequence;
+  }
+
+  /// Regions changed after frame [sequence], merged into at most [maxRects]
+  /// rectangles. Empty when nothing changed; null if not tracking.
+  static ScreenChanges? changesSince(int sequence, {int maxRects = 16}) {
+    _tryInit();
+    if (_bindings == null || maxRects <= 0) return null;
+    final rectsPtr = ffi.malloc<CURect>(maxRects);
+    final sequencePtr = ffi.malloc<Int64>();
+    try {
+      final count = _bindings!.cu_screen_get_dirty_rects(
+        sequence,
+        rectsPtr,
+        maxRects,
+        sequencePtr,
+      );
+      if (count < 0) return null;
+      final rects = <Rect>[
+        for (var i = 0; i < count; i++)
+          Rect(
+            rectsPtr[i].x,
+            rectsPtr[i].y,
+            rectsPtr[i].width,
+            rectsPtr[i].height,
+          ),
+      ];
+      return ScreenChanges(sequencePtr.value, rects);
+    } finally {
+      ffi.malloc.free(rectsPtr);
+      ffi.malloc.free(sequencePtr);
+    }
+  }
+
+  /// Block until nothing in [region] (default: the whole screen) has changed
+  /// for [quiet], or [timeout] passes. Use after an action instead of a fixed
+  /// sleep before capturing.
+  ///
+  /// Cheapest while change tracking is running ([startChangeTracking]);
+  /// otherwise the region is captured and compared repeatedly. Null if the
+  /// region can't be captured.
+  static StableWait? waitUntilStable({
+    Rect? region,
+    Duration quiet = const Duration(milliseconds: 150),
+    Duration timeout = const Duration(seconds: 3),
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final elapsedPtr = ffi.malloc<Int64>();
+    try {
+      final result = _bindings!.cu_screen_wait_stable(
+        region?.x ?? 0,
+        region?.y ?? 0,
+        region?.width ?? 0,
+        region?.height ?? 0,
+        quiet.inMilliseconds,
+        timeout.inMilliseconds,
+        elapsedPtr,
+      );
+      if (result < 0) return null;
+      return StableWait(result == 1, Duration(milliseconds: elapsedPtr.value));
+    } finally {
+      ffi.malloc.free(elapsedPtr);
+    }
+  }
+
   static Uint8List? _captureScreen({
     int? x,
     int? y,
@@ -371,6 +922,7 @@ class Screen {
     int? maxSmallDimension,
     int? maxLargeDimension,
     int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
   }) {
     if (_bindings == null) return null;
 
@@ -389,6 +941,7 @@ class Screen {
             maxSmallDimension ?? -1,
             maxLargeDimension ?? -1,
             quality,
+            _resizeFilterValue(filter),
             sizePtr,
           );
         } else {
@@ -396,6 +949,7 @@ class Screen {
             maxSmallDimension ?? -1,
             maxLargeDimension ?? -1,
             quality,
+            _resizeFilterValue(filter),
             sizePtr,
           );
         }
@@ -438,6 +992,505 @@ class Screen {
   }
 }
 
+/// Tells which parts of the screen changed between captures by comparing
+/// per-tile hashes. Unlike [Screen.changesSince] this works on every
+/// platform, at the cost of capturing each time.
+///
+/// Each differ remembers only the last frame it was given; keep one per
+/// region being watched and call [dispose] when done.
+class FrameDiffer {
+  Pointer<CUFrameDiffer> _differ = nullptr;
+
+  FrameDiffer({int tileSize = 32}) {
+    _tryInit();
+    if (_bindings != null) {
+      _differ = _bindings!.cu_frame_differ_create(tileSize);
+    }
+  }
+
+  /// Capture a region and compare it with the previous capture. The first
+  /// call reports the whole region. Null if capture failed.
+  FrameChanges? captureRegion(
+    int x,
+    int y,
+    int width,
+    int height, {
+    int maxRects = 16,
+  }) {
+    return _diff(
+      maxRects,
+      (rects, changedPixels) => _bindings!.cu_frame_differ_capture_region(
+        _differ,
+        x,
+        y,
+        width,
+        height,
+        rects,
+        maxRects,
+        changedPixels,
+      ),
+    );
+  }
+
+  /// Capture the entire screen and compare it with the previous capture.
+  FrameChanges? capture({int maxRects = 16}) {
+    return _diff(
+      maxRects,
+      (rects, changedPixels) => _bindings!.cu_frame_differ_capture_full(
+        _differ,
+        rects,
+        maxRects,
+        changedPixels,
+      ),
+    );
+  }
+
+  /// Forget the previous capture.
+  void reset() {
+    if (_differ != nullptr) _bindings!.cu_frame_differ_reset(_differ);
+  }
+
+  void dispose() {
+    if (_differ == nullptr) return;
+    _bindings!.cu_frame_differ_destroy(_differ);
+    _differ = nullptr;
+  }
+
+  FrameChanges? _diff(
+    int maxRects,
+    int Function(Pointer<CURect> rects, Pointer<Int64> changedPixels) call,
+  ) {
+    if (_differ == nullptr || maxRects <= 0) return null;
+    final rectsPtr = ffi.malloc<CURect>(maxRects);
+    final pixelsPtr = ffi.malloc<Int64>();
+    try {
+      final count = call(rectsPtr, pixelsPtr);
+      if (count < 0) return null;
+      final rects = <Rect>[
+        for (var i = 0; i < count; i++)
+          Rect(
+            rectsPtr[i].x,
+            rectsPtr[i].y,
+            rectsPtr[i].width,
+            rectsPtr[i].height,
+          ),
+      ];
+      return FrameChanges(rects, pixelsPtr.value);
+    } finally {
+      ffi.malloc.free(rectsPtr);
+      ffi.malloc.free(pixelsPtr);
+    }
+  }
+}
+
+/// Captures a region continuously on a native thread. The newest frame is
+/// always ready, so taking a screenshot costs a copy instead of a grab and
+/// an encode. Call [stop] when done.
+class CaptureSession {
+  Pointer<CUCaptureSession> _session;
+  final bool _encodeJpeg;
+  int _lastSequence = 0;
+
+  CaptureSession._(this._session, this._encodeJpeg);
+
+  /// Start capturing [region] (default: the whole screen) every [interval].
+  /// With [encodeJpeg] each frame is also JPEG-encoded using the same
+  /// resizing options as [Screen.capture]. Null if the session can't start,
+  /// which includes sessions with [encodeJpeg] on macOS.
+  static CaptureSession? start({
+    Rect? region,
+    Duration interval = const Duration(milliseconds: 100),
+    int ringSize = 4,
+    bool encodeJpeg = true,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final config = ffi.calloc<CUCaptureSessionConfig>();
+    try {
+      config.ref
+        ..x = region?.x ?? 0
+        ..y = region?.y ?? 0
+        ..width = region?.width ?? 0
+        ..height = region?.height ?? 0
+        ..intervalMs = interval.inMilliseconds
+        ..ringSize = ringSize
+        ..encodeJpeg = encodeJpeg ? 1 : 0
+        ..maxSmallDim = maxSmallDimension ?? -1
+        ..maxLargeDim = maxLargeDimension ?? -1
+        ..quality = quality
+        ..filter = _resizeFilterValue(filter);
+      final session = _bindings!.cu_capture_session_start(config);
+      if (session == nullptr) return null;
+      return CaptureSession._(session, encodeJpeg);
+    } finally {
+      ffi.calloc.free(config);
+    }
+  }
+
+  /// The newest frame, or null if none has been captured yet.
+  SessionFrame? latest() {
+    if (_session == nullptr) return null;
+    return _take(_bindings!.cu_capture_session_latest(_session));
+  }
+
+  /// The first frame newer than [after] (default: the last frame returned),
+  /// waiting up to [timeout] for it.
+  SessionFrame? next({int? after, Duration timeout = const Duration(seconds: 1)}) {
+    if (_session == nullptr) return null;
+    return _take(
+      _bindings!.cu_capture_session_next(
+        _session,
+        after ?? _lastSequence,
+        timeout.inMilliseconds,
+      ),
+    );
+  }
+
+  CaptureSessionStats get stats {
+    if (_session == nullptr) return const CaptureSessionStats(0, 0, 0, 0);
+    final statsPtr = ffi.calloc<CUCaptureSessionStats>();
+    try {
+      _bindings!.cu_capture_session_get_stats(_session, statsPtr);
+      final s = statsPtr.ref;
+      return CaptureSessionStats(s.captured, s.dropped, s.late, s.failed);
+    } finally {
+      ffi.calloc.free(statsPtr);
+    }
+  }
+
+  void stop() {
+    if (_session == nullptr) return;
+    _bindings!.cu_capture_session_stop(_session);
+    _session = nullptr;
+  }
+
+  // Copies the borrowed frame into Dart memory and hands it back at once.
+  SessionFrame? _take(Pointer<CUCaptureFrame> framePtr) {
+    if (framePtr == nullptr) return null;
+    try {
+      final frame = framePtr.ref;
+      final bitmap = frame.bitmap;
+      _lastSequence = frame.sequence;
+      if (_encodeJpeg) {
+        return SessionFrame(
+          frame.sequence,
+          Duration(microseconds: frame.timestampUs),
+          bitmap.width,
+          bitmap.height,
+          jpeg: Uint8List.fromList(frame.jpeg.asTypedList(frame.jpegSize)),
+        );
+      }
+      final size = bitmap.bytewidth * bitmap.height;
+      return SessionFrame(
+        frame.sequence,
+        Duration(microseconds: frame.timestampUs),
+        bitmap.width,
+        bitmap.height,
+        pixels: Uint8List.fromList(bitmap.data.asTypedList(size)),
+        bytewidth: bitmap.bytewidth,
+      );
+    } finally {
+      _bindings!.cu_capture_session_release_frame(_session, framePtr);
+    }
+  }
+}
+
+/// Native memory that JPEG captures are written into, so a capture loop can
+/// reuse one buffer instead of allocating per frame. Grows when a capture
+/// doesn't fit. Call [dispose] when done.
+class JpegBuffer {
+  Pointer<Uint8> _data;
+  int _capacity;
+  int _length = 0;
+
+  JpegBuffer([int capacity = 512 * 1024])
+      : _capacity = capacity > 0 ? capacity : 1,
+        _data = ffi.malloc<Uint8>(capacity > 0 ? capacity : 1);
+
+  int get capacity => _capacity;
+
+  /// The last capture written here, as a view of the native memory. Valid
+  /// until the next capture into this buffer or [dispose]; copy it to keep it.
+  Uint8List get bytes => _data == nullptr ? Uint8List(0) : _data.asTypedList(_length);
+
+  // Makes room for at least [size] bytes, with headroom for the next frames
+  void _reserve(int size) {
+    if (size <= _capacity) return;
+    ffi.malloc.free(_data);
+    _capacity = size + size ~/ 4;
+    _data = ffi.malloc<Uint8>(_capacity);
+    _length = 0;
+  }
+
+  void dispose() {
+    if (_data == nullptr) return;
+    ffi.malloc.free(_data);
+    _data = nullptr;
+    _capacity = 0;
+    _length = 0;
+  }
+}
+
+// Frees a CUBitmap whose CapturedFrame was garbage collected undisposed
+final NativeFinalizer _captureFinalizer =
+    NativeFinalizer(_dylib!.lookup<NativeFinalizerFunction>('cu_screen_free_capture'));
+
+/// A raw screen capture whose pixels stay in native memory. Reading
+/// [pixels] makes no copy, which matters for large frames: a 4K frame is
+/// 33 MB. The native memory is released by [dispose], or by a finalizer once
+/// the frame is garbage collected.
+///
+/// [pixels] is only valid while the frame is reachable and not disposed;
+/// keep the frame, not just the view, and copy the view to keep the pixels
+/// longer.
+class CapturedFrame implements Finalizable {
+  Pointer<CUBitmap> _bitmap;
+  Uint8List _pixels;
+
+  final int width;
+  final int height;
+
+  /// Bytes from the start of one row to the next, at least
+  /// `width * bytesPerPixel`.
+  final int bytesPerRow;
+  final int bitsPerPixel;
+  final int bytesPerPixel;
+
+  CapturedFrame._(this._bitmap, this._pixels, this.width, this.height, this.bytesPerRow,
+      this.bitsPerPixel, this.bytesPerPixel);
+
+  static CapturedFrame? _wrap(Pointer<CUBitmap> bitmap) {
+    if (bitmap == nullptr) return null;
+    final ref = bitmap.ref;
+    final length = ref.bytewidth * ref.height;
+    final frame = CapturedFrame._(bitmap, ref.data.asTypedList(length), ref.width, ref.height,
+        ref.bytewidth, ref.bitsPerPixel, ref.bytesPerPixel);
+    // externalSize lets the GC weigh the native frame it keeps alive
+    _captureFinalizer.attach(frame, bitmap.cast(), detach: frame, externalSize: length);
+    return frame;
+  }
+
+  /// The pixels, [bytesPerRow] bytes per row from the top, each pixel in
+  /// the capture's native order (B, G, R, then padding or alpha for 32-bit
+  /// pixels). Empty once disposed.
+  Uint8List get pixels => _pixels;
+
+  bool get isDisposed => _bitmap == nullptr;
+
+  /// Releases the native memory now instead of at garbage collection.
+  void dispose() {
+    if (_bitmap == nullptr) return;
+    _captureFinalizer.detach(this);
+    _bindings!.cu_screen_free_capture(_bitmap);
+    _bitmap = nullptr;
+    _pixels = Uint8List(0);
+  }
+}
+
+/// Captures JPEG screenshots with native encoder state (compressor, tables,
+/// capture and output buffers) kept from one capture to the next, so a
+/// long-running capture loop makes no large native allocations per
+/// screenshot. Skips the capture cache. Call [dispose] when done.
+class JpegEncoder {
+  Pointer<CUJpegEncoder> _encoder;
+
+  JpegEncoder._(this._encoder);
+
+  /// Null if no encoder can be created.
+  static JpegEncoder? create() {
+    _tryInit();
+    if (_bindings == null) return null;
+    final encoder = _bindings!.cu_jpeg_encoder_create();
+    if (encoder == nullptr) return null;
+    return JpegEncoder._(encoder);
+  }
+
+  /// Capture [region] (default: the whole screen) as JPEG, resized like
+  /// [Screen.capture].
+  Uint8List? capture({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    if (_encoder == nullptr) return null;
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final jpegPtr = _bindings!.cu_jpeg_encoder_capture_region(
+        _encoder,
+        region?.x ?? 0,
+        region?.y ?? 0,
+        region?.width ?? 0,
+        region?.height ?? 0,
+        maxSmallDimension ?? -1,
+        maxLargeDimension ?? -1,
+        quality,
+        _resizeFilterValue(filter),
+        sizePtr,
+      );
+      if (jpegPtr == nullptr) return null;
+      // The native bytes are reused by the next capture
+      return Uint8List.fromList(jpegPtr.asTypedList(sizePtr.value));
+    } finally {
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  /// Same as [capture], but the JPEG is written straight into [buffer], which
+  /// grows if it's too small. Returns a view of the buffer (see
+  /// [JpegBuffer.bytes]), or null on failure.
+  Uint8List? captureInto(
+    JpegBuffer buffer, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    if (_encoder == nullptr || buffer._data == nullptr) return null;
+    var size = _bindings!.cu_jpeg_encoder_capture_region_into(
+      _encoder,
+      region?.x ?? 0,
+      region?.y ?? 0,
+      region?.width ?? 0,
+      region?.height ?? 0,
+      maxSmallDimension ?? -1,
+      maxLargeDimension ?? -1,
+      quality,
+      _resizeFilterValue(filter),
+      buffer._data,
+      buffer._capacity,
+    );
+    if (size > buffer._capacity) {
+      // The encoder kept the JPEG; fetch it once there's room
+      buffer._reserve(size);
+      size = _bindings!.cu_jpeg_encoder_copy_last(_encoder, buffer._data, buffer._capacity);
+    }
+    if (size < 0 || size > buffer._capacity) return null;
+    buffer._length = size;
+    return buffer.bytes;
+  }
+
+  /// Same as [Screen.captureWithinBudget], but guided by this encoder's
+  /// earlier frames only, which suits one steady stream of similar frames.
+  BudgetCapture? captureWithinBudget(
+    int maxBytes, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    if (_encoder == nullptr) return null;
+    final qualityPtr = ffi.malloc<Int32>();
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final jpegPtr = _bindings!.cu_jpeg_encoder_capture_region_budget(
+        _encoder,
+        region?.x ?? 0,
+        region?.y ?? 0,
+        region?.width ?? 0,
+        region?.height ?? 0,
+        maxSmallDimension ?? -1,
+        maxLargeDimension ?? -1,
+        maxBytes,
+        _resizeFilterValue(filter),
+        qualityPtr,
+        sizePtr,
+      );
+      if (jpegPtr == nullptr) return null;
+      // The native bytes are reused by the next capture
+      return BudgetCapture(Uint8List.fromList(jpegPtr.asTypedList(sizePtr.value)), qualityPtr.value);
+    } finally {
+      ffi.malloc.free(qualityPtr);
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  void dispose() {
+    if (_encoder == nullptr) return;
+    _bindings!.cu_jpeg_encoder_destroy(_encoder);
+    _encoder = nullptr;
+  }
+}
+
+/// Repeated captures of one region at one fixed image size. The image size,
+/// the resize weight tables and the [transform] between screen and image
+/// coordinates are worked out once when the plan is created, and capture
+/// buffers are kept from one frame to the next. Call [dispose] when done.
+class CapturePlan {
+  Pointer<CUCapturePlan> _plan;
+
+  /// Size of every image this plan captures.
+  final Size imageSize;
+
+  /// Maps points in this plan's images back to the screen, and vice versa.
+  final CoordinateTransform transform;
+
+  CapturePlan._(this._plan, this.imageSize, this.transform);
+
+  /// Plans captures of [region] (default: the whole screen), resized like
+  /// [Screen.capture]. The image size follows from the region's size in
+  /// screen coordinates. Null if no plan can be created.
+  static CapturePlan? create({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) {
+    _tryInit();
+    if (_bindings == null) return null;
+    final plan = _bindings!.cu_capture_plan_create(
+      region?.x ?? 0,
+      region?.y ?? 0,
+      region?.width ?? 0,
+      region?.height ?? 0,
+      maxSmallDimension ?? -1,
+      maxLargeDimension ?? -1,
+      _resizeFilterValue(filter),
+    );
+    if (plan == nullptr) return null;
+    final size = _bindings!.cu_capture_plan_get_image_size(plan);
+    final transform = _bindings!.cu_capture_plan_get_transform(plan);
+    return CapturePlan._(
+      plan,
+      Size(size.width, size.height),
+      CoordinateTransform(transform.scaleX, transform.scaleY, transform.originX, transform.originY),
+    );
+  }
+
+  /// Capture one frame as [format]. [quality] is unused for PNG, and the
+  /// compression effort for lossless WebP. Null on failure, or if the format
+  /// isn't available (WebP without libwebp, JPEG on macOS).
+  Uint8List? capture({CaptureFormat format = CaptureFormat.jpeg, int quality = 80}) {
+    if (_plan == nullptr) return null;
+    final sizePtr = ffi.malloc<Int64>();
+    try {
+      final data = _bindings!.cu_capture_plan_capture(
+        _plan,
+        _captureFormatValue(format),
+        quality,
+        sizePtr,
+      );
+      if (data == nullptr) return null;
+      // The native bytes are reused by the next capture
+      return Uint8List.fromList(data.asTypedList(sizePtr.value));
+    } finally {
+      ffi.malloc.free(sizePtr);
+    }
+  }
+
+  void dispose() {
+    if (_plan == nullptr) return;
+    _bindings!.cu_capture_plan_destroy(_plan);
+    _plan = nullptr;
+  }
+}
+
 /// Utility functions
 class ComputerUse {
   ComputerUse._();
@@ -57,10 +57,179 @@ class Keyboard {
 class Screen {
   Screen._();
   static Size getSize() => const Size(0, 0);
-  static Uint8List? capture({int? maxSmallDimension, int? maxLargeDimension, int quality = 80}) => null;
+  static Uint8List? capture(
+          {int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
   static Uint8List? captureRegion(int x, int y, int width, int height,
-          {int? maxSmallDimension, int? maxLargeDimension, int quality = 80}) =>
+          {int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static CapturedFrame? captureFrame({Rect? region}) => null;
+  static void setCaptureCacheEnabled(bool enabled) {}
+  static void clearCaptureCache() {}
+  static CaptureCacheStats get captureCacheStats => const CaptureCacheStats(0, 0);
+  static int get encodeThreads => 1;
+  static set encodeThreads(int threads) {}
+  static bool startChangeTracking() => false;
+  static void stopChangeTracking() {}
+  static int? get frameSequence => null;
+  static ScreenChanges? changesSince(int sequence, {int maxRects = 16}) => null;
+  static Uint8List? captureInto(JpegBuffer buffer,
+          {Rect? region,
+          int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static BudgetCapture? captureWithinBudget(int maxBytes,
+          {Rect? region,
+          int? maxSmallDimension,
+          int? maxLargeDimension,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static Uint8List? capturePng(
+          {Rect? region,
+          int? maxSmallDimension,
+          int? maxLargeDimension,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static bool get isWebpAvailable => false;
+  static Uint8List? captureWebp(
+          {Rect? region,
+          int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          bool lossless = false,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static List<CaptureOutput>? captureOutputs(List<CaptureOutputSpec> specs,
+          {Rect? region}) =>
+      null;
+  static const int maxCaptureOutputs = 16;
+  static String? captureBase64(
+          {Rect? region,
+          CaptureFormat format = CaptureFormat.jpeg,
+          int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area,
+          bool dataUri = false}) =>
+      null;
+  static List<Monitor> getMonitors() => const [];
+  static Uint8List? captureMonitor(int index,
+          {int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      null;
+  static List<MonitorCapture> captureAllMonitors(
+          {int? maxSmallDimension,
+          int? maxLargeDimension,
+          int quality = 80,
+          ResizeFilter filter = ResizeFilter.area}) =>
+      const [];
+  static StableWait? waitUntilStable(
+          {Rect? region,
+          Duration quiet = const Duration(milliseconds: 150),
+          Duration timeout = const Duration(seconds: 3)}) =>
+      null;
+}
+
+class FrameDiffer {
+  FrameDiffer({int tileSize = 32});
+  FrameChanges? captureRegion(int x, int y, int width, int height, {int maxRects = 16}) => null;
+  FrameChanges? capture({int maxRects = 16}) => null;
+  void reset() {}
+  void dispose() {}
+}
+
+class CaptureSession {
+  CaptureSession._();
+  static CaptureSession? start({
+    Rect? region,
+    Duration interval = const Duration(milliseconds: 100),
+    int ringSize = 4,
+    bool encodeJpeg = true,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) =>
+      null;
+  SessionFrame? latest() => null;
+  SessionFrame? next({int? after, Duration timeout = const Duration(seconds: 1)}) => null;
+  CaptureSessionStats get stats => const CaptureSessionStats(0, 0, 0, 0);
+  void stop() {}
+}
+
+class JpegBuffer {
+  JpegBuffer([int capacity = 512 * 1024]);
+  int get capacity => 0;
+  Uint8List get bytes => Uint8List(0);
+  void dispose() {}
+}
+
+class CapturedFrame {
+  CapturedFrame._();
+  int get width => 0;
+  int get height => 0;
+  int get bytesPerRow => 0;
+  int get bitsPerPixel => 0;
+  int get bytesPerPixel => 0;
+  Uint8List get pixels => Uint8List(0);
+  bool get isDisposed => true;
+  void dispose() {}
+}
+
+class JpegEncoder {
+  JpegEncoder._();
+  static JpegEncoder? create() => null;
+  Uint8List? capture({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) =>
+      null;
+  Uint8List? captureInto(
+    JpegBuffer buffer, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    int quality = 80,
+    ResizeFilter filter = ResizeFilter.area,
+  }) =>
+      null;
+  BudgetCapture? captureWithinBudget(
+    int maxBytes, {
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) =>
+      null;
+  void dispose() {}
+}
+
+class CapturePlan {
+  CapturePlan._();
+  static CapturePlan? create({
+    Rect? region,
+    int? maxSmallDimension,
+    int? maxLargeDimension,
+    ResizeFilter filter = ResizeFilter.area,
+  }) =>
       null;
+  Size get imageSize => const Size(0, 0);
+  CoordinateTransform get transform => const CoordinateTransform(1, 1, 0, 0);
+  Uint8List? capture({CaptureFormat format = CaptureFormat.jpeg, int quality = 80}) => null;
+  void dispose() {}
 }
 
 // Misc utilities ------------------------------------------------------------
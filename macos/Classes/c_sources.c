@@ -5,4 +5,18 @@
 #include "../../src/macos/screen.c"
 #include "../../src/nutdart.c"
 #include "../../src/deadbeef_rand.c"
-#include "../../src/MMBitmap.c"
\ No newline at end of file
+#include "../../src/MMBitmap.c"
+#include "../../src/pixelhash.c"
+#include "../../src/rectmerge.c"
+#include "../../src/framediff.c"
+#include "../../src/screenwait.c"
+#include "../../src/capturesession.c"
+#include "../../src/monitorcapture.c"
+#include "../../src/resample.c"
+#include "../../src/workpool.c"
+#include "../../src/jpegbudget.c"
+#include "../../src/pngencode.c"
+#include "../../src/webpencode.c"
+#include "../../src/multiencode.c"
+#include "../../src/base64.c"
+#include "../../src/captureplan.c"
\ No newline at end of file
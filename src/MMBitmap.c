@@ -72,22 +72,25 @@ MMBitmapRef copyMMBitmapFromPortion(MMBitmapRef source, MMRect rect)
 		return NULL;
 	} else {
 		uint8_t *copiedBuf = NULL;
-		const size_t bufsize = rect.size.height * source->bytewidth;
-		const size_t offset = (source->bytewidth * rect.origin.y) +
-		                      (rect.origin.x * source->bytesPerPixel);
-
-		/* Don't go over the bounds, programmer! */
-		assert((bufsize + offset) <= (source->bytewidth * source->height));
+		const size_t bytewidth = rect.size.width * source->bytesPerPixel;
+		const size_t bufsize = rect.size.height * bytewidth;
+		const uint8_t *row = source->imageBuffer +
+		                     (source->bytewidth * rect.origin.y) +
+		                     (rect.origin.x * source->bytesPerPixel);
 
 		copiedBuf = malloc(bufsize);
 		if (copiedBuf == NULL) return NULL;
 
-		memcpy(copiedBuf, source->imageBuffer + offset, bufsize);
+		/* Copy row by row; the source rows may be wider than the portion. */
+		for (int64_t y = 0; y < rect.size.height; y++) {
+			memcpy(copiedBuf + y * bytewidth, row, bytewidth);
+			row += source->bytewidth;
+		}
 
 		return createMMBitmap(copiedBuf,
 		                      rect.size.width,
 		                      rect.size.height,
-		                      source->bytewidth,
+		                      bytewidth,
 		                      source->bitsPerPixel,
 		                      source->bytesPerPixel);
 	}
@@ -0,0 +1,174 @@
+#include "base64.h"
+#include "cpufeatures.h"
+
+#if defined(MM_CPU_X86)
+	#define BASE64_X86 1
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define BASE64_TARGET_AVX2
+	#else
+		#define BASE64_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	/* Needs AArch64's four-register table lookup. */
+	#define BASE64_NEON 1
+	#include <arm_neon.h>
+#endif
+
+static const char base64Alphabet[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64EncodedLength(size_t size)
+{
+	return (size + 2) / 3 * 4;
+}
+
+/* Encodes whole groups of three bytes from `in` until `size`, then the
+ * padded tail. */
+static void encodeBase64Scalar(const uint8_t *src, size_t size, char *dst, size_t in, size_t out)
+{
+	for (; in + 3 <= size; in += 3, out += 4) {
+		const uint32_t group = (uint32_t)src[in] << 16 | (uint32_t)src[in + 1] << 8 | src[in + 2];
+		dst[out] = base64Alphabet[group >> 18];
+		dst[out + 1] = base64Alphabet[(group >> 12) & 0x3F];
+		dst[out + 2] = base64Alphabet[(group >> 6) & 0x3F];
+		dst[out + 3] = base64Alphabet[group & 0x3F];
+	}
+	if (in < size) {
+		const uint32_t group = (uint32_t)src[in] << 16 | (in + 1 < size ? (uint32_t)src[in + 1] << 8 : 0);
+		dst[out] = base64Alphabet[group >> 18];
+		dst[out + 1] = base64Alphabet[(group >> 12) & 0x3F];
+		dst[out + 2] = in + 1 < size ? base64Alphabet[(group >> 6) & 0x3F] : '=';
+		dst[out + 3] = '=';
+	}
+}
+
+/* AVX2 kernel (after Muła and Lemire): each 128-bit lane takes 12 bytes,
+ * spreads every 3 of them over a 32-bit word, pulls out the four 6-bit
+ * indices with two multiplies, and maps indices to characters by adding
+ * an offset looked up per range of the alphabet. */
+
+#if defined(BASE64_X86)
+
+BASE64_TARGET_AVX2
+static void encodeBase64AVX2(const uint8_t *src, size_t size, char *dst)
+{
+	/* Bytes b, a, c, b of each group a, b, c, per lane. */
+	const __m256i spread = _mm256_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	/* Offset to add to an index, by range: 0 for a-z, 1-10 for 0-9, 11 for
+	 * '+', 12 for '/' and 13 for A-Z (see below). */
+	const __m256i offsets = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	size_t in = 0, out = 0;
+	/* The second lane's load reads 4 bytes past the 24 it uses. */
+	for (; in + 28 <= size; in += 24, out += 32) {
+		const __m256i bytes = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + in))),
+			_mm_loadu_si128((const __m128i *)(src + in + 12)), 1);
+		const __m256i words = _mm256_shuffle_epi8(bytes, spread);
+
+		/* Indices 0 and 2 by a high multiply, 1 and 3 by a low one. */
+		const __m256i even = _mm256_mulhi_epu16(_mm256_and_si256(words, _mm256_set1_epi32(0x0FC0FC00)),
+		                                        _mm256_set1_epi32(0x04000040));
+		const __m256i odd = _mm256_mullo_epi16(_mm256_and_si256(words, _mm256_set1_epi32(0x003F03F0)),
+		                                       _mm256_set1_epi32(0x01000010));
+		const __m256i indices = _mm256_or_si256(even, odd);
+
+		/* 52-63 become 1-12, the rest 0; then 0-25 become 13. */
+		__m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+		const __m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+		_mm256_storeu_si256((__m256i *)(dst + out), chars);
+	}
+	encodeBase64Scalar(src, size, dst, in, out);
+}
+
+#endif /* BASE64_X86 */
+
+/* NEON kernel: de-interleaves 48 bytes into three registers, computes the
+ * four index registers with shifts, looks characters up in the 64-byte
+ * alphabet held in four registers, and stores them re-interleaved. */
+
+#if defined(BASE64_NEON)
+
+static void encodeBase64NEON(const uint8_t *src, size_t size, char *dst)
+{
+	const uint8_t *alphabet = (const uint8_t *)base64Alphabet;
+	uint8x16x4_t table;
+	table.val[0] = vld1q_u8(alphabet);
+	table.val[1] = vld1q_u8(alphabet + 16);
+	table.val[2] = vld1q_u8(alphabet + 32);
+	table.val[3] = vld1q_u8(alphabet + 48);
+	const uint8x16_t low6 = vdupq_n_u8(0x3F);
+
+	size_t in = 0, out = 0;
+	for (; in + 48 <= size; in += 48, out += 64) {
+		const uint8x16x3_t bytes = vld3q_u8(src + in);
+		uint8x16x4_t indices;
+		indices.val[0] = vshrq_n_u8(bytes.val[0], 2);
+		indices.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), low6);
+		indices.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), low6);
+		indices.val[3] = vandq_u8(bytes.val[2], low6);
+
+		uint8x16x4_t chars;
+		chars.val[0] = vqtbl4q_u8(table, indices.val[0]);
+		chars.val[1] = vqtbl4q_u8(table, indices.val[1]);
+		chars.val[2] = vqtbl4q_u8(table, indices.val[2]);
+		chars.val[3] = vqtbl4q_u8(table, indices.val[3]);
+		vst4q_u8((uint8_t *)dst + out, chars);
+	}
+	encodeBase64Scalar(src, size, dst, in, out);
+}
+
+#endif /* BASE64_NEON */
+
+static bool base64BackendSupported(MMBase64Backend backend)
+{
+	switch (backend) {
+	case MMBase64BackendScalar:
+		return true;
+#if defined(BASE64_X86)
+	case MMBase64BackendAVX2:
+		return MMCPUHasAVX2();
+#endif
+#if defined(BASE64_NEON)
+	case MMBase64BackendNEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+bool encodeBase64(const uint8_t *src, size_t size, char *dst, MMBase64Backend backend)
+{
+	if (backend == MMBase64BackendAuto) {
+		backend = base64BackendSupported(MMBase64BackendAVX2) ? MMBase64BackendAVX2
+		        : base64BackendSupported(MMBase64BackendNEON) ? MMBase64BackendNEON
+		        : MMBase64BackendScalar;
+	}
+	if (!base64BackendSupported(backend)) return false;
+
+	switch (backend) {
+#if defined(BASE64_X86)
+	case MMBase64BackendAVX2:
+		encodeBase64AVX2(src, size, dst);
+		break;
+#endif
+#if defined(BASE64_NEON)
+	case MMBase64BackendNEON:
+		encodeBase64NEON(src, size, dst);
+		break;
+#endif
+	default:
+		encodeBase64Scalar(src, size, dst, 0, 0);
+		break;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef BASE64_H
+#define BASE64_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Base64 (RFC 4648, standard alphabet, padded, no line breaks) for encoded
+ * screenshots on their way into JSON requests. AVX2 and NEON (AArch64)
+ * kernels encode 24 and 48 input bytes per step, picked for the running CPU;
+ * a scalar version handles the tail and is the reference they must match. */
+
+typedef enum {
+	MMBase64BackendAuto = 0,  /* Fastest one this CPU supports. */
+	MMBase64BackendScalar,
+	MMBase64BackendAVX2,
+	MMBase64BackendNEON
+} MMBase64Backend;
+
+/* Characters in the base64 of `size` bytes, padding included. */
+size_t base64EncodedLength(size_t size);
+
+/* Writes the base64 of `size` bytes at `src` to `dst`, which must hold
+ * base64EncodedLength(size) characters; no terminating NUL is added.
+ * Returns false, writing nothing, if this build or CPU doesn't support
+ * `backend`. */
+bool encodeBase64(const uint8_t *src, size_t size, char *dst, MMBase64Backend backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BASE64_H */
@@ -0,0 +1,175 @@
+// Test frames shared by the encoder benchmarks: synthetic desktop scenes (a
+// terminal, an anti-aliased code editor and a desktop with a photo
+// wallpaper), drawn as 32-bit BGRX, and a loader for captured frames saved
+// as binary PPM.
+#pragma once
+#include "../MMBitmap.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline uint32_t hash32(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352D;
+    value ^= value >> 15;
+    value *= 0x846CA68B;
+    return value ^ (value >> 16);
+}
+
+static inline void putPixel(uint8_t *pixel, int r, int g, int b)
+{
+    pixel[0] = (uint8_t)b;
+    pixel[1] = (uint8_t)g;
+    pixel[2] = (uint8_t)r;
+    pixel[3] = 0xFF;
+}
+
+// Coverage (0-255) of glyph `ch` at (x, y) within a cell, from a 5x7 dot
+// pattern. With `antialias`, each cell pixel averages 2x2 samples, giving
+// the edge shades text rendering produces.
+static inline int glyphCoverage(uint32_t ch, int x, int y, int cellWidth, int cellHeight, int antialias)
+{
+    const int samples = antialias ? 2 : 1;
+    int covered = 0;
+    for (int sy = 0; sy < samples; sy++) {
+        for (int sx = 0; sx < samples; sx++) {
+            const int gx = ((x * samples + sx) * 7) / (cellWidth * samples) - 1;
+            const int gy = ((y * samples + sy) * 10) / (cellHeight * samples) - 2;
+            if (gx < 0 || gx >= 5 || gy < 0 || gy >= 7) continue;
+            if (hash32(ch * 64 + (uint32_t)(gy * 5 + gx)) & 1) covered++;
+        }
+    }
+    return covered * 255 / (samples * samples);
+}
+
+// Lines of text on a background; line length and colour vary per line
+static inline void drawText(uint8_t *pixels, int width, int height, int x0, int y0, int x1, int y1,
+                     const int background[3], const int (*colors)[3], int colorCount,
+                     int antialias, uint32_t seed)
+{
+    const int cellWidth = 9, cellHeight = 18;
+    for (int y = y0; y < y1 && y < height; y++) {
+        const int line = (y - y0) / cellHeight;
+        const uint32_t lineHash = hash32(seed + (uint32_t)line);
+        const int length = (int)(lineHash % 100);
+        const int indent = (int)((lineHash >> 8) % 4) * 4;
+        for (int x = x0; x < x1 && x < width; x++) {
+            const int column = (x - x0) / cellWidth;
+            int coverage = 0;
+            const int *color = background;
+            if (column >= indent && column < indent + length) {
+                const uint32_t ch = hash32(lineHash + (uint32_t)column) % 95;
+                // Words separated by spaces, each word in one colour
+                if (ch % 7 != 0) {
+                    color = colors[(hash32(lineHash + (uint32_t)(column / 6)) % (uint32_t)colorCount)];
+                    coverage = glyphCoverage(ch, (x - x0) % cellWidth, (y - y0) % cellHeight,
+                                             cellWidth, cellHeight, antialias);
+                }
+            }
+            putPixel(pixels + ((size_t)y * width + x) * 4,
+                     background[0] + (color[0] - background[0]) * coverage / 255,
+                     background[1] + (color[1] - background[1]) * coverage / 255,
+                     background[2] + (color[2] - background[2]) * coverage / 255);
+        }
+    }
+}
+
+static inline void drawTerminal(uint8_t *pixels, int width, int height)
+{
+    static const int background[3] = { 30, 30, 30 };
+    static const int colors[][3] = {
+        { 204, 204, 204 }, { 205, 49, 49 }, { 13, 188, 121 }, { 229, 229, 16 },
+        { 36, 114, 200 }, { 188, 63, 188 }, { 17, 168, 205 }, { 255, 255, 255 }
+    };
+    drawText(pixels, width, height, 0, 0, width, height, background, colors, 8, 0, 1);
+}
+
+static inline void drawEditor(uint8_t *pixels, int width, int height)
+{
+    static const int background[3] = { 255, 255, 255 };
+    static const int gutter[3] = { 240, 240, 240 };
+    static const int gutterText[][3] = { { 140, 140, 140 } };
+    static const int colors[][3] = {
+        { 0, 0, 0 }, { 175, 0, 219 }, { 0, 16, 128 }, { 163, 21, 21 },
+        { 0, 128, 0 }, { 38, 127, 153 }, { 121, 94, 38 }
+    };
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            putPixel(pixels + ((size_t)y * width + x) * 4, gutter[0], gutter[1], gutter[2]);
+        }
+    }
+    drawText(pixels, width, height, 0, 0, 54, height, gutter, gutterText, 1, 1, 2);
+    drawText(pixels, width, height, 60, 0, width, height, background, colors, 7, 1, 3);
+}
+
+static inline void drawDesktop(uint8_t *pixels, int width, int height)
+{
+    // Wallpaper: smooth gradients with photographic noise
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int noise = (int)(hash32((uint32_t)(y * width + x)) % 24) - 12;
+            const int r = 40 + x * 120 / width + noise;
+            const int g = 80 + y * 100 / height + noise;
+            const int b = 160 - x * 60 / width + noise;
+            putPixel(pixels + ((size_t)y * width + x) * 4, r, g, b);
+        }
+    }
+    // A window with a title bar and anti-aliased text
+    static const int background[3] = { 250, 250, 250 };
+    static const int colors[][3] = { { 30, 30, 30 }, { 0, 102, 204 } };
+    const int x0 = width / 8, y0 = height / 8, x1 = width * 3 / 4, y1 = height * 7 / 8;
+    // 32 rows of title bar, fewer if the window is shorter than that
+    const int titleBottom = y0 + 32 < y1 ? y0 + 32 : y1;
+    for (int y = y0; y < titleBottom && y < height; y++) {
+        for (int x = x0; x < x1; x++) {
+            putPixel(pixels + ((size_t)y * width + x) * 4, 220 - (y - y0), 220 - (y - y0), 225 - (y - y0));
+        }
+    }
+    drawText(pixels, width, height, x0, titleBottom, x1, y1, background, colors, 2, 1, 4);
+}
+
+typedef struct {
+    const char *name;
+    void (*draw)(uint8_t *, int, int);
+} BenchScene;
+
+static const BenchScene benchScenes[] = {
+    { "terminal", drawTerminal },
+    { "editor", drawEditor },
+    { "desktop", drawDesktop },
+};
+
+// Reads a binary PPM (P6, 8-bit), as saved by e.g. `grim -t ppm` or
+// ImageMagick's `import -window root`, into a new 32-bit bitmap. Returns
+// NULL if the file can't be read or isn't such a PPM.
+static inline MMBitmapRef loadPpmFrame(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    int width = 0, height = 0, maxValue = 0;
+    if (fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) != 3 ||
+        width <= 0 || height <= 0 || maxValue != 255 || fgetc(file) == EOF) {
+        fclose(file);
+        return NULL;
+    }
+    const size_t rowSize = (size_t)width * 3;
+    uint8_t *row = malloc(rowSize);
+    uint8_t *pixels = malloc((size_t)width * height * 4);
+    MMBitmapRef bitmap = NULL;
+    if (row != NULL && pixels != NULL) {
+        int y = 0;
+        for (; y < height && fread(row, 1, rowSize, file) == rowSize; y++) {
+            for (int x = 0; x < width; x++) {
+                putPixel(pixels + ((size_t)y * width + x) * 4, row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
+            }
+        }
+        if (y == height) {
+            bitmap = createMMBitmap(pixels, (size_t)width, (size_t)height, (size_t)width * 4, 32, 4);
+        }
+    }
+    if (bitmap == NULL) free(pixels);
+    free(row);
+    fclose(file);
+    return bitmap;
+}
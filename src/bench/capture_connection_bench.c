@@ -0,0 +1,89 @@
+// Microbenchmark: per-call latency of a screen grab that opens its own X
+// connection (the old copyMMBitmapFromDisplayInRect_x11 behaviour) versus a
+// grab through the cached capture connection.
+//
+// Usage: capture_connection_bench [iterations] [width] [height]
+// A 1x1 region (the default) isolates connection overhead from pixel
+// transfer; pass the screen size to see the effect on full grabs.
+#include "../screengrab.h"
+#include "../MMBitmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+static double nowMicros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    const double da = *(const double *)a;
+    const double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static void report(const char *label, double *samples, int count)
+{
+    double total = 0;
+    for (int i = 0; i < count; i++) total += samples[i];
+    qsort(samples, count, sizeof(double), compareDoubles);
+    printf("%-28s mean %9.1f us   median %9.1f us   p95 %9.1f us\n",
+           label, total / count, samples[count / 2], samples[(count * 95) / 100]);
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    const int width = argc > 2 ? atoi(argv[2]) : 1;
+    const int height = argc > 3 ? atoi(argv[3]) : 1;
+    if (iterations <= 0 || width <= 0 || height <= 0) {
+        fprintf(stderr, "usage: %s [iterations] [width] [height]\n", argv[0]);
+        return 2;
+    }
+
+    double *perCall = malloc(sizeof(double) * iterations);
+    double *cached = malloc(sizeof(double) * iterations);
+    if (perCall == NULL || cached == NULL) return 1;
+
+    // Warm up both paths (first cached call opens the connection and
+    // attaches the shared memory segment).
+    MMBitmapRef warm = copyMMBitmapFromDisplayInRect(MMRectMake(0, 0, width, height));
+    if (warm == NULL) {
+        fputs("capture failed; is DISPLAY set?\n", stderr);
+        return 1;
+    }
+    destroyMMBitmap(warm);
+
+    for (int i = 0; i < iterations; i++) {
+        const double start = nowMicros();
+        Display *display = XOpenDisplay(NULL);
+        if (display == NULL) return 1;
+        XImage *image = XGetImage(display, XDefaultRootWindow(display),
+                                  0, 0, (unsigned int)width, (unsigned int)height,
+                                  AllPlanes, ZPixmap);
+        if (image != NULL) XDestroyImage(image);
+        XCloseDisplay(display);
+        perCall[i] = nowMicros() - start;
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        const double start = nowMicros();
+        MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(0, 0, width, height));
+        if (bitmap != NULL) destroyMMBitmap(bitmap);
+        cached[i] = nowMicros() - start;
+    }
+
+    printf("%d grabs of %dx%d\n", iterations, width, height);
+    report("XOpenDisplay per grab", perCall, iterations);
+    report("cached capture connection", cached, iterations);
+
+    free(perCall);
+    free(cached);
+    return 0;
+}
@@ -0,0 +1,244 @@
+// Benchmark for the PNG encoder against the JPEG path: encodes the synthetic
+// desktop frames of bench_frames.h as PNG and as JPEG, and reports the time
+// per frame and the encoded size.
+//
+// Built with zlib (HAVE_ZLIB), it also decodes every PNG and checks that
+// its pixels are the frame's, and times zlib's fastest level on the same
+// filtered scanlines so the built-in deflate can be compared with it.
+//
+// Usage: png_bench [iterations] [width height]
+// Defaults to 1920x1080. Exits non-zero if an encode fails or a PNG does not
+// decode to the frame it was encoded from.
+#include "../pngencode.h"
+#include "../screengrab_jpeg.h"
+#include "../resample.h"
+#include "bench_frames.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+static double nowMicros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+#ifdef HAVE_ZLIB
+static uint32_t readBigEndian32(const uint8_t *bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+           ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static int paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// Decodes `png` far enough to compare it with `bitmap`: checks the chunk
+// CRCs, inflates the image data with zlib, undoes the row filters and
+// compares every pixel, through the palette for palette images. Handles
+// the subset of PNG the encoder writes: 8-bit RGB, or a palette of 1, 2, 4
+// or 8 bits per pixel, without interlacing. The filtered scanlines are
+// copied to `scanlines` (to be free()'d) before they are unfiltered.
+static bool pngMatchesBitmap(const uint8_t *png, int64_t size, MMBitmapRef bitmap,
+                             uint8_t **scanlines, size_t *scanlinesSize)
+{
+    *scanlines = NULL;
+    *scanlinesSize = 0;
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (size < 8 || memcmp(png, signature, 8) != 0) return false;
+
+    uint32_t width = 0, height = 0;
+    int depth = 0, colorType = -1;
+    uint8_t palette[256 * 3];
+    uint32_t paletteSize = 0;
+    uint8_t *idat = NULL;
+    size_t idatSize = 0;
+    bool ended = false, ok = true;
+
+    for (int64_t at = 8; ok && !ended; ) {
+        if (size - at < 12) {
+            ok = false;
+            break;
+        }
+        const uint32_t length = readBigEndian32(png + at);
+        if ((int64_t)length > size - at - 12) {
+            ok = false;
+            break;
+        }
+        const uint8_t *type = png + at + 4;
+        const uint8_t *data = type + 4;
+        if (crc32(0, type, length + 4) != readBigEndian32(data + length)) {
+            ok = false;
+            break;
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0 && length == 13) {
+            width = readBigEndian32(data);
+            height = readBigEndian32(data + 4);
+            depth = data[8];
+            colorType = data[9];
+            ok = data[12] == 0;  // No interlacing
+        } else if (memcmp(type, "PLTE", 4) == 0 && length % 3 == 0 && length <= sizeof(palette)) {
+            memcpy(palette, data, length);
+            paletteSize = length / 3;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            uint8_t *grown = realloc(idat, idatSize + length);
+            if (grown == NULL) {
+                ok = false;
+                break;
+            }
+            idat = grown;
+            memcpy(idat + idatSize, data, length);
+            idatSize += length;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        at += 12 + (int64_t)length;
+    }
+
+    const bool rgb = colorType == 2 && depth == 8;
+    const bool indexed = colorType == 3 && paletteSize > 0 &&
+                         (depth == 1 || depth == 2 || depth == 4 || depth == 8);
+    ok = ok && ended && (rgb || indexed) &&
+         width == bitmap->width && height == bitmap->height;
+
+    const int bitsPerPixel = rgb ? 24 : depth;
+    const size_t rowBytes = ((size_t)width * bitsPerPixel + 7) / 8;
+    const size_t filterStep = rgb ? 3 : 1;
+    uLongf rawSize = (uLongf)((rowBytes + 1) * height);
+    uint8_t *raw = ok ? malloc(rawSize) : NULL;
+    ok = raw != NULL && uncompress(raw, &rawSize, idat, (uLong)idatSize) == Z_OK &&
+         rawSize == (uLongf)((rowBytes + 1) * height);
+    if (ok && (*scanlines = malloc(rawSize)) != NULL) {
+        memcpy(*scanlines, raw, rawSize);
+        *scanlinesSize = rawSize;
+    }
+
+    for (uint32_t y = 0; ok && y < height; y++) {
+        uint8_t *row = raw + (size_t)y * (rowBytes + 1);
+        const uint8_t *up = y > 0 ? row - (rowBytes + 1) + 1 : NULL;
+        const int filter = row[0];
+        row++;
+        for (size_t i = 0; i < rowBytes; i++) {
+            const int a = i >= filterStep ? row[i - filterStep] : 0;
+            const int b = up ? up[i] : 0;
+            const int c = up && i >= filterStep ? up[i - filterStep] : 0;
+            switch (filter) {
+            case 0: break;
+            case 1: row[i] += a; break;
+            case 2: row[i] += b; break;
+            case 3: row[i] += (a + b) / 2; break;
+            case 4: row[i] += paeth(a, b, c); break;
+            default: ok = false; break;
+            }
+        }
+
+        const uint8_t *pixel = bitmap->imageBuffer + (size_t)y * bitmap->bytewidth;
+        for (uint32_t x = 0; ok && x < width; x++, pixel += bitmap->bytesPerPixel) {
+            const uint8_t *color = row + (size_t)x * 3;
+            if (indexed) {
+                const uint32_t bit = x * (uint32_t)depth;
+                const uint32_t index = (row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+                if (index >= paletteSize) {
+                    ok = false;
+                    break;
+                }
+                color = palette + index * 3;
+            }
+            ok = color[0] == pixel[2] && color[1] == pixel[1] && color[2] == pixel[0];
+        }
+    }
+
+    free(raw);
+    free(idat);
+    return ok;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    const int width = argc > 3 ? atoi(argv[2]) : 1920;
+    const int height = argc > 3 ? atoi(argv[3]) : 1080;
+    if (iterations <= 0 || width <= 0 || height <= 0) {
+        fprintf(stderr, "usage: %s [iterations] [width height]\n", argv[0]);
+        return 2;
+    }
+
+    uint8_t *pixels = malloc((size_t)width * height * 4);
+    if (pixels == NULL) return 1;
+    MMBitmapRef bitmap = createMMBitmap(pixels, (size_t)width, (size_t)height,
+                                        (size_t)width * 4, 32, 4);
+    if (bitmap == NULL) return 1;
+
+    printf("%dx%d, %d iterations\n", width, height, iterations);
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(benchScenes) / sizeof(benchScenes[0]); s++) {
+        benchScenes[s].draw(bitmap->imageBuffer, width, height);
+
+        int64_t pngSize = 0, jpegSize = 0;
+        double start = nowMicros();
+        for (int i = 0; i < iterations; i++) {
+            free(encodeMMBitmapPng(bitmap, -1, -1, MMResampleArea, &pngSize));
+        }
+        const double png = (nowMicros() - start) / iterations / 1000;
+
+        start = nowMicros();
+        for (int i = 0; i < iterations; i++) {
+            free(encodeMMBitmapJpeg(bitmap, -1, -1, 80, MMResampleArea, &jpegSize));
+        }
+        const double jpeg = (nowMicros() - start) / iterations / 1000;
+
+        if (pngSize == 0) failures++;
+        printf("%-9s png %7.2f ms %9lld bytes   jpeg q80 %7.2f ms %9lld bytes", benchScenes[s].name,
+               png, (long long)pngSize, jpeg, (long long)jpegSize);
+
+#ifdef HAVE_ZLIB
+        uint8_t *encoded = encodeMMBitmapPng(bitmap, -1, -1, MMResampleArea, &pngSize);
+        uint8_t *scanlines = NULL;
+        size_t scanlinesSize = 0;
+        const bool matches = encoded != NULL &&
+                             pngMatchesBitmap(encoded, pngSize, bitmap, &scanlines, &scanlinesSize);
+        free(encoded);
+        if (!matches) failures++;
+        printf("   %s", matches ? "decodes ok" : "DECODE MISMATCH");
+
+        // zlib's fastest level on the same scanlines. This is deflate
+        // alone; the png time above also covers palette search and filters.
+        uLongf zlibSize = compressBound((uLong)scanlinesSize);
+        uint8_t *compressed = scanlines != NULL ? malloc(zlibSize) : NULL;
+        if (compressed != NULL) {
+            const uLongf capacity = zlibSize;
+            start = nowMicros();
+            for (int i = 0; i < iterations; i++) {
+                zlibSize = capacity;
+                compress2(compressed, &zlibSize, scanlines, (uLong)scanlinesSize, 1);
+            }
+            const double zlib = (nowMicros() - start) / iterations / 1000;
+            printf("   zlib -1 deflate only %7.2f ms %9lu bytes", zlib, (unsigned long)zlibSize);
+        }
+        free(compressed);
+        free(scanlines);
+        printf("\n");
+#else
+        printf("\n");
+#endif
+    }
+#ifndef HAVE_ZLIB
+    printf("built without zlib: PNGs were not decoded and checked\n");
+#endif
+
+    destroyMMBitmap(bitmap);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+// Benchmark for WebP against JPEG: encodes each frame as JPEG q80, lossy
+// WebP q80, lossless WebP and PNG, and reports the time per frame and the
+// encoded size. Frames are captured screenshots given as binary PPM files,
+// or else the synthetic desktop frames of bench_frames.h.
+//
+// Usage: webp_bench [iterations] [frame.ppm ...]
+// Exits non-zero if an encode fails, or with 2 if WebP is not built in.
+#include "../webpencode.h"
+#include "../pngencode.h"
+#include "../screengrab_jpeg.h"
+#include "../resample.h"
+#include "bench_frames.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef enum {
+    FormatJpeg,
+    FormatWebp,
+    FormatWebpLossless,
+    FormatPng
+} Format;
+
+static const char *formatNames[] = { "jpeg q80", "webp q80", "webp lossless", "png" };
+
+static double nowMicros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static uint8_t* encode(Format format, MMBitmapRef bitmap, int64_t *outSize)
+{
+    switch (format) {
+    case FormatJpeg:
+        return encodeMMBitmapJpeg(bitmap, -1, -1, 80, MMResampleArea, outSize);
+    case FormatWebp:
+        return encodeMMBitmapWebp(bitmap, -1, -1, 80, false, MMResampleArea, outSize);
+    case FormatWebpLossless:
+        return encodeMMBitmapWebp(bitmap, -1, -1, 80, true, MMResampleArea, outSize);
+    case FormatPng:
+        return encodeMMBitmapPng(bitmap, -1, -1, MMResampleArea, outSize);
+    }
+    return NULL;
+}
+
+// Encodes `bitmap` in every format, printing one line each; returns the
+// number of failed encodes
+static int benchFrame(const char *name, MMBitmapRef bitmap, int iterations,
+                      double totalMillis[], int64_t totalBytes[])
+{
+    int failures = 0;
+    printf("%s (%zux%zu)\n", name, bitmap->width, bitmap->height);
+    for (int f = FormatJpeg; f <= FormatPng; f++) {
+        int64_t size = 0;
+        const double start = nowMicros();
+        for (int i = 0; i < iterations; i++) {
+            free(encode((Format)f, bitmap, &size));
+        }
+        const double millis = (nowMicros() - start) / iterations / 1000;
+        if (size == 0) failures++;
+        totalMillis[f] += millis;
+        totalBytes[f] += size;
+        printf("  %-14s %8.2f ms %9lld bytes\n", formatNames[f], millis, (long long)size);
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 5;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations] [frame.ppm ...]\n", argv[0]);
+        return 2;
+    }
+    if (!MMWebpAvailable()) {
+        fprintf(stderr, "built without libwebp\n");
+        return 2;
+    }
+
+    double totalMillis[FormatPng + 1] = { 0 };
+    int64_t totalBytes[FormatPng + 1] = { 0 };
+    int failures = 0;
+    if (argc > 2) {
+        for (int a = 2; a < argc; a++) {
+            MMBitmapRef bitmap = loadPpmFrame(argv[a]);
+            if (bitmap == NULL) {
+                fprintf(stderr, "%s: not a binary 8-bit PPM\n", argv[a]);
+                failures++;
+                continue;
+            }
+            failures += benchFrame(argv[a], bitmap, iterations, totalMillis, totalBytes);
+            destroyMMBitmap(bitmap);
+        }
+    } else {
+        const int width = 1920, height = 1080;
+        uint8_t *pixels = malloc((size_t)width * height * 4);
+        if (pixels == NULL) return 1;
+        MMBitmapRef bitmap = createMMBitmap(pixels, (size_t)width, (size_t)height,
+                                            (size_t)width * 4, 32, 4);
+        if (bitmap == NULL) return 1;
+        for (size_t s = 0; s < sizeof(benchScenes) / sizeof(benchScenes[0]); s++) {
+            benchScenes[s].draw(bitmap->imageBuffer, width, height);
+            failures += benchFrame(benchScenes[s].name, bitmap, iterations, totalMillis, totalBytes);
+        }
+        destroyMMBitmap(bitmap);
+    }
+
+    printf("total\n");
+    for (int f = FormatJpeg; f <= FormatPng; f++) {
+        printf("  %-14s %8.2f ms %9lld bytes (%.0f%% of jpeg)\n", formatNames[f], totalMillis[f],
+               (long long)totalBytes[f],
+               totalBytes[FormatJpeg] > 0 ? 100.0 * totalBytes[f] / totalBytes[FormatJpeg] : 0.0);
+    }
+    return failures == 0 ? 0 : 1;
+}
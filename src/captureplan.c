@@ -0,0 +1,174 @@
+#include "captureplan.h"
+#include "screengrab.h"
+#include "screengrab_jpeg.h"
+#include "pngencode.h"
+#include "webpencode.h"
+#include "multiencode.h"
+#include "resample.h"
+#include "screen.h"
+#include <stdlib.h>
+
+struct _MMCapturePlan {
+	MMRect region;
+	MMSize imageSize;
+	MMCaptureTransform transform;
+	MMResampleFilter filter;
+
+	MMBitmap grab;          /* Reused from frame to frame. */
+	size_t grabCapacity;
+
+	/* Built for the first grab's pixel size and depth, and rebuilt only if
+	 * those change. NULL while the grab needs no resizing. */
+	MMResamplerRef resampler;
+	size_t resamplerWidth;
+	size_t resamplerHeight;
+	uint8_t resamplerDepth;
+
+	MMBitmap image;         /* The resized frame; capacity only grows. */
+	size_t imageCapacity;
+
+	MMJpegEncoderRef jpeg;  /* NULL on macOS. */
+	uint8_t *encoded;       /* The last PNG or WebP, owned here. */
+};
+
+MMCapturePlanRef createMMCapturePlan(MMRect region, int32_t maxSmallDim, int32_t maxLargeDim,
+                                     int32_t filter)
+{
+	if (region.size.width <= 0 || region.size.height <= 0) {
+		MMSize size = getMainDisplaySize();
+		region = MMRectMake(0, 0, size.width, size.height);
+		if (region.size.width <= 0 || region.size.height <= 0) return NULL;
+	}
+
+	MMCapturePlanRef plan = calloc(1, sizeof(MMCapturePlan));
+	if (plan == NULL) return NULL;
+
+	int64_t width, height;
+	calculateResizedDimensions(region.size.width, region.size.height,
+	                           maxSmallDim, maxLargeDim, &width, &height);
+	plan->region = region;
+	plan->imageSize = MMSizeMake(width, height);
+	plan->filter = (MMResampleFilter)filter;
+	plan->transform.scaleX = (double)width / (double)region.size.width;
+	plan->transform.scaleY = (double)height / (double)region.size.height;
+	plan->transform.originX = (double)region.origin.x;
+	plan->transform.originY = (double)region.origin.y;
+	plan->jpeg = createMMJpegEncoder();
+	return plan;
+}
+
+void destroyMMCapturePlan(MMCapturePlanRef plan)
+{
+	if (plan == NULL) return;
+	destroyMMResampler(plan->resampler);
+	destroyMMJpegEncoder(plan->jpeg);
+	free(plan->grab.imageBuffer);
+	free(plan->image.imageBuffer);
+	free(plan->encoded);
+	free(plan);
+}
+
+MMRect getMMCapturePlanRegion(MMCapturePlanRef plan)
+{
+	return plan->region;
+}
+
+MMSize getMMCapturePlanImageSize(MMCapturePlanRef plan)
+{
+	return plan->imageSize;
+}
+
+MMCaptureTransform getMMCapturePlanTransform(MMCapturePlanRef plan)
+{
+	return plan->transform;
+}
+
+/* Grabs into the previous frame's buffer when the backend allows, else takes
+ * over a freshly grabbed one. */
+static MMBitmapRef grabPlanRegion(MMCapturePlanRef plan)
+{
+	MMBitmap *grab = &plan->grab;
+	if (grab->imageBuffer == NULL ||
+	    !copyMMBitmapFromDisplayInRectInto(plan->region, grab, plan->grabCapacity)) {
+		MMBitmapRef grabbed = copyMMBitmapFromDisplayInRect(plan->region);
+		if (grabbed == NULL) return NULL;
+		free(grab->imageBuffer);
+		*grab = *grabbed;
+		plan->grabCapacity = grabbed->bytewidth * grabbed->height;
+		grabbed->imageBuffer = NULL;
+		destroyMMBitmap(grabbed);
+	}
+	return grab;
+}
+
+MMBitmapRef captureMMCapturePlanFrame(MMCapturePlanRef plan)
+{
+	MMBitmapRef grab = grabPlanRegion(plan);
+	if (grab == NULL) return NULL;
+
+	const size_t width = (size_t)plan->imageSize.width;
+	const size_t height = (size_t)plan->imageSize.height;
+	if (grab->width == width && grab->height == height) return grab;
+
+	const uint8_t depth = grab->bytesPerPixel;
+	if (plan->resampler == NULL || plan->resamplerWidth != grab->width ||
+	    plan->resamplerHeight != grab->height || plan->resamplerDepth != depth) {
+		destroyMMResampler(plan->resampler);
+		plan->resampler = createMMResampler(grab->width, grab->height, width, height,
+		                                    depth, plan->filter);
+		if (plan->resampler == NULL) return NULL;
+		plan->resamplerWidth = grab->width;
+		plan->resamplerHeight = grab->height;
+		plan->resamplerDepth = depth;
+	}
+
+	MMBitmap *image = &plan->image;
+	const size_t bytewidth = width * depth;
+	if (plan->imageCapacity < bytewidth * height) {
+		uint8_t *buffer = realloc(image->imageBuffer, bytewidth * height);
+		if (buffer == NULL) return NULL;
+		image->imageBuffer = buffer;
+		plan->imageCapacity = bytewidth * height;
+	}
+	image->width = width;
+	image->height = height;
+	image->bytewidth = bytewidth;
+	image->bitsPerPixel = grab->bitsPerPixel;
+	image->bytesPerPixel = depth;
+
+	if (!resampleMMRows(plan->resampler, grab->imageBuffer, grab->bytewidth,
+	                    0, height, image->imageBuffer, bytewidth)) {
+		return NULL;
+	}
+	return image;
+}
+
+const uint8_t *captureMMCapturePlanImage(MMCapturePlanRef plan, int32_t format,
+                                         int32_t quality, int64_t *outSize)
+{
+	*outSize = 0;
+	free(plan->encoded);
+	plan->encoded = NULL;
+
+	MMBitmapRef frame = captureMMCapturePlanFrame(plan);
+	if (frame == NULL) return NULL;
+
+	/* The frame already has the plan's size, so the encoders don't resize. */
+	switch (format) {
+	case MMEncodeJpeg:
+		if (plan->jpeg == NULL) return NULL;
+		return encodeMMBitmapJpegWith(plan->jpeg, frame, -1, -1, quality, plan->filter,
+		                              NULL, 0, outSize);
+	case MMEncodePng:
+		plan->encoded = encodeMMBitmapPng(frame, -1, -1, plan->filter, outSize);
+		return plan->encoded;
+	case MMEncodeWebp:
+	case MMEncodeWebpLossless:
+		plan->encoded = encodeMMBitmapWebp(frame, -1, -1, quality,
+		                                   format == MMEncodeWebpLossless, plan->filter,
+		                                   outSize);
+		return plan->encoded;
+	default:
+		return NULL;
+	}
+}
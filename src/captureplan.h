@@ -0,0 +1,89 @@
+#pragma once
+#ifndef CAPTUREPLAN_H
+#define CAPTUREPLAN_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A capture plan fixes everything about a repeated capture that doesn't
+ * change between frames: the screen region, the output size, the resize
+ * weight tables and the mapping between screen and image coordinates. Each
+ * frame then only grabs, resizes with the cached tables and encodes, into
+ * buffers kept from the frame before.
+ *
+ * The output size is worked out once, from the region's size in screen
+ * coordinates, so every frame has the same size even where the grab comes
+ * back at a higher pixel density. A plan is not thread-safe. */
+
+typedef struct _MMCapturePlan MMCapturePlan;
+typedef MMCapturePlan *MMCapturePlanRef;
+
+/* Maps screen coordinates to image coordinates, pixel centre to pixel
+ * centre:
+ *
+ *     imageX = (screenX - originX + 0.5) * scaleX - 0.5
+ *
+ * and likewise for y; MMCaptureTransformToScreen() is the inverse. */
+typedef struct _MMCaptureTransform {
+	double scaleX;   /* Image pixels per screen pixel. */
+	double scaleY;
+	double originX;  /* Screen position of the region's top-left corner. */
+	double originY;
+} MMCaptureTransform;
+
+/* Creates a plan for `region` (the main display if its width or height is
+ * <= 0), scaled down with `filter` (an MMResampleFilter) to fit
+ * `maxSmallDim` and `maxLargeDim` (-1 for no limit). Follows the Create Rule
+ * (caller is responsible for destroy()'ing object). Returns NULL on error. */
+MMCapturePlanRef createMMCapturePlan(MMRect region, int32_t maxSmallDim, int32_t maxLargeDim,
+                                     int32_t filter);
+
+void destroyMMCapturePlan(MMCapturePlanRef plan);
+
+MMRect getMMCapturePlanRegion(MMCapturePlanRef plan);
+
+/* The size of every image the plan produces. */
+MMSize getMMCapturePlanImageSize(MMCapturePlanRef plan);
+
+MMCaptureTransform getMMCapturePlanTransform(MMCapturePlanRef plan);
+
+/* Grabs the region and resizes it to the plan's image size. Returns a bitmap
+ * that belongs to the plan and stays valid until its next capture or its
+ * destruction, or NULL on error. */
+MMBitmapRef captureMMCapturePlanFrame(MMCapturePlanRef plan);
+
+/* Captures a frame as in captureMMCapturePlanFrame() and encodes it as
+ * `format` (an MMEncodeFormat) at `quality`, which is unused for PNG.
+ * Returns the encoded bytes, which belong to the plan and stay valid until
+ * its next capture or its destruction, and their length in `outSize`; or
+ * NULL on error. JPEG is always NULL on macOS. */
+const uint8_t *captureMMCapturePlanImage(MMCapturePlanRef plan, int32_t format,
+                                         int32_t quality, int64_t *outSize);
+
+H_INLINE void MMCaptureTransformToImage(const MMCaptureTransform *transform,
+                                        double screenX, double screenY,
+                                        double *imageX, double *imageY)
+{
+	*imageX = (screenX - transform->originX + 0.5) * transform->scaleX - 0.5;
+	*imageY = (screenY - transform->originY + 0.5) * transform->scaleY - 0.5;
+}
+
+H_INLINE void MMCaptureTransformToScreen(const MMCaptureTransform *transform,
+                                         double imageX, double imageY,
+                                         double *screenX, double *screenY)
+{
+	*screenX = (imageX + 0.5) / transform->scaleX - 0.5 + transform->originX;
+	*screenY = (imageY + 0.5) / transform->scaleY - 0.5 + transform->originY;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTUREPLAN_H */
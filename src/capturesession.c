@@ -0,0 +1,293 @@
+#include "capturesession.h"
+#include "screengrab.h"
+#include "screengrab_jpeg.h"
+#include "mmthread.h"
+#include "monotonic.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_RING_SIZE 2
+
+typedef struct _MMCaptureSlot {
+	MMCaptureFrame frame;  /* First, so a frame pointer is a slot pointer. */
+	size_t capacity;       /* Bytes allocated for frame.bitmap. */
+	size_t jpegCapacity;   /* Bytes allocated for frame.jpeg; only grows. */
+	int borrowers;
+	bool read;             /* Borrowed at least once since published. */
+} MMCaptureSlot;
+
+struct _MMCaptureSession {
+	MMCaptureSessionConfig config;
+	MMThread thread;
+	MMJpegEncoderRef jpeg;  /* Used by the producer only; NULL on macOS. */
+
+	MMMutex lock;
+	MMCond published;      /* Signalled for every new frame and on stop. */
+	MMCond wake;           /* Wakes the producer early on stop. */
+	bool running;
+	int references;        /* The session itself plus each borrowed frame. */
+
+	MMCaptureSlot *slots;
+	size_t slotCount;
+	MMCaptureSlot *latest;
+	int64_t sequence;
+	MMCaptureSessionStats stats;
+};
+
+static void freeCaptureSession(MMCaptureSessionRef session)
+{
+	for (size_t i = 0; i < session->slotCount; i++) {
+		free(session->slots[i].frame.bitmap.imageBuffer);
+		free(session->slots[i].frame.jpeg);
+	}
+	free(session->slots);
+	destroyMMJpegEncoder(session->jpeg);
+	MMCondDestroy(&session->published);
+	MMCondDestroy(&session->wake);
+	MMMutexDestroy(&session->lock);
+	free(session);
+}
+
+/* Drops one reference. Called with the lock held; unlocks it. */
+static void unrefCaptureSession(MMCaptureSessionRef session)
+{
+	const bool last = --session->references == 0;
+	MMMutexUnlock(&session->lock);
+	if (last) freeCaptureSession(session);
+}
+
+/* Picks the slot to overwrite: the oldest one nobody is borrowing, leaving
+ * the newest frame alone when possible. Called with the lock held. */
+static MMCaptureSlot *pickFreeSlot(MMCaptureSessionRef session)
+{
+	MMCaptureSlot *best = NULL;
+	for (size_t i = 0; i < session->slotCount; i++) {
+		MMCaptureSlot *slot = &session->slots[i];
+		if (slot->borrowers > 0 || slot == session->latest) continue;
+		if (best == NULL || slot->frame.sequence < best->frame.sequence) best = slot;
+	}
+	return best;
+}
+
+/* Encodes the slot's frame into its JPEG buffer. A JPEG too large for the
+ * buffer lands in the encoder's memory instead and is copied over once the
+ * buffer has grown to fit it. */
+static bool encodeSlotJpeg(MMCaptureSessionRef session, MMCaptureSlot *slot)
+{
+	int64_t size = 0;
+	const uint8_t *jpeg = encodeMMBitmapJpegWith(session->jpeg, &slot->frame.bitmap,
+	                                             session->config.maxSmallDim,
+	                                             session->config.maxLargeDim,
+	                                             session->config.quality,
+	                                             session->config.filter,
+	                                             slot->frame.jpeg, slot->jpegCapacity,
+	                                             &size);
+	if (jpeg == NULL) return false;
+
+	if (jpeg != slot->frame.jpeg) {
+		uint8_t *grown = realloc(slot->frame.jpeg, (size_t)size);
+		if (grown == NULL) return false;
+		slot->frame.jpeg = grown;
+		slot->jpegCapacity = (size_t)size;
+		memcpy(grown, jpeg, (size_t)size);
+	}
+	slot->frame.jpegSize = size;
+	return true;
+}
+
+/* Grabs into `slot`, reusing its buffer when the backend allows and taking
+ * over a freshly grabbed one otherwise. */
+static bool fillSlot(MMCaptureSessionRef session, MMCaptureSlot *slot)
+{
+	MMBitmap *bitmap = &slot->frame.bitmap;
+	if (bitmap->imageBuffer == NULL ||
+	    !copyMMBitmapFromDisplayInRectInto(session->config.region, bitmap, slot->capacity)) {
+		MMBitmapRef grabbed = copyMMBitmapFromDisplayInRect(session->config.region);
+		if (grabbed == NULL) return false;
+
+		free(bitmap->imageBuffer);
+		*bitmap = *grabbed;
+		slot->capacity = grabbed->bytewidth * grabbed->height;
+		grabbed->imageBuffer = NULL;
+		destroyMMBitmap(grabbed);
+	}
+
+	slot->frame.jpegSize = 0;
+	if (session->config.encodeJpeg) {
+		return encodeSlotJpeg(session, slot);
+	}
+	return true;
+}
+
+static MM_THREAD_FUNC(captureSessionMain)
+{
+	MMCaptureSessionRef session = arg;
+	const double interval = session->config.intervalMs;
+	double nextTick = monotonicMilliseconds();
+
+	MMMutexLock(&session->lock);
+	while (session->running) {
+		double now = monotonicMilliseconds();
+		if (now < nextTick) {
+			MMCondTimedWait(&session->wake, &session->lock, nextTick - now);
+			continue;
+		}
+
+		MMCaptureSlot *slot = pickFreeSlot(session);
+		if (slot == NULL) {
+			/* Every slot is borrowed; try again next tick. */
+			session->stats.late++;
+			nextTick += interval > 0 ? interval : 1.0;
+			continue;
+		}
+		if (slot->frame.sequence > 0 && !slot->read) session->stats.dropped++;
+		slot->frame.sequence = 0;
+		MMMutexUnlock(&session->lock);
+
+		const double started = monotonicMilliseconds();
+		const bool filled = fillSlot(session, slot);
+
+		MMMutexLock(&session->lock);
+		if (filled) {
+			slot->frame.sequence = ++session->sequence;
+			slot->frame.timestampMs = started;
+			slot->read = false;
+			session->latest = slot;
+			session->stats.captured++;
+			MMCondBroadcast(&session->published);
+		} else {
+			session->stats.failed++;
+		}
+
+		/* Keep the schedule, skipping the ticks a slow grab overran. */
+		nextTick += interval;
+		now = monotonicMilliseconds();
+		if (interval > 0 && nextTick < now) {
+			const int64_t missed = (int64_t)((now - nextTick) / interval) + 1;
+			session->stats.late += missed;
+			nextTick += (double)missed * interval;
+		}
+	}
+	MMCondBroadcast(&session->published);
+	MMMutexUnlock(&session->lock);
+
+	return MM_THREAD_RESULT;
+}
+
+MMCaptureSessionRef startMMCaptureSession(const MMCaptureSessionConfig *config)
+{
+	if (config == NULL || config->region.size.width <= 0 || config->region.size.height <= 0) {
+		return NULL;
+	}
+
+	MMCaptureSessionRef session = calloc(1, sizeof(MMCaptureSession));
+	if (session == NULL) return NULL;
+
+	session->config = *config;
+	if (session->config.intervalMs < 0) session->config.intervalMs = 0;
+	session->slotCount = config->ringSize < MIN_RING_SIZE ? MIN_RING_SIZE : config->ringSize;
+	session->slots = calloc(session->slotCount, sizeof(MMCaptureSlot));
+	if (session->slots == NULL) {
+		free(session);
+		return NULL;
+	}
+
+	if (session->config.encodeJpeg) {
+		session->jpeg = createMMJpegEncoder();
+		if (session->jpeg == NULL) {
+			free(session->slots);
+			free(session);
+			return NULL;
+		}
+	}
+
+	MMMutexInit(&session->lock);
+	MMCondInit(&session->published);
+	MMCondInit(&session->wake);
+	session->running = true;
+	session->references = 1;
+
+	if (!MMThreadCreate(&session->thread, captureSessionMain, session)) {
+		freeCaptureSession(session);
+		return NULL;
+	}
+	return session;
+}
+
+void stopMMCaptureSession(MMCaptureSessionRef session)
+{
+	if (session == NULL) return;
+
+	MMMutexLock(&session->lock);
+	session->running = false;
+	MMCondBroadcast(&session->wake);
+	MMMutexUnlock(&session->lock);
+	MMThreadJoin(session->thread);
+
+	MMMutexLock(&session->lock);
+	unrefCaptureSession(session);
+}
+
+/* Marks the newest frame borrowed. Called with the lock held. */
+static const MMCaptureFrame *borrowLatest(MMCaptureSessionRef session)
+{
+	MMCaptureSlot *slot = session->latest;
+	if (slot == NULL) return NULL;
+
+	slot->borrowers++;
+	slot->read = true;
+	session->references++;
+	return &slot->frame;
+}
+
+const MMCaptureFrame *acquireLatestMMCaptureFrame(MMCaptureSessionRef session)
+{
+	if (session == NULL) return NULL;
+
+	MMMutexLock(&session->lock);
+	const MMCaptureFrame *frame = borrowLatest(session);
+	MMMutexUnlock(&session->lock);
+	return frame;
+}
+
+const MMCaptureFrame *acquireNextMMCaptureFrame(MMCaptureSessionRef session,
+                                                int64_t afterSequence, double timeoutMs)
+{
+	if (session == NULL) return NULL;
+
+	const double deadline = monotonicMilliseconds() + timeoutMs;
+	const MMCaptureFrame *frame = NULL;
+
+	MMMutexLock(&session->lock);
+	for (;;) {
+		if (session->latest != NULL && session->latest->frame.sequence > afterSequence) {
+			frame = borrowLatest(session);
+			break;
+		}
+		const double remaining = deadline - monotonicMilliseconds();
+		if (!session->running || remaining <= 0) break;
+		MMCondTimedWait(&session->published, &session->lock, remaining);
+	}
+	MMMutexUnlock(&session->lock);
+	return frame;
+}
+
+void releaseMMCaptureFrame(MMCaptureSessionRef session, const MMCaptureFrame *frame)
+{
+	if (session == NULL || frame == NULL) return;
+
+	MMCaptureSlot *slot = (MMCaptureSlot *)frame;
+	MMMutexLock(&session->lock);
+	assert(slot->borrowers > 0);
+	slot->borrowers--;
+	unrefCaptureSession(session);
+}
+
+void getMMCaptureSessionStats(MMCaptureSessionRef session, MMCaptureSessionStats *stats)
+{
+	if (session == NULL || stats == NULL) return;
+
+	MMMutexLock(&session->lock);
+	*stats = session->stats;
+	MMMutexUnlock(&session->lock);
+}
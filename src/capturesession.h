@@ -0,0 +1,83 @@
+#pragma once
+#ifndef CAPTURESESSION_H
+#define CAPTURESESSION_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Continuous capture. A session owns a producer thread that grabs a region
+ * at a fixed interval into a ring of preallocated frames, optionally encoding
+ * each one as JPEG. Consumers borrow the newest frame (or wait for the next)
+ * without copying it, and give it back when done; a borrowed frame is never
+ * overwritten.
+ *
+ * Frame and JPEG buffers are reused once they are large enough, and every
+ * JPEG goes through one encoder kept for the session, so a steady-state
+ * session allocates nothing per frame on backends that can grab into a
+ * caller's buffer (see copyMMBitmapFromDisplayInRectInto()). */
+
+typedef struct _MMCaptureSessionConfig {
+	MMRect region;
+	double intervalMs;     /* Time between grabs; 0 captures back to back. */
+	size_t ringSize;       /* Frames in the ring, at least 2. */
+	bool encodeJpeg;       /* Also produce a JPEG of every frame. */
+	int32_t maxSmallDim;   /* JPEG scaling limits, -1 for none. */
+	int32_t maxLargeDim;
+	int32_t quality;
+	int32_t filter;        /* MMResampleFilter for the scaling. */
+} MMCaptureSessionConfig;
+
+typedef struct _MMCaptureFrame {
+	int64_t sequence;      /* 1 for the first frame, increasing by one. */
+	double timestampMs;    /* monotonicMilliseconds() when the grab started. */
+	MMBitmap bitmap;
+	uint8_t *jpeg;         /* NULL unless the session encodes JPEG. */
+	int64_t jpegSize;
+} MMCaptureFrame;
+
+typedef struct _MMCaptureSessionStats {
+	int64_t captured;      /* Frames published. */
+	int64_t dropped;       /* Frames overwritten before anyone borrowed them. */
+	int64_t late;          /* Ticks skipped because a grab overran the interval. */
+	int64_t failed;        /* Grabs or encodes that failed. */
+} MMCaptureSessionStats;
+
+typedef struct _MMCaptureSession MMCaptureSession;
+typedef MMCaptureSession *MMCaptureSessionRef;
+
+/* Starts a session. Returns NULL if the thread, the ring or the JPEG
+ * encoder can't be created; JPEG sessions always fail on macOS, where
+ * createMMJpegEncoder() returns NULL. */
+MMCaptureSessionRef startMMCaptureSession(const MMCaptureSessionConfig *config);
+
+/* Stops the producer and releases the session. Frames still borrowed stay
+ * valid until they are returned with releaseMMCaptureFrame(). */
+void stopMMCaptureSession(MMCaptureSessionRef session);
+
+/* Borrows the newest frame, or returns NULL if none has been captured
+ * yet. */
+const MMCaptureFrame *acquireLatestMMCaptureFrame(MMCaptureSessionRef session);
+
+/* Borrows the first frame newer than `afterSequence`, waiting up to
+ * `timeoutMs` for it. Returns NULL on timeout. */
+const MMCaptureFrame *acquireNextMMCaptureFrame(MMCaptureSessionRef session,
+                                                int64_t afterSequence, double timeoutMs);
+
+/* Returns a borrowed frame to the ring. */
+void releaseMMCaptureFrame(MMCaptureSessionRef session, const MMCaptureFrame *frame);
+
+void getMMCaptureSessionStats(MMCaptureSessionRef session, MMCaptureSessionStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTURESESSION_H */
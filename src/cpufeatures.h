@@ -0,0 +1,48 @@
+#pragma once
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include "inline_keywords.h"
+#include <stdbool.h>
+
+/* Runtime CPU feature checks for code with instruction-set specific
+ * kernels, which compile those kernels with per-function target attributes
+ * and pick one at run time. */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define MM_CPU_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+	#endif
+
+/* Whether the CPU and OS support AVX2. */
+H_INLINE bool MMCPUHasAVX2(void)
+{
+	static int detected = -1;  /* Racing first calls store the same value. */
+	if (detected < 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		bool avx2 = false;
+		__cpuid(info, 0);
+		if (info[0] >= 7) {
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] & (1 << 5)) != 0;
+			}
+		}
+		detected = avx2;
+#else
+		__builtin_cpu_init();
+		detected = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	}
+	return detected == 1;
+}
+
+#endif /* MM_CPU_X86 */
+
+#endif /* CPUFEATURES_H */
@@ -0,0 +1,203 @@
+#include "framediff.h"
+#include "pixelhash.h"
+#include "rectmerge.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct _MMFrameDiffer {
+	size_t tileSize;
+
+	/* Geometry of the remembered frame; hashes is empty when there is
+	 * none. */
+	size_t width;
+	size_t height;
+	uint8_t bytesPerPixel;
+	size_t columns;
+	size_t rows;
+	uint64_t *hashes;        /* columns * rows, in reading order. */
+
+	/* Scratch space, sized with the hashes. */
+	PixelHashState *states;  /* One per column of the current tile row. */
+	uint64_t *rowHashes;     /* Hashes of the current tile row. */
+	MMRect *rects;           /* At most one per changed tile. */
+	size_t *openRects;       /* Per column: rect still growing downwards. */
+};
+
+MMFrameDifferRef createMMFrameDiffer(size_t tileSize)
+{
+	MMFrameDifferRef differ = calloc(1, sizeof(MMFrameDiffer));
+	if (differ == NULL) return NULL;
+
+	differ->tileSize = tileSize > 0 ? tileSize : FRAMEDIFF_DEFAULT_TILE_SIZE;
+	return differ;
+}
+
+static void freeFrameState(MMFrameDifferRef differ)
+{
+	free(differ->hashes);
+	free(differ->states);
+	free(differ->rowHashes);
+	free(differ->rects);
+	free(differ->openRects);
+	differ->hashes = NULL;
+	differ->states = NULL;
+	differ->rowHashes = NULL;
+	differ->rects = NULL;
+	differ->openRects = NULL;
+	differ->width = differ->height = 0;
+	differ->columns = differ->rows = 0;
+}
+
+void destroyMMFrameDiffer(MMFrameDifferRef differ)
+{
+	if (differ == NULL) return;
+	freeFrameState(differ);
+	free(differ);
+}
+
+void resetMMFrameDiffer(MMFrameDifferRef differ)
+{
+	assert(differ != NULL);
+	freeFrameState(differ);
+}
+
+/* Sizes the tile arrays for `bitmap`. Returns false on allocation failure. */
+static bool allocFrameState(MMFrameDifferRef differ, MMBitmapRef bitmap)
+{
+	const size_t tile = differ->tileSize;
+	const size_t columns = (bitmap->width + tile - 1) / tile;
+	const size_t rows = (bitmap->height + tile - 1) / tile;
+	const size_t tiles = columns * rows;
+
+	freeFrameState(differ);
+	differ->hashes = malloc(sizeof(uint64_t) * tiles);
+	differ->states = malloc(sizeof(PixelHashState) * columns);
+	differ->rowHashes = malloc(sizeof(uint64_t) * columns);
+	differ->rects = malloc(sizeof(MMRect) * tiles);
+	differ->openRects = malloc(sizeof(size_t) * columns);
+	if (differ->hashes == NULL || differ->states == NULL || differ->rowHashes == NULL ||
+	    differ->rects == NULL || differ->openRects == NULL) {
+		freeFrameState(differ);
+		return false;
+	}
+
+	differ->width = bitmap->width;
+	differ->height = bitmap->height;
+	differ->bytesPerPixel = bitmap->bytesPerPixel;
+	differ->columns = columns;
+	differ->rows = rows;
+	return true;
+}
+
+/* Hashes tile row `row` into `out`. Rows of pixels are walked top to bottom
+ * and each one feeds every tile it crosses, so memory is read in order. */
+static void hashTileRow(MMFrameDifferRef differ, MMBitmapRef bitmap, size_t row,
+                        uint64_t *out)
+{
+	const size_t tile = differ->tileSize;
+	const size_t tileBytes = tile * bitmap->bytesPerPixel;
+	const size_t rowBytes = bitmap->width * bitmap->bytesPerPixel;
+	const size_t y0 = row * tile;
+	const size_t y1 = (y0 + tile < bitmap->height) ? y0 + tile : bitmap->height;
+
+	for (size_t c = 0; c < differ->columns; c++) {
+		pixelHashInit(&differ->states[c], (uint64_t)(row * differ->columns + c));
+	}
+
+	const uint8_t *line = bitmap->imageBuffer + y0 * bitmap->bytewidth;
+	for (size_t y = y0; y < y1; y++) {
+		size_t offset = 0;
+		for (size_t c = 0; c < differ->columns; c++) {
+			const size_t length = (offset + tileBytes < rowBytes) ? tileBytes : rowBytes - offset;
+			pixelHashUpdate(&differ->states[c], line + offset, length);
+			offset += length;
+		}
+		line += bitmap->bytewidth;
+	}
+
+	for (size_t c = 0; c < differ->columns; c++) {
+		out[c] = pixelHashFinal(&differ->states[c]);
+	}
+}
+
+/* Clips the tile span [c0, c1) x [r0, r1) to the frame. */
+static MMRect tileSpanRect(MMFrameDifferRef differ, size_t c0, size_t c1,
+                           size_t r0, size_t r1)
+{
+	const size_t tile = differ->tileSize;
+	const size_t x1 = (c1 * tile < differ->width) ? c1 * tile : differ->width;
+	const size_t y1 = (r1 * tile < differ->height) ? r1 * tile : differ->height;
+	return MMRectMake(c0 * tile, r0 * tile, x1 - c0 * tile, y1 - r0 * tile);
+}
+
+int32_t diffMMFrame(MMFrameDifferRef differ, MMBitmapRef bitmap,
+                    MMRect *rects, int32_t maxRects, int64_t *outChangedPixels)
+{
+	assert(differ != NULL);
+	if (bitmap == NULL || bitmap->imageBuffer == NULL ||
+	    bitmap->width == 0 || bitmap->height == 0) {
+		return -1;
+	}
+	if (rects == NULL) maxRects = 0;
+
+	const bool sameGeometry = differ->hashes != NULL &&
+	                          differ->width == bitmap->width &&
+	                          differ->height == bitmap->height &&
+	                          differ->bytesPerPixel == bitmap->bytesPerPixel;
+	if (!sameGeometry) {
+		if (!allocFrameState(differ, bitmap)) return -1;
+	}
+
+	/* Runs of changed tiles in a tile row extend the rectangle above them
+	 * when they span the same columns, so a solid block of changes becomes a
+	 * single rectangle before mergeMMRects() sees it. */
+	size_t rectCount = 0;
+	int64_t changedPixels = 0;
+	const size_t none = (size_t)-1;
+	for (size_t c = 0; c < differ->columns; c++) differ->openRects[c] = none;
+
+	uint64_t *rowHashes = differ->rowHashes;
+	for (size_t r = 0; r < differ->rows; r++) {
+		uint64_t *stored = differ->hashes + r * differ->columns;
+		hashTileRow(differ, bitmap, r, rowHashes);
+
+		size_t c = 0;
+		while (c < differ->columns) {
+			if (sameGeometry && rowHashes[c] == stored[c]) {
+				differ->openRects[c] = none;
+				c++;
+				continue;
+			}
+
+			size_t end = c;
+			while (end < differ->columns && (!sameGeometry || rowHashes[end] != stored[end])) end++;
+
+			const MMRect span = tileSpanRect(differ, c, end, r, r + 1);
+			changedPixels += span.size.width * span.size.height;
+
+			const size_t above = differ->openRects[c];
+			if (above != none &&
+			    differ->rects[above].origin.x == span.origin.x &&
+			    differ->rects[above].size.width == span.size.width) {
+				differ->rects[above].size.height += span.size.height;
+			} else {
+				for (size_t i = c; i < end; i++) differ->openRects[i] = none;
+				differ->openRects[c] = rectCount;
+				differ->rects[rectCount++] = span;
+			}
+			for (size_t i = c + 1; i < end; i++) differ->openRects[i] = none;
+			c = end;
+		}
+
+		memcpy(stored, rowHashes, sizeof(uint64_t) * differ->columns);
+	}
+
+	if (outChangedPixels != NULL) *outChangedPixels = changedPixels;
+	if (rectCount == 0) return 0;
+	if (maxRects <= 0) return 1;
+
+	rectCount = mergeMMRects(differ->rects, rectCount, (size_t)maxRects);
+	memcpy(rects, differ->rects, sizeof(MMRect) * rectCount);
+	return (int32_t)rectCount;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef FRAMEDIFF_H
+#define FRAMEDIFF_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Frame differ. Splits each frame into square tiles, hashes every tile and
+ * compares the hashes with those of the previous frame given to the same
+ * differ. Only the hashes are kept, never the pixels, so it works the same on
+ * every backend, with or without a damage extension.
+ *
+ * A differ is not thread-safe; give each consumer its own. */
+
+#define FRAMEDIFF_DEFAULT_TILE_SIZE 32
+
+typedef struct _MMFrameDiffer MMFrameDiffer;
+typedef MMFrameDiffer *MMFrameDifferRef;
+
+/* Creates a differ using `tileSize` x `tileSize` tiles (0 for the default).
+ * Follows the Create Rule (caller is responsible for destroy()'ing object).
+ * Returns NULL on error. */
+MMFrameDifferRef createMMFrameDiffer(size_t tileSize);
+
+void destroyMMFrameDiffer(MMFrameDifferRef differ);
+
+/* Forgets the previous frame, so the next one is reported as fully
+ * changed. */
+void resetMMFrameDiffer(MMFrameDifferRef differ);
+
+/* Compares `bitmap` with the previous frame and remembers it for next time.
+ * Changed tiles are merged into at most `maxRects` bounding rectangles (in
+ * bitmap coordinates) written to `rects`; the return value is how many were
+ * written, 0 meaning unchanged. The first frame, and any frame whose size or
+ * pixel format differs from the last, is reported whole. With no output
+ * buffer (`maxRects` 0) nothing is written and 1 is returned if anything
+ * changed. `outChangedPixels` (optional) receives the area of the changed
+ * tiles. Returns -1 on error. */
+int32_t diffMMFrame(MMFrameDifferRef differ, MMBitmapRef bitmap,
+                    MMRect *rects, int32_t maxRects, int64_t *outChangedPixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMEDIFF_H */
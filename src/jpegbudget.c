@@ -0,0 +1,123 @@
+#include "jpegbudget.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Aim a little under the budget while nothing fits, so a correction that
+ * slightly underestimates the size still does. Once something fits, a miss
+ * costs nothing, so aim close. */
+#define JPEG_BUDGET_AIM 0.95
+#define JPEG_BUDGET_RAISE_AIM 0.99
+
+/* Until measured: about 1.5x the bytes from quality 50 to 80. */
+#define JPEG_BUDGET_DEFAULT_SLOPE 0.4
+#define JPEG_BUDGET_MIN_SLOPE 0.05
+#define JPEG_BUDGET_MAX_SLOPE 2.0
+#define JPEG_BUDGET_FIRST_QUALITY 75
+
+/* The search runs along -ln(scale), where scale is the percentage libjpeg
+ * scales its quantisation tables by for a quality (jpeg_quality_scaling()).
+ * ln(size) is close to a straight line along it over the whole quality
+ * range, where against quality itself it bends sharply above 80. */
+static double qualityAxis(int32_t quality)
+{
+	const double scale = quality < 50 ? 5000.0 / quality : 200.0 - 2.0 * quality;
+	return -log(scale);
+}
+
+/* The highest quality at or below `axis`, clamped to the budget's range. */
+static int32_t qualityFromAxis(double axis)
+{
+	const double scale = exp(-axis);
+	const double quality = scale > 100.0 ? 5000.0 / scale : (200.0 - scale) / 2.0;
+	if (!(quality >= MM_JPEG_BUDGET_MIN_QUALITY)) return MM_JPEG_BUDGET_MIN_QUALITY;
+	if (quality > MM_JPEG_BUDGET_MAX_QUALITY) return MM_JPEG_BUDGET_MAX_QUALITY;
+	return (int32_t)floor(quality + 1e-9);
+}
+
+static bool keepJpegBudgetResult(MMJpegBudgetResult *result, const uint8_t *jpeg, int64_t size)
+{
+	if (result->capacity < (size_t)size) {
+		uint8_t *grown = realloc(result->data, (size_t)size);
+		if (grown == NULL) return false;
+		result->data = grown;
+		result->capacity = (size_t)size;
+	}
+	memcpy(result->data, jpeg, (size_t)size);
+	result->size = size;
+	return true;
+}
+
+int32_t searchMMJpegBudget(MMJpegQualityModel *model, size_t pixels, int64_t maxBytes,
+                           MMJpegBudgetEncodeFunc encode, void *context,
+                           MMJpegBudgetResult *result)
+{
+	if (maxBytes <= 0 || pixels == 0) return -1;
+
+	double slope = model->slope > 0 ? model->slope : JPEG_BUDGET_DEFAULT_SLOPE;
+	const double logPixels = log((double)pixels);
+	const double logBudget = log((double)maxBytes);
+
+	int32_t quality = JPEG_BUDGET_FIRST_QUALITY;
+	if (model->valid) {
+		const double logAim = logBudget + log(JPEG_BUDGET_AIM) - logPixels;
+		quality = qualityFromAxis(qualityAxis(model->quality) +
+		                          (logAim - model->logBytesPerPixel) / slope);
+	}
+
+	int32_t best = -1;                               /* Highest quality that fit */
+	int32_t failed = MM_JPEG_BUDGET_MAX_QUALITY + 1; /* Lowest that didn't */
+	int32_t lastQuality = -1;
+	double lastLogSize = 0;
+	bool measured = false;
+
+	for (int pass = 0; pass < MM_JPEG_BUDGET_PASSES; pass++) {
+		int64_t size = 0;
+		const uint8_t *jpeg = encode(context, quality, &size);
+		if (jpeg == NULL || size <= 0) return -1;
+
+		/* Two sizes of this frame give its own slope */
+		const double logSize = log((double)size);
+		if (lastQuality >= 0 && logSize != lastLogSize) {
+			const double frameSlope = (logSize - lastLogSize) /
+			                          (qualityAxis(quality) - qualityAxis(lastQuality));
+			if (frameSlope > 0) {
+				slope = frameSlope;
+				measured = true;
+			}
+		}
+		lastQuality = quality;
+		lastLogSize = logSize;
+
+		if (size <= maxBytes) {
+			if (quality > best) {
+				if (!keepJpegBudgetResult(result, jpeg, size)) return -1;
+				best = quality;
+			}
+		} else if (quality < failed) {
+			failed = quality;
+		}
+
+		/* Next guess, strictly between what fit and what didn't. With only
+		 * the last pass left and nothing fitting yet, take the floor: that
+		 * is the one encode that settles whether anything fits at all. */
+		const double aim = best >= 0 ? JPEG_BUDGET_RAISE_AIM : JPEG_BUDGET_AIM;
+		int32_t next = qualityFromAxis(qualityAxis(quality) +
+		                               (logBudget + log(aim) - logSize) / slope);
+		if (size > maxBytes && next >= quality) next = quality - 1;
+		if (best < 0 && pass + 2 == MM_JPEG_BUDGET_PASSES) next = MM_JPEG_BUDGET_MIN_QUALITY;
+		if (next < MM_JPEG_BUDGET_MIN_QUALITY || next <= best || next >= failed) break;
+		quality = next;
+	}
+
+	if (measured) {
+		slope = model->slope > 0 ? (model->slope + slope) / 2 : slope;
+		if (slope < JPEG_BUDGET_MIN_SLOPE) slope = JPEG_BUDGET_MIN_SLOPE;
+		if (slope > JPEG_BUDGET_MAX_SLOPE) slope = JPEG_BUDGET_MAX_SLOPE;
+		model->slope = slope;
+	}
+	model->valid = true;
+	model->quality = lastQuality;
+	model->logBytesPerPixel = lastLogSize - logPixels;
+	return best;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef JPEGBUDGET_H
+#define JPEGBUDGET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Size-targeted JPEG encoding: the highest quality whose output fits a byte
+ * budget, found with a few encodes of one frame. ln(size) is close to linear
+ * in the log of libjpeg's quantiser scale for a quality, so the search
+ * interpolates along that. The first guess comes from a model of recent frames; each
+ * further encode corrects it with the sizes measured for this frame. If
+ * nothing has fit by the last encode, that one is at the lowest quality. */
+
+#define MM_JPEG_BUDGET_MIN_QUALITY 10
+#define MM_JPEG_BUDGET_MAX_QUALITY 95
+
+/* Encodes per frame: the first guess and at most two corrections. */
+#define MM_JPEG_BUDGET_PASSES 3
+
+/* What recent frames taught: the slope of ln(size) along that scale, and the
+ * size per pixel of the last frame at the last quality tried on it. Starts
+ * zeroed. */
+typedef struct _MMJpegQualityModel {
+	bool valid;
+	int32_t quality;
+	double logBytesPerPixel;
+	double slope;   /* 0 until measured */
+} MMJpegQualityModel;
+
+/* The encode that fit best so far. Its buffer is kept between searches and
+ * only grows; free() `data` when done with it. */
+typedef struct _MMJpegBudgetResult {
+	uint8_t *data;
+	size_t capacity;
+	int64_t size;
+} MMJpegBudgetResult;
+
+/* Encodes the frame at `quality`. Returns bytes that stay valid until the
+ * next call, or NULL on error. */
+typedef const uint8_t *(*MMJpegBudgetEncodeFunc)(void *context, int32_t quality,
+                                                 int64_t *outSize);
+
+/* Encodes a frame of `pixels` pixels through `encode` at most
+ * MM_JPEG_BUDGET_PASSES times, copies the highest-quality JPEG of at most
+ * `maxBytes` bytes into `result` and updates `model`. Returns the quality of
+ * that JPEG, or -1 if none fit even at MM_JPEG_BUDGET_MIN_QUALITY or an
+ * encode failed. */
+int32_t searchMMJpegBudget(MMJpegQualityModel *model, size_t pixels, int64_t maxBytes,
+                           MMJpegBudgetEncodeFunc encode, void *context,
+                           MMJpegBudgetResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JPEGBUDGET_H */
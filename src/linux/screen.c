@@ -3,6 +3,7 @@
 #include "../highlightwindow.h"
 
 #include <X11/Xlib.h>
+#include <X11/extensions/Xinerama.h>
 #include "../xdisplay.h"
 
 MMSize getMainDisplaySize(void)
@@ -14,6 +15,38 @@ MMSize getMainDisplaySize(void)
 	                  (size_t)DisplayHeight(display, screen));
 }
 
+int32_t getMonitors(MMMonitor *monitors, int32_t maxMonitors)
+{
+	Display *display = XGetMainDisplay();
+	if (display == NULL) return -1;
+
+	int count = 0;
+	XineramaScreenInfo *screens = NULL;
+	if (XineramaIsActive(display)) {
+		screens = XineramaQueryScreens(display, &count);
+	}
+
+	/* Without Xinerama the X screen is the only monitor. Otherwise the first
+	 * Xinerama screen is treated as primary, as most window managers do. */
+	if (screens == NULL || count <= 0) {
+		if (screens != NULL) XFree(screens);
+		if (monitors != NULL && maxMonitors > 0) {
+			const MMSize size = getMainDisplaySize();
+			monitors[0].bounds = MMRectMake(0, 0, size.width, size.height);
+			monitors[0].primary = true;
+		}
+		return 1;
+	}
+
+	for (int i = 0; i < count && monitors != NULL && i < maxMonitors; i++) {
+		monitors[i].bounds = MMRectMake(screens[i].x_org, screens[i].y_org,
+		                                screens[i].width, screens[i].height);
+		monitors[i].primary = i == 0;
+	}
+	XFree(screens);
+	return (int32_t)count;
+}
+
 bool pointVisibleOnMainDisplay(MMPoint point)
 {
 	MMSize displaySize = getMainDisplaySize();
@@ -0,0 +1,275 @@
+#include "../screendamage.h"
+#include "../xdisplay.h"
+#include "../rectmerge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
+
+/* Number of damage rectangles remembered. Older damage is dropped and a query
+ * reaching past it gets the whole screen. */
+#define DAMAGE_HISTORY 1024
+
+/* Rectangles one batch of events is reduced to before it is recorded. */
+#define DAMAGE_RECTS_PER_FRAME 16
+
+typedef struct {
+	int64_t sequence;
+	MMRect rect;
+} DamageEntry;
+
+static pthread_mutex_t damageLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t damageThread;
+static int running = 0;
+static volatile int connectionLost = 0; /* Tracker thread lost the server. */
+static int wakePipe[2] = {-1, -1};
+static int64_t sequence = 0;
+static int64_t oldestSequence = 1; /* Oldest sequence still fully in history. */
+static MMSize screenSize;
+static DamageEntry history[DAMAGE_HISTORY];
+static size_t historyStart = 0;
+static size_t historyCount = 0;
+
+/* Records one batch of damage as a new frame. Called with damageLock held. */
+static void recordFrame(MMRect *rects, size_t count)
+{
+	count = mergeMMRects(rects, count, DAMAGE_RECTS_PER_FRAME);
+	sequence++;
+
+	for (size_t i = 0; i < count; i++) {
+		if (historyCount == DAMAGE_HISTORY) {
+			/* Dropping the oldest entry makes its frame incomplete. */
+			oldestSequence = history[historyStart].sequence + 1;
+			historyStart = (historyStart + 1) % DAMAGE_HISTORY;
+			historyCount--;
+		}
+		DamageEntry *entry = &history[(historyStart + historyCount) % DAMAGE_HISTORY];
+		entry->sequence = sequence;
+		entry->rect = rects[i];
+		historyCount++;
+	}
+}
+
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+static void damageIOErrorExit(Display *display, void *userData)
+{
+	(void)display;
+	(void)userData;
+	connectionLost = 1;
+}
+#endif
+
+static void *damageThreadMain(void *arg)
+{
+	Display *display = (Display *)arg;
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+	XSetRecoverableIOErrorExit(display, damageIOErrorExit, NULL);
+#endif
+	int eventBase, errorBase;
+	XDamageQueryExtension(display, &eventBase, &errorBase);
+	Damage damage = XDamageCreate(display, DefaultRootWindow(display),
+	                              XDamageReportRawRectangles);
+	XFlush(display);
+
+	MMRect batch[256];
+	size_t batchCount = 0;
+	struct pollfd fds[2];
+	fds[0].fd = ConnectionNumber(display);
+	fds[0].events = POLLIN;
+	fds[1].fd = wakePipe[0];
+	fds[1].events = POLLIN;
+
+	while (!connectionLost) {
+		if (XPending(display) == 0) {
+			if (poll(fds, 2, -1) < 0) continue;
+			if (fds[1].revents) break; /* Stop requested. */
+			if (fds[0].revents & (POLLHUP | POLLERR)) {
+				connectionLost = 1;
+				break;
+			}
+		}
+
+		/* Drain everything queued so a burst of drawing becomes one frame. */
+		while (!connectionLost && XPending(display) > 0) {
+			XEvent event;
+			XNextEvent(display, &event);
+			if (event.type != eventBase + XDamageNotify) continue;
+
+			const XDamageNotifyEvent *notify = (const XDamageNotifyEvent *)&event;
+			MMRect rect = MMRectMake(notify->area.x, notify->area.y,
+			                         notify->area.width, notify->area.height);
+			if (batchCount == sizeof(batch) / sizeof(batch[0])) {
+				batchCount = mergeMMRects(batch, batchCount, DAMAGE_RECTS_PER_FRAME);
+			}
+			batch[batchCount++] = rect;
+		}
+
+		if (batchCount > 0) {
+			pthread_mutex_lock(&damageLock);
+			recordFrame(batch, batchCount);
+			pthread_mutex_unlock(&damageLock);
+			batchCount = 0;
+		}
+	}
+
+	if (connectionLost) {
+		/* Queries now report "not tracking" until the tracker is restarted. */
+		fputs("Damage tracker lost its display connection\n", stderr);
+		XCloseRecoverableDisplay(display, 1);
+		return NULL;
+	}
+
+	XDamageDestroy(display, damage);
+	XCloseRecoverableDisplay(display, 0);
+	return NULL;
+}
+
+static bool isWaylandSession(void)
+{
+	/* XDamage on XWayland only sees X clients, which would make native
+	 * Wayland windows look static. */
+	const char *sessionType = getenv("XDG_SESSION_TYPE");
+	const char *waylandDisplay = getenv("WAYLAND_DISPLAY");
+	return (sessionType && strcmp(sessionType, "wayland") == 0) ||
+	       (waylandDisplay && waylandDisplay[0] != '\0');
+}
+
+bool startDamageTracking(void)
+{
+	if (connectionLost) {
+		/* Reap the tracker that lost its server before starting afresh. */
+		stopDamageTracking();
+	}
+
+	pthread_mutex_lock(&damageLock);
+	if (running) {
+		pthread_mutex_unlock(&damageLock);
+		return true;
+	}
+
+	bool started = false;
+	Display *display = NULL;
+	int eventBase, errorBase;
+
+	if (isWaylandSession()) goto done;
+
+	display = XOpenDisplay(getXDisplay());
+	if (display == NULL) goto done;
+	if (!XDamageQueryExtension(display, &eventBase, &errorBase)) {
+		XCloseDisplay(display);
+		goto done;
+	}
+
+	const int screen = DefaultScreen(display);
+	screenSize = MMSizeMake(DisplayWidth(display, screen), DisplayHeight(display, screen));
+
+	if (pipe(wakePipe) != 0) {
+		XCloseDisplay(display);
+		goto done;
+	}
+
+	/* Sequences stay increasing for the life of the process, so a sequence
+	 * saved before a restart never reads as current. The screen may have
+	 * changed while nothing was tracking it, so the restart counts as a
+	 * frame whose damage is unknown: anything older is reported whole. */
+	sequence++;
+	oldestSequence = sequence + 1;
+	historyStart = 0;
+	historyCount = 0;
+	connectionLost = 0;
+
+	if (pthread_create(&damageThread, NULL, damageThreadMain, display) != 0) {
+		close(wakePipe[0]);
+		close(wakePipe[1]);
+		XCloseDisplay(display);
+		goto done;
+	}
+
+	running = 1;
+	started = true;
+
+done:
+	pthread_mutex_unlock(&damageLock);
+	return started;
+}
+
+void stopDamageTracking(void)
+{
+	pthread_mutex_lock(&damageLock);
+	if (!running) {
+		pthread_mutex_unlock(&damageLock);
+		return;
+	}
+	running = 0;
+	pthread_mutex_unlock(&damageLock);
+
+	const char stop = 1;
+	if (write(wakePipe[1], &stop, 1) != 1) {
+		fputs("Could not signal damage tracker to stop\n", stderr);
+	}
+	pthread_join(damageThread, NULL);
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	wakePipe[0] = wakePipe[1] = -1;
+
+	pthread_mutex_lock(&damageLock);
+	historyCount = 0;
+	pthread_mutex_unlock(&damageLock);
+}
+
+int64_t getDamageSequence(void)
+{
+	pthread_mutex_lock(&damageLock);
+	const int64_t result = (running && !connectionLost) ? sequence : -1;
+	pthread_mutex_unlock(&damageLock);
+	return result;
+}
+
+int32_t copyDamageSince(int64_t sinceSequence, MMRect *rects, int32_t maxRects,
+                        int64_t *outSequence)
+{
+	pthread_mutex_lock(&damageLock);
+	if (!running || connectionLost) {
+		pthread_mutex_unlock(&damageLock);
+		return -1;
+	}
+	if (outSequence != NULL) *outSequence = sequence;
+
+	int32_t count = 0;
+	if (sinceSequence >= sequence) {
+		/* Nothing new. */
+	} else if (maxRects <= 0 || rects == NULL) {
+		/* Caller only wants to know whether anything changed. */
+		count = 1;
+	} else if (sinceSequence + 1 < oldestSequence) {
+		/* History doesn't reach back that far; report everything. */
+		rects[0] = MMRectMake(0, 0, screenSize.width, screenSize.height);
+		count = 1;
+	} else {
+		MMRect *collected = malloc(sizeof(MMRect) * historyCount);
+		size_t collectedCount = 0;
+		if (collected == NULL) {
+			rects[0] = MMRectMake(0, 0, screenSize.width, screenSize.height);
+			count = 1;
+		} else {
+			for (size_t i = 0; i < historyCount; i++) {
+				const DamageEntry *entry = &history[(historyStart + i) % DAMAGE_HISTORY];
+				if (entry->sequence > sinceSequence) {
+					collected[collectedCount++] = entry->rect;
+				}
+			}
+			collectedCount = mergeMMRects(collected, collectedCount, (size_t)maxRects);
+			memcpy(rects, collected, sizeof(MMRect) * collectedCount);
+			count = (int32_t)collectedCount;
+			free(collected);
+		}
+	}
+
+	pthread_mutex_unlock(&damageLock);
+	return count;
+}
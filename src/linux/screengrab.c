@@ -3,9 +3,13 @@
 #include <stdlib.h> /* malloc() */
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
 #include "../xdisplay.h"
 
 // Forward declaration for Wayland support
@@ -19,12 +23,234 @@ static int is_wayland_session(void) {
            (wayland_display && strlen(wayland_display) > 0);
 }
 
+/* Serializes use of the capture connection and the state tied to it. */
+static pthread_mutex_t captureLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Persistent MIT-SHM state. One segment, sized to the whole screen, is
+ * attached to the capture display once and reused by every grab; a region
+ * grab only wraps it in a smaller XImage header. */
+static unsigned long shmGeneration = 0; /* Capture connection it belongs to. */
+static XShmSegmentInfo shmInfo;
+static size_t shmCapacity = 0;      /* Size of the attached segment. */
+static int shmUnsupported = 0;      /* MIT-SHM failed on this connection. */
+
+/* X error trapping. The error handler is process-wide, so swapping one in
+ * around each request would race every other Xlib user in the process.
+ * Instead one handler is installed on first use and stays. It claims the
+ * errors a trap asked for (on the trapped display, from the trap's first
+ * request on) and passes every other error to the handler it replaced. */
+static pthread_once_t errorTrapOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t errorTrapLock = PTHREAD_MUTEX_INITIALIZER;
+static XErrorHandler previousErrorHandler = NULL;
+static Display *trapDisplay = NULL;      /* NULL when no trap is open. */
+static unsigned long trapFirstSerial = 0;
+static int trapError = 0;
+
+static int trappingErrorHandler(Display *display, XErrorEvent *event)
+{
+    pthread_mutex_lock(&errorTrapLock);
+    const int claimed = display == trapDisplay && event->serial >= trapFirstSerial;
+    if (claimed) trapError = 1;
+    XErrorHandler previous = previousErrorHandler;
+    pthread_mutex_unlock(&errorTrapLock);
+
+    if (claimed || previous == NULL) return 0;
+    return previous(display, event);
+}
+
+static void installTrappingErrorHandler(void)
+{
+    pthread_mutex_lock(&errorTrapLock);
+    previousErrorHandler = XSetErrorHandler(trappingErrorHandler);
+    pthread_mutex_unlock(&errorTrapLock);
+}
+
+/* Starts trapping errors caused by the requests made on `display` from now
+ * until endXErrorTrap(). One trap at a time; called with captureLock
+ * held. */
+static void beginXErrorTrap(Display *display)
+{
+    pthread_once(&errorTrapOnce, installTrappingErrorHandler);
+
+    pthread_mutex_lock(&errorTrapLock);
+    trapDisplay = display;
+    trapFirstSerial = NextRequest(display);
+    trapError = 0;
+    pthread_mutex_unlock(&errorTrapLock);
+}
+
+/* Waits for the server to answer the trapped requests and returns nonzero
+ * if any of them failed. */
+static int endXErrorTrap(Display *display)
+{
+    XSync(display, False);
+
+    pthread_mutex_lock(&errorTrapLock);
+    const int failed = trapError;
+    trapDisplay = NULL;
+    pthread_mutex_unlock(&errorTrapLock);
+    return failed;
+}
+
+/* Detaches the segment from the server (if `display` is still the
+ * connection it was attached to) and from this process. */
+static void releaseShmSegment(Display *display)
+{
+    if (shmCapacity == 0) return;
+
+    if (display != NULL) {
+        XShmDetach(display, &shmInfo);
+        XSync(display, False);
+    }
+    shmdt(shmInfo.shmaddr);
+    shmInfo.shmaddr = NULL;
+    shmInfo.shmid = -1;
+    shmCapacity = 0;
+}
+
+/* Makes sure a segment of at least `size` bytes is attached to `display`.
+ * Returns 0 if MIT-SHM can't be used, in which case the caller should fall
+ * back to XGetImage(). */
+static int ensureShmSegment(Display *display, size_t size)
+{
+    const unsigned long generation = XGetCaptureDisplayGeneration();
+    if (generation != shmGeneration) {
+        /* The display was reopened; the old attachment died with it. */
+        releaseShmSegment(NULL);
+        shmGeneration = generation;
+        shmUnsupported = !XShmQueryExtension(display);
+    }
+    if (shmUnsupported) return 0;
+    if (shmCapacity >= size) return 1;
+
+    releaseShmSegment(display);
+
+    shmInfo.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shmInfo.shmid < 0) return 0;
+
+    shmInfo.shmaddr = shmat(shmInfo.shmid, NULL, 0);
+    if (shmInfo.shmaddr == (char *)-1) {
+        shmctl(shmInfo.shmid, IPC_RMID, NULL);
+        shmInfo.shmaddr = NULL;
+        return 0;
+    }
+    shmInfo.readOnly = False;
+
+    /* Attaching fails asynchronously (BadAccess) when the server can't see
+     * our memory, e.g. on a remote display. Trap that instead of letting the
+     * default handler exit the process. */
+    beginXErrorTrap(display);
+    Status attached = XShmAttach(display, &shmInfo);
+    const int attachFailed = endXErrorTrap(display);
+
+    /* Mark for removal now; it goes away once both sides have detached. */
+    shmctl(shmInfo.shmid, IPC_RMID, NULL);
+
+    if (!attached || attachFailed) {
+        shmdt(shmInfo.shmaddr);
+        shmInfo.shmaddr = NULL;
+        shmUnsupported = 1;
+        return 0;
+    }
+
+    shmCapacity = size;
+    return 1;
+}
+
+/* Grabs `rect` into the shared segment and returns an XImage describing it,
+ * or NULL if MIT-SHM isn't usable on this display or the grab failed. The
+ * image must be released with releaseShmImage(). Called with captureLock
+ * held. */
+static XImage *grabShmImage(Display *display, MMRect rect)
+{
+    const int screen = DefaultScreen(display);
+    Visual *visual = DefaultVisual(display, screen);
+    const unsigned int depth = (unsigned int)DefaultDepth(display, screen);
+
+    /* Size the segment to the whole screen so every region fits and it is
+     * only reallocated when the screen itself grows. */
+    XImage *probe = XShmCreateImage(display, visual, depth, ZPixmap, NULL, &shmInfo,
+                                    (unsigned int)DisplayWidth(display, screen),
+                                    (unsigned int)DisplayHeight(display, screen));
+    if (probe == NULL) return NULL;
+    const size_t screenBytes = (size_t)probe->bytes_per_line * (size_t)probe->height;
+    XDestroyImage(probe);
+
+    if (!ensureShmSegment(display, screenBytes)) return NULL;
+
+    XImage *image = XShmCreateImage(display, visual, depth, ZPixmap, shmInfo.shmaddr,
+                                    &shmInfo,
+                                    (unsigned int)rect.size.width,
+                                    (unsigned int)rect.size.height);
+    if (image == NULL) return NULL;
+
+    const size_t size = (size_t)image->bytes_per_line * (size_t)image->height;
+    Status ok = False;
+    if (size <= shmCapacity) {
+        beginXErrorTrap(display);
+        ok = XShmGetImage(display, XDefaultRootWindow(display), image,
+                          (int)rect.origin.x, (int)rect.origin.y, AllPlanes);
+        if (endXErrorTrap(display)) ok = False;
+    }
+
+    if (!ok) {
+        image->data = NULL;
+        XDestroyImage(image);
+        return NULL;
+    }
+    return image;
+}
+
+static void releaseShmImage(XImage *image)
+{
+    image->data = NULL; /* The segment is not ours to free. */
+    XDestroyImage(image);
+}
+
+/* Grabs `rect` through the shared segment into a new bitmap. Returns NULL if
+ * MIT-SHM isn't usable on this display or the grab failed. Called with
+ * captureLock held. */
+static MMBitmapRef copyMMBitmapFromDisplayInRect_shm(Display *display, MMRect rect)
+{
+    XImage *image = grabShmImage(display, rect);
+    if (image == NULL) return NULL;
+
+    MMBitmapRef bitmap = NULL;
+    const size_t size = (size_t)image->bytes_per_line * (size_t)image->height;
+    uint8_t *buffer = malloc(size);
+    if (buffer != NULL) {
+        memcpy(buffer, image->data, size);
+        bitmap = createMMBitmap(buffer,
+                                rect.size.width,
+                                rect.size.height,
+                                (size_t)image->bytes_per_line,
+                                (uint8_t)image->bits_per_pixel,
+                                (uint8_t)image->bits_per_pixel / 8);
+        if (bitmap == NULL) free(buffer);
+    }
+
+    releaseShmImage(image);
+    return bitmap;
+}
+
 static MMBitmapRef copyMMBitmapFromDisplayInRect_x11(MMRect rect)
 {
  MMBitmapRef bitmap;
 
- Display *display = XOpenDisplay(NULL);
- if (display == NULL) return NULL;
+ pthread_mutex_lock(&captureLock);
+
+ Display *display = XGetCaptureDisplay();
+ if (display == NULL) {
+  pthread_mutex_unlock(&captureLock);
+  return NULL;
+ }
+
+ /* Fast path: MIT-SHM on the persistent capture connection. */
+ bitmap = copyMMBitmapFromDisplayInRect_shm(display, rect);
+ if (bitmap != NULL) {
+  pthread_mutex_unlock(&captureLock);
+  return bitmap;
+ }
  
  XImage *image = XGetImage(display,
                            XDefaultRootWindow(display),
@@ -33,7 +259,7 @@ static MMBitmapRef copyMMBitmapFromDisplayInRect_x11(MMRect rect)
                            (unsigned int)rect.size.width,
                            (unsigned int)rect.size.height,
                            AllPlanes, ZPixmap);
- XCloseDisplay(display);
+ pthread_mutex_unlock(&captureLock);
  if (image == NULL) return NULL;
 
  bitmap = createMMBitmap((uint8_t *)image->data,
@@ -63,3 +289,32 @@ MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
    // Use X11 method (works on X11 and XWayland)
    return copyMMBitmapFromDisplayInRect_x11(rect);
 }
+
+bool copyMMBitmapFromDisplayInRectInto(MMRect rect, MMBitmapRef bitmap, size_t capacity)
+{
+    /* Only the MIT-SHM path can fill a caller's buffer without an extra
+     * allocation. */
+    if (is_wayland_session() || bitmap == NULL || bitmap->imageBuffer == NULL) {
+        return false;
+    }
+
+    bool copied = false;
+    pthread_mutex_lock(&captureLock);
+    Display *display = XGetCaptureDisplay();
+    XImage *image = display != NULL ? grabShmImage(display, rect) : NULL;
+    if (image != NULL) {
+        const size_t size = (size_t)image->bytes_per_line * (size_t)image->height;
+        if (size <= capacity) {
+            memcpy(bitmap->imageBuffer, image->data, size);
+            bitmap->width = (size_t)rect.size.width;
+            bitmap->height = (size_t)rect.size.height;
+            bitmap->bytewidth = (size_t)image->bytes_per_line;
+            bitmap->bitsPerPixel = (uint8_t)image->bits_per_pixel;
+            bitmap->bytesPerPixel = (uint8_t)image->bits_per_pixel / 8;
+            copied = true;
+        }
+        releaseShmImage(image);
+    }
+    pthread_mutex_unlock(&captureLock);
+    return copied;
+}
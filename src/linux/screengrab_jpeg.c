@@ -1,138 +1,47 @@
 #include "../screengrab.h"
+#include "../screengrab_jpeg.h"
 #include "../screen.h"
 #include "../MMBitmap.h"
+#include "../pixelhash.h"
+#include "../rectmerge.h"
+#include "../screendamage.h"
+#include "../resample.h"
+#include "../workpool.h"
+#include "../jpegbudget.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <jpeglib.h>
 #include <jerror.h>
 
-// Calculate new dimensions based on constraints
-static void calculateResizedDimensions(int64_t originalWidth, int64_t originalHeight,
-                                     int32_t maxSmallDim, int32_t maxLargeDim,
-                                     int64_t* newWidth, int64_t* newHeight) {
-    // Validate input parameters
-    if (!newWidth || !newHeight || originalWidth <= 0 || originalHeight <= 0) {
-        if (newWidth) *newWidth = 1;
-        if (newHeight) *newHeight = 1;
-        return;
-    }
-    
-    *newWidth = originalWidth;
-    *newHeight = originalHeight;
-    
-    // If no constraints, return original size
-    if (maxSmallDim <= 0 && maxLargeDim <= 0) {
-        return;
-    }
-    
-    int64_t smallDim = (originalWidth < originalHeight) ? originalWidth : originalHeight;
-    int64_t largeDim = (originalWidth > originalHeight) ? originalWidth : originalHeight;
-    
-    double scale = 1.0;
-    
-    // Apply small dimension constraint
-    if (maxSmallDim > 0 && smallDim > maxSmallDim) {
-        scale = (double)maxSmallDim / (double)smallDim;
-    }
-    
-    // Apply large dimension constraint
-    if (maxLargeDim > 0 && largeDim * scale > maxLargeDim) {
-        scale = (double)maxLargeDim / (double)largeDim;
-    }
-    
-    if (scale < 1.0) {
-        *newWidth = (int64_t)(originalWidth * scale);
-        *newHeight = (int64_t)(originalHeight * scale);
-        
-        // Ensure minimum size of 1x1
-        if (*newWidth < 1) *newWidth = 1;
-        if (*newHeight < 1) *newHeight = 1;
-    }
-}
+// Forward declaration for Wayland support (screengrab_wayland.c)
+uint8_t* copyJpegFromDisplayInRect_wayland(MMRect rect, double scale, int32_t quality,
+                                           int64_t* outSize);
 
-// Simple bilinear resize function
-static uint8_t* resizeBitmap(uint8_t* srcData, int64_t srcWidth, int64_t srcHeight, 
-                           size_t srcBytewidth, uint8_t bytesPerPixel,
-                           int64_t dstWidth, int64_t dstHeight, size_t* dstBytewidth) {
-    if (!srcData || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
-        return NULL;
-    }
-    
-    // Calculate destination bytewidth (aligned to 4 bytes)
-    *dstBytewidth = ((dstWidth * bytesPerPixel + 3) / 4) * 4;
-    
-    uint8_t* dstData = (uint8_t*)malloc(*dstBytewidth * dstHeight);
-    if (!dstData) {
-        return NULL;
-    }
-    
-    double xRatio = (double)srcWidth / (double)dstWidth;
-    double yRatio = (double)srcHeight / (double)dstHeight;
-    
-    for (int64_t y = 0; y < dstHeight; y++) {
-        for (int64_t x = 0; x < dstWidth; x++) {
-            double srcX = x * xRatio;
-            double srcY = y * yRatio;
-            
-            int64_t x1 = (int64_t)srcX;
-            int64_t y1 = (int64_t)srcY;
-            int64_t x2 = (x1 + 1 < srcWidth) ? x1 + 1 : x1;
-            int64_t y2 = (y1 + 1 < srcHeight) ? y1 + 1 : y1;
-            
-            double xWeight = srcX - x1;
-            double yWeight = srcY - y1;
-            
-            for (int c = 0; c < bytesPerPixel; c++) {
-                uint8_t p1 = srcData[y1 * srcBytewidth + x1 * bytesPerPixel + c];
-                uint8_t p2 = srcData[y1 * srcBytewidth + x2 * bytesPerPixel + c];
-                uint8_t p3 = srcData[y2 * srcBytewidth + x1 * bytesPerPixel + c];
-                uint8_t p4 = srcData[y2 * srcBytewidth + x2 * bytesPerPixel + c];
-                
-                double interpolated = p1 * (1 - xWeight) * (1 - yWeight) +
-                                    p2 * xWeight * (1 - yWeight) +
-                                    p3 * (1 - xWeight) * yWeight +
-                                    p4 * xWeight * yWeight;
-                
-                dstData[y * *dstBytewidth + x * bytesPerPixel + c] = (uint8_t)interpolated;
-            }
-        }
-    }
-    
-    return dstData;
-}
+// Rows handed to libjpeg per jpeg_write_scanlines() call. Resizing and
+// pixel conversion work one band at a time, so the only full-size buffer is
+// the captured bitmap itself.
+#define JPEG_BAND_ROWS 16
 
-// Convert bitmap pixel data to RGB (JPEG needs RGB)
+// Convert rows of bitmap pixel data to RGB (JPEG needs RGB)
 // X11 can return different pixel formats (24-bit BGR, 32-bit BGRA, etc.)
-static uint8_t* convertToRGB(uint8_t* srcData, int64_t width, int64_t height, 
-                            size_t srcBytewidth, uint8_t bytesPerPixel, size_t* rgbBytewidth) {
-    if (!srcData || width <= 0 || height <= 0) {
-        return NULL;
-    }
-    
-    *rgbBytewidth = width * 3;  // RGB is 3 bytes per pixel
-    uint8_t* rgbData = (uint8_t*)malloc(*rgbBytewidth * height);
-    if (!rgbData) {
-        return NULL;
-    }
-    
-    for (int64_t y = 0; y < height; y++) {
+static void convertRowsToRGB(const uint8_t* srcData, size_t srcBytewidth, uint8_t bytesPerPixel,
+                             int64_t width, int64_t rowCount,
+                             uint8_t* rgbData, size_t rgbBytewidth) {
+    for (int64_t y = 0; y < rowCount; y++) {
         for (int64_t x = 0; x < width; x++) {
-            uint8_t* srcPixel = srcData + y * srcBytewidth + x * bytesPerPixel;
-            uint8_t* dstPixel = rgbData + y * *rgbBytewidth + x * 3;
+            const uint8_t* srcPixel = srcData + y * srcBytewidth + x * bytesPerPixel;
+            uint8_t* dstPixel = rgbData + y * rgbBytewidth + x * 3;
             
-            if (bytesPerPixel == 4) {
-                // 32-bit: Assume BGRA format
-                dstPixel[0] = srcPixel[2]; // R = B from BGRA
-                dstPixel[1] = srcPixel[1]; // G = G from BGRA  
-                dstPixel[2] = srcPixel[0]; // B = R from BGRA
+            if (bytesPerPixel == 4 || bytesPerPixel == 3) {
+                // 32-bit BGRA or 24-bit BGR
+                dstPixel[0] = srcPixel[2]; // R
+                dstPixel[1] = srcPixel[1]; // G
+                dstPixel[2] = srcPixel[0]; // B
                 // Alpha channel is ignored
-            } else if (bytesPerPixel == 3) {
-                // 24-bit: Assume BGR format
-                dstPixel[0] = srcPixel[2]; // R = B from BGR
-                dstPixel[1] = srcPixel[1]; // G = G from BGR
-                dstPixel[2] = srcPixel[0]; // B = R from BGR
             } else {
                 // Fallback: copy as-is and hope for the best
                 dstPixel[0] = (bytesPerPixel > 0) ? srcPixel[0] : 0;
@@ -141,164 +50,1015 @@ static uint8_t* convertToRGB(uint8_t* srcData, int64_t width, int64_t height,
             }
         }
     }
-    
-    return rgbData;
+}
+
+// Output buffer for the memory destination. It is kept between images and
+// only ever grows, so an encoder that is reused stops allocating once it
+// has seen its largest frame. An image can go into a caller's buffer
+// instead, as long as it fits; if it doesn't, what was written so far moves
+// to the encoder's own buffer and the image is finished there.
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t size;
+    uint8_t* target;         // Caller's buffer for the next image, or NULL
+    size_t targetCapacity;
+    int inTarget;            // The last image is in target rather than data
+} JpegOutput;
+
+// First buffer size for an encoder that hasn't written anything yet
+#define JPEG_INITIAL_OUTPUT_BYTES 65536
+
+static const uint8_t* jpegOutputBytes(const JpegOutput* output) {
+    return output->inTarget ? output->target : output->data;
+}
+
+// Grows the encoder's own buffer to at least `capacity` bytes, keeping its
+// contents.
+static int reserveJpegOutput(JpegOutput* output, size_t capacity) {
+    if (output->capacity >= capacity) {
+        return 1;
+    }
+    uint8_t* grown = (uint8_t*)realloc(output->data, capacity);
+    if (!grown) {
+        return 0;
+    }
+    output->data = grown;
+    output->capacity = capacity;
+    return 1;
 }
 
 // Memory destination manager for libjpeg
 typedef struct {
     struct jpeg_destination_mgr pub;
-    uint8_t** outbuffer;
-    int64_t* outsize;
-    uint8_t* buffer;
-    size_t bufsize;
+    JpegOutput* output;
 } mem_destination_mgr;
 
 static void init_mem_destination(j_compress_ptr cinfo) {
     mem_destination_mgr* dest = (mem_destination_mgr*)cinfo->dest;
-    dest->bufsize = 65536; // Start with 64KB
-    dest->buffer = (uint8_t*)malloc(dest->bufsize);
-    dest->pub.next_output_byte = dest->buffer;
-    dest->pub.free_in_buffer = dest->bufsize;
+    JpegOutput* output = dest->output;
+    output->inTarget = output->target != NULL && output->targetCapacity > 0;
+    if (output->inTarget) {
+        dest->pub.next_output_byte = output->target;
+        dest->pub.free_in_buffer = output->targetCapacity;
+        return;
+    }
+    if (!reserveJpegOutput(output, JPEG_INITIAL_OUTPUT_BYTES)) {
+        ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+    }
+    dest->pub.next_output_byte = output->data;
+    dest->pub.free_in_buffer = output->capacity;
 }
 
 static boolean empty_mem_output_buffer(j_compress_ptr cinfo) {
     mem_destination_mgr* dest = (mem_destination_mgr*)cinfo->dest;
-    size_t oldsize = dest->bufsize;
-    dest->bufsize *= 2;
-    dest->buffer = (uint8_t*)realloc(dest->buffer, dest->bufsize);
-    dest->pub.next_output_byte = dest->buffer + oldsize;
-    dest->pub.free_in_buffer = dest->bufsize - oldsize;
+    JpegOutput* output = dest->output;
+    size_t written = output->capacity;
+    if (output->inTarget) {
+        // The caller's buffer is full; carry on in our own
+        written = output->targetCapacity;
+        if (!reserveJpegOutput(output, written * 2 > JPEG_INITIAL_OUTPUT_BYTES
+                                           ? written * 2 : JPEG_INITIAL_OUTPUT_BYTES)) {
+            ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 1);
+        }
+        memcpy(output->data, output->target, written);
+        output->inTarget = 0;
+    } else if (!reserveJpegOutput(output, written * 2)) {
+        ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 1);
+    }
+    dest->pub.next_output_byte = output->data + written;
+    dest->pub.free_in_buffer = output->capacity - written;
     return TRUE;
 }
 
 static void term_mem_destination(j_compress_ptr cinfo) {
     mem_destination_mgr* dest = (mem_destination_mgr*)cinfo->dest;
-    *dest->outsize = dest->bufsize - dest->pub.free_in_buffer;
-    *dest->outbuffer = dest->buffer;
+    JpegOutput* output = dest->output;
+    const size_t capacity = output->inTarget ? output->targetCapacity : output->capacity;
+    output->size = capacity - dest->pub.free_in_buffer;
+    // libjpeg empties a full buffer before knowing whether more is coming,
+    // so an image that exactly fills the caller's buffer is still all there
+    if (output->target && output->size <= output->targetCapacity) {
+        output->inTarget = 1;
+    }
 }
 
-// Convert MMBitmap to JPEG using libjpeg
-static uint8_t* convertBitmapToJpeg(MMBitmapRef bitmap, int32_t quality, 
-                                   int64_t resizeWidth, int64_t resizeHeight,
-                                   int64_t* outSize) {
-    if (!bitmap || !outSize) {
-        return NULL;
+// What to encode: a bitmap, scaled to width x height
+typedef struct {
+    MMBitmapRef bitmap;
+    int64_t width;
+    int64_t height;
+    MMResampleFilter filter;
+    int quality;
+    J_COLOR_SPACE colorSpace;
+    int components;
+    int resize;
+    int convert;  // The encoder needs an RGB copy of each band
+} JpegEncodeParams;
+
+// Band buffers: resized rows in the bitmap's own format, then RGB rows if
+// the encoder can't take that format. One set per encoding thread, kept
+// for as long as the source and output geometry stay the same.
+typedef struct {
+    int valid;
+    MMResamplerRef resampler;
+    uint8_t* resizedBand;
+    uint8_t* rgbBand;
+
+    // What they were made for
+    size_t sourceWidth;
+    size_t sourceHeight;
+    uint8_t bytesPerPixel;
+    int64_t width;
+    int64_t height;
+    MMResampleFilter filter;
+    int resize;
+    int convert;
+} JpegBandBuffers;
+
+static void destroyJpegBandBuffers(JpegBandBuffers* buffers) {
+    destroyMMResampler(buffers->resampler);
+    free(buffers->resizedBand);
+    free(buffers->rgbBand);
+    memset(buffers, 0, sizeof(*buffers));
+}
+
+// Makes `buffers` fit `params`, keeping them if they already do.
+static int prepareJpegBandBuffers(const JpegEncodeParams* params, JpegBandBuffers* buffers) {
+    const MMBitmapRef bitmap = params->bitmap;
+    if (buffers->valid &&
+        buffers->sourceWidth == bitmap->width && buffers->sourceHeight == bitmap->height &&
+        buffers->bytesPerPixel == bitmap->bytesPerPixel &&
+        buffers->width == params->width && buffers->height == params->height &&
+        buffers->filter == params->filter &&
+        buffers->resize == params->resize && buffers->convert == params->convert) {
+        return 1;
     }
-    
-    *outSize = 0;
-    
-    // Clamp quality to valid range
-    int clampedQuality = quality;
-    if (clampedQuality < 0) clampedQuality = 85;  // Default quality
-    if (clampedQuality > 100) clampedQuality = 100;
-    
-    uint8_t* workingData = bitmap->imageBuffer;
-    size_t workingBytewidth = bitmap->bytewidth;
-    int64_t workingWidth = bitmap->width;
-    int64_t workingHeight = bitmap->height;
-    uint8_t* resizedData = NULL;
-    
-    // Resize if needed
-    if (resizeWidth != bitmap->width || resizeHeight != bitmap->height) {
-        size_t resizedBytewidth;
-        resizedData = resizeBitmap(bitmap->imageBuffer, bitmap->width, bitmap->height,
-                                 bitmap->bytewidth, bitmap->bytesPerPixel,
-                                 resizeWidth, resizeHeight, &resizedBytewidth);
-        if (!resizedData) {
-            return NULL;
-        }
-        workingData = resizedData;
-        workingBytewidth = resizedBytewidth;
-        workingWidth = resizeWidth;
-        workingHeight = resizeHeight;
+
+    destroyJpegBandBuffers(buffers);
+    int ok = 1;
+    if (params->resize) {
+        buffers->resizedBand = (uint8_t*)malloc((size_t)params->width * bitmap->bytesPerPixel *
+                                                JPEG_BAND_ROWS);
+        buffers->resampler = createMMResampler(bitmap->width, bitmap->height,
+                                               params->width, params->height,
+                                               bitmap->bytesPerPixel, params->filter);
+        ok = buffers->resizedBand && buffers->resampler;
     }
-    
-    // Convert to RGB format
-    size_t rgbBytewidth;
-    uint8_t* rgbData = convertToRGB(workingData, workingWidth, workingHeight,
-                                   workingBytewidth, bitmap->bytesPerPixel, &rgbBytewidth);
-    if (!rgbData) {
-        if (resizedData) free(resizedData);
-        return NULL;
+    if (ok && params->convert) {
+        buffers->rgbBand = (uint8_t*)malloc((size_t)params->width * 3 * JPEG_BAND_ROWS);
+        ok = buffers->rgbBand != NULL;
     }
-    
-    // Setup JPEG compression
+    if (!ok) {
+        destroyJpegBandBuffers(buffers);
+        return 0;
+    }
+
+    buffers->valid = 1;
+    buffers->sourceWidth = bitmap->width;
+    buffers->sourceHeight = bitmap->height;
+    buffers->bytesPerPixel = bitmap->bytesPerPixel;
+    buffers->width = params->width;
+    buffers->height = params->height;
+    buffers->filter = params->filter;
+    buffers->resize = params->resize;
+    buffers->convert = params->convert;
+    return 1;
+}
+
+// A libjpeg compressor and everything it reuses from one image to the next:
+// the quantisation and Huffman tables for the last quality and pixel
+// format, the band buffers and the output buffer. libjpeg keeps pointers
+// into it, so it must not move once initialised.
+typedef struct {
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
-    mem_destination_mgr dest_mgr;
-    uint8_t* jpegData = NULL;
+    mem_destination_mgr dest;
+    JpegOutput output;
+    int configured;  // cinfo's tables are set up for quality and colorSpace
+    int quality;
+    J_COLOR_SPACE colorSpace;
+    JpegBandBuffers buffers;
+} JpegCoder;
+
+static void initJpegCoder(JpegCoder* coder) {
+    memset(coder, 0, sizeof(*coder));
+    coder->cinfo.err = jpeg_std_error(&coder->jerr);
+    jpeg_create_compress(&coder->cinfo);
+
+    coder->dest.pub.init_destination = init_mem_destination;
+    coder->dest.pub.empty_output_buffer = empty_mem_output_buffer;
+    coder->dest.pub.term_destination = term_mem_destination;
+    coder->dest.output = &coder->output;
+    coder->cinfo.dest = &coder->dest.pub;
+}
+
+static void destroyJpegCoder(JpegCoder* coder) {
+    jpeg_destroy_compress(&coder->cinfo);
+    destroyJpegBandBuffers(&coder->buffers);
+    free(coder->output.data);
+}
+
+// Encodes destination rows [firstRow, firstRow + rowCount) as a JPEG of
+// their own into coder->output, resizing and converting them a band at a
+// time. A non-zero restartInterval (in MCUs) is written to the header for
+// strips that are joined later.
+static int encodeJpegRows(JpegCoder* coder, const JpegEncodeParams* params,
+                          int64_t firstRow, int64_t rowCount, unsigned int restartInterval) {
+    MMBitmapRef bitmap = params->bitmap;
+    const uint8_t bytesPerPixel = bitmap->bytesPerPixel;
+    const size_t resizedBytewidth = (size_t)params->width * bytesPerPixel;
+    const size_t rgbBytewidth = (size_t)params->width * 3;
+
+    coder->output.size = 0;
+    JpegBandBuffers* buffers = &coder->buffers;
+    if (!prepareJpegBandBuffers(params, buffers)) {
+        return 0;
+    }
     
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
+    // Set compression parameters. They persist in cinfo between images, so
+    // the tables are only rebuilt when quality or pixel format change.
+    struct jpeg_compress_struct* cinfo = &coder->cinfo;
+    cinfo->image_width = (JDIMENSION)params->width;
+    cinfo->image_height = (JDIMENSION)rowCount;
+    cinfo->input_components = params->components;
+    cinfo->in_color_space = params->colorSpace;
+    if (!coder->configured || coder->quality != params->quality ||
+        coder->colorSpace != params->colorSpace) {
+        jpeg_set_defaults(cinfo);
+        jpeg_set_quality(cinfo, params->quality, TRUE);
+        coder->configured = 1;
+        coder->quality = params->quality;
+        coder->colorSpace = params->colorSpace;
+    }
+    cinfo->restart_interval = restartInterval;
     
-    // Setup memory destination
-    dest_mgr.pub.init_destination = init_mem_destination;
-    dest_mgr.pub.empty_output_buffer = empty_mem_output_buffer;
-    dest_mgr.pub.term_destination = term_mem_destination;
-    dest_mgr.outbuffer = &jpegData;
-    dest_mgr.outsize = outSize;
-    cinfo.dest = (struct jpeg_destination_mgr*)&dest_mgr;
+    // Start compression
+    jpeg_start_compress(cinfo, TRUE);
     
-    // Set compression parameters
-    cinfo.image_width = (JDIMENSION)workingWidth;
-    cinfo.image_height = (JDIMENSION)workingHeight;
-    cinfo.input_components = 3; // RGB
-    cinfo.in_color_space = JCS_RGB;
+    // Produce and write scanlines a band at a time
+    JSAMPROW rowPointers[JPEG_BAND_ROWS];
+    while (cinfo->next_scanline < cinfo->image_height) {
+        const int64_t bandRow = firstRow + cinfo->next_scanline;
+        int64_t bandRows = firstRow + rowCount - bandRow;
+        if (bandRows > JPEG_BAND_ROWS) bandRows = JPEG_BAND_ROWS;
+
+        uint8_t* band = bitmap->imageBuffer + bandRow * bitmap->bytewidth;
+        size_t bandBytewidth = bitmap->bytewidth;
+        if (params->resize) {
+            if (!resampleMMRows(buffers->resampler, bitmap->imageBuffer, bitmap->bytewidth,
+                                bandRow, bandRows, buffers->resizedBand, resizedBytewidth)) {
+                // Back to idle with the tables kept, and nothing half-written
+                jpeg_abort_compress(cinfo);
+                coder->output.size = 0;
+                return 0;
+            }
+            band = buffers->resizedBand;
+            bandBytewidth = resizedBytewidth;
+        }
+        if (params->convert) {
+            convertRowsToRGB(band, bandBytewidth, bytesPerPixel, params->width, bandRows,
+                             buffers->rgbBand, rgbBytewidth);
+            band = buffers->rgbBand;
+            bandBytewidth = rgbBytewidth;
+        }
+
+        for (int64_t row = 0; row < bandRows; row++) {
+            rowPointers[row] = band + row * bandBytewidth;
+        }
+        jpeg_write_scanlines(cinfo, rowPointers, (JDIMENSION)bandRows);
+    }
     
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo, clampedQuality, TRUE);
+    // Finish compression; the compressor stays ready for the next image
+    jpeg_finish_compress(cinfo);
+    return coder->output.size > 0;
+}
     
-    // Start compression
-    jpeg_start_compress(&cinfo, TRUE);
+struct _MMJpegEncoder {
+    JpegCoder coder;          // Single-threaded encodes
+    JpegCoder* stripCoders;   // One per strip of parallel encodes
+    size_t stripCount;
+    JpegOutput joined;        // Parallel encodes, joined into one JPEG
+
+    // Byte-budget encodes: the frame resized once for every pass, the
+    // quality model and the best pass
+    JpegBandBuffers budgetBuffers;
+    MMBitmap budgetFrame;
+    size_t budgetFrameCapacity;
+    MMJpegQualityModel model;
+    MMJpegBudgetResult budget;
+};
     
-    // Write scanlines
-    JSAMPROW row_pointer[1];
-    while (cinfo.next_scanline < cinfo.image_height) {
-        row_pointer[0] = rgbData + cinfo.next_scanline * rgbBytewidth;
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
+MMJpegEncoderRef createMMJpegEncoder(void) {
+    MMJpegEncoderRef encoder = (MMJpegEncoderRef)calloc(1, sizeof(MMJpegEncoder));
+    if (!encoder) {
+        return NULL;
+    }
+    initJpegCoder(&encoder->coder);
+    return encoder;
+}
+
+static void destroyJpegStripCoders(MMJpegEncoderRef encoder) {
+    for (size_t i = 0; i < encoder->stripCount; i++) {
+        destroyJpegCoder(&encoder->stripCoders[i]);
+    }
+    free(encoder->stripCoders);
+    encoder->stripCoders = NULL;
+    encoder->stripCount = 0;
+}
+
+void destroyMMJpegEncoder(MMJpegEncoderRef encoder) {
+    if (!encoder) {
+        return;
+    }
+    destroyJpegCoder(&encoder->coder);
+    destroyJpegStripCoders(encoder);
+    free(encoder->joined.data);
+    destroyJpegBandBuffers(&encoder->budgetBuffers);
+    free(encoder->budgetFrame.imageBuffer);
+    free(encoder->budget.data);
+    free(encoder);
+}
+
+// Parallel encoding. The image is cut into horizontal strips of whole MCU
+// rows and each strip is resized, converted and encoded on its own, as a
+// JPEG whose restart interval is exactly one strip. Joining them is then
+// only a matter of keeping the first strip's headers (with the full image
+// height), and putting the restart markers libjpeg would have written
+// between the strips' entropy-coded data. The result decodes to the same
+// pixels as a single-threaded encode with that restart interval.
+
+// Threads used per encode (1: the calling thread only), and the pool of
+// helpers for them. An encode that finds the pool busy runs single-threaded
+// rather than queueing behind another one.
+static pthread_mutex_t jpegPoolLock = PTHREAD_MUTEX_INITIALIZER;
+static MMWorkPoolRef jpegPool = NULL;
+static int32_t jpegThreads = 1;
+
+// Strips shorter than this aren't worth a thread
+#define JPEG_MIN_STRIP_ROWS 64
+
+typedef struct {
+    const JpegEncodeParams* params;
+    int64_t stripRows;
+    unsigned int restartInterval;
+    JpegCoder* coders;
+} JpegStripJob;
+
+static void encodeJpegStrip(void* context, size_t index) {
+    JpegStripJob* job = (JpegStripJob*)context;
+    const int64_t firstRow = (int64_t)index * job->stripRows;
+    int64_t rowCount = job->params->height - firstRow;
+    if (rowCount > job->stripRows) rowCount = job->stripRows;
+    encodeJpegRows(&job->coders[index], job->params, firstRow, rowCount, job->restartInterval);
+}
+
+// Returns the offset of the entropy-coded data in an encoded strip (just
+// past its SOS segment), or 0 if the headers don't parse.
+static size_t findJpegScanData(const uint8_t* jpeg, size_t size, size_t* sofOffset) {
+    size_t pos = 2;
+    while (pos + 4 <= size && jpeg[pos] == 0xFF) {
+        const uint8_t marker = jpeg[pos + 1];
+        const size_t length = ((size_t)jpeg[pos + 2] << 8) | jpeg[pos + 3];
+        if (marker >= 0xC0 && marker <= 0xC2 && sofOffset) {
+            *sofOffset = pos;
+        }
+        pos += 2 + length;
+        if (marker == 0xDA) {
+            return pos <= size ? pos : 0;
+        }
+    }
+    return 0;
+}
+
+// Joins strips encoded by encodeJpegStrip() into one JPEG of `height` rows
+// in `joined`, going straight to its target when the whole JPEG fits.
+static int joinJpegStrips(const JpegCoder* coders, size_t count, int64_t height,
+                          JpegOutput* joined) {
+    size_t sofOffset = 0;
+    const JpegOutput* first = &coders[0].output;
+    const size_t headerSize = findJpegScanData(first->data, first->size, &sofOffset);
+    if (headerSize == 0 || sofOffset == 0) {
+        return 0;
+    }
+
+    size_t total = headerSize + 2;
+    for (size_t i = 0; i < count; i++) {
+        const JpegOutput* strip = &coders[i].output;
+        const size_t scanStart = findJpegScanData(strip->data, strip->size, NULL);
+        if (scanStart == 0 || strip->size < scanStart + 2) {
+            return 0;
+        }
+        // Scan data, minus EOI, plus the restart marker before the next strip
+        total += strip->size - 2 - scanStart + (i + 1 < count ? 2 : 0);
+    }
+
+    joined->inTarget = joined->target != NULL && joined->targetCapacity > 0 &&
+                       total <= joined->targetCapacity;
+    if (!joined->inTarget && !reserveJpegOutput(joined, total)) {
+        return 0;
+    }
+
+    uint8_t* jpeg = joined->inTarget ? joined->target : joined->data;
+    memcpy(jpeg, first->data, headerSize);
+    jpeg[sofOffset + 5] = (uint8_t)(height >> 8);
+    jpeg[sofOffset + 6] = (uint8_t)height;
+
+    size_t pos = headerSize;
+    for (size_t i = 0; i < count; i++) {
+        const JpegOutput* strip = &coders[i].output;
+        const size_t scanStart = findJpegScanData(strip->data, strip->size, NULL);
+        const size_t length = strip->size - 2 - scanStart;
+        memcpy(jpeg + pos, strip->data + scanStart, length);
+        pos += length;
+        if (i + 1 < count) {
+            jpeg[pos++] = 0xFF;
+            jpeg[pos++] = (uint8_t)(JPEG_RST0 + (i % 8));
+        }
+    }
+    jpeg[pos++] = 0xFF;
+    jpeg[pos++] = (uint8_t)JPEG_EOI;
+
+    joined->size = pos;
+    return 1;
+}
+
+// Encodes in strips on `pool`, with one of the encoder's strip coders per
+// strip. Returns NULL, having done nothing, if the image is too small to
+// split.
+static JpegOutput* encodeJpegStrips(MMJpegEncoderRef encoder, const JpegEncodeParams* params,
+                                    MMWorkPoolRef pool) {
+    // MCU size of the default 4:2:0 sampling, as jpeg_set_defaults() sets it
+    const int64_t mcuWidth = 2 * DCTSIZE;
+    const int64_t mcuHeight = 2 * DCTSIZE;
+    const int64_t mcusPerRow = (params->width + mcuWidth - 1) / mcuWidth;
+
+    const int64_t threads = (int64_t)getMMWorkPoolThreadCount(pool);
+    int64_t stripRows = (params->height + threads - 1) / threads;
+    stripRows = (stripRows + mcuHeight - 1) / mcuHeight * mcuHeight;
+    if (stripRows < JPEG_MIN_STRIP_ROWS) {
+        stripRows = JPEG_MIN_STRIP_ROWS;
+    }
+    // The restart interval is a 16-bit count of MCUs
+    const int64_t maxStripRows = 65535 / mcusPerRow * mcuHeight;
+    if (stripRows > maxStripRows) {
+        stripRows = maxStripRows;
+    }
+    if (stripRows <= 0 || stripRows >= params->height) {
+        return NULL;
+    }
+
+    const size_t count = (size_t)((params->height + stripRows - 1) / stripRows);
+    if (encoder->stripCount != count) {
+        destroyJpegStripCoders(encoder);
+        encoder->stripCoders = (JpegCoder*)calloc(count, sizeof(JpegCoder));
+        if (!encoder->stripCoders) {
+            return NULL;
+        }
+        for (size_t i = 0; i < count; i++) {
+            initJpegCoder(&encoder->stripCoders[i]);
+        }
+        encoder->stripCount = count;
+    }
+
+    JpegStripJob job = {
+        params, stripRows, (unsigned int)(stripRows / mcuHeight * mcusPerRow), encoder->stripCoders
+    };
+    runMMWorkPool(pool, count, encodeJpegStrip, &job);
+
+    for (size_t i = 0; i < count; i++) {
+        if (encoder->stripCoders[i].output.size == 0) {
+            return NULL;
+        }
     }
+    if (!joinJpegStrips(encoder->stripCoders, count, params->height, &encoder->joined)) {
+        return NULL;
+    }
+    return &encoder->joined;
+}
+
+void setJpegThreads_LINUX(int32_t threads) {
+    if (threads <= 0) {
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int32_t)cores : 1;
+    }
+
+    pthread_mutex_lock(&jpegPoolLock);
+    if (threads != jpegThreads) {
+        destroyMMWorkPool(jpegPool);
+        jpegPool = threads > 1 ? createMMWorkPool((size_t)threads) : NULL;
+        jpegThreads = jpegPool ? (int32_t)getMMWorkPoolThreadCount(jpegPool) : 1;
+    }
+    pthread_mutex_unlock(&jpegPoolLock);
+}
+
+int32_t getJpegThreads_LINUX(void) {
+    pthread_mutex_lock(&jpegPoolLock);
+    const int32_t threads = jpegThreads;
+    pthread_mutex_unlock(&jpegPoolLock);
+    return threads;
+}
+
+// Convert MMBitmap to JPEG using libjpeg, with `encoder`'s state, into
+// `buffer` if it fits in `capacity` bytes. Returns the encoder's output
+// holding the JPEG, or NULL on error.
+static JpegOutput* convertBitmapToJpeg(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                       int32_t quality, int64_t resizeWidth,
+                                       int64_t resizeHeight, MMResampleFilter filter,
+                                       uint8_t* buffer, size_t capacity) {
+    if (!bitmap || !bitmap->imageBuffer || resizeWidth <= 0 || resizeHeight <= 0) {
+        return NULL;
+    }
+
+    // An empty buffer can't take a single byte: libjpeg writes before it
+    // checks for room, so encode into our own output instead
+    if (capacity == 0) {
+        buffer = NULL;
+    }
+    encoder->coder.output.target = buffer;
+    encoder->coder.output.targetCapacity = buffer ? capacity : 0;
+    encoder->joined.target = buffer;
+    encoder->joined.targetCapacity = buffer ? capacity : 0;
     
-    // Finish compression
-    jpeg_finish_compress(&cinfo);
-    jpeg_destroy_compress(&cinfo);
+    // Clamp quality to valid range
+    int clampedQuality = quality;
+    if (clampedQuality < 0) clampedQuality = 85;  // Default quality
+    if (clampedQuality > 100) clampedQuality = 100;
     
-    // Clean up
-    free(rgbData);
-    if (resizedData) free(resizedData);
+    JpegEncodeParams params;
+    params.bitmap = bitmap;
+    params.width = resizeWidth;
+    params.height = resizeHeight;
+    params.filter = filter;
+    params.quality = clampedQuality;
+    params.resize = resizeWidth != (int64_t)bitmap->width ||
+                    resizeHeight != (int64_t)bitmap->height;
+
+    // libjpeg-turbo takes BGRX/BGR scanlines as they are, so the pixels go
+    // to the encoder without a swizzled copy. Plain libjpeg only takes RGB.
+    params.colorSpace = JCS_RGB;
+    params.components = 3;
+#ifdef JCS_EXTENSIONS
+    if (bitmap->bytesPerPixel == 4) {
+        params.colorSpace = JCS_EXT_BGRX;
+        params.components = 4;
+    } else if (bitmap->bytesPerPixel == 3) {
+        params.colorSpace = JCS_EXT_BGR;
+    }
+#endif
+    params.convert = params.colorSpace == JCS_RGB;
+
+    // Split across the pool if it's free; otherwise encode right here
+    if (pthread_mutex_trylock(&jpegPoolLock) == 0) {
+        JpegOutput* output = jpegPool ? encodeJpegStrips(encoder, &params, jpegPool) : NULL;
+        pthread_mutex_unlock(&jpegPoolLock);
+        if (output) {
+            return output;
+        }
+    }
+    if (!encodeJpegRows(&encoder->coder, &params, 0, resizeHeight, 0)) {
+        return NULL;
+    }
+    return &encoder->coder.output;
+}
+
+static JpegOutput* encodeBitmapJpegWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                        int32_t maxSmallDim, int32_t maxLargeDim,
+                                        int32_t quality, int32_t filter,
+                                        uint8_t* buffer, size_t capacity) {
+    if (!encoder || !bitmap) {
+        return NULL;
+    }
+
+    // Calculate resize dimensions
+    int64_t newWidth, newHeight;
+    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim, 
+                              &newWidth, &newHeight);
     
-    return jpegData;
+    return convertBitmapToJpeg(encoder, bitmap, quality, newWidth, newHeight,
+                               (MMResampleFilter)filter, buffer, capacity);
+}
+
+const uint8_t* encodeMMBitmapJpegWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t quality, int32_t filter,
+                                      uint8_t* buffer, size_t capacity, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    JpegOutput* output = encodeBitmapJpegWith(encoder, bitmap, maxSmallDim, maxLargeDim,
+                                              quality, filter, buffer, capacity);
+    if (!output) {
+        return NULL;
+    }
+    if (outSize) *outSize = (int64_t)output->size;
+    return jpegOutputBytes(output);
+}
+
+uint8_t* encodeMMBitmapJpeg(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                            int32_t quality, int32_t filter, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    MMJpegEncoderRef encoder = createMMJpegEncoder();
+    JpegOutput* output = encodeBitmapJpegWith(encoder, bitmap, maxSmallDim, maxLargeDim,
+                                              quality, filter, NULL, 0);
+
+    // A one-off encode hands the encoder's buffer to the caller
+    uint8_t* jpeg = NULL;
+    if (output) {
+        jpeg = output->data;
+        if (outSize) *outSize = (int64_t)output->size;
+        output->data = NULL;
+        output->capacity = 0;
+    }
+    destroyMMJpegEncoder(encoder);
+    return jpeg;
+}
+
+// Byte-budget encoding (see jpegbudget.h). The frame is resized once into
+// the encoder, and every pass encodes those pixels as they are.
+
+// Quality model for one-off budget encodes, shared by all of them
+static pthread_mutex_t jpegModelLock = PTHREAD_MUTEX_INITIALIZER;
+static MMJpegQualityModel jpegModel;
+
+typedef struct {
+    MMJpegEncoderRef encoder;
+    MMBitmapRef frame;
+    MMResampleFilter filter;
+} JpegBudgetPass;
+
+static const uint8_t* encodeJpegBudgetPass(void* context, int32_t quality, int64_t* outSize) {
+    JpegBudgetPass* pass = (JpegBudgetPass*)context;
+    JpegOutput* output = convertBitmapToJpeg(pass->encoder, pass->frame, quality,
+                                             (int64_t)pass->frame->width,
+                                             (int64_t)pass->frame->height,
+                                             pass->filter, NULL, 0);
+    if (!output) {
+        return NULL;
+    }
+    *outSize = (int64_t)output->size;
+    return jpegOutputBytes(output);
+}
+
+// Returns `bitmap` resized to width x height in the encoder's budget frame,
+// or `bitmap` itself if it already has that size.
+static MMBitmapRef resizeJpegBudgetFrame(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                         int64_t width, int64_t height,
+                                         MMResampleFilter filter) {
+    if (width == (int64_t)bitmap->width && height == (int64_t)bitmap->height) {
+        return bitmap;
+    }
+
+    JpegEncodeParams params;
+    memset(&params, 0, sizeof(params));
+    params.bitmap = bitmap;
+    params.width = width;
+    params.height = height;
+    params.filter = filter;
+    params.resize = 1;
+    if (!prepareJpegBandBuffers(&params, &encoder->budgetBuffers)) {
+        return NULL;
+    }
+
+    MMBitmap* frame = &encoder->budgetFrame;
+    const size_t bytewidth = (size_t)width * bitmap->bytesPerPixel;
+    const size_t size = bytewidth * (size_t)height;
+    if (encoder->budgetFrameCapacity < size) {
+        uint8_t* grown = (uint8_t*)realloc(frame->imageBuffer, size);
+        if (!grown) {
+            return NULL;
+        }
+        frame->imageBuffer = grown;
+        encoder->budgetFrameCapacity = size;
+    }
+    frame->width = (size_t)width;
+    frame->height = (size_t)height;
+    frame->bytewidth = bytewidth;
+    frame->bitsPerPixel = bitmap->bitsPerPixel;
+    frame->bytesPerPixel = bitmap->bytesPerPixel;
+
+    if (!resampleMMRows(encoder->budgetBuffers.resampler, bitmap->imageBuffer, bitmap->bytewidth,
+                        0, (size_t)height, frame->imageBuffer, bytewidth)) {
+        return NULL;
+    }
+    return frame;
+}
+
+static MMJpegBudgetResult* encodeBitmapJpegBudget(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                                  int32_t maxSmallDim, int32_t maxLargeDim,
+                                                  int64_t maxBytes, int32_t filter,
+                                                  int32_t* outQuality) {
+    if (outQuality) *outQuality = -1;
+    if (!encoder || !bitmap || !bitmap->imageBuffer) {
+        return NULL;
+    }
+
+    int64_t newWidth, newHeight;
+    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim,
+                              &newWidth, &newHeight);
+    JpegBudgetPass pass;
+    pass.encoder = encoder;
+    pass.filter = (MMResampleFilter)filter;
+    pass.frame = resizeJpegBudgetFrame(encoder, bitmap, newWidth, newHeight, pass.filter);
+    if (!pass.frame) {
+        return NULL;
+    }
+
+    const int32_t quality = searchMMJpegBudget(&encoder->model,
+                                               pass.frame->width * pass.frame->height,
+                                               maxBytes, encodeJpegBudgetPass, &pass,
+                                               &encoder->budget);
+    if (outQuality) *outQuality = quality;
+    return quality >= 0 ? &encoder->budget : NULL;
+}
+
+const uint8_t* encodeMMBitmapJpegBudgetWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int64_t maxBytes, int32_t filter,
+                                            int32_t* outQuality, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    MMJpegBudgetResult* result = encodeBitmapJpegBudget(encoder, bitmap, maxSmallDim,
+                                                        maxLargeDim, maxBytes, filter,
+                                                        outQuality);
+    if (!result) {
+        return NULL;
+    }
+    if (outSize) *outSize = result->size;
+    return result->data;
+}
+
+uint8_t* encodeMMBitmapJpegBudget(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                                  int64_t maxBytes, int32_t filter,
+                                  int32_t* outQuality, int64_t* outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+    MMJpegEncoderRef encoder = createMMJpegEncoder();
+    if (!encoder) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&jpegModelLock);
+    encoder->model = jpegModel;
+    pthread_mutex_unlock(&jpegModelLock);
+
+    MMJpegBudgetResult* result = encodeBitmapJpegBudget(encoder, bitmap, maxSmallDim,
+                                                        maxLargeDim, maxBytes, filter,
+                                                        outQuality);
+
+    pthread_mutex_lock(&jpegModelLock);
+    jpegModel = encoder->model;
+    pthread_mutex_unlock(&jpegModelLock);
+
+    // Hand the best pass's buffer to the caller
+    uint8_t* jpeg = NULL;
+    if (result) {
+        jpeg = result->data;
+        if (outSize) *outSize = result->size;
+        result->data = NULL;
+        result->capacity = 0;
+    }
+    destroyMMJpegEncoder(encoder);
+    return jpeg;
+}
+
+// Capture result cache. Repeated requests for the same region and encoding
+// parameters get the previous JPEG back while the screen is unchanged, which
+// is decided by damage tracking when it is running and by a frame hash
+// otherwise. Either way a hit skips resizing and libjpeg entirely.
+#define JPEG_CACHE_ENTRIES 4
+#define JPEG_CACHE_DAMAGE_RECTS 16
+
+typedef struct {
+    int valid;
+    MMRect rect;
+    int32_t maxSmallDim;
+    int32_t maxLargeDim;
+    int32_t quality;
+    int32_t filter;
+    int64_t damageSequence;  // Damage sequence at capture time, -1 if untracked
+    uint64_t frameHash;      // 0 if grim encoded it: only damage can match
+    uint64_t lastUsed;
+    uint8_t* jpeg;
+    int64_t size;
+} JpegCacheEntry;
+
+static pthread_mutex_t jpegCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static JpegCacheEntry jpegCache[JPEG_CACHE_ENTRIES];
+static int jpegCacheEnabled = 1;
+static uint64_t jpegCacheClock = 0;
+static int64_t jpegCacheHits = 0;
+static int64_t jpegCacheMisses = 0;
+
+static JpegCacheEntry* findJpegCacheEntry(MMRect rect, int32_t maxSmallDim,
+                                          int32_t maxLargeDim, int32_t quality,
+                                          int32_t filter) {
+    for (int i = 0; i < JPEG_CACHE_ENTRIES; i++) {
+        JpegCacheEntry* entry = &jpegCache[i];
+        if (entry->valid &&
+            entry->rect.origin.x == rect.origin.x && entry->rect.origin.y == rect.origin.y &&
+            entry->rect.size.width == rect.size.width && entry->rect.size.height == rect.size.height &&
+            entry->maxSmallDim == maxSmallDim && entry->maxLargeDim == maxLargeDim &&
+            entry->quality == quality && entry->filter == filter) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Returns whether damage tracking proves `rect` unchanged since `sinceSequence`.
+static int regionUndamagedSince(MMRect rect, int64_t sinceSequence) {
+    if (sinceSequence < 0) {
+        return 0;
+    }
+
+    MMRect damaged[JPEG_CACHE_DAMAGE_RECTS];
+    int32_t count = copyDamageSince(sinceSequence, damaged, JPEG_CACHE_DAMAGE_RECTS, NULL);
+    if (count < 0) {
+        return 0;
+    }
+
+    for (int32_t i = 0; i < count; i++) {
+        if (MMRectsIntersect(damaged[i], rect)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Returns a caller-owned copy of a cache entry's JPEG and counts the hit.
+// Called with jpegCacheLock held.
+static uint8_t* copyJpegCacheHit(JpegCacheEntry* entry, int64_t* outSize) {
+    uint8_t* copy = (uint8_t*)malloc((size_t)entry->size);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, entry->jpeg, (size_t)entry->size);
+    entry->lastUsed = ++jpegCacheClock;
+    jpegCacheHits++;
+    if (outSize) *outSize = entry->size;
+    return copy;
+}
+
+// Stores a freshly encoded JPEG, replacing the entry for the same key or the
+// least recently used one. Called with jpegCacheLock held.
+static void storeJpegCacheEntry(MMRect rect, int32_t maxSmallDim, int32_t maxLargeDim,
+                                int32_t quality, int32_t filter, int64_t damageSequence,
+                                uint64_t frameHash, const uint8_t* jpeg, int64_t size) {
+    JpegCacheEntry* entry = findJpegCacheEntry(rect, maxSmallDim, maxLargeDim, quality, filter);
+    if (!entry) {
+        entry = &jpegCache[0];
+        for (int i = 1; i < JPEG_CACHE_ENTRIES && entry->valid; i++) {
+            if (!jpegCache[i].valid || jpegCache[i].lastUsed < entry->lastUsed) {
+                entry = &jpegCache[i];
+            }
+        }
+    }
+
+    uint8_t* copy = (uint8_t*)realloc(entry->valid ? entry->jpeg : NULL, (size_t)size);
+    if (!copy) {
+        if (entry->valid) free(entry->jpeg);
+        memset(entry, 0, sizeof(*entry));
+        return;
+    }
+    memcpy(copy, jpeg, (size_t)size);
+
+    entry->valid = 1;
+    entry->rect = rect;
+    entry->maxSmallDim = maxSmallDim;
+    entry->maxLargeDim = maxLargeDim;
+    entry->quality = quality;
+    entry->filter = filter;
+    entry->damageSequence = damageSequence;
+    entry->frameHash = frameHash;
+    entry->lastUsed = ++jpegCacheClock;
+    entry->jpeg = copy;
+    entry->size = size;
+}
+
+void clearJpegCache_LINUX(void) {
+    pthread_mutex_lock(&jpegCacheLock);
+    for (int i = 0; i < JPEG_CACHE_ENTRIES; i++) {
+        if (jpegCache[i].valid) free(jpegCache[i].jpeg);
+        memset(&jpegCache[i], 0, sizeof(jpegCache[i]));
+    }
+    jpegCacheHits = 0;
+    jpegCacheMisses = 0;
+    pthread_mutex_unlock(&jpegCacheLock);
+}
+
+void setJpegCacheEnabled_LINUX(int32_t enabled) {
+    pthread_mutex_lock(&jpegCacheLock);
+    jpegCacheEnabled = enabled != 0;
+    pthread_mutex_unlock(&jpegCacheLock);
+    if (!enabled) {
+        clearJpegCache_LINUX();
+    }
+}
+
+void getJpegCacheStats_LINUX(int64_t* hits, int64_t* misses) {
+    pthread_mutex_lock(&jpegCacheLock);
+    if (hits) *hits = jpegCacheHits;
+    if (misses) *misses = jpegCacheMisses;
+    pthread_mutex_unlock(&jpegCacheLock);
 }
 
 // Linux implementation for region JPEG capture
 uint8_t* copyBitmapRegionJpeg_LINUX(int64_t x, int64_t y, int64_t width, int64_t height, 
                                     int32_t maxSmallDim, int32_t maxLargeDim, 
-                                    int32_t quality, int64_t* outSize) {
+                                    int32_t quality, int32_t filter, int64_t* outSize) {
     if (outSize) *outSize = 0;
+
+    MMRect rect = MMRectMake(x, y, width, height);
+    uint8_t* result = NULL;
+
+    // Damage tracking can answer without grabbing at all
+    pthread_mutex_lock(&jpegCacheLock);
+    const int cacheEnabled = jpegCacheEnabled;
+    if (cacheEnabled) {
+        JpegCacheEntry* entry = findJpegCacheEntry(rect, maxSmallDim, maxLargeDim, quality, filter);
+        if (entry && regionUndamagedSince(rect, entry->damageSequence)) {
+            result = copyJpegCacheHit(entry, outSize);
+        }
+    }
+    pthread_mutex_unlock(&jpegCacheLock);
+    if (result) {
+        return result;
+    }
+
+    // Read the sequence before grabbing so damage racing the grab still
+    // invalidates the entry next time
+    const int64_t damageSequence = cacheEnabled ? getDamageSequence() : -1;
+
+    // Without a native Wayland capture path, grim can encode (and scale) the
+    // JPEG itself, which saves decoding its output and encoding it again.
+    // grim scales with its own filter, so this is only for the default one
+    // or when there is nothing to scale.
+    if (width > 0 && height > 0) {
+        int64_t scaledWidth, scaledHeight;
+        calculateResizedDimensions(width, height, maxSmallDim, maxLargeDim,
+                                   &scaledWidth, &scaledHeight);
+        const int resized = scaledWidth != width || scaledHeight != height;
+        int64_t size = 0;
+        if (!resized || filter == MMResampleArea) {
+            result = copyJpegFromDisplayInRect_wayland(rect, (double)scaledWidth / (double)width,
+                                                       quality, &size);
+        }
+        if (result) {
+            if (cacheEnabled) {
+                pthread_mutex_lock(&jpegCacheLock);
+                jpegCacheMisses++;
+                storeJpegCacheEntry(rect, maxSmallDim, maxLargeDim, quality, filter,
+                                    damageSequence, 0, result, size);
+                pthread_mutex_unlock(&jpegCacheLock);
+            }
+            if (outSize) *outSize = size;
+            return result;
+        }
+    }
     
     // Capture the region as bitmap first
-    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(rect);
     if (!bitmap) {
         return NULL;
     }
-    
-    // Calculate resize dimensions
-    int64_t newWidth, newHeight;
-    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim, 
-                              &newWidth, &newHeight);
+
+    // Same pixels as last time means the same JPEG
+    uint64_t frameHash = 0;
+    if (cacheEnabled) {
+        frameHash = hashMMBitmap(bitmap);
+        pthread_mutex_lock(&jpegCacheLock);
+        JpegCacheEntry* entry = findJpegCacheEntry(rect, maxSmallDim, maxLargeDim, quality, filter);
+        if (entry && entry->frameHash == frameHash) {
+            entry->damageSequence = damageSequence;
+            result = copyJpegCacheHit(entry, outSize);
+        }
+        pthread_mutex_unlock(&jpegCacheLock);
+        if (result) {
+            destroyMMBitmap(bitmap);
+            return result;
+        }
+    }
     
     // Convert to JPEG
-    uint8_t* result = convertBitmapToJpeg(bitmap, quality, newWidth, newHeight, outSize);
+    int64_t size = 0;
+    result = encodeMMBitmapJpeg(bitmap, maxSmallDim, maxLargeDim, quality, filter, &size);
     
     // Clean up bitmap
     destroyMMBitmap(bitmap);
+
+    if (cacheEnabled && result) {
+        pthread_mutex_lock(&jpegCacheLock);
+        jpegCacheMisses++;
+        storeJpegCacheEntry(rect, maxSmallDim, maxLargeDim, quality, filter,
+                            damageSequence, frameHash, result, size);
+        pthread_mutex_unlock(&jpegCacheLock);
+    }
     
+    if (outSize) *outSize = size;
     return result;
 }
 
 // Linux implementation for full screen JPEG capture
 uint8_t* copyBitmapFullJpeg_LINUX(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                  int32_t quality, int64_t* outSize) {
+                                  int32_t quality, int32_t filter, int64_t* outSize) {
     if (outSize) *outSize = 0;
     
     // Get screen size
@@ -306,7 +1066,7 @@ uint8_t* copyBitmapFullJpeg_LINUX(int32_t maxSmallDim, int32_t maxLargeDim,
     
     // Use region capture for full screen
     return copyBitmapRegionJpeg_LINUX(0, 0, screenSize.width, screenSize.height,
-                                     maxSmallDim, maxLargeDim, quality, outSize);
+                                     maxSmallDim, maxLargeDim, quality, filter, outSize);
 }
 
 // Free JPEG data allocated by Linux implementation
@@ -1,165 +1,344 @@
+#define _GNU_SOURCE // pipe2()
 #include "../screengrab.h"
 #include "../endian.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
-// Simple BMP header structure for creating raw bitmaps
-typedef struct {
-    uint16_t type;
-    uint32_t size;
-    uint16_t reserved1;
-    uint16_t reserved2;
-    uint32_t offset;
-} __attribute__((packed)) BMPHeader;
+extern char **environ;
 
-typedef struct {
-    uint32_t size;
-    int32_t width;
-    int32_t height;
-    uint16_t planes;
-    uint16_t bitCount;
-    uint32_t compression;
-    uint32_t imageSize;
-    int32_t xPixelsPerMeter;
-    int32_t yPixelsPerMeter;
-    uint32_t colorsUsed;
-    uint32_t colorsImportant;
-} __attribute__((packed)) BMPInfoHeader;
+#ifdef HAVE_WLR_SCREENCOPY
+// Native wlr-screencopy client (screengrab_wlr.c)
+MMBitmapRef copyMMBitmapFromDisplayInRect_wlr(MMRect rect);
+bool isWlrScreencopyAvailable(void);
+#endif
 
-static MMBitmapRef capture_with_grim(MMRect rect) {
-    char cmd[512];
-    char temp_file[] = "/tmp/nutdart_screenshot_XXXXXX.bmp";
-    int fd = mkstemp(temp_file);
-    if (fd == -1) return NULL;
+// Largest image dimension we accept from a tool's output
+#define MAX_TOOL_IMAGE_DIM 32768
+
+// Command-line tools, looked up in PATH once
+static pthread_once_t toolsOnce = PTHREAD_ONCE_INIT;
+static char grimPath[PATH_MAX];
+static char importPath[PATH_MAX];
+
+static bool find_in_path(const char *name, char *out, size_t outSize) {
+    const char *path = getenv("PATH");
+    if (!path || !*path) path = "/usr/local/bin:/usr/bin:/bin";
+
+    while (*path) {
+        const char *end = strchr(path, ':');
+        const size_t length = end ? (size_t)(end - path) : strlen(path);
+        if (length > 0) {
+            const int written = snprintf(out, outSize, "%.*s/%s", (int)length, path, name);
+            if (written > 0 && (size_t)written < outSize && access(out, X_OK) == 0) {
+                return true;
+            }
+        }
+        if (!end) break;
+        path = end + 1;
+    }
+    out[0] = '\0';
+    return false;
+}
+
+static void detect_tools(void) {
+    find_in_path("grim", grimPath, sizeof(grimPath));
+    find_in_path("import", importPath, sizeof(importPath));
+}
+
+// Runs `argv` with stdout connected to a pipe and stderr discarded.
+// Returns the child's pid and the read end of the pipe in `outFd`, or -1.
+static pid_t spawn_with_stdout_pipe(const char *path, char *const argv[], int *outFd) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    const int error = posix_spawn(&pid, path, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    if (error != 0) {
+        close(fds[0]);
+        return -1;
+    }
+    *outFd = fds[0];
+    return pid;
+}
+
+// Closes the pipe and reaps the child. Returns true if it exited cleanly.
+static bool finish_child(pid_t pid, int fd) {
     close(fd);
-    
-    // Use grim to capture the specified region as BMP (easier to parse)
-    snprintf(cmd, sizeof(cmd), 
-        "grim -t bmp -g \"%d,%d %dx%d\" \"%s\" 2>/dev/null",
-        (int)rect.origin.x, (int)rect.origin.y,
-        (int)rect.size.width, (int)rect.size.height,
-        temp_file);
-    
-    int result = system(cmd);
-    if (result != 0) {
-        unlink(temp_file);
-        return NULL;
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        // ECHILD means the host ignores SIGCHLD; we can't see the status.
+        if (errno != EINTR) return errno == ECHILD;
     }
-    
-    // Load the BMP file
-    FILE *f = fopen(temp_file, "rb");
-    if (!f) {
-        unlink(temp_file);
-        return NULL;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Buffered reads from a pipe
+typedef struct {
+    int fd;
+    size_t pos;
+    size_t len;
+    uint8_t buf[16384];
+} PipeReader;
+
+static bool reader_fill(PipeReader *reader) {
+    for (;;) {
+        const ssize_t n = read(reader->fd, reader->buf, sizeof(reader->buf));
+        if (n > 0) {
+            reader->pos = 0;
+            reader->len = (size_t)n;
+            return true;
+        }
+        if (n == 0 || errno != EINTR) return false;
     }
-    
-    BMPHeader header;
-    BMPInfoHeader info;
-    
-    if (fread(&header, sizeof(header), 1, f) != 1 ||
-        fread(&info, sizeof(info), 1, f) != 1) {
-        fclose(f);
-        unlink(temp_file);
-        return NULL;
+}
+
+static int reader_byte(PipeReader *reader) {
+    if (reader->pos == reader->len && !reader_fill(reader)) return -1;
+    return reader->buf[reader->pos++];
+}
+
+static bool reader_read(PipeReader *reader, uint8_t *dest, size_t size) {
+    while (size > 0) {
+        if (reader->pos == reader->len && !reader_fill(reader)) return false;
+        size_t chunk = reader->len - reader->pos;
+        if (chunk > size) chunk = size;
+        memcpy(dest, reader->buf + reader->pos, chunk);
+        reader->pos += chunk;
+        dest += chunk;
+        size -= chunk;
     }
-    
-    // Only support 24-bit or 32-bit BMPs for simplicity
-    if (info.bitCount != 24 && info.bitCount != 32) {
-        fclose(f);
-        unlink(temp_file);
-        return NULL;
+    return true;
+}
+
+// Reads one unsigned decimal from a PPM header, skipping whitespace and
+// comments. Consumes the single whitespace byte that ends it.
+static long read_ppm_number(PipeReader *reader) {
+    int c = reader_byte(reader);
+    for (;;) {
+        if (c == '#') {
+            while (c != '\n' && c != -1) c = reader_byte(reader);
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            c = reader_byte(reader);
+        } else {
+            break;
+        }
     }
-    
-    // Seek to image data
-    fseek(f, header.offset, SEEK_SET);
-    
-    // Calculate bytes per line (BMPs are padded to 4-byte boundaries)
-    int bytes_per_pixel = info.bitCount / 8;
-    int row_size = ((info.width * bytes_per_pixel + 3) & ~3);
-    int image_size = row_size * abs(info.height);
-    
-    uint8_t *image_data = malloc(image_size);
-    if (!image_data) {
-        fclose(f);
-        unlink(temp_file);
+    if (c < '0' || c > '9') return -1;
+
+    long value = 0;
+    while (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        if (value > INT_MAX) return -1;
+        c = reader_byte(reader);
+    }
+    return value;
+}
+
+// Streams a binary PPM (P6, 8-bit) into a new 32-bit BGRX bitmap, one row
+// at a time.
+static MMBitmapRef read_ppm_bitmap(PipeReader *reader) {
+    if (reader_byte(reader) != 'P' || reader_byte(reader) != '6') return NULL;
+
+    const long width = read_ppm_number(reader);
+    const long height = read_ppm_number(reader);
+    const long maxval = read_ppm_number(reader);
+    if (width <= 0 || height <= 0 || width > MAX_TOOL_IMAGE_DIM ||
+        height > MAX_TOOL_IMAGE_DIM || maxval != 255) {
         return NULL;
     }
-    
-    if (fread(image_data, image_size, 1, f) != 1) {
-        free(image_data);
-        fclose(f);
-        unlink(temp_file);
+
+    const size_t bytewidth = (size_t)width * 4;
+    uint8_t *buffer = malloc(bytewidth * (size_t)height);
+    uint8_t *row = malloc((size_t)width * 3);
+    if (!buffer || !row) {
+        free(buffer);
+        free(row);
         return NULL;
     }
-    
-    fclose(f);
-    unlink(temp_file);
-    
-    // Create MMBitmap (note: BMP is typically bottom-up, might need to flip)
-    MMBitmapRef bitmap = createMMBitmap(image_data,
-                                        abs(info.width),
-                                        abs(info.height),
-                                        row_size,
-                                        info.bitCount,
-                                        bytes_per_pixel);
-    
+
+    for (long y = 0; y < height; y++) {
+        if (!reader_read(reader, row, (size_t)width * 3)) {
+            free(buffer);
+            free(row);
+            return NULL;
+        }
+        const uint8_t *src = row;
+        uint8_t *dst = buffer + (size_t)y * bytewidth;
+        for (long x = 0; x < width; x++, src += 3, dst += 4) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = 0xff;
+        }
+    }
+    free(row);
+
+    MMBitmapRef bitmap = createMMBitmap(buffer, (size_t)width, (size_t)height,
+                                        bytewidth, 32, 4);
+    if (!bitmap) free(buffer);
     return bitmap;
 }
 
-static MMBitmapRef capture_with_imagemagick(MMRect rect) {
-    char cmd[512];
-    char temp_file[] = "/tmp/nutdart_screenshot_XXXXXX.bmp";
-    int fd = mkstemp(temp_file);
-    if (fd == -1) return NULL;
-    close(fd);
-    
-    // Use ImageMagick's import command
-    snprintf(cmd, sizeof(cmd),
-        "import -window root -crop %dx%d+%d+%d %s 2>/dev/null",
-        (int)rect.size.width, (int)rect.size.height,
-        (int)rect.origin.x, (int)rect.origin.y,
-        temp_file);
-    
-    if (system(cmd) != 0) {
-        unlink(temp_file);
-        return NULL;
+// Runs a tool that writes a PPM to stdout and decodes it as it arrives.
+static MMBitmapRef capture_ppm_from_tool(const char *path, char *const argv[]) {
+    int fd;
+    const pid_t pid = spawn_with_stdout_pipe(path, argv, &fd);
+    if (pid < 0) return NULL;
+
+    PipeReader *reader = malloc(sizeof(PipeReader));
+    MMBitmapRef bitmap = NULL;
+    if (reader) {
+        reader->fd = fd;
+        reader->pos = 0;
+        reader->len = 0;
+        bitmap = read_ppm_bitmap(reader);
+        free(reader);
     }
-    
-    // Use same BMP loading logic as grim
-    FILE *f = fopen(temp_file, "rb");
-    if (!f) {
-        unlink(temp_file);
-        return NULL;
+
+    if (!finish_child(pid, fd) && bitmap) {
+        destroyMMBitmap(bitmap);
+        bitmap = NULL;
     }
-    
-    // ... (same BMP loading code as above)
-    fclose(f);
-    unlink(temp_file);
-    return NULL; // Simplified for now
+    return bitmap;
+}
+
+static void format_grim_geometry(char *out, size_t outSize, MMRect rect) {
+    snprintf(out, outSize, "%lld,%lld %lldx%lld",
+             (long long)rect.origin.x, (long long)rect.origin.y,
+             (long long)rect.size.width, (long long)rect.size.height);
+}
+
+static MMBitmapRef capture_with_grim(MMRect rect) {
+    char geometry[96];
+    format_grim_geometry(geometry, sizeof(geometry), rect);
+
+    // -s 1 keeps the image at layout size on HiDPI outputs
+    char *argv[] = { "grim", "-t", "ppm", "-s", "1", "-g", geometry, "-", NULL };
+    return capture_ppm_from_tool(grimPath, argv);
+}
+
+static MMBitmapRef capture_with_imagemagick(MMRect rect) {
+    char crop[96];
+    snprintf(crop, sizeof(crop), "%lldx%lld+%lld+%lld",
+             (long long)rect.size.width, (long long)rect.size.height,
+             (long long)rect.origin.x, (long long)rect.origin.y);
+
+    char *argv[] = { "import", "-silent", "-window", "root", "-crop", crop,
+                     "-depth", "8", "ppm:-", NULL };
+    return capture_ppm_from_tool(importPath, argv);
+}
+
+static bool is_wayland_session(void) {
+    const char *session_type = getenv("XDG_SESSION_TYPE");
+    const char *wayland_display = getenv("WAYLAND_DISPLAY");
+
+    return (session_type && strcmp(session_type, "wayland") == 0) ||
+           (wayland_display && wayland_display[0] != '\0');
 }
 
 MMBitmapRef copyMMBitmapFromDisplayInRect_wayland(MMRect rect) {
     MMBitmapRef bitmap = NULL;
-    
-    // Try grim first (works with Sway/wlroots compositors)
-    if (system("which grim > /dev/null 2>&1") == 0) {
+
+#ifdef HAVE_WLR_SCREENCOPY
+    // Talk to wlroots compositors directly, without spawning anything
+    bitmap = copyMMBitmapFromDisplayInRect_wlr(rect);
+    if (bitmap) return bitmap;
+#endif
+
+    pthread_once(&toolsOnce, detect_tools);
+
+    // Try grim (works with Sway/wlroots compositors)
+    if (grimPath[0]) {
         bitmap = capture_with_grim(rect);
         if (bitmap) return bitmap;
     }
-    
-    // Try ImageMagick import (works in many environments)
-    if (system("which import > /dev/null 2>&1") == 0) {
+
+    // Try ImageMagick import (works where XWayland exposes the root window)
+    if (importPath[0]) {
         bitmap = capture_with_imagemagick(rect);
         if (bitmap) return bitmap;
     }
-    
-    // Try gnome-screenshot (requires user interaction)
-    if (system("which gnome-screenshot > /dev/null 2>&1") == 0) {
-        // This would require user interaction, so maybe skip in automated scenarios
-    }
-    
+
     return NULL;
-}
\ No newline at end of file
+}
+
+uint8_t *copyJpegFromDisplayInRect_wayland(MMRect rect, double scale, int32_t quality,
+                                           int64_t *outSize) {
+    if (outSize) *outSize = 0;
+    if (!is_wayland_session()) return NULL;
+
+#ifdef HAVE_WLR_SCREENCOPY
+    // The native path grabs faster than grim can encode
+    if (isWlrScreencopyAvailable()) return NULL;
+#endif
+
+    pthread_once(&toolsOnce, detect_tools);
+    if (!grimPath[0]) return NULL;
+
+    char geometry[96];
+    char scaleArg[32];
+    char qualityArg[16];
+    format_grim_geometry(geometry, sizeof(geometry), rect);
+    snprintf(scaleArg, sizeof(scaleArg), "%.9g", scale);
+    // Negative means the default, as for the libjpeg path
+    snprintf(qualityArg, sizeof(qualityArg), "%d",
+             quality < 0 ? 85 : (quality > 100 ? 100 : quality));
+
+    char *argv[] = { "grim", "-t", "jpeg", "-q", qualityArg, "-s", scaleArg,
+                     "-g", geometry, "-", NULL };
+    int fd;
+    const pid_t pid = spawn_with_stdout_pipe(grimPath, argv, &fd);
+    if (pid < 0) return NULL;
+
+    // Grow the buffer as the encoded image streams in
+    size_t capacity = 256 * 1024;
+    size_t size = 0;
+    uint8_t *jpeg = malloc(capacity);
+    while (jpeg) {
+        if (size == capacity) {
+            uint8_t *grown = realloc(jpeg, capacity * 2);
+            if (!grown) {
+                free(jpeg);
+                jpeg = NULL;
+                break;
+            }
+            jpeg = grown;
+            capacity *= 2;
+        }
+        const ssize_t n = read(fd, jpeg + size, capacity - size);
+        if (n > 0) {
+            size += (size_t)n;
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR) {
+            free(jpeg);
+            jpeg = NULL;
+        }
+    }
+
+    const bool exited = finish_child(pid, fd);
+    if (!jpeg || !exited || size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+        free(jpeg);
+        return NULL;
+    }
+    if (outSize) *outSize = (int64_t)size;
+    return jpeg;
+}
@@ -0,0 +1,502 @@
+// Native Wayland capture through wlr-screencopy (wlroots compositors such as
+// Sway, Hyprland, river, labwc, cage).
+//
+// One connection is kept open across captures, together with a wl_shm
+// buffer that is reused while the frame geometry stays the same, so a grab
+// costs a round trip to the compositor and a copy out of shared memory.
+#define _GNU_SOURCE
+#include "../screengrab.h"
+#include "../monotonic.h"
+#include <wayland-client.h>
+#include "wlr-screencopy-unstable-v1-client-protocol.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define WLR_MAX_OUTPUTS 16
+#define WLR_TIMEOUT_MS 2000
+
+typedef struct {
+    struct wl_output *output;
+    uint32_t name;          // Registry name, for global_remove
+    int32_t x;              // Position in the compositor's layout
+    int32_t y;
+    int32_t width;          // Current mode, in buffer pixels
+    int32_t height;
+    int32_t scale;
+    int32_t transform;      // enum wl_output_transform
+} WlrOutput;
+
+typedef enum {
+    WLR_CAPTURE_OK,
+    WLR_CAPTURE_FAILED,      // Protocol error or lost connection
+    WLR_CAPTURE_UNSUPPORTED, // Rotated or fractionally scaled output
+} WlrCaptureResult;
+
+typedef struct {
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t flags;
+    bool bufferKnown;       // A wl_shm buffer event arrived
+    bool buffersDone;       // All buffer types were announced
+    bool ready;
+    bool failed;
+} WlrFrameState;
+
+// Everything below is guarded by wlrLock.
+static pthread_mutex_t wlrLock = PTHREAD_MUTEX_INITIALIZER;
+static struct wl_display *wlDisplay = NULL;
+static struct wl_registry *wlRegistry = NULL;
+static struct wl_shm *wlShm = NULL;
+static struct zwlr_screencopy_manager_v1 *screencopyManager = NULL;
+static uint32_t screencopyVersion = 0;
+static WlrOutput outputs[WLR_MAX_OUTPUTS];
+static int outputCount = 0;
+static bool screencopyUnsupported = false; // The compositor lacks the protocol
+
+// Shared-memory buffer the compositor copies into.
+static int shmFd = -1;
+static void *shmData = NULL;
+static size_t shmSize = 0;
+static struct wl_shm_pool *shmPool = NULL;
+static struct wl_buffer *shmBuffer = NULL;
+static uint32_t shmFormat, shmWidth, shmHeight, shmStride;
+
+static void outputGeometry(void *data, struct wl_output *output, int32_t x, int32_t y,
+                           int32_t physicalWidth, int32_t physicalHeight, int32_t subpixel,
+                           const char *make, const char *model, int32_t transform) {
+    WlrOutput *entry = data;
+    (void)output; (void)physicalWidth; (void)physicalHeight; (void)subpixel;
+    (void)make; (void)model;
+    entry->x = x;
+    entry->y = y;
+    entry->transform = transform;
+}
+
+static void outputMode(void *data, struct wl_output *output, uint32_t flags,
+                       int32_t width, int32_t height, int32_t refresh) {
+    WlrOutput *entry = data;
+    (void)output; (void)refresh;
+    if (flags & WL_OUTPUT_MODE_CURRENT) {
+        entry->width = width;
+        entry->height = height;
+    }
+}
+
+static void outputDone(void *data, struct wl_output *output) {
+    (void)data; (void)output;
+}
+
+static void outputScale(void *data, struct wl_output *output, int32_t factor) {
+    WlrOutput *entry = data;
+    (void)output;
+    entry->scale = factor > 0 ? factor : 1;
+}
+
+static const struct wl_output_listener outputListener = {
+    .geometry = outputGeometry,
+    .mode = outputMode,
+    .done = outputDone,
+    .scale = outputScale,
+};
+
+static void registryGlobal(void *data, struct wl_registry *registry, uint32_t name,
+                           const char *interface, uint32_t version) {
+    (void)data;
+    if (strcmp(interface, wl_shm_interface.name) == 0) {
+        wlShm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (strcmp(interface, zwlr_screencopy_manager_v1_interface.name) == 0) {
+        screencopyVersion = version < 3 ? version : 3;
+        screencopyManager = wl_registry_bind(registry, name,
+                                             &zwlr_screencopy_manager_v1_interface,
+                                             screencopyVersion);
+    } else if (strcmp(interface, wl_output_interface.name) == 0 &&
+               outputCount < WLR_MAX_OUTPUTS) {
+        WlrOutput *entry = &outputs[outputCount++];
+        memset(entry, 0, sizeof(*entry));
+        entry->name = name;
+        entry->scale = 1;
+        entry->output = wl_registry_bind(registry, name, &wl_output_interface,
+                                         version < 2 ? version : 2);
+        wl_output_add_listener(entry->output, &outputListener, entry);
+    }
+}
+
+static void registryGlobalRemove(void *data, struct wl_registry *registry, uint32_t name) {
+    (void)data; (void)registry;
+    for (int i = 0; i < outputCount; i++) {
+        if (outputs[i].name != name) continue;
+        wl_output_destroy(outputs[i].output);
+        // Listeners point at the entries, so shift by re-adding them.
+        outputs[i] = outputs[--outputCount];
+        if (i < outputCount) {
+            wl_proxy_set_user_data((struct wl_proxy *)outputs[i].output, &outputs[i]);
+        }
+        return;
+    }
+}
+
+static const struct wl_registry_listener registryListener = {
+    .global = registryGlobal,
+    .global_remove = registryGlobalRemove,
+};
+
+static void releaseShmBuffer(void) {
+    if (shmBuffer) wl_buffer_destroy(shmBuffer);
+    if (shmPool) wl_shm_pool_destroy(shmPool);
+    if (shmData) munmap(shmData, shmSize);
+    if (shmFd >= 0) close(shmFd);
+    shmBuffer = NULL;
+    shmPool = NULL;
+    shmData = NULL;
+    shmSize = 0;
+    shmFd = -1;
+}
+
+static void disconnectWayland(void) {
+    releaseShmBuffer();
+    for (int i = 0; i < outputCount; i++) {
+        wl_output_destroy(outputs[i].output);
+    }
+    outputCount = 0;
+    if (screencopyManager) zwlr_screencopy_manager_v1_destroy(screencopyManager);
+    if (wlShm) wl_shm_destroy(wlShm);
+    if (wlRegistry) wl_registry_destroy(wlRegistry);
+    if (wlDisplay) wl_display_disconnect(wlDisplay);
+    screencopyManager = NULL;
+    wlShm = NULL;
+    wlRegistry = NULL;
+    wlDisplay = NULL;
+}
+
+static bool connectWayland(void) {
+    if (wlDisplay) return true;
+    if (screencopyUnsupported) return false;
+
+    wlDisplay = wl_display_connect(NULL);
+    if (!wlDisplay) return false;
+
+    wlRegistry = wl_display_get_registry(wlDisplay);
+    wl_registry_add_listener(wlRegistry, &registryListener, NULL);
+
+    // The first round trip announces globals, the second the output state.
+    if (wl_display_roundtrip(wlDisplay) < 0 || wl_display_roundtrip(wlDisplay) < 0) {
+        disconnectWayland();
+        return false;
+    }
+
+    if (!screencopyManager || !wlShm) {
+        // Not a wlroots compositor; don't ask again.
+        screencopyUnsupported = true;
+        disconnectWayland();
+        return false;
+    }
+    return true;
+}
+
+// Dispatches events until *done or *failed is set, giving up after
+// WLR_TIMEOUT_MS so a stalled compositor can't hang the caller.
+static bool dispatchUntil(const bool *done, const bool *failed) {
+    const double deadline = monotonicMilliseconds() + WLR_TIMEOUT_MS;
+
+    while (!*done && !*failed) {
+        while (wl_display_prepare_read(wlDisplay) != 0) {
+            if (wl_display_dispatch_pending(wlDisplay) < 0) return false;
+        }
+        if (*done || *failed) {
+            wl_display_cancel_read(wlDisplay);
+            break;
+        }
+        wl_display_flush(wlDisplay);
+
+        const int remaining = (int)(deadline - monotonicMilliseconds());
+        if (remaining <= 0) {
+            wl_display_cancel_read(wlDisplay);
+            return false;
+        }
+
+        struct pollfd pfd = { wl_display_get_fd(wlDisplay), POLLIN, 0 };
+        const int polled = poll(&pfd, 1, remaining);
+        if (polled <= 0) {
+            wl_display_cancel_read(wlDisplay);
+            if (polled < 0 && errno == EINTR) continue;
+            return false;
+        }
+        if (wl_display_read_events(wlDisplay) < 0 ||
+            wl_display_dispatch_pending(wlDisplay) < 0) {
+            return false;
+        }
+    }
+    return !*failed;
+}
+
+static void frameBuffer(void *data, struct zwlr_screencopy_frame_v1 *frame, uint32_t format,
+                        uint32_t width, uint32_t height, uint32_t stride) {
+    WlrFrameState *state = data;
+    (void)frame;
+    state->format = format;
+    state->width = width;
+    state->height = height;
+    state->stride = stride;
+    state->bufferKnown = true;
+    // Before version 3 the wl_shm buffer is the only one announced.
+    if (screencopyVersion < 3) state->buffersDone = true;
+}
+
+static void frameFlags(void *data, struct zwlr_screencopy_frame_v1 *frame, uint32_t flags) {
+    WlrFrameState *state = data;
+    (void)frame;
+    state->flags = flags;
+}
+
+static void frameReady(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                       uint32_t secondsHigh, uint32_t secondsLow, uint32_t nanoseconds) {
+    WlrFrameState *state = data;
+    (void)frame; (void)secondsHigh; (void)secondsLow; (void)nanoseconds;
+    state->ready = true;
+}
+
+static void frameFailed(void *data, struct zwlr_screencopy_frame_v1 *frame) {
+    WlrFrameState *state = data;
+    (void)frame;
+    state->failed = true;
+}
+
+static void frameDamage(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                        uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    (void)data; (void)frame; (void)x; (void)y; (void)width; (void)height;
+}
+
+static void frameDmabuf(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                        uint32_t format, uint32_t width, uint32_t height) {
+    (void)data; (void)frame; (void)format; (void)width; (void)height;
+}
+
+static void frameBufferDone(void *data, struct zwlr_screencopy_frame_v1 *frame) {
+    WlrFrameState *state = data;
+    (void)frame;
+    state->buffersDone = true;
+}
+
+static const struct zwlr_screencopy_frame_v1_listener frameListener = {
+    .buffer = frameBuffer,
+    .flags = frameFlags,
+    .ready = frameReady,
+    .failed = frameFailed,
+    .damage = frameDamage,
+    .linux_dmabuf = frameDmabuf,
+    .buffer_done = frameBufferDone,
+};
+
+// Makes sure shmBuffer matches the announced frame geometry.
+static bool ensureShmBuffer(const WlrFrameState *state) {
+    if (shmBuffer && shmFormat == state->format && shmWidth == state->width &&
+        shmHeight == state->height && shmStride == state->stride) {
+        return true;
+    }
+
+    const size_t size = (size_t)state->stride * state->height;
+    if (size > shmSize) {
+        releaseShmBuffer();
+        shmFd = memfd_create("nutdart-screencopy", MFD_CLOEXEC);
+        if (shmFd < 0) return false;
+        if (ftruncate(shmFd, (off_t)size) < 0) {
+            releaseShmBuffer();
+            return false;
+        }
+        shmData = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        if (shmData == MAP_FAILED) {
+            shmData = NULL;
+            releaseShmBuffer();
+            return false;
+        }
+        shmSize = size;
+        shmPool = wl_shm_create_pool(wlShm, shmFd, (int32_t)size);
+    } else if (shmBuffer) {
+        wl_buffer_destroy(shmBuffer);
+    }
+
+    shmBuffer = wl_shm_pool_create_buffer(shmPool, 0, (int32_t)state->width,
+                                          (int32_t)state->height, (int32_t)state->stride,
+                                          state->format);
+    shmFormat = state->format;
+    shmWidth = state->width;
+    shmHeight = state->height;
+    shmStride = state->stride;
+    return shmBuffer != NULL;
+}
+
+// Copies the captured frame into `dest` at (destX, destY), scaling to
+// destWidth x destHeight (nearest neighbour) when the output is scaled.
+// Output is always BGRX, which is what XRGB8888 already is in memory.
+static void blitFrame(const WlrFrameState *state, MMBitmapRef dest, int64_t destX,
+                      int64_t destY, int64_t destWidth, int64_t destHeight) {
+    const bool swapRB = state->format == WL_SHM_FORMAT_XBGR8888 ||
+                        state->format == WL_SHM_FORMAT_ABGR8888;
+    const bool invert = (state->flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT) != 0;
+
+    for (int64_t dy = 0; dy < destHeight; dy++) {
+        int64_t sy = dy * (int64_t)state->height / destHeight;
+        if (invert) sy = (int64_t)state->height - 1 - sy;
+        const uint8_t *src = (const uint8_t *)shmData + (size_t)sy * state->stride;
+        uint8_t *dst = dest->imageBuffer + (size_t)(destY + dy) * dest->bytewidth +
+                       (size_t)destX * 4;
+
+        if (!swapRB && destWidth == (int64_t)state->width) {
+            memcpy(dst, src, (size_t)destWidth * 4);
+            continue;
+        }
+        for (int64_t dx = 0; dx < destWidth; dx++) {
+            const uint8_t *p = src + (size_t)(dx * (int64_t)state->width / destWidth) * 4;
+            dst[dx * 4 + 0] = swapRB ? p[2] : p[0];
+            dst[dx * 4 + 1] = p[1];
+            dst[dx * 4 + 2] = swapRB ? p[0] : p[2];
+            dst[dx * 4 + 3] = 0xff;
+        }
+    }
+}
+
+// Captures the part of `output` covering `region` (layout coordinates) into
+// `dest`, which covers `destRect`.
+static WlrCaptureResult captureOutputRegion(const WlrOutput *output, MMRect region,
+                                            MMBitmapRef dest, MMRect destRect) {
+    WlrFrameState state;
+    memset(&state, 0, sizeof(state));
+
+    struct zwlr_screencopy_frame_v1 *frame = zwlr_screencopy_manager_v1_capture_output_region(
+        screencopyManager, 0, output->output,
+        (int32_t)(region.origin.x - output->x), (int32_t)(region.origin.y - output->y),
+        (int32_t)region.size.width, (int32_t)region.size.height);
+    if (!frame) return WLR_CAPTURE_FAILED;
+    zwlr_screencopy_frame_v1_add_listener(frame, &frameListener, &state);
+
+    bool ok = dispatchUntil(&state.buffersDone, &state.failed) && state.bufferKnown;
+
+    // Under a fractional scale wl_output reports the scale rounded up, so
+    // the layout size worked out from it is wrong and the buffer the
+    // compositor offers isn't the region times that scale.
+    if (ok && ((int64_t)state.width != region.size.width * output->scale ||
+               (int64_t)state.height != region.size.height * output->scale)) {
+        zwlr_screencopy_frame_v1_destroy(frame);
+        return WLR_CAPTURE_UNSUPPORTED;
+    }
+    if (ok) {
+        ok = state.format == WL_SHM_FORMAT_XRGB8888 || state.format == WL_SHM_FORMAT_ARGB8888 ||
+             state.format == WL_SHM_FORMAT_XBGR8888 || state.format == WL_SHM_FORMAT_ABGR8888;
+    }
+    if (ok) ok = ensureShmBuffer(&state);
+    if (ok) {
+        zwlr_screencopy_frame_v1_copy(frame, shmBuffer);
+        ok = dispatchUntil(&state.ready, &state.failed);
+    }
+    if (ok) {
+        blitFrame(&state, dest, region.origin.x - destRect.origin.x,
+                  region.origin.y - destRect.origin.y, region.size.width, region.size.height);
+    }
+
+    zwlr_screencopy_frame_v1_destroy(frame);
+    return ok ? WLR_CAPTURE_OK : WLR_CAPTURE_FAILED;
+}
+
+static bool intersectRects(MMRect a, MMRect b, MMRect *out) {
+    const int64_t x1 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+    const int64_t y1 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+    const int64_t ax2 = a.origin.x + a.size.width, bx2 = b.origin.x + b.size.width;
+    const int64_t ay2 = a.origin.y + a.size.height, by2 = b.origin.y + b.size.height;
+    const int64_t x2 = ax2 < bx2 ? ax2 : bx2;
+    const int64_t y2 = ay2 < by2 ? ay2 : by2;
+    if (x2 <= x1 || y2 <= y1) return false;
+    *out = MMRectMake(x1, y1, x2 - x1, y2 - y1);
+    return true;
+}
+
+// True if the compositor speaks wlr-screencopy. Connects on first use.
+bool isWlrScreencopyAvailable(void) {
+    pthread_mutex_lock(&wlrLock);
+    const bool available = connectWayland();
+    pthread_mutex_unlock(&wlrLock);
+    return available;
+}
+
+// Captures `rect` (layout coordinates) from every output it covers into
+// `dest`, setting *captured if any output did. Drops the connection if an
+// output failed. Called with wlrLock held.
+static WlrCaptureResult captureLayoutRect(MMRect rect, MMBitmapRef dest, bool *captured) {
+    *captured = false;
+    for (int i = 0; i < outputCount; i++) {
+        const WlrOutput *output = &outputs[i];
+        const MMRect logical = MMRectMake(output->x, output->y,
+                                          output->width / output->scale,
+                                          output->height / output->scale);
+        MMRect part;
+        if (!intersectRects(rect, logical, &part)) continue;
+
+        // The mode is in buffer pixels before the transform, so the layout
+        // size above is only right for an upright output.
+        if (output->transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+            return WLR_CAPTURE_UNSUPPORTED;
+        }
+
+        const WlrCaptureResult result = captureOutputRegion(output, part, dest, rect);
+        if (result == WLR_CAPTURE_FAILED) {
+            // Start from a fresh connection next time.
+            disconnectWayland();
+        }
+        if (result != WLR_CAPTURE_OK) return result;
+        *captured = true;
+    }
+    return WLR_CAPTURE_OK;
+}
+
+// Grabs `rect` (layout coordinates) through wlr-screencopy, stitching
+// together every output it covers. Outputs with an integer scale are
+// sampled down to layout size. Rotated, flipped or fractionally scaled
+// outputs have a layout geometry wl_output alone doesn't give, so covering
+// one returns NULL and the caller falls back to grim. Also returns NULL if
+// the compositor doesn't support the protocol or the capture failed.
+MMBitmapRef copyMMBitmapFromDisplayInRect_wlr(MMRect rect) {
+    if (rect.size.width <= 0 || rect.size.height <= 0) return NULL;
+
+    pthread_mutex_lock(&wlrLock);
+    const bool reused = wlDisplay != NULL;
+    if (!connectWayland()) {
+        pthread_mutex_unlock(&wlrLock);
+        return NULL;
+    }
+
+    const size_t bytewidth = (size_t)rect.size.width * 4;
+    const size_t size = (size_t)rect.size.height * bytewidth;
+    uint8_t *buffer = calloc(1, size);
+    MMBitmap dest = { buffer, (size_t)rect.size.width, (size_t)rect.size.height,
+                      bytewidth, 32, 4 };
+
+    bool captured = false;
+    WlrCaptureResult result = buffer != NULL ? captureLayoutRect(rect, &dest, &captured)
+                                             : WLR_CAPTURE_FAILED;
+
+    // A connection kept from earlier captures goes stale when the
+    // compositor exits or restarts; try once more on a fresh one rather
+    // than losing this frame.
+    if (buffer && result == WLR_CAPTURE_FAILED && reused && connectWayland()) {
+        memset(buffer, 0, size);
+        result = captureLayoutRect(rect, &dest, &captured);
+    }
+    pthread_mutex_unlock(&wlrLock);
+
+    if (result != WLR_CAPTURE_OK || !captured) {
+        free(buffer);
+        return NULL;
+    }
+
+    MMBitmapRef bitmap = createMMBitmap(buffer, (size_t)rect.size.width,
+                                        (size_t)rect.size.height, bytewidth, 32, 4);
+    if (!bitmap) free(buffer);
+    return bitmap;
+}
@@ -1,13 +1,26 @@
 #include "../xdisplay.h"
+#include <X11/Xlibint.h> /* For XlibDisplayIOError */
 #include <stdio.h> /* For fputs() */
 #include <stdlib.h> /* For atexit() */
 #include <string.h> /* For strdup() */
+#include <poll.h> /* For poll() */
+#include <pthread.h>
+#include <sys/socket.h> /* For recv() */
 
 static Display *mainDisplay = NULL;
 static int registered = 0;
 static char *displayName = NULL;
 static int hasDisplayNameChanged = 0;
 
+/* The capture connection is kept apart from the main display so screen grabs
+ * don't queue behind (or in front of) input requests. */
+static Display *captureDisplay = NULL;
+static int captureRegistered = 0;
+static unsigned long displayNameSerial = 0; /* Bumped by setXDisplay(). */
+static unsigned long captureDisplaySerial = 0;
+static unsigned long captureGeneration = 0;
+static volatile int captureDisplayBroken = 0;
+
 Display *XGetMainDisplay(void)
 {
 	/* Close the display if displayName has changed */
@@ -39,6 +52,149 @@ void XCloseMainDisplay(void)
 	}
 }
 
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+/* Displays whose I/O errors are survived; a full table leaves new ones to
+ * the previous handler. */
+#define MAX_RECOVERABLE_DISPLAYS 4
+static pthread_mutex_t recoverableLock = PTHREAD_MUTEX_INITIALIZER;
+static Display *recoverableDisplays[MAX_RECOVERABLE_DISPLAYS];
+static XIOErrorHandler previousIOErrorHandler = NULL;
+static int recoverableHandlerInstalled = 0;
+
+static int recoverableIOError(Display *display)
+{
+	pthread_mutex_lock(&recoverableLock);
+	int recoverable = 0;
+	for (int i = 0; i < MAX_RECOVERABLE_DISPLAYS; i++) {
+		if (recoverableDisplays[i] == display) recoverable = 1;
+	}
+	XIOErrorHandler previous = previousIOErrorHandler;
+	pthread_mutex_unlock(&recoverableLock);
+
+	/* Returning hands over to the display's exit handler. */
+	if (recoverable || previous == NULL) return 0;
+	return previous(display);
+}
+#endif
+
+void XSetRecoverableIOErrorExit(Display *display, void (*handler)(Display *, void *),
+                                void *userData)
+{
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+	XSetIOErrorExitHandler(display, handler, userData);
+
+	pthread_mutex_lock(&recoverableLock);
+	if (!recoverableHandlerInstalled) {
+		previousIOErrorHandler = XSetIOErrorHandler(recoverableIOError);
+		recoverableHandlerInstalled = 1;
+	}
+	for (int i = 0; i < MAX_RECOVERABLE_DISPLAYS; i++) {
+		if (recoverableDisplays[i] == NULL) {
+			recoverableDisplays[i] = display;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&recoverableLock);
+#else
+	(void)display;
+	(void)handler;
+	(void)userData;
+#endif
+}
+
+void XCloseRecoverableDisplay(Display *display, int broken)
+{
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+	pthread_mutex_lock(&recoverableLock);
+	for (int i = 0; i < MAX_RECOVERABLE_DISPLAYS; i++) {
+		if (recoverableDisplays[i] == display) recoverableDisplays[i] = NULL;
+	}
+	pthread_mutex_unlock(&recoverableLock);
+#endif
+
+	/* A plain XCloseDisplay() would flush into the dead socket and run the
+	 * fatal I/O error path again; marked as having had its I/O error it
+	 * skips every request, so it only closes the socket and frees Xlib's
+	 * state. */
+	if (broken) display->flags |= XlibDisplayIOError;
+	XCloseDisplay(display);
+}
+
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+/* Called instead of exit() when the capture connection dies. Returning marks
+ * the Display as failed and lets the next XGetCaptureDisplay() reconnect. */
+static void captureIOErrorExit(Display *display, void *userData)
+{
+	(void)display;
+	(void)userData;
+	captureDisplayBroken = 1;
+}
+#endif
+
+/* Returns whether the server end of the capture connection has hung up. */
+static int captureConnectionLost(void)
+{
+	if (captureDisplayBroken) return 1;
+
+	struct pollfd pfd;
+	pfd.fd = ConnectionNumber(captureDisplay);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) <= 0) return 0;
+	if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) return 1;
+
+	/* Readable with nothing to read means the server closed its end. */
+	char byte;
+	return recv(pfd.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+Display *XGetCaptureDisplay(void)
+{
+	if (captureDisplay != NULL) {
+		if (captureConnectionLost()) {
+			fputs("Capture display connection lost, reconnecting\n", stderr);
+			XCloseRecoverableDisplay(captureDisplay, 1);
+			captureDisplay = NULL;
+		} else if (captureDisplaySerial != displayNameSerial) {
+			XCloseCaptureDisplay();
+		}
+	}
+
+	if (captureDisplay == NULL) {
+		captureDisplayBroken = 0;
+		captureDisplay = XOpenDisplay(displayName);
+
+		if (captureDisplay == NULL) {
+			fputs("Could not open capture display\n", stderr);
+		} else {
+#if defined(HAVE_XSETIOERROREXITHANDLER)
+			XSetRecoverableIOErrorExit(captureDisplay, captureIOErrorExit, NULL);
+#endif
+			captureDisplaySerial = displayNameSerial;
+			captureGeneration++;
+			if (!captureRegistered) {
+				atexit(&XCloseCaptureDisplay);
+				captureRegistered = 1;
+			}
+		}
+	}
+
+	return captureDisplay;
+}
+
+unsigned long XGetCaptureDisplayGeneration(void)
+{
+	return captureGeneration;
+}
+
+void XCloseCaptureDisplay(void)
+{
+	if (captureDisplay != NULL) {
+		XCloseRecoverableDisplay(captureDisplay, captureDisplayBroken);
+		captureDisplay = NULL;
+	}
+}
+
 char * getXDisplay(void)
 {
 	return displayName;
@@ -46,6 +202,8 @@ char * getXDisplay(void)
 
 void setXDisplay(const char *name)
 {
-	displayName = strdup(name);
+	free(displayName);
+	displayName = (name != NULL) ? strdup(name) : NULL;
 	hasDisplayNameChanged = 1;
+	displayNameSerial++;
 }
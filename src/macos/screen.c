@@ -11,6 +11,30 @@ MMSize getMainDisplaySize(void)
 	                  CGDisplayPixelsHigh(displayID));
 }
 
+int32_t getMonitors(MMMonitor *monitors, int32_t maxMonitors)
+{
+	CGDirectDisplayID displays[32];
+	uint32_t count = 0;
+	if (CGGetActiveDisplayList(32, displays, &count) != kCGErrorSuccess) return -1;
+
+	int32_t written = 0;
+	for (uint32_t i = 0; i < count && monitors != NULL && written < maxMonitors; i++) {
+		const CGRect bounds = CGDisplayBounds(displays[i]);
+		MMMonitor *entry = &monitors[written++];
+		entry->bounds = MMRectMake((int64_t)bounds.origin.x, (int64_t)bounds.origin.y,
+		                           (int64_t)bounds.size.width, (int64_t)bounds.size.height);
+		entry->primary = CGDisplayIsMain(displays[i]) != 0;
+
+		/* Keep the primary monitor first. */
+		if (entry->primary && written > 1) {
+			MMMonitor first = monitors[0];
+			monitors[0] = *entry;
+			*entry = first;
+		}
+	}
+	return (int32_t)count;
+}
+
 bool pointVisibleOnMainDisplay(MMPoint point)
 {
 	MMSize displaySize = getMainDisplaySize();
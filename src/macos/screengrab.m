@@ -1,4 +1,5 @@
 #include "../screengrab.h"
+#include "../screengrab_jpeg.h"
 #include "../endian.h"
 #include <stdlib.h> /* malloc() */
 
@@ -12,3 +13,46 @@ MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect) {
     // This allows the rest of the library (mouse/keyboard) to work
     return NULL;
 }
+
+bool copyMMBitmapFromDisplayInRectInto(MMRect rect, MMBitmapRef bitmap, size_t capacity) {
+    return false;
+}
+
+// JPEG encoding goes through ScreenCaptureKit on macOS
+uint8_t *encodeMMBitmapJpeg(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                            int32_t quality, int32_t filter, int64_t *outSize) {
+    if (outSize) *outSize = 0;
+    return NULL;
+}
+
+MMJpegEncoderRef createMMJpegEncoder(void) {
+    return NULL;
+}
+
+void destroyMMJpegEncoder(MMJpegEncoderRef encoder) {
+}
+
+const uint8_t *encodeMMBitmapJpegWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t quality, int32_t filter,
+                                      uint8_t *buffer, size_t capacity, int64_t *outSize) {
+    if (outSize) *outSize = 0;
+    return NULL;
+}
+
+uint8_t *encodeMMBitmapJpegBudget(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                                  int64_t maxBytes, int32_t filter,
+                                  int32_t *outQuality, int64_t *outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+    return NULL;
+}
+
+const uint8_t *encodeMMBitmapJpegBudgetWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int64_t maxBytes, int32_t filter,
+                                            int32_t *outQuality, int64_t *outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+    return NULL;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef MMTHREAD_H
+#define MMTHREAD_H
+
+#include "os.h"
+#include "inline_keywords.h"
+#include <stdbool.h>
+
+#if defined(IS_WINDOWS)
+	#include <process.h> /* For _beginthreadex() */
+#else
+	#include <pthread.h>
+	#include <time.h>
+	#include <errno.h>
+#endif
+
+/* Minimal threads, mutexes and condition variables over Win32 and pthreads,
+ * for the modules that run work in the background. */
+
+#if defined(IS_WINDOWS)
+
+typedef HANDLE MMThread;
+typedef CRITICAL_SECTION MMMutex;
+typedef CONDITION_VARIABLE MMCond;
+
+/* Declares a thread entry point: MM_THREAD_FUNC(worker) { ...; return MM_THREAD_RESULT; } */
+#define MM_THREAD_FUNC(name) unsigned __stdcall name(void *arg)
+#define MM_THREAD_RESULT 0
+typedef unsigned (__stdcall *MMThreadFunc)(void *);
+
+#else
+
+typedef pthread_t MMThread;
+typedef pthread_mutex_t MMMutex;
+typedef pthread_cond_t MMCond;
+
+#define MM_THREAD_FUNC(name) void *name(void *arg)
+#define MM_THREAD_RESULT NULL
+typedef void *(*MMThreadFunc)(void *);
+
+#endif
+
+/* Starts `func(arg)` on a new thread. Returns false on failure. */
+H_INLINE bool MMThreadCreate(MMThread *thread, MMThreadFunc func, void *arg)
+{
+#if defined(IS_WINDOWS)
+	*thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL);
+	return *thread != NULL;
+#else
+	return pthread_create(thread, NULL, func, arg) == 0;
+#endif
+}
+
+/* Waits for the thread to finish and releases it. */
+H_INLINE void MMThreadJoin(MMThread thread)
+{
+#if defined(IS_WINDOWS)
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+}
+
+H_INLINE void MMMutexInit(MMMutex *mutex)
+{
+#if defined(IS_WINDOWS)
+	InitializeCriticalSection(mutex);
+#else
+	pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+H_INLINE void MMMutexDestroy(MMMutex *mutex)
+{
+#if defined(IS_WINDOWS)
+	DeleteCriticalSection(mutex);
+#else
+	pthread_mutex_destroy(mutex);
+#endif
+}
+
+H_INLINE void MMMutexLock(MMMutex *mutex)
+{
+#if defined(IS_WINDOWS)
+	EnterCriticalSection(mutex);
+#else
+	pthread_mutex_lock(mutex);
+#endif
+}
+
+H_INLINE void MMMutexUnlock(MMMutex *mutex)
+{
+#if defined(IS_WINDOWS)
+	LeaveCriticalSection(mutex);
+#else
+	pthread_mutex_unlock(mutex);
+#endif
+}
+
+H_INLINE void MMCondInit(MMCond *cond)
+{
+#if defined(IS_WINDOWS)
+	InitializeConditionVariable(cond);
+#else
+	pthread_cond_init(cond, NULL);
+#endif
+}
+
+H_INLINE void MMCondDestroy(MMCond *cond)
+{
+#if defined(IS_WINDOWS)
+	(void)cond; /* Condition variables need no cleanup on Windows. */
+#else
+	pthread_cond_destroy(cond);
+#endif
+}
+
+H_INLINE void MMCondWait(MMCond *cond, MMMutex *mutex)
+{
+#if defined(IS_WINDOWS)
+	SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+	pthread_cond_wait(cond, mutex);
+#endif
+}
+
+/* Waits at most `milliseconds`. Returns false on timeout. Like any condition
+ * wait it can also return early, so callers re-check their predicate. */
+H_INLINE bool MMCondTimedWait(MMCond *cond, MMMutex *mutex, double milliseconds)
+{
+	if (milliseconds < 0) milliseconds = 0;
+#if defined(IS_WINDOWS)
+	return SleepConditionVariableCS(cond, mutex, (DWORD)milliseconds) != 0;
+#else
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	const long long nanoseconds = (long long)deadline.tv_nsec + (long long)(milliseconds * 1000000.0);
+	deadline.tv_sec += (time_t)(nanoseconds / 1000000000LL);
+	deadline.tv_nsec = (long)(nanoseconds % 1000000000LL);
+	return pthread_cond_timedwait(cond, mutex, &deadline) != ETIMEDOUT;
+#endif
+}
+
+H_INLINE void MMCondBroadcast(MMCond *cond)
+{
+#if defined(IS_WINDOWS)
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
+
+#endif /* MMTHREAD_H */
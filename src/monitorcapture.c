@@ -0,0 +1,95 @@
+#include "monitorcapture.h"
+#include "screengrab.h"
+#include "screengrab_jpeg.h"
+#include "rectmerge.h"
+#include "mmthread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MONITORS 16
+
+typedef struct {
+	MMBitmapRef source;  /* Grab of the bounding box, shared read-only. */
+	MMRect crop;         /* Monitor within `source`, in source pixels. */
+	int32_t maxSmallDim;
+	int32_t maxLargeDim;
+	int32_t quality;
+	int32_t filter;
+	MMMonitorJpeg *result;
+} MonitorEncodeJob;
+
+static MM_THREAD_FUNC(encodeMonitorJob)
+{
+	MonitorEncodeJob *job = arg;
+	if (job->crop.size.width <= 0 || job->crop.size.height <= 0) return MM_THREAD_RESULT;
+
+	MMBitmapRef monitor = copyMMBitmapFromPortion(job->source, job->crop);
+	if (monitor != NULL) {
+		job->result->jpeg = encodeMMBitmapJpeg(monitor, job->maxSmallDim, job->maxLargeDim,
+		                                       job->quality, job->filter, &job->result->size);
+		destroyMMBitmap(monitor);
+	}
+	return MM_THREAD_RESULT;
+}
+
+int32_t copyAllMonitorsJpeg(MMMonitorJpeg *results, int32_t maxResults,
+                            int32_t maxSmallDim, int32_t maxLargeDim, int32_t quality,
+                            int32_t filter)
+{
+	MMMonitor monitors[MAX_MONITORS];
+	int32_t count = getMonitors(monitors, MAX_MONITORS);
+	if (count <= 0 || results == NULL || maxResults <= 0) return count < 0 ? -1 : 0;
+	if (count > MAX_MONITORS) count = MAX_MONITORS;
+	if (count > maxResults) count = maxResults;
+
+	MMRect bounds = monitors[0].bounds;
+	for (int32_t i = 1; i < count; i++) {
+		bounds = MMRectUnion(bounds, monitors[i].bounds);
+	}
+
+	MMBitmapRef source = copyMMBitmapFromDisplayInRect(bounds);
+	if (source == NULL) return -1;
+
+	/* The grab can come back scaled (e.g. DPI virtualization on Windows), so
+	 * map monitor rectangles into its pixels. */
+	const double scaleX = (double)source->width / (double)bounds.size.width;
+	const double scaleY = (double)source->height / (double)bounds.size.height;
+
+	MonitorEncodeJob jobs[MAX_MONITORS];
+	MMThread threads[MAX_MONITORS];
+	bool started[MAX_MONITORS];
+	for (int32_t i = 0; i < count; i++) {
+		const MMRect m = monitors[i].bounds;
+		int64_t x = (int64_t)((double)(m.origin.x - bounds.origin.x) * scaleX);
+		int64_t y = (int64_t)((double)(m.origin.y - bounds.origin.y) * scaleY);
+		int64_t width = (int64_t)((double)m.size.width * scaleX);
+		int64_t height = (int64_t)((double)m.size.height * scaleY);
+		if (x + width > (int64_t)source->width) width = (int64_t)source->width - x;
+		if (y + height > (int64_t)source->height) height = (int64_t)source->height - y;
+
+		results[i].monitor = monitors[i];
+		results[i].jpeg = NULL;
+		results[i].size = 0;
+
+		jobs[i].source = source;
+		jobs[i].crop = MMRectMake(x, y, width, height);
+		jobs[i].maxSmallDim = maxSmallDim;
+		jobs[i].maxLargeDim = maxLargeDim;
+		jobs[i].quality = quality;
+		jobs[i].filter = filter;
+		jobs[i].result = &results[i];
+	}
+
+	/* The calling thread takes the last monitor itself. */
+	for (int32_t i = 0; i < count - 1; i++) {
+		started[i] = MMThreadCreate(&threads[i], encodeMonitorJob, &jobs[i]);
+		if (!started[i]) encodeMonitorJob(&jobs[i]);
+	}
+	encodeMonitorJob(&jobs[count - 1]);
+	for (int32_t i = 0; i < count - 1; i++) {
+		if (started[i]) MMThreadJoin(threads[i]);
+	}
+
+	destroyMMBitmap(source);
+	return count;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef MONITORCAPTURE_H
+#define MONITORCAPTURE_H
+
+#include "types.h"
+#include "screen.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct _MMMonitorJpeg {
+	MMMonitor monitor;
+	uint8_t *jpeg;   /* To be free()'d by the caller. */
+	int64_t size;
+} MMMonitorJpeg;
+
+/* Captures every monitor as its own JPEG. The screen is grabbed once, over
+ * the bounding box of all monitors, and the per-monitor crops are resized and
+ * encoded in parallel, one thread per monitor.
+ *
+ * Writes up to `maxResults` entries and returns how many were written, or -1
+ * if the grab failed. An entry whose encode failed has a NULL `jpeg`. */
+int32_t copyAllMonitorsJpeg(MMMonitorJpeg *results, int32_t maxResults,
+                            int32_t maxSmallDim, int32_t maxLargeDim, int32_t quality,
+                            int32_t filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MONITORCAPTURE_H */
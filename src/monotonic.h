@@ -0,0 +1,32 @@
+#pragma once
+#ifndef MONOTONIC_H
+#define MONOTONIC_H
+
+#include "os.h"
+#include "inline_keywords.h"
+#include <stdint.h>
+
+#if !defined(IS_WINDOWS)
+	#include <time.h> /* For clock_gettime() */
+#endif
+
+/*
+ * Returns milliseconds elapsed since an arbitrary fixed point, from a clock
+ * that never jumps (unlike the wall clock). Only differences between two
+ * readings are meaningful.
+ */
+H_INLINE double monotonicMilliseconds(void)
+{
+#if defined(IS_WINDOWS)
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+#endif
+}
+
+#endif /* MONOTONIC_H */
@@ -0,0 +1,155 @@
+#include "multiencode.h"
+#include "screengrab_jpeg.h"
+#include "pngencode.h"
+#include "webpencode.h"
+#include "resample.h"
+#include "mmthread.h"
+#include <stdlib.h>
+
+/* One distinct output size. */
+typedef struct {
+	int64_t width;
+	int64_t height;
+	int32_t filter;
+	MMBitmapRef bitmap;  /* The source itself, or a resized copy owned here. */
+} EncodeLevel;
+
+typedef struct {
+	MMBitmapRef bitmap;  /* Shared read-only. */
+	MMEncodeOutput *output;
+} EncodeJob;
+
+static MM_THREAD_FUNC(encodeOutputJob)
+{
+	EncodeJob *job = arg;
+	MMEncodeOutput *output = job->output;
+	MMBitmapRef bitmap = job->bitmap;
+	if (bitmap == NULL) return MM_THREAD_RESULT;
+
+	/* Levels already have the output's size, so nothing is resized here. */
+	switch (output->format) {
+	case MMEncodeJpeg:
+		output->data = encodeMMBitmapJpeg(bitmap, -1, -1, output->quality, output->filter,
+		                                  &output->size);
+		break;
+	case MMEncodePng:
+		output->data = encodeMMBitmapPng(bitmap, -1, -1, output->filter, &output->size);
+		break;
+	case MMEncodeWebp:
+	case MMEncodeWebpLossless:
+		output->data = encodeMMBitmapWebp(bitmap, -1, -1, output->quality,
+		                                  output->format == MMEncodeWebpLossless,
+		                                  output->filter, &output->size);
+		break;
+	}
+	return MM_THREAD_RESULT;
+}
+
+/* Returns the level `output` is encoded from, adding it if it's new. */
+static size_t findEncodeLevel(EncodeLevel *levels, size_t *levelCount, MMBitmapRef bitmap,
+                              const MMEncodeOutput *output)
+{
+	int64_t width, height;
+	calculateResizedDimensions((int64_t)bitmap->width, (int64_t)bitmap->height,
+	                           output->maxSmallDim, output->maxLargeDim, &width, &height);
+	/* Full size doesn't depend on the filter. */
+	const bool resized = width != (int64_t)bitmap->width || height != (int64_t)bitmap->height;
+	for (size_t i = 0; i < *levelCount; i++) {
+		if (levels[i].width == width && levels[i].height == height &&
+		    (!resized || levels[i].filter == output->filter)) {
+			return i;
+		}
+	}
+	levels[*levelCount].width = width;
+	levels[*levelCount].height = height;
+	levels[*levelCount].filter = output->filter;
+	levels[*levelCount].bitmap = resized ? NULL : bitmap;
+	return (*levelCount)++;
+}
+
+/* Resizes `level` from the smallest finished level at least as large on both
+ * axes with the same filter, or else from `bitmap`. */
+static void buildEncodeLevel(EncodeLevel *levels, size_t levelCount, EncodeLevel *level,
+                             MMBitmapRef bitmap)
+{
+	MMBitmapRef source = bitmap;
+	for (size_t i = 0; i < levelCount; i++) {
+		const EncodeLevel *other = &levels[i];
+		if (other == level || other->bitmap == NULL || other->bitmap == bitmap ||
+		    other->filter != level->filter ||
+		    other->width < level->width || other->height < level->height) {
+			continue;
+		}
+		if (other->width * other->height < (int64_t)source->width * (int64_t)source->height) {
+			source = other->bitmap;
+		}
+	}
+	level->bitmap = resampleMMBitmap(source, (size_t)level->width, (size_t)level->height,
+	                                 (MMResampleFilter)level->filter);
+}
+
+int32_t encodeMMBitmapOutputs(MMBitmapRef bitmap, MMEncodeOutput *outputs, int32_t count)
+{
+	if (outputs == NULL || count <= 0) return 0;
+	for (int32_t i = 0; i < count; i++) {
+		outputs[i].data = NULL;
+		outputs[i].size = 0;
+		outputs[i].width = 0;
+		outputs[i].height = 0;
+	}
+	if (bitmap == NULL || bitmap->imageBuffer == NULL ||
+	    bitmap->width == 0 || bitmap->height == 0) {
+		return 0;
+	}
+	if (count > MM_MAX_ENCODE_OUTPUTS) count = MM_MAX_ENCODE_OUTPUTS;
+
+	EncodeLevel levels[MM_MAX_ENCODE_OUTPUTS];
+	size_t levelCount = 0;
+	size_t outputLevels[MM_MAX_ENCODE_OUTPUTS];
+	for (int32_t i = 0; i < count; i++) {
+		outputLevels[i] = findEncodeLevel(levels, &levelCount, bitmap, &outputs[i]);
+		outputs[i].width = levels[outputLevels[i]].width;
+		outputs[i].height = levels[outputLevels[i]].height;
+	}
+
+	/* Largest first, so every level can be made from a larger one. */
+	size_t order[MM_MAX_ENCODE_OUTPUTS];
+	for (size_t i = 0; i < levelCount; i++) {
+		size_t j = i;
+		const int64_t area = levels[i].width * levels[i].height;
+		for (; j > 0 && levels[order[j - 1]].width * levels[order[j - 1]].height < area; j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+
+	EncodeJob jobs[MM_MAX_ENCODE_OUTPUTS];
+	MMThread threads[MM_MAX_ENCODE_OUTPUTS];
+	bool started[MM_MAX_ENCODE_OUTPUTS] = { false };
+	int32_t last = -1;  /* The calling thread encodes the last output itself. */
+	for (size_t k = 0; k < levelCount; k++) {
+		EncodeLevel *level = &levels[order[k]];
+		if (level->bitmap == NULL) buildEncodeLevel(levels, levelCount, level, bitmap);
+		for (int32_t i = 0; i < count; i++) {
+			if (outputLevels[i] != order[k]) continue;
+			jobs[i].bitmap = level->bitmap;
+			jobs[i].output = &outputs[i];
+			if (last >= 0) {
+				started[last] = MMThreadCreate(&threads[last], encodeOutputJob, &jobs[last]);
+				if (!started[last]) encodeOutputJob(&jobs[last]);
+			}
+			last = i;
+		}
+	}
+	encodeOutputJob(&jobs[last]);
+
+	int32_t encoded = 0;
+	for (int32_t i = 0; i < count; i++) {
+		if (started[i]) MMThreadJoin(threads[i]);
+		if (outputs[i].data != NULL) encoded++;
+	}
+	for (size_t i = 0; i < levelCount; i++) {
+		if (levels[i].bitmap != NULL && levels[i].bitmap != bitmap) destroyMMBitmap(levels[i].bitmap);
+	}
+	return encoded;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef MULTIENCODE_H
+#define MULTIENCODE_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum {
+	MMEncodeJpeg = 0,
+	MMEncodePng = 1,
+	MMEncodeWebp = 2,
+	MMEncodeWebpLossless = 3
+} MMEncodeFormat;
+
+typedef struct _MMEncodeOutput {
+	int32_t format;       /* An MMEncodeFormat. */
+	int32_t maxSmallDim;  /* -1 for no limit. */
+	int32_t maxLargeDim;
+	int32_t quality;      /* JPEG and WebP quality; lossless WebP effort; unused for PNG. */
+	int32_t filter;       /* An MMResampleFilter. */
+	uint8_t *data;        /* Set on return: to be free()'d by the caller; NULL on error. */
+	int64_t size;
+	int64_t width;        /* Set on return: the encoded image's size. */
+	int64_t height;
+} MMEncodeOutput;
+
+/* Encodes one frame several ways at once. Each distinct output size is
+ * resized once, from the smallest larger size already made with the same
+ * filter (or from `bitmap`), so a pyramid of sizes costs little more than
+ * its largest step. Outputs are encoded in parallel, one thread each, and
+ * an output starts encoding as soon as its size is ready.
+ *
+ * At most MM_MAX_ENCODE_OUTPUTS outputs are encoded; the rest are left
+ * with NULL data. JPEG outputs are always NULL on macOS, where JPEG
+ * encoding goes through ScreenCaptureKit. Returns how many outputs were
+ * encoded. */
+#define MM_MAX_ENCODE_OUTPUTS 16  /* Matches CU_MAX_CAPTURE_OUTPUTS. */
+
+int32_t encodeMMBitmapOutputs(MMBitmapRef bitmap, MMEncodeOutput *outputs, int32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTIENCODE_H */
@@ -6,8 +6,22 @@
 #include "microsleep.h"
 #include "keycode.h"
 #include "MMBitmap.h"
+#include "screendamage.h"
+#include "framediff.h"
+#include "screenwait.h"
+#include "capturesession.h"
+#include "monitorcapture.h"
+#include "screengrab_jpeg.h"
+#include "pngencode.h"
+#include "webpencode.h"
+#include "multiencode.h"
+#include "base64.h"
+#include "captureplan.h"
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 // Helper function to convert key string to MMKeyCode
 MMKeyCode stringToKeyCode(const char* key) {
@@ -257,22 +271,16 @@ CUBitmap* cu_screen_capture_region(int64_t x, int64_t y, int64_t width, int64_t
         return NULL;
     }
     
-    // Copy bitmap data
-    size_t data_size = bitmap->bytewidth * bitmap->height;
-    result->data = malloc(data_size);
-    if (result->data == NULL) {
-        free(result);
-        destroyMMBitmap(bitmap);
-        return NULL;
-    }
-    
-    memcpy(result->data, bitmap->imageBuffer, data_size);
+    // Take over the grab's pixels instead of copying them; every backend
+    // allocates them with malloc, so cu_screen_free_capture can free them
+    result->data = bitmap->imageBuffer;
     result->width = bitmap->width;
     result->height = bitmap->height;
     result->bytewidth = bitmap->bytewidth;
     result->bitsPerPixel = bitmap->bitsPerPixel;
     result->bytesPerPixel = bitmap->bytesPerPixel;
     
+    bitmap->imageBuffer = NULL;
     destroyMMBitmap(bitmap);
     return result;
 }
@@ -300,25 +308,30 @@ CUBitmap* cu_screen_capture_full(void) {
 #ifdef _WIN32
 uint8_t* copyBitmapRegionJpeg_WIN32(int64_t x, int64_t y, int64_t width, int64_t height, 
                                     int32_t maxSmallDim, int32_t maxLargeDim, 
-                                    int32_t quality, int64_t* outSize);
+                                    int32_t quality, int32_t filter, int64_t* outSize);
 uint8_t* copyBitmapFullJpeg_WIN32(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                  int32_t quality, int64_t* outSize);
+                                  int32_t quality, int32_t filter, int64_t* outSize);
 void freeJpegData_WIN32(uint8_t* data);
 #endif
 
 #ifdef __linux__
 uint8_t* copyBitmapRegionJpeg_LINUX(int64_t x, int64_t y, int64_t width, int64_t height, 
                                     int32_t maxSmallDim, int32_t maxLargeDim, 
-                                    int32_t quality, int64_t* outSize);
+                                    int32_t quality, int32_t filter, int64_t* outSize);
 uint8_t* copyBitmapFullJpeg_LINUX(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                  int32_t quality, int64_t* outSize);
+                                  int32_t quality, int32_t filter, int64_t* outSize);
 void freeJpegData_LINUX(uint8_t* data);
+void setJpegCacheEnabled_LINUX(int32_t enabled);
+void clearJpegCache_LINUX(void);
+void getJpegCacheStats_LINUX(int64_t* hits, int64_t* misses);
+void setJpegThreads_LINUX(int32_t threads);
+int32_t getJpegThreads_LINUX(void);
 #endif
 
 // JPEG screenshot functions with resizing
 uint8_t* cu_screen_capture_region_jpeg(int64_t x, int64_t y, int64_t width, int64_t height, 
                                        int32_t maxSmallDim, int32_t maxLargeDim, 
-                                       int32_t quality, int64_t* outSize) {
+                                       int32_t quality, int32_t filter, int64_t* outSize) {
 #ifdef __APPLE__
 #if TARGET_OS_OSX
     // Use ScreenCaptureKit for JPEG with resizing
@@ -327,11 +340,11 @@ uint8_t* cu_screen_capture_region_jpeg(int64_t x, int64_t y, int64_t width, int6
 #endif
 #ifdef _WIN32
     // Use Windows implementation
-    return copyBitmapRegionJpeg_WIN32(x, y, width, height, maxSmallDim, maxLargeDim, quality, outSize);
+    return copyBitmapRegionJpeg_WIN32(x, y, width, height, maxSmallDim, maxLargeDim, quality, filter, outSize);
 #endif
 #ifdef __linux__
     // Use Linux implementation
-    return copyBitmapRegionJpeg_LINUX(x, y, width, height, maxSmallDim, maxLargeDim, quality, outSize);
+    return copyBitmapRegionJpeg_LINUX(x, y, width, height, maxSmallDim, maxLargeDim, quality, filter, outSize);
 #endif
     // Fallback: not implemented for other platforms yet
     if (outSize) *outSize = 0;
@@ -339,7 +352,7 @@ uint8_t* cu_screen_capture_region_jpeg(int64_t x, int64_t y, int64_t width, int6
 }
 
 uint8_t* cu_screen_capture_full_jpeg(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                     int32_t quality, int64_t* outSize) {
+                                     int32_t quality, int32_t filter, int64_t* outSize) {
 #ifdef __APPLE__
 #if TARGET_OS_OSX
     // Use ScreenCaptureKit for JPEG with resizing
@@ -348,11 +361,11 @@ uint8_t* cu_screen_capture_full_jpeg(int32_t maxSmallDim, int32_t maxLargeDim,
 #endif
 #ifdef _WIN32
     // Use Windows implementation
-    return copyBitmapFullJpeg_WIN32(maxSmallDim, maxLargeDim, quality, outSize);
+    return copyBitmapFullJpeg_WIN32(maxSmallDim, maxLargeDim, quality, filter, outSize);
 #endif
 #ifdef __linux__
     // Use Linux implementation
-    return copyBitmapFullJpeg_LINUX(maxSmallDim, maxLargeDim, quality, outSize);
+    return copyBitmapFullJpeg_LINUX(maxSmallDim, maxLargeDim, quality, filter, outSize);
 #endif
     // Fallback: not implemented for other platforms yet
     if (outSize) *outSize = 0;
@@ -380,6 +393,707 @@ void cu_screen_free_jpeg(uint8_t* data) {
     }
 }
 
+uint8_t* cu_screen_capture_region_jpeg_budget(int64_t x, int64_t y, int64_t width, int64_t height,
+                                              int32_t maxSmallDim, int32_t maxLargeDim,
+                                              int64_t maxBytes, int32_t filter,
+                                              int32_t* outQuality, int64_t* outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+#ifdef __APPLE__
+    // ScreenCaptureKit encodes at a fixed quality, so there is nothing to search
+    return NULL;
+#else
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    uint8_t* jpeg = encodeMMBitmapJpegBudget(bitmap, maxSmallDim, maxLargeDim, maxBytes, filter,
+                                             outQuality, outSize);
+    destroyMMBitmap(bitmap);
+    return jpeg;
+#endif
+}
+
+uint8_t* cu_screen_capture_full_jpeg_budget(int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int64_t maxBytes, int32_t filter,
+                                            int32_t* outQuality, int64_t* outSize) {
+    MMSize size = getMainDisplaySize();
+    return cu_screen_capture_region_jpeg_budget(0, 0, size.width, size.height,
+                                                maxSmallDim, maxLargeDim, maxBytes, filter,
+                                                outQuality, outSize);
+}
+
+uint8_t* cu_screen_capture_region_png(int64_t x, int64_t y, int64_t width, int64_t height,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t filter, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    uint8_t* png = encodeMMBitmapPng(bitmap, maxSmallDim, maxLargeDim, filter, outSize);
+    destroyMMBitmap(bitmap);
+    return png;
+}
+
+uint8_t* cu_screen_capture_full_png(int32_t maxSmallDim, int32_t maxLargeDim,
+                                    int32_t filter, int64_t* outSize) {
+    MMSize size = getMainDisplaySize();
+    return cu_screen_capture_region_png(0, 0, size.width, size.height,
+                                        maxSmallDim, maxLargeDim, filter, outSize);
+}
+
+void cu_screen_free_png(uint8_t* data) {
+    free(data);
+}
+
+int32_t cu_screen_webp_available(void) {
+    return MMWebpAvailable() ? 1 : 0;
+}
+
+uint8_t* cu_screen_capture_region_webp(int64_t x, int64_t y, int64_t width, int64_t height,
+                                       int32_t maxSmallDim, int32_t maxLargeDim,
+                                       int32_t quality, int32_t lossless, int32_t filter,
+                                       int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    if (!MMWebpAvailable()) {
+        return NULL;
+    }
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    uint8_t* webp = encodeMMBitmapWebp(bitmap, maxSmallDim, maxLargeDim, quality,
+                                       lossless != 0, filter, outSize);
+    destroyMMBitmap(bitmap);
+    return webp;
+}
+
+uint8_t* cu_screen_capture_full_webp(int32_t maxSmallDim, int32_t maxLargeDim,
+                                     int32_t quality, int32_t lossless, int32_t filter,
+                                     int64_t* outSize) {
+    MMSize size = getMainDisplaySize();
+    return cu_screen_capture_region_webp(0, 0, size.width, size.height,
+                                         maxSmallDim, maxLargeDim, quality, lossless, filter,
+                                         outSize);
+}
+
+void cu_screen_free_webp(uint8_t* data) {
+    free(data);
+}
+
+int32_t cu_screen_capture_region_multi(int64_t x, int64_t y, int64_t width, int64_t height,
+                                       CUCaptureOutput* outputs, int32_t count) {
+    if (outputs == NULL || count <= 0) {
+        return 0;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        outputs[i].data = NULL;
+        outputs[i].size = 0;
+        outputs[i].width = 0;
+        outputs[i].height = 0;
+    }
+    if (count > MM_MAX_ENCODE_OUTPUTS) {
+        count = MM_MAX_ENCODE_OUTPUTS;
+    }
+
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    if (bitmap == NULL) {
+        return -1;
+    }
+    MMEncodeOutput encodes[MM_MAX_ENCODE_OUTPUTS];
+    for (int32_t i = 0; i < count; i++) {
+        encodes[i].format = outputs[i].format;
+        encodes[i].maxSmallDim = outputs[i].maxSmallDim;
+        encodes[i].maxLargeDim = outputs[i].maxLargeDim;
+        encodes[i].quality = outputs[i].quality;
+        encodes[i].filter = outputs[i].filter;
+    }
+    int32_t encoded = encodeMMBitmapOutputs(bitmap, encodes, count);
+    destroyMMBitmap(bitmap);
+    for (int32_t i = 0; i < count; i++) {
+        outputs[i].data = encodes[i].data;
+        outputs[i].size = encodes[i].size;
+        outputs[i].width = encodes[i].width;
+        outputs[i].height = encodes[i].height;
+    }
+    return encoded;
+}
+
+int32_t cu_screen_capture_full_multi(CUCaptureOutput* outputs, int32_t count) {
+    MMSize size = getMainDisplaySize();
+    return cu_screen_capture_region_multi(0, 0, size.width, size.height, outputs, count);
+}
+
+void cu_screen_free_outputs(CUCaptureOutput* outputs, int32_t count) {
+    if (outputs == NULL) {
+        return;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        free(outputs[i].data);
+        outputs[i].data = NULL;
+        outputs[i].size = 0;
+    }
+}
+
+// Captures the region, or the full screen when `full` is set, in `format`.
+// Frees the result with `*outFree`.
+static uint8_t* captureEncoded(bool full, int64_t x, int64_t y, int64_t width, int64_t height,
+                               int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                               int32_t quality, int32_t filter, int64_t* outSize,
+                               void (**outFree)(uint8_t*)) {
+    switch (format) {
+    case CU_FORMAT_JPEG:
+        *outFree = cu_screen_free_jpeg;
+        return full ? cu_screen_capture_full_jpeg(maxSmallDim, maxLargeDim, quality, filter, outSize)
+                    : cu_screen_capture_region_jpeg(x, y, width, height, maxSmallDim, maxLargeDim,
+                                                    quality, filter, outSize);
+    case CU_FORMAT_PNG:
+        *outFree = cu_screen_free_png;
+        return full ? cu_screen_capture_full_png(maxSmallDim, maxLargeDim, filter, outSize)
+                    : cu_screen_capture_region_png(x, y, width, height, maxSmallDim, maxLargeDim,
+                                                   filter, outSize);
+    case CU_FORMAT_WEBP:
+    case CU_FORMAT_WEBP_LOSSLESS: {
+        const int32_t lossless = format == CU_FORMAT_WEBP_LOSSLESS;
+        *outFree = cu_screen_free_webp;
+        return full ? cu_screen_capture_full_webp(maxSmallDim, maxLargeDim, quality, lossless,
+                                                  filter, outSize)
+                    : cu_screen_capture_region_webp(x, y, width, height, maxSmallDim, maxLargeDim,
+                                                    quality, lossless, filter, outSize);
+    }
+    default:
+        return NULL;
+    }
+}
+
+// Returns `prefix` followed by the base64 of `image` as a NUL-terminated
+// string, and its length in `outLength`.
+static char* writeBase64(const uint8_t* image, int64_t size, const char* prefix,
+                         int64_t* outLength) {
+    const size_t prefixLength = strlen(prefix);
+    const size_t length = prefixLength + base64EncodedLength((size_t)size);
+    char* base64 = malloc(length + 1);
+    if (base64 != NULL) {
+        memcpy(base64, prefix, prefixLength);
+        encodeBase64(image, (size_t)size, base64 + prefixLength, MMBase64BackendAuto);
+        base64[length] = '\0';
+        if (outLength) *outLength = (int64_t)length;
+    }
+    return base64;
+}
+
+#ifndef __APPLE__
+static char* captureJpegBase64(bool full, int64_t x, int64_t y, int64_t width, int64_t height,
+                               int32_t maxSmallDim, int32_t maxLargeDim, int32_t quality,
+                               int32_t filter, const char* prefix, int64_t* outLength);
+#endif
+
+static char* captureBase64(bool full, int64_t x, int64_t y, int64_t width, int64_t height,
+                           int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                           int32_t quality, int32_t filter, int32_t dataUri, int64_t* outLength) {
+    if (outLength) *outLength = 0;
+    const char* prefix = "";
+    if (dataUri) {
+        prefix = format == CU_FORMAT_JPEG ? "data:image/jpeg;base64,"
+               : format == CU_FORMAT_PNG ? "data:image/png;base64,"
+               : "data:image/webp;base64,";
+    }
+#ifndef __APPLE__
+    if (format == CU_FORMAT_JPEG) {
+        return captureJpegBase64(full, x, y, width, height, maxSmallDim, maxLargeDim,
+                                 quality, filter, prefix, outLength);
+    }
+#endif
+
+    void (*freeImage)(uint8_t*) = NULL;
+    int64_t size = 0;
+    uint8_t* image = captureEncoded(full, x, y, width, height, format, maxSmallDim, maxLargeDim,
+                                    quality, filter, &size, &freeImage);
+    if (image == NULL) {
+        return NULL;
+    }
+    char* base64 = writeBase64(image, size, prefix, outLength);
+    freeImage(image);
+    return base64;
+}
+
+char* cu_screen_capture_region_base64(int64_t x, int64_t y, int64_t width, int64_t height,
+                                      int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t quality, int32_t filter, int32_t dataUri,
+                                      int64_t* outLength) {
+    return captureBase64(false, x, y, width, height, format, maxSmallDim, maxLargeDim,
+                         quality, filter, dataUri, outLength);
+}
+
+char* cu_screen_capture_full_base64(int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                                    int32_t quality, int32_t filter, int32_t dataUri,
+                                    int64_t* outLength) {
+    return captureBase64(true, 0, 0, 0, 0, format, maxSmallDim, maxLargeDim,
+                         quality, filter, dataUri, outLength);
+}
+
+void cu_screen_free_base64(char* data) {
+    free(data);
+}
+
+int64_t cu_base64_encode(const uint8_t* data, int64_t size, char* out) {
+    if (size < 0 || (size > 0 && (data == NULL || out == NULL))) {
+        return -1;
+    }
+    encodeBase64(data, (size_t)size, out, MMBase64BackendAuto);
+    return (int64_t)base64EncodedLength((size_t)size);
+}
+
+void cu_screen_jpeg_cache_set_enabled(int32_t enabled) {
+#ifdef __linux__
+    setJpegCacheEnabled_LINUX(enabled);
+#else
+    (void)enabled;
+#endif
+}
+
+void cu_screen_jpeg_cache_clear(void) {
+#ifdef __linux__
+    clearJpegCache_LINUX();
+#endif
+}
+
+void cu_screen_jpeg_cache_get_stats(int64_t* hits, int64_t* misses) {
+#ifdef __linux__
+    getJpegCacheStats_LINUX(hits, misses);
+#else
+    if (hits) *hits = 0;
+    if (misses) *misses = 0;
+#endif
+}
+
+void cu_screen_jpeg_set_threads(int32_t threads) {
+#ifdef __linux__
+    setJpegThreads_LINUX(threads);
+#else
+    (void)threads;
+#endif
+}
+
+int32_t cu_screen_jpeg_get_threads(void) {
+#ifdef __linux__
+    return getJpegThreads_LINUX();
+#else
+    return 1;
+#endif
+}
+
+// Reusable JPEG encoders
+struct CUJpegEncoder {
+    MMJpegEncoderRef jpeg;  // NULL where JPEG goes through ScreenCaptureKit
+    MMBitmap bitmap;        // Last grab, whose buffer the next one reuses
+    size_t capacity;
+    uint8_t* ownedJpeg;     // Last result when there's no MMJpegEncoder
+    const uint8_t* last;    // Last JPEG if it's in the encoder's memory
+    int64_t lastSize;
+};
+
+CUJpegEncoder* cu_jpeg_encoder_create(void) {
+    CUJpegEncoder* encoder = calloc(1, sizeof(CUJpegEncoder));
+    if (encoder == NULL) {
+        return NULL;
+    }
+#ifndef __APPLE__
+    encoder->jpeg = createMMJpegEncoder();
+    if (encoder->jpeg == NULL) {
+        free(encoder);
+        return NULL;
+    }
+#endif
+    return encoder;
+}
+
+void cu_jpeg_encoder_destroy(CUJpegEncoder* encoder) {
+    if (encoder == NULL) {
+        return;
+    }
+    destroyMMJpegEncoder(encoder->jpeg);
+    free(encoder->bitmap.imageBuffer);
+    cu_screen_free_jpeg(encoder->ownedJpeg);
+    free(encoder);
+}
+
+// The region an encoder captures: width or height <= 0 means the whole screen
+static MMRect jpegEncoderRect(int64_t x, int64_t y, int64_t width, int64_t height) {
+    if (width <= 0 || height <= 0) {
+        MMSize size = getMainDisplaySize();
+        return MMRectMake(0, 0, size.width, size.height);
+    }
+    return MMRectMake(x, y, width, height);
+}
+
+// Grabs `rect` into the previous grab's buffer when the backend allows, else
+// takes over a freshly grabbed one. Returns NULL on failure.
+static MMBitmapRef grabWithJpegEncoder(CUJpegEncoder* encoder, MMRect rect) {
+    MMBitmap* bitmap = &encoder->bitmap;
+    if (bitmap->imageBuffer == NULL ||
+        !copyMMBitmapFromDisplayInRectInto(rect, bitmap, encoder->capacity)) {
+        MMBitmapRef grabbed = copyMMBitmapFromDisplayInRect(rect);
+        if (grabbed == NULL) {
+            return NULL;
+        }
+        free(bitmap->imageBuffer);
+        *bitmap = *grabbed;
+        encoder->capacity = grabbed->bytewidth * grabbed->height;
+        grabbed->imageBuffer = NULL;
+        destroyMMBitmap(grabbed);
+    }
+    return bitmap;
+}
+
+// Captures with `encoder`, into `buffer` if the JPEG fits in `capacity`
+// bytes. Returns wherever the JPEG ended up, or NULL on failure.
+static const uint8_t* captureWithJpegEncoder(CUJpegEncoder* encoder,
+                                             int64_t x, int64_t y,
+                                             int64_t width, int64_t height,
+                                             int32_t maxSmallDim, int32_t maxLargeDim,
+                                             int32_t quality, int32_t filter,
+                                             uint8_t* buffer, size_t capacity,
+                                             int64_t* outSize) {
+    *outSize = 0;
+    encoder->last = NULL;
+    encoder->lastSize = 0;
+    MMRect rect = jpegEncoderRect(x, y, width, height);
+
+    const uint8_t* jpeg = NULL;
+    if (encoder->jpeg == NULL) {
+        cu_screen_free_jpeg(encoder->ownedJpeg);
+        encoder->ownedJpeg = cu_screen_capture_region_jpeg(rect.origin.x, rect.origin.y,
+                                                           rect.size.width, rect.size.height,
+                                                           maxSmallDim, maxLargeDim,
+                                                           quality, filter, outSize);
+        jpeg = encoder->ownedJpeg;
+        if (jpeg != NULL && buffer != NULL && (size_t)*outSize <= capacity) {
+            memcpy(buffer, jpeg, (size_t)*outSize);
+            jpeg = buffer;
+        }
+    } else {
+        MMBitmapRef bitmap = grabWithJpegEncoder(encoder, rect);
+        if (bitmap == NULL) {
+            return NULL;
+        }
+        jpeg = encodeMMBitmapJpegWith(encoder->jpeg, bitmap, maxSmallDim, maxLargeDim,
+                                      quality, filter, buffer, capacity, outSize);
+    }
+
+    if (jpeg != NULL && jpeg != buffer) {
+        encoder->last = jpeg;
+        encoder->lastSize = *outSize;
+    }
+    return jpeg;
+}
+
+#ifndef __APPLE__
+// Base64 JPEGs share one encoder, so the JPEG stays in its memory and only
+// the base64 string is allocated per capture. This skips the one-off JPEG
+// cache and grim's encoder, which both hand back a JPEG of their own.
+#ifdef _WIN32
+static SRWLOCK base64EncoderLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t base64EncoderLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static CUJpegEncoder* base64Encoder = NULL;
+
+static char* captureJpegBase64(bool full, int64_t x, int64_t y, int64_t width, int64_t height,
+                               int32_t maxSmallDim, int32_t maxLargeDim, int32_t quality,
+                               int32_t filter, const char* prefix, int64_t* outLength) {
+    // The encoder reads an empty region as the whole screen
+    if (!full && (width <= 0 || height <= 0)) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&base64EncoderLock);
+#else
+    pthread_mutex_lock(&base64EncoderLock);
+#endif
+    if (base64Encoder == NULL) {
+        base64Encoder = cu_jpeg_encoder_create();
+    }
+    char* base64 = NULL;
+    if (base64Encoder != NULL) {
+        int64_t size = 0;
+        const uint8_t* jpeg = captureWithJpegEncoder(base64Encoder, x, y,
+                                                     full ? 0 : width, full ? 0 : height,
+                                                     maxSmallDim, maxLargeDim, quality, filter,
+                                                     NULL, 0, &size);
+        if (jpeg != NULL) {
+            base64 = writeBase64(jpeg, size, prefix, outLength);
+        }
+    }
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&base64EncoderLock);
+#else
+    pthread_mutex_unlock(&base64EncoderLock);
+#endif
+    return base64;
+}
+#endif
+
+const uint8_t* cu_jpeg_encoder_capture_region(CUJpegEncoder* encoder,
+                                              int64_t x, int64_t y,
+                                              int64_t width, int64_t height,
+                                              int32_t maxSmallDim, int32_t maxLargeDim,
+                                              int32_t quality, int32_t filter,
+                                              int64_t* outSize) {
+    int64_t size = 0;
+    const uint8_t* jpeg = NULL;
+    if (encoder != NULL) {
+        jpeg = captureWithJpegEncoder(encoder, x, y, width, height, maxSmallDim, maxLargeDim,
+                                      quality, filter, NULL, 0, &size);
+    }
+    if (outSize) *outSize = size;
+    return jpeg;
+}
+
+int64_t cu_jpeg_encoder_capture_region_into(CUJpegEncoder* encoder,
+                                            int64_t x, int64_t y,
+                                            int64_t width, int64_t height,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int32_t quality, int32_t filter,
+                                            uint8_t* buffer, int64_t capacity) {
+    if (encoder == NULL) {
+        return -1;
+    }
+    int64_t size = 0;
+    const uint8_t* jpeg = captureWithJpegEncoder(encoder, x, y, width, height,
+                                                 maxSmallDim, maxLargeDim, quality, filter,
+                                                 buffer, capacity > 0 ? (size_t)capacity : 0,
+                                                 &size);
+    return jpeg != NULL ? size : -1;
+}
+
+const uint8_t* cu_jpeg_encoder_capture_region_budget(CUJpegEncoder* encoder,
+                                                     int64_t x, int64_t y,
+                                                     int64_t width, int64_t height,
+                                                     int32_t maxSmallDim, int32_t maxLargeDim,
+                                                     int64_t maxBytes, int32_t filter,
+                                                     int32_t* outQuality, int64_t* outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+    if (encoder == NULL) {
+        return NULL;
+    }
+    encoder->last = NULL;
+    encoder->lastSize = 0;
+    if (encoder->jpeg == NULL) {
+        return NULL;
+    }
+
+    MMBitmapRef bitmap = grabWithJpegEncoder(encoder, jpegEncoderRect(x, y, width, height));
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    int64_t size = 0;
+    const uint8_t* jpeg = encodeMMBitmapJpegBudgetWith(encoder->jpeg, bitmap,
+                                                       maxSmallDim, maxLargeDim, maxBytes,
+                                                       filter, outQuality, &size);
+    if (jpeg != NULL) {
+        encoder->last = jpeg;
+        encoder->lastSize = size;
+        if (outSize) *outSize = size;
+    }
+    return jpeg;
+}
+
+int64_t cu_jpeg_encoder_copy_last(CUJpegEncoder* encoder, uint8_t* buffer, int64_t capacity) {
+    if (encoder == NULL || encoder->last == NULL) {
+        return -1;
+    }
+    if (buffer != NULL && encoder->lastSize <= capacity) {
+        memcpy(buffer, encoder->last, (size_t)encoder->lastSize);
+    }
+    return encoder->lastSize;
+}
+
+// Capture plans
+struct CUCapturePlan {
+    MMCapturePlanRef plan;
+};
+
+CUCapturePlan* cu_capture_plan_create(int64_t x, int64_t y, int64_t width, int64_t height,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t filter) {
+    CUCapturePlan* plan = calloc(1, sizeof(CUCapturePlan));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->plan = createMMCapturePlan(MMRectMake(x, y, width, height),
+                                     maxSmallDim, maxLargeDim, filter);
+    if (plan->plan == NULL) {
+        free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void cu_capture_plan_destroy(CUCapturePlan* plan) {
+    if (plan == NULL) {
+        return;
+    }
+    destroyMMCapturePlan(plan->plan);
+    free(plan);
+}
+
+CUSize cu_capture_plan_get_image_size(CUCapturePlan* plan) {
+    CUSize result = {0, 0};
+    if (plan != NULL) {
+        MMSize size = getMMCapturePlanImageSize(plan->plan);
+        result.width = size.width;
+        result.height = size.height;
+    }
+    return result;
+}
+
+CUCoordinateTransform cu_capture_plan_get_transform(CUCapturePlan* plan) {
+    CUCoordinateTransform result = {1.0, 1.0, 0.0, 0.0};
+    if (plan != NULL) {
+        MMCaptureTransform transform = getMMCapturePlanTransform(plan->plan);
+        result.scaleX = transform.scaleX;
+        result.scaleY = transform.scaleY;
+        result.originX = transform.originX;
+        result.originY = transform.originY;
+    }
+    return result;
+}
+
+static int64_t roundToPixel(double value) {
+    return (int64_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+CUPoint cu_capture_plan_to_screen(CUCapturePlan* plan, double imageX, double imageY) {
+    CUPoint result = {0, 0};
+    if (plan != NULL) {
+        MMCaptureTransform transform = getMMCapturePlanTransform(plan->plan);
+        double x, y;
+        MMCaptureTransformToScreen(&transform, imageX, imageY, &x, &y);
+        result.x = roundToPixel(x);
+        result.y = roundToPixel(y);
+    }
+    return result;
+}
+
+CUPoint cu_capture_plan_to_image(CUCapturePlan* plan, double screenX, double screenY) {
+    CUPoint result = {0, 0};
+    if (plan != NULL) {
+        MMCaptureTransform transform = getMMCapturePlanTransform(plan->plan);
+        double x, y;
+        MMCaptureTransformToImage(&transform, screenX, screenY, &x, &y);
+        result.x = roundToPixel(x);
+        result.y = roundToPixel(y);
+    }
+    return result;
+}
+
+const uint8_t* cu_capture_plan_capture(CUCapturePlan* plan, int32_t format,
+                                       int32_t quality, int64_t* outSize) {
+    int64_t size = 0;
+    const uint8_t* data = plan != NULL
+        ? captureMMCapturePlanImage(plan->plan, format, quality, &size)
+        : NULL;
+    if (outSize) *outSize = data != NULL ? size : 0;
+    return data;
+}
+
+// Monitors
+#define CU_MAX_MONITORS 16
+
+static void copyMonitorOut(const MMMonitor* monitor, CUMonitor* out) {
+    out->x = monitor->bounds.origin.x;
+    out->y = monitor->bounds.origin.y;
+    out->width = monitor->bounds.size.width;
+    out->height = monitor->bounds.size.height;
+    out->primary = monitor->primary ? 1 : 0;
+}
+
+int32_t cu_screen_get_monitors(CUMonitor* outMonitors, int32_t maxMonitors) {
+    MMMonitor monitors[CU_MAX_MONITORS];
+    int32_t count = getMonitors(monitors, CU_MAX_MONITORS);
+    for (int32_t i = 0; outMonitors != NULL && i < count && i < maxMonitors && i < CU_MAX_MONITORS; i++) {
+        copyMonitorOut(&monitors[i], &outMonitors[i]);
+    }
+    return count;
+}
+
+static bool getMonitorBounds(int32_t index, MMRect* bounds) {
+    MMMonitor monitors[CU_MAX_MONITORS];
+    int32_t count = getMonitors(monitors, CU_MAX_MONITORS);
+    if (index < 0 || index >= count || index >= CU_MAX_MONITORS) {
+        return false;
+    }
+    *bounds = monitors[index].bounds;
+    return true;
+}
+
+CUBitmap* cu_screen_capture_monitor(int32_t index) {
+    MMRect bounds;
+    if (!getMonitorBounds(index, &bounds)) {
+        return NULL;
+    }
+    return cu_screen_capture_region(bounds.origin.x, bounds.origin.y,
+                                    bounds.size.width, bounds.size.height);
+}
+
+uint8_t* cu_screen_capture_monitor_jpeg(int32_t index,
+                                        int32_t maxSmallDim, int32_t maxLargeDim,
+                                        int32_t quality, int32_t filter, int64_t* outSize) {
+    MMRect bounds;
+    if (outSize) *outSize = 0;
+    if (!getMonitorBounds(index, &bounds)) {
+        return NULL;
+    }
+    return cu_screen_capture_region_jpeg(bounds.origin.x, bounds.origin.y,
+                                         bounds.size.width, bounds.size.height,
+                                         maxSmallDim, maxLargeDim, quality, filter, outSize);
+}
+
+int32_t cu_screen_capture_all_monitors_jpeg(CUMonitorJpeg* outResults, int32_t maxResults,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int32_t quality, int32_t filter) {
+    if (outResults == NULL || maxResults <= 0) {
+        return 0;
+    }
+    if (maxResults > CU_MAX_MONITORS) {
+        maxResults = CU_MAX_MONITORS;
+    }
+
+    MMMonitorJpeg results[CU_MAX_MONITORS];
+    int32_t count = copyAllMonitorsJpeg(results, maxResults, maxSmallDim, maxLargeDim, quality, filter);
+    if (count >= 0) {
+        for (int32_t i = 0; i < count; i++) {
+            copyMonitorOut(&results[i].monitor, &outResults[i].monitor);
+            outResults[i].jpeg = results[i].jpeg;
+            outResults[i].size = results[i].size;
+        }
+        return count;
+    }
+
+    // No bitmap grab on this backend (macOS); capture each monitor in turn
+    MMMonitor monitors[CU_MAX_MONITORS];
+    count = getMonitors(monitors, CU_MAX_MONITORS);
+    if (count < 0) {
+        return -1;
+    }
+    if (count > maxResults) {
+        count = maxResults;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        const MMRect bounds = monitors[i].bounds;
+        copyMonitorOut(&monitors[i], &outResults[i].monitor);
+        outResults[i].jpeg = cu_screen_capture_region_jpeg(bounds.origin.x, bounds.origin.y,
+                                                           bounds.size.width, bounds.size.height,
+                                                           maxSmallDim, maxLargeDim, quality,
+                                                           filter, &outResults[i].size);
+    }
+    return count;
+}
+
 void cu_screen_free_capture(CUBitmap* bitmap) {
     if (bitmap != NULL) {
         if (bitmap->data != NULL) {
@@ -389,6 +1103,264 @@ void cu_screen_free_capture(CUBitmap* bitmap) {
     }
 }
 
+static void copyRectsOut(const MMRect* rects, CURect* outRects, int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        outRects[i].x = rects[i].origin.x;
+        outRects[i].y = rects[i].origin.y;
+        outRects[i].width = rects[i].size.width;
+        outRects[i].height = rects[i].size.height;
+    }
+}
+
+// Damage tracking
+int32_t cu_screen_damage_start(void) {
+#ifdef __linux__
+    return startDamageTracking() ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+void cu_screen_damage_stop(void) {
+#ifdef __linux__
+    stopDamageTracking();
+#endif
+}
+
+int64_t cu_screen_get_frame_sequence(void) {
+#ifdef __linux__
+    return getDamageSequence();
+#else
+    return -1;
+#endif
+}
+
+int32_t cu_screen_get_dirty_rects(int64_t sinceSequence, CURect* outRects,
+                                  int32_t maxRects, int64_t* outSequence) {
+#ifdef __linux__
+    if (outRects == NULL || maxRects <= 0) {
+        return copyDamageSince(sinceSequence, NULL, 0, outSequence);
+    }
+
+    MMRect* rects = malloc(sizeof(MMRect) * (size_t)maxRects);
+    if (rects == NULL) {
+        return -1;
+    }
+
+    int32_t count = copyDamageSince(sinceSequence, rects, maxRects, outSequence);
+    copyRectsOut(rects, outRects, count);
+    free(rects);
+    return count;
+#else
+    (void)sinceSequence;
+    (void)outRects;
+    (void)maxRects;
+    if (outSequence) *outSequence = -1;
+    return -1;
+#endif
+}
+
+// Frame differ
+CUFrameDiffer* cu_frame_differ_create(int32_t tileSize) {
+    if (tileSize < 0) {
+        return NULL;
+    }
+    return (CUFrameDiffer*)createMMFrameDiffer((size_t)tileSize);
+}
+
+void cu_frame_differ_destroy(CUFrameDiffer* differ) {
+    destroyMMFrameDiffer((MMFrameDifferRef)differ);
+}
+
+void cu_frame_differ_reset(CUFrameDiffer* differ) {
+    if (differ != NULL) {
+        resetMMFrameDiffer((MMFrameDifferRef)differ);
+    }
+}
+
+static int32_t diffBitmapOut(CUFrameDiffer* differ, MMBitmapRef bitmap,
+                             CURect* outRects, int32_t maxRects,
+                             int64_t* outChangedPixels) {
+    if (outRects == NULL || maxRects <= 0) {
+        return diffMMFrame((MMFrameDifferRef)differ, bitmap, NULL, 0, outChangedPixels);
+    }
+
+    MMRect* rects = malloc(sizeof(MMRect) * (size_t)maxRects);
+    if (rects == NULL) {
+        return -1;
+    }
+
+    int32_t count = diffMMFrame((MMFrameDifferRef)differ, bitmap, rects, maxRects, outChangedPixels);
+    copyRectsOut(rects, outRects, count);
+    free(rects);
+    return count;
+}
+
+int32_t cu_frame_differ_compare(CUFrameDiffer* differ, const CUBitmap* bitmap,
+                                CURect* outRects, int32_t maxRects,
+                                int64_t* outChangedPixels) {
+    if (differ == NULL || bitmap == NULL) {
+        return -1;
+    }
+
+    // Borrow the caller's pixels; the differ keeps only hashes.
+    MMBitmap view = {
+        bitmap->data,
+        (size_t)bitmap->width,
+        (size_t)bitmap->height,
+        (size_t)bitmap->bytewidth,
+        bitmap->bitsPerPixel,
+        bitmap->bytesPerPixel,
+    };
+    return diffBitmapOut(differ, &view, outRects, maxRects, outChangedPixels);
+}
+
+int32_t cu_frame_differ_capture_region(CUFrameDiffer* differ,
+                                       int64_t x, int64_t y, int64_t width, int64_t height,
+                                       CURect* outRects, int32_t maxRects,
+                                       int64_t* outChangedPixels) {
+    if (differ == NULL) {
+        return -1;
+    }
+
+    MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
+    if (bitmap == NULL) {
+        return -1;
+    }
+
+    int32_t count = diffBitmapOut(differ, bitmap, outRects, maxRects, outChangedPixels);
+    destroyMMBitmap(bitmap);
+    return count;
+}
+
+int32_t cu_frame_differ_capture_full(CUFrameDiffer* differ,
+                                     CURect* outRects, int32_t maxRects,
+                                     int64_t* outChangedPixels) {
+    if (differ == NULL) {
+        return -1;
+    }
+
+#ifdef __APPLE__
+    // Full-screen grabs go through ScreenCaptureKit here.
+    CUBitmap* bitmap = cu_screen_capture_full();
+    if (bitmap == NULL) {
+        return -1;
+    }
+
+    int32_t count = cu_frame_differ_compare(differ, bitmap, outRects, maxRects, outChangedPixels);
+    cu_screen_free_capture(bitmap);
+    return count;
+#else
+    MMSize size = getMainDisplaySize();
+    return cu_frame_differ_capture_region(differ, 0, 0, size.width, size.height,
+                                          outRects, maxRects, outChangedPixels);
+#endif
+}
+
+int32_t cu_screen_wait_stable(int64_t x, int64_t y, int64_t width, int64_t height,
+                              int64_t quietMs, int64_t timeoutMs,
+                              int64_t* outElapsedMs) {
+    if (width <= 0 || height <= 0) {
+        MMSize size = getMainDisplaySize();
+        x = 0;
+        y = 0;
+        width = size.width;
+        height = size.height;
+    }
+    return waitForStableRegion(MMRectMake(x, y, width, height), quietMs, timeoutMs, outElapsedMs);
+}
+
+// Continuous capture sessions
+typedef struct {
+    CUCaptureFrame frame;           // First, so the public pointer converts back
+    const MMCaptureFrame* borrowed;
+} CUCaptureFrameHandle;
+
+CUCaptureSession* cu_capture_session_start(const CUCaptureSessionConfig* config) {
+    if (config == NULL) {
+        return NULL;
+    }
+
+    MMCaptureSessionConfig sessionConfig;
+    sessionConfig.region = MMRectMake(config->x, config->y, config->width, config->height);
+    if (config->width <= 0 || config->height <= 0) {
+        MMSize size = getMainDisplaySize();
+        sessionConfig.region = MMRectMake(0, 0, size.width, size.height);
+    }
+    sessionConfig.intervalMs = config->intervalMs;
+    sessionConfig.ringSize = config->ringSize > 0 ? (size_t)config->ringSize : 0;
+    sessionConfig.encodeJpeg = config->encodeJpeg != 0;
+    sessionConfig.maxSmallDim = config->maxSmallDim;
+    sessionConfig.maxLargeDim = config->maxLargeDim;
+    sessionConfig.quality = config->quality;
+    sessionConfig.filter = config->filter;
+
+    return (CUCaptureSession*)startMMCaptureSession(&sessionConfig);
+}
+
+void cu_capture_session_stop(CUCaptureSession* session) {
+    stopMMCaptureSession((MMCaptureSessionRef)session);
+}
+
+static CUCaptureFrame* wrapCaptureFrame(CUCaptureSession* session, const MMCaptureFrame* borrowed) {
+    if (borrowed == NULL) {
+        return NULL;
+    }
+
+    CUCaptureFrameHandle* handle = malloc(sizeof(CUCaptureFrameHandle));
+    if (handle == NULL) {
+        releaseMMCaptureFrame((MMCaptureSessionRef)session, borrowed);
+        return NULL;
+    }
+
+    handle->borrowed = borrowed;
+    handle->frame.sequence = borrowed->sequence;
+    handle->frame.timestampUs = (int64_t)(borrowed->timestampMs * 1000.0);
+    handle->frame.bitmap.data = borrowed->bitmap.imageBuffer;
+    handle->frame.bitmap.width = borrowed->bitmap.width;
+    handle->frame.bitmap.height = borrowed->bitmap.height;
+    handle->frame.bitmap.bytewidth = borrowed->bitmap.bytewidth;
+    handle->frame.bitmap.bitsPerPixel = borrowed->bitmap.bitsPerPixel;
+    handle->frame.bitmap.bytesPerPixel = borrowed->bitmap.bytesPerPixel;
+    handle->frame.jpeg = borrowed->jpeg;
+    handle->frame.jpegSize = borrowed->jpegSize;
+    return &handle->frame;
+}
+
+CUCaptureFrame* cu_capture_session_latest(CUCaptureSession* session) {
+    MMCaptureSessionRef ref = (MMCaptureSessionRef)session;
+    return wrapCaptureFrame(session, acquireLatestMMCaptureFrame(ref));
+}
+
+CUCaptureFrame* cu_capture_session_next(CUCaptureSession* session,
+                                        int64_t afterSequence, int32_t timeoutMs) {
+    MMCaptureSessionRef ref = (MMCaptureSessionRef)session;
+    return wrapCaptureFrame(session, acquireNextMMCaptureFrame(ref, afterSequence, timeoutMs));
+}
+
+void cu_capture_session_release_frame(CUCaptureSession* session, CUCaptureFrame* frame) {
+    if (session == NULL || frame == NULL) {
+        return;
+    }
+
+    CUCaptureFrameHandle* handle = (CUCaptureFrameHandle*)frame;
+    releaseMMCaptureFrame((MMCaptureSessionRef)session, handle->borrowed);
+    free(handle);
+}
+
+void cu_capture_session_get_stats(CUCaptureSession* session, CUCaptureSessionStats* outStats) {
+    if (outStats == NULL) {
+        return;
+    }
+
+    MMCaptureSessionStats stats = {0, 0, 0, 0};
+    getMMCaptureSessionStats((MMCaptureSessionRef)session, &stats);
+    outStats->captured = stats.captured;
+    outStats->dropped = stats.dropped;
+    outStats->late = stats.late;
+    outStats->failed = stats.failed;
+}
+
 // Utility functions
 void cu_sleep_ms(int milliseconds) {
     microsleep((double)milliseconds);
@@ -76,20 +76,353 @@ typedef struct {
     uint8_t bytesPerPixel;
 } CUBitmap;
 
+// The bitmap owns the grab's own pixel buffer, so capturing makes no copy of
+// the frame beyond the one out of the platform's capture buffer (none for
+// plain XGetImage). Free both with cu_screen_free_capture.
 NUTDART_API CUBitmap* cu_screen_capture_region(int64_t x, int64_t y, int64_t width, int64_t height);
 NUTDART_API CUBitmap* cu_screen_capture_full(void);
 NUTDART_API void cu_screen_free_capture(CUBitmap* bitmap);
 
+// Resize filters for the JPEG functions
+#define CU_RESIZE_BILINEAR 0  // Fastest; aliases text when shrinking a lot
+#define CU_RESIZE_AREA 1      // Averages every covered pixel; best for downscaling
+#define CU_RESIZE_LANCZOS3 2  // Sharpest, and slowest
+
 // JPEG screenshot functions with resizing
 // maxSmallDim/maxLargeDim: -1 means no limit
 // quality: 0-100 (JPEG quality)
+// filter: one of CU_RESIZE_*; ignored on macOS, where ScreenCaptureKit scales.
+//   On Wayland without wlr-screencopy, grim scales with its own filter when
+//   CU_RESIZE_AREA (the default) is asked for; the others are honoured.
 // outSize: pointer to receive the size of the returned JPEG data
 NUTDART_API uint8_t* cu_screen_capture_region_jpeg(int64_t x, int64_t y, int64_t width, int64_t height, 
                                        int32_t maxSmallDim, int32_t maxLargeDim, 
-                                       int32_t quality, int64_t* outSize);
+                                       int32_t quality, int32_t filter, int64_t* outSize);
 NUTDART_API uint8_t* cu_screen_capture_full_jpeg(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                     int32_t quality, int64_t* outSize);
+                                     int32_t quality, int32_t filter, int64_t* outSize);
 NUTDART_API void cu_screen_free_jpeg(uint8_t* data);
+// Same as cu_screen_capture_*_jpeg, but at the highest quality whose JPEG
+// fits in maxBytes, written to outQuality. The frame is grabbed and resized
+// once and re-encoded at most twice, guided by the sizes of earlier frames.
+// Return NULL, with quality -1, if nothing fits even at quality 10, and
+// always on macOS. Free with cu_screen_free_jpeg.
+NUTDART_API uint8_t* cu_screen_capture_region_jpeg_budget(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                          int32_t maxSmallDim, int32_t maxLargeDim,
+                                                          int64_t maxBytes, int32_t filter,
+                                                          int32_t* outQuality, int64_t* outSize);
+NUTDART_API uint8_t* cu_screen_capture_full_jpeg_budget(int32_t maxSmallDim, int32_t maxLargeDim,
+                                                        int64_t maxBytes, int32_t filter,
+                                                        int32_t* outQuality, int64_t* outSize);
+
+// Lossless PNG screenshots, resized like the JPEG functions. Frames of at
+// most 256 colours become palette images, which keeps text sharp and small.
+// Free with cu_screen_free_png.
+NUTDART_API uint8_t* cu_screen_capture_region_png(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                  int32_t maxSmallDim, int32_t maxLargeDim,
+                                                  int32_t filter, int64_t* outSize);
+NUTDART_API uint8_t* cu_screen_capture_full_png(int32_t maxSmallDim, int32_t maxLargeDim,
+                                                int32_t filter, int64_t* outSize);
+NUTDART_API void cu_screen_free_png(uint8_t* data);
+
+// WebP screenshots, resized like the JPEG functions. Needs libwebp at build
+// time; without it cu_screen_webp_available returns 0 and captures return
+// NULL. For lossy output quality works as for JPEG; with lossless set it is
+// the compression effort (0 fastest, 100 smallest). Free with
+// cu_screen_free_webp.
+NUTDART_API int32_t cu_screen_webp_available(void);
+NUTDART_API uint8_t* cu_screen_capture_region_webp(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                   int32_t maxSmallDim, int32_t maxLargeDim,
+                                                   int32_t quality, int32_t lossless, int32_t filter,
+                                                   int64_t* outSize);
+NUTDART_API uint8_t* cu_screen_capture_full_webp(int32_t maxSmallDim, int32_t maxLargeDim,
+                                                 int32_t quality, int32_t lossless, int32_t filter,
+                                                 int64_t* outSize);
+NUTDART_API void cu_screen_free_webp(uint8_t* data);
+
+// Several encodings of one grab
+#define CU_FORMAT_JPEG 0
+#define CU_FORMAT_PNG 1
+#define CU_FORMAT_WEBP 2
+#define CU_FORMAT_WEBP_LOSSLESS 3
+// At most this many outputs per call; any more are left empty
+#define CU_MAX_CAPTURE_OUTPUTS 16
+
+typedef struct {
+    int32_t format;         // CU_FORMAT_*
+    int32_t maxSmallDim;    // -1 means no limit
+    int32_t maxLargeDim;
+    int32_t quality;        // JPEG/WebP quality; lossless WebP effort; unused for PNG
+    int32_t filter;         // CU_RESIZE_*
+    uint8_t* data;          // Out: the encoded image, NULL if this output failed
+    int64_t size;           // Out
+    int64_t width;          // Out: image size after resizing
+    int64_t height;
+} CUCaptureOutput;
+
+// Grabs the region once and encodes it once per output, so every output
+// shows the same moment. Each distinct size is resized once, from the
+// nearest larger one, and outputs are encoded in parallel. JPEG outputs are
+// empty on macOS. Returns the number of outputs encoded, or -1 if the grab
+// failed. Free the data with cu_screen_free_outputs.
+NUTDART_API int32_t cu_screen_capture_region_multi(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                   CUCaptureOutput* outputs, int32_t count);
+NUTDART_API int32_t cu_screen_capture_full_multi(CUCaptureOutput* outputs, int32_t count);
+NUTDART_API void cu_screen_free_outputs(CUCaptureOutput* outputs, int32_t count);
+
+// Base64 screenshots, ready to paste into a JSON request. Captures like the
+// function for `format` (CU_FORMAT_*; quality is unused for PNG), then
+// writes the base64 with SIMD, behind "data:image/...;base64," if dataUri
+// is set. Returns a NUL-terminated string and its length in outLength, or
+// NULL on failure. Free with cu_screen_free_base64. Except on macOS, JPEG
+// goes through one shared encoder, so the JPEG itself is never allocated;
+// like cu_jpeg_encoder_capture_region it skips the JPEG cache.
+NUTDART_API char* cu_screen_capture_region_base64(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                  int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                                                  int32_t quality, int32_t filter, int32_t dataUri,
+                                                  int64_t* outLength);
+NUTDART_API char* cu_screen_capture_full_base64(int32_t format, int32_t maxSmallDim, int32_t maxLargeDim,
+                                                int32_t quality, int32_t filter, int32_t dataUri,
+                                                int64_t* outLength);
+NUTDART_API void cu_screen_free_base64(char* data);
+// Writes the base64 of size bytes to out, which must hold 4 * ((size + 2) / 3)
+// characters (no NUL is added). Returns that length, or -1 on bad arguments.
+NUTDART_API int64_t cu_base64_encode(const uint8_t* data, int64_t size, char* out);
+
+// Monitors
+typedef struct {
+    int64_t x;
+    int64_t y;
+    int64_t width;
+    int64_t height;
+    int32_t primary;        // 1 for the primary monitor
+} CUMonitor;
+
+// Writes up to maxMonitors monitors, primary first, and returns the total
+// number of monitors (may exceed maxMonitors), or -1 on error
+NUTDART_API int32_t cu_screen_get_monitors(CUMonitor* outMonitors, int32_t maxMonitors);
+// Captures one monitor by index (as ordered by cu_screen_get_monitors)
+NUTDART_API CUBitmap* cu_screen_capture_monitor(int32_t index);
+NUTDART_API uint8_t* cu_screen_capture_monitor_jpeg(int32_t index,
+                                         int32_t maxSmallDim, int32_t maxLargeDim,
+                                         int32_t quality, int32_t filter, int64_t* outSize);
+
+typedef struct {
+    CUMonitor monitor;
+    uint8_t* jpeg;          // Free with cu_screen_free_jpeg; NULL if encoding failed
+    int64_t size;
+} CUMonitorJpeg;
+
+// Captures every monitor as its own JPEG, encoding them in parallel.
+// Returns the number of results written, or -1 on failure.
+NUTDART_API int32_t cu_screen_capture_all_monitors_jpeg(CUMonitorJpeg* outResults, int32_t maxResults,
+                                                        int32_t maxSmallDim, int32_t maxLargeDim,
+                                                        int32_t quality, int32_t filter);
+
+// JPEG capture cache (Linux)
+// Repeated JPEG captures with the same region, maxSmallDim, maxLargeDim,
+// quality and filter return the previous bytes while the screen is unchanged (checked
+// with damage tracking when running, a frame hash otherwise). On by default.
+NUTDART_API void cu_screen_jpeg_cache_set_enabled(int32_t enabled);
+// Drops cached JPEGs and resets the counters
+NUTDART_API void cu_screen_jpeg_cache_clear(void);
+NUTDART_API void cu_screen_jpeg_cache_get_stats(int64_t* hits, int64_t* misses);
+
+// JPEG encoding threads (Linux)
+// Threads that resize and encode one JPEG. 1 (the default) keeps the work on
+// the calling thread; 0 uses one per CPU core. With more, large images are
+// encoded as strips joined with restart markers.
+NUTDART_API void cu_screen_jpeg_set_threads(int32_t threads);
+NUTDART_API int32_t cu_screen_jpeg_get_threads(void);
+
+// Reusable JPEG encoders
+// An encoder keeps its capture buffer, libjpeg compressor, tables, resize
+// buffers and output buffer between captures, so repeated screenshots of
+// the same size make no large allocations (Linux; Windows keeps only the
+// capture and output buffers). It bypasses the JPEG capture cache. Use from
+// one thread at a time.
+typedef struct CUJpegEncoder CUJpegEncoder;
+
+// Returns NULL on failure
+NUTDART_API CUJpegEncoder* cu_jpeg_encoder_create(void);
+NUTDART_API void cu_jpeg_encoder_destroy(CUJpegEncoder* encoder);
+// Captures and encodes like cu_screen_capture_region_jpeg (width or height
+// <= 0 captures the whole screen). The bytes belong to the encoder and stay
+// valid until its next capture or destruction; don't free them.
+NUTDART_API const uint8_t* cu_jpeg_encoder_capture_region(CUJpegEncoder* encoder,
+                                                          int64_t x, int64_t y,
+                                                          int64_t width, int64_t height,
+                                                          int32_t maxSmallDim, int32_t maxLargeDim,
+                                                          int32_t quality, int32_t filter,
+                                                          int64_t* outSize);
+// Same, but libjpeg writes straight into the caller's buffer (Linux; other
+// platforms copy into it). Returns the JPEG's size, or -1 on failure. A size
+// above capacity means the buffer was too small; the encoder then holds the
+// JPEG, and cu_jpeg_encoder_copy_last fetches it without capturing again.
+NUTDART_API int64_t cu_jpeg_encoder_capture_region_into(CUJpegEncoder* encoder,
+                                                        int64_t x, int64_t y,
+                                                        int64_t width, int64_t height,
+                                                        int32_t maxSmallDim, int32_t maxLargeDim,
+                                                        int32_t quality, int32_t filter,
+                                                        uint8_t* buffer, int64_t capacity);
+// Copies the last JPEG the encoder holds (see above) into buffer. Returns its
+// size, copying nothing if above capacity, or -1 if the encoder holds none.
+NUTDART_API int64_t cu_jpeg_encoder_copy_last(CUJpegEncoder* encoder, uint8_t* buffer, int64_t capacity);
+// Captures like cu_screen_capture_region_jpeg_budget, learning from this
+// encoder's earlier frames only. The bytes belong to the encoder, as with
+// cu_jpeg_encoder_capture_region. Returns NULL on macOS.
+NUTDART_API const uint8_t* cu_jpeg_encoder_capture_region_budget(CUJpegEncoder* encoder,
+                                                                 int64_t x, int64_t y,
+                                                                 int64_t width, int64_t height,
+                                                                 int32_t maxSmallDim, int32_t maxLargeDim,
+                                                                 int64_t maxBytes, int32_t filter,
+                                                                 int32_t* outQuality, int64_t* outSize);
+
+// Capture plans (all platforms)
+// A plan works out the output size, the resize weight tables and the mapping
+// between screen and image coordinates once for a region, so repeated
+// captures of it only grab, resize and encode, reusing their buffers. The
+// output size comes from the region's size in screen coordinates and never
+// changes. Use from one thread at a time.
+typedef struct CUCapturePlan CUCapturePlan;
+
+// Maps screen coordinates to image coordinates, pixel centre to pixel centre:
+// imageX = (screenX - originX + 0.5) * scaleX - 0.5, and likewise for y.
+typedef struct {
+    double scaleX;          // Image pixels per screen pixel
+    double scaleY;
+    double originX;         // Screen position of the region's top-left corner
+    double originY;
+} CUCoordinateTransform;
+
+// Width or height <= 0 plans for the whole screen. Returns NULL on failure
+NUTDART_API CUCapturePlan* cu_capture_plan_create(int64_t x, int64_t y, int64_t width, int64_t height,
+                                                  int32_t maxSmallDim, int32_t maxLargeDim,
+                                                  int32_t filter);
+NUTDART_API void cu_capture_plan_destroy(CUCapturePlan* plan);
+// The size of every image the plan produces
+NUTDART_API CUSize cu_capture_plan_get_image_size(CUCapturePlan* plan);
+NUTDART_API CUCoordinateTransform cu_capture_plan_get_transform(CUCapturePlan* plan);
+// Maps a point between the plan's images and the screen, rounding to the
+// nearest pixel
+NUTDART_API CUPoint cu_capture_plan_to_screen(CUCapturePlan* plan, double imageX, double imageY);
+NUTDART_API CUPoint cu_capture_plan_to_image(CUCapturePlan* plan, double screenX, double screenY);
+// Captures and encodes a frame as format (CU_FORMAT_*) at quality, which PNG
+// ignores. The bytes belong to the plan and stay valid until its next
+// capture or destruction; don't free them. JPEG returns NULL on macOS.
+NUTDART_API const uint8_t* cu_capture_plan_capture(CUCapturePlan* plan, int32_t format,
+                                                   int32_t quality, int64_t* outSize);
+
+// Screen rectangle (damage/dirty regions)
+typedef struct {
+    int64_t x;
+    int64_t y;
+    int64_t width;
+    int64_t height;
+} CURect;
+
+// Damage tracking (X11 with the XDamage extension; unavailable elsewhere)
+// A background thread counts screen updates as frames. Callers remember the
+// sequence number of their last capture and ask what changed since then.
+// cu_screen_damage_start: returns 1 if tracking is active, 0 if unavailable
+NUTDART_API int32_t cu_screen_damage_start(void);
+NUTDART_API void cu_screen_damage_stop(void);
+// Returns the current frame sequence number, or -1 if not tracking
+NUTDART_API int64_t cu_screen_get_frame_sequence(void);
+// Writes the regions changed after sinceSequence, merged into at most
+// maxRects rectangles, and returns how many were written (0 = unchanged).
+// If sinceSequence is too old the whole screen is reported. With maxRects 0
+// nothing is written and 1 means "something changed".
+// outSequence (optional) receives the sequence the result is current to.
+// Returns -1 if not tracking.
+NUTDART_API int32_t cu_screen_get_dirty_rects(int64_t sinceSequence, CURect* outRects,
+                                              int32_t maxRects, int64_t* outSequence);
+
+// Frame differ (all platforms)
+// Splits each capture into tiles, hashes them and compares the hashes with
+// the previous capture given to the same differ. Use one differ per consumer;
+// a differ is not thread-safe.
+typedef struct CUFrameDiffer CUFrameDiffer;
+
+// tileSize: tile edge in pixels, 0 for the default (32). Returns NULL on failure
+NUTDART_API CUFrameDiffer* cu_frame_differ_create(int32_t tileSize);
+NUTDART_API void cu_frame_differ_destroy(CUFrameDiffer* differ);
+// Forgets the previous frame; the next comparison reports everything changed
+NUTDART_API void cu_frame_differ_reset(CUFrameDiffer* differ);
+// Compares bitmap with the previous frame and remembers it. Changed tiles are
+// merged into at most maxRects rectangles (bitmap coordinates); returns how
+// many were written (0 = unchanged). The first frame, or one of a different
+// size, is reported whole. With maxRects 0 nothing is written and 1 means
+// "something changed". outChangedPixels (optional) receives the changed area.
+// Returns -1 on failure.
+NUTDART_API int32_t cu_frame_differ_compare(CUFrameDiffer* differ, const CUBitmap* bitmap,
+                                            CURect* outRects, int32_t maxRects,
+                                            int64_t* outChangedPixels);
+// Captures a region (or the full screen) and compares it as above.
+// Rectangles are relative to the captured area. Returns -1 if capture fails.
+NUTDART_API int32_t cu_frame_differ_capture_region(CUFrameDiffer* differ,
+                                                   int64_t x, int64_t y, int64_t width, int64_t height,
+                                                   CURect* outRects, int32_t maxRects,
+                                                   int64_t* outChangedPixels);
+NUTDART_API int32_t cu_frame_differ_capture_full(CUFrameDiffer* differ,
+                                                 CURect* outRects, int32_t maxRects,
+                                                 int64_t* outChangedPixels);
+
+// Waits until nothing in the region has changed for quietMs, or timeoutMs
+// passes. Uses damage tracking when it is running, otherwise repeated
+// captures compared tile by tile. width or height <= 0 means the full screen.
+// Returns 1 once stable, 0 on timeout, -1 if the region can't be captured.
+// outElapsedMs (optional) receives the time spent waiting.
+NUTDART_API int32_t cu_screen_wait_stable(int64_t x, int64_t y, int64_t width, int64_t height,
+                                          int64_t quietMs, int64_t timeoutMs,
+                                          int64_t* outElapsedMs);
+
+// Continuous capture sessions
+// A native thread grabs a region at a fixed interval into a ring of reused
+// frames. Frames are borrowed without copying and must be released.
+typedef struct {
+    int64_t x;              // Region; width or height <= 0 means full screen
+    int64_t y;
+    int64_t width;
+    int64_t height;
+    int32_t intervalMs;     // Time between grabs; 0 captures back to back
+    int32_t ringSize;       // Frames in the ring (at least 2)
+    int32_t encodeJpeg;     // 1 to also encode every frame as JPEG
+    int32_t maxSmallDim;    // JPEG resizing, -1 means no limit
+    int32_t maxLargeDim;
+    int32_t quality;
+    int32_t filter;         // CU_RESIZE_*
+} CUCaptureSessionConfig;
+
+typedef struct {
+    int64_t sequence;       // 1 for the first frame, increasing by one
+    int64_t timestampUs;    // Monotonic clock when the grab started
+    CUBitmap bitmap;        // Raw pixels, owned by the session
+    uint8_t* jpeg;          // NULL unless encodeJpeg was set
+    int64_t jpegSize;
+} CUCaptureFrame;
+
+typedef struct {
+    int64_t captured;       // Frames published
+    int64_t dropped;        // Frames overwritten before anyone took them
+    int64_t late;           // Ticks skipped because a grab overran the interval
+    int64_t failed;         // Grabs or encodes that failed
+} CUCaptureSessionStats;
+
+typedef struct CUCaptureSession CUCaptureSession;
+
+// Returns NULL if the session can't be started, and for sessions with
+// encodeJpeg set on macOS, which encodes JPEG through ScreenCaptureKit
+NUTDART_API CUCaptureSession* cu_capture_session_start(const CUCaptureSessionConfig* config);
+// Stops capturing. Frames not yet released stay valid until released.
+NUTDART_API void cu_capture_session_stop(CUCaptureSession* session);
+// Borrows the newest frame; NULL if nothing has been captured yet
+NUTDART_API CUCaptureFrame* cu_capture_session_latest(CUCaptureSession* session);
+// Borrows the first frame newer than afterSequence, waiting up to timeoutMs.
+// Returns NULL on timeout or once the session is stopped.
+NUTDART_API CUCaptureFrame* cu_capture_session_next(CUCaptureSession* session,
+                                                    int64_t afterSequence, int32_t timeoutMs);
+NUTDART_API void cu_capture_session_release_frame(CUCaptureSession* session, CUCaptureFrame* frame);
+NUTDART_API void cu_capture_session_get_stats(CUCaptureSession* session, CUCaptureSessionStats* outStats);
 
 // Utility functions
 NUTDART_API void cu_sleep_ms(int milliseconds);
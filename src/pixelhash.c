@@ -0,0 +1,87 @@
+#include "pixelhash.h"
+#include <string.h>
+
+#define LANES 8
+#define PRIME32_A 0x9E3779B1U
+#define PRIME32_B 0x85EBCA77U
+#define PRIME64_A 0x9E3779B97F4A7C15ULL
+#define PRIME64_B 0xC2B2AE3D27D4EB4FULL
+
+void pixelHashInit(PixelHashState *state, uint64_t seed)
+{
+	for (int lane = 0; lane < LANES; lane++) {
+		state->acc[lane] = (uint32_t)(seed >> (lane & 1 ? 32 : 0)) + PRIME32_B * (uint32_t)(lane + 1);
+	}
+	state->seed = seed;
+	state->tail = PRIME64_B;
+	state->length = 0;
+}
+
+void pixelHashUpdate(PixelHashState *state, const uint8_t *data, size_t length)
+{
+	uint32_t *acc = state->acc;
+	size_t i = 0;
+
+	/* 32 bytes per step, one word per lane. Each lane is a bijection of its
+	 * previous state for a fixed input, so no change is ever cancelled out
+	 * within a lane. */
+	for (; i + sizeof(uint32_t) * LANES <= length; i += sizeof(uint32_t) * LANES) {
+		uint32_t words[LANES];
+		memcpy(words, data + i, sizeof(words));
+		for (int lane = 0; lane < LANES; lane++) {
+			uint32_t v = (acc[lane] ^ words[lane]) * PRIME32_A;
+			acc[lane] = v ^ (v >> 15);
+		}
+	}
+	for (; i < length; i++) {
+		state->tail = (state->tail ^ data[i]) * PRIME64_A;
+	}
+	state->length += length;
+}
+
+uint64_t pixelHashFinal(const PixelHashState *state)
+{
+	uint64_t hash = state->seed ^ (state->length * PRIME64_A);
+	for (int lane = 0; lane < LANES; lane++) {
+		hash = (hash ^ state->acc[lane]) * PRIME64_B;
+		hash ^= hash >> 29;
+	}
+	hash = (hash ^ state->tail) * PRIME64_A;
+
+	hash ^= hash >> 32;
+	hash *= PRIME64_B;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+uint64_t hashPixelBytes(const uint8_t *data, size_t length, uint64_t seed)
+{
+	PixelHashState state;
+	pixelHashInit(&state, seed);
+	pixelHashUpdate(&state, data, length);
+	return pixelHashFinal(&state);
+}
+
+uint64_t hashMMBitmapRect(MMBitmapRef bitmap, MMRect rect)
+{
+	assert(bitmap != NULL && bitmap->imageBuffer != NULL);
+	assert(MMBitmapRectInBounds(bitmap, rect));
+
+	const size_t rowBytes = (size_t)rect.size.width * bitmap->bytesPerPixel;
+	const uint8_t *row = bitmap->imageBuffer +
+	                     (size_t)rect.origin.y * bitmap->bytewidth +
+	                     (size_t)rect.origin.x * bitmap->bytesPerPixel;
+
+	/* Fully packed bitmaps hash in one go. */
+	if (rect.origin.x == 0 && rowBytes == bitmap->bytewidth) {
+		return hashPixelBytes(row, rowBytes * (size_t)rect.size.height, PRIME64_A);
+	}
+
+	PixelHashState state;
+	pixelHashInit(&state, (uint64_t)rect.size.height * PRIME64_B);
+	for (int64_t y = 0; y < rect.size.height; y++) {
+		pixelHashUpdate(&state, row, rowBytes);
+		row += bitmap->bytewidth;
+	}
+	return pixelHashFinal(&state);
+}
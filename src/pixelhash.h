@@ -0,0 +1,47 @@
+#pragma once
+#ifndef PIXELHASH_H
+#define PIXELHASH_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Fast non-cryptographic hashing of pixel data, for telling whether a frame
+ * (or part of one) changed. Not suitable for anything adversarial. */
+
+/* Incremental form of hashPixelBytes(), for hashing data that isn't
+ * contiguous, such as the rows of a tile. Small enough to keep one per tile
+ * on the stack or in an array. */
+typedef struct _PixelHashState {
+	uint32_t acc[8];
+	uint64_t seed;
+	uint64_t tail;   /* Bytes that didn't fill a whole block. */
+	uint64_t length;
+} PixelHashState;
+
+void pixelHashInit(PixelHashState *state, uint64_t seed);
+void pixelHashUpdate(PixelHashState *state, const uint8_t *data, size_t length);
+uint64_t pixelHashFinal(const PixelHashState *state);
+
+/* Hashes `length` bytes. The bulk loop runs eight independent 32-bit lanes
+ * so compilers can vectorize it. */
+uint64_t hashPixelBytes(const uint8_t *data, size_t length, uint64_t seed);
+
+/* Hashes the pixels of `rect` within `bitmap`, ignoring row padding. `rect`
+ * must lie within the bitmap. */
+uint64_t hashMMBitmapRect(MMBitmapRef bitmap, MMRect rect);
+
+/* Hashes every pixel of `bitmap`. */
+#define hashMMBitmap(bitmap) hashMMBitmapRect((bitmap), MMBitmapGetBounds((bitmap)))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIXELHASH_H */
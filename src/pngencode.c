@@ -0,0 +1,924 @@
+#include "pngencode.h"
+#include "resample.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Output buffer. Space is reserved ahead of each step, so the writers below
+ * never check it. */
+typedef struct {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+} PngBuffer;
+
+static bool reservePngBuffer(PngBuffer *out, size_t extra)
+{
+	if (out->capacity - out->size >= extra) return true;
+	size_t capacity = out->capacity > 0 ? out->capacity : 64 * 1024;
+	while (capacity - out->size < extra) capacity *= 2;
+	uint8_t *grown = realloc(out->data, capacity);
+	if (grown == NULL) return false;
+	out->data = grown;
+	out->capacity = capacity;
+	return true;
+}
+
+static void putPngU32(PngBuffer *out, uint32_t value)
+{
+	out->data[out->size++] = (uint8_t)(value >> 24);
+	out->data[out->size++] = (uint8_t)(value >> 16);
+	out->data[out->size++] = (uint8_t)(value >> 8);
+	out->data[out->size++] = (uint8_t)value;
+}
+
+/* CRC-32 a nibble at a time: a 64-byte table, and fast enough for the few
+ * bytes per pixel a compressed frame has. */
+static const uint32_t crcNibbles[16] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t updateCrc(uint32_t crc, const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ crcNibbles[crc & 15];
+		crc = (crc >> 4) ^ crcNibbles[crc & 15];
+	}
+	return crc;
+}
+
+static uint32_t computeAdler32(const uint8_t *data, size_t length)
+{
+	uint32_t a = 1, b = 0;
+	while (length > 0) {
+		/* The most bytes before the sums can overflow */
+		const size_t block = length < 5552 ? length : 5552;
+		for (size_t i = 0; i < block; i++) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += block;
+		length -= block;
+	}
+	return (b << 16) | a;
+}
+
+/* Appends a chunk whose `length` bytes of data were already written after
+ * its length and type, which start at `start`. */
+static void finishPngChunk(PngBuffer *out, size_t start)
+{
+	const size_t length = out->size - start - 8;
+	out->data[start] = (uint8_t)(length >> 24);
+	out->data[start + 1] = (uint8_t)(length >> 16);
+	out->data[start + 2] = (uint8_t)(length >> 8);
+	out->data[start + 3] = (uint8_t)length;
+	const uint32_t crc = updateCrc(0xFFFFFFFF, out->data + start + 4, length + 4);
+	putPngU32(out, crc ^ 0xFFFFFFFF);
+}
+
+static bool putPngChunk(PngBuffer *out, const char *type, const uint8_t *data, size_t length)
+{
+	if (!reservePngBuffer(out, length + 12)) return false;
+	const size_t start = out->size;
+	out->size += 4;
+	memcpy(out->data + out->size, type, 4);
+	out->size += 4;
+	if (length > 0) memcpy(out->data + out->size, data, length);
+	out->size += length;
+	finishPngChunk(out, start);
+	return true;
+}
+
+/* Deflate (RFC 1951) ---------------------------------------------------- */
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MIN_MATCH 4     /* What a hash slot covers; deflate allows 3 */
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_BLOCK_SYMBOLS 65535
+#define DEFLATE_MAX_BITS 15
+#define DEFLATE_LITERALS 286
+#define DEFLATE_DISTANCES 30
+#define DEFLATE_CODE_LENGTHS 19
+#define DEFLATE_END_OF_BLOCK 256
+
+/* A literal byte (distance 0) or a back-reference. */
+typedef struct {
+	uint16_t length;
+	uint16_t distance;
+} DeflateSymbol;
+
+typedef struct {
+	PngBuffer *out;
+	uint64_t bits;
+	unsigned count;
+} BitWriter;
+
+static void putBits(BitWriter *writer, uint32_t value, unsigned length)
+{
+	writer->bits |= (uint64_t)value << writer->count;
+	writer->count += length;
+	if (writer->count >= 32) {
+		PngBuffer *out = writer->out;
+		out->data[out->size++] = (uint8_t)writer->bits;
+		out->data[out->size++] = (uint8_t)(writer->bits >> 8);
+		out->data[out->size++] = (uint8_t)(writer->bits >> 16);
+		out->data[out->size++] = (uint8_t)(writer->bits >> 24);
+		writer->bits >>= 32;
+		writer->count -= 32;
+	}
+}
+
+/* Pads to a byte boundary and writes out every pending bit. */
+static void flushBits(BitWriter *writer)
+{
+	PngBuffer *out = writer->out;
+	while (writer->count > 0) {
+		out->data[out->size++] = (uint8_t)writer->bits;
+		writer->bits >>= 8;
+		writer->count = writer->count > 8 ? writer->count - 8 : 0;
+	}
+	writer->bits = 0;
+}
+
+static unsigned highestBit(uint32_t value)
+{
+#if defined(__GNUC__)
+	return 31u - (unsigned)__builtin_clz(value);
+#else
+	unsigned bit = 0;
+	while (value >>= 1) bit++;
+	return bit;
+#endif
+}
+
+/* Length 3..258 to its symbol (257..285) and extra bits. */
+static unsigned lengthSymbol(unsigned length, unsigned *extraBits, unsigned *extra)
+{
+	if (length == DEFLATE_MAX_MATCH) {
+		*extraBits = 0;
+		*extra = 0;
+		return 285;
+	}
+	const unsigned value = length - 3;
+	if (value < 8) {
+		*extraBits = 0;
+		*extra = 0;
+		return 257 + value;
+	}
+	const unsigned bits = highestBit(value) - 2;
+	*extraBits = bits;
+	*extra = value & ((1u << bits) - 1);
+	return 261 + 4 * bits + ((value >> bits) & 3);
+}
+
+/* Distance 1..32768 to its symbol (0..29) and extra bits. */
+static unsigned distanceSymbol(unsigned distance, unsigned *extraBits, unsigned *extra)
+{
+	const unsigned value = distance - 1;
+	if (value < 4) {
+		*extraBits = 0;
+		*extra = 0;
+		return value;
+	}
+	const unsigned top = highestBit(value);
+	*extraBits = top - 1;
+	*extra = value & ((1u << (top - 1)) - 1);
+	return 2 * top + ((value >> (top - 1)) & 1);
+}
+
+static const unsigned lengthExtraBits[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const unsigned distanceExtraBits[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const uint8_t codeLengthOrder[DEFLATE_CODE_LENGTHS] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+typedef struct {
+	uint32_t key;      /* Frequency, then code length */
+	uint16_t symbol;
+} HuffmanEntry;
+
+static int compareHuffmanEntries(const void *a, const void *b)
+{
+	const HuffmanEntry *x = a, *y = b;
+	if (x->key != y->key) return x->key < y->key ? -1 : 1;
+	return (int)x->symbol - (int)y->symbol;
+}
+
+/* Moffat and Katajainen's in-place code length calculation. `entries` is
+ * sorted by ascending frequency; on return each key is a code length. */
+static void computeHuffmanDepths(HuffmanEntry *entries, int count)
+{
+	int root = 0, leaf = 2, next;
+	entries[0].key += entries[1].key;
+	for (next = 1; next < count - 1; next++) {
+		if (leaf >= count || entries[root].key < entries[leaf].key) {
+			entries[next].key = entries[root].key;
+			entries[root++].key = (uint32_t)next;
+		} else {
+			entries[next].key = entries[leaf++].key;
+		}
+		if (leaf >= count || (root < next && entries[root].key < entries[leaf].key)) {
+			entries[next].key += entries[root].key;
+			entries[root++].key = (uint32_t)next;
+		} else {
+			entries[next].key += entries[leaf++].key;
+		}
+	}
+
+	entries[count - 2].key = 0;
+	for (next = count - 3; next >= 0; next--) {
+		entries[next].key = entries[entries[next].key].key + 1;
+	}
+
+	int available = 1, used = 0;
+	uint32_t depth = 0;
+	root = count - 2;
+	next = count - 1;
+	while (available > 0) {
+		while (root >= 0 && entries[root].key == depth) {
+			used++;
+			root--;
+		}
+		while (available > used) {
+			entries[next--].key = depth;
+			available--;
+		}
+		available = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+/* Code lengths of at most `maxBits` for `count` symbols with frequencies
+ * `freq`. A lone used symbol gets a partner, so every code is complete. */
+static void buildHuffmanLengths(const uint32_t *freq, int count, unsigned maxBits, uint8_t *lengths)
+{
+	HuffmanEntry entries[DEFLATE_LITERALS];
+	int used = 0;
+	memset(lengths, 0, (size_t)count);
+	for (int i = 0; i < count; i++) {
+		if (freq[i] > 0) {
+			entries[used].key = freq[i];
+			entries[used].symbol = (uint16_t)i;
+			used++;
+		}
+	}
+	if (used < 2) {
+		const int symbol = used == 1 ? entries[0].symbol : 0;
+		lengths[symbol] = 1;
+		lengths[symbol == 0 ? 1 : 0] = 1;
+		return;
+	}
+
+	qsort(entries, (size_t)used, sizeof(HuffmanEntry), compareHuffmanEntries);
+	computeHuffmanDepths(entries, used);
+
+	/* Limit the depth by moving codes down until the Kraft sum is exact
+	 * again (the same correction zlib and miniz make). */
+	unsigned lengthCounts[33] = {0};
+	for (int i = 0; i < used; i++) {
+		lengthCounts[entries[i].key < 32 ? entries[i].key : 32]++;
+	}
+	for (unsigned bits = maxBits + 1; bits <= 32; bits++) {
+		lengthCounts[maxBits] += lengthCounts[bits];
+		lengthCounts[bits] = 0;
+	}
+	uint32_t total = 0;
+	for (unsigned bits = maxBits; bits > 0; bits--) {
+		total += lengthCounts[bits] << (maxBits - bits);
+	}
+	while (total != (1u << maxBits)) {
+		lengthCounts[maxBits]--;
+		for (unsigned bits = maxBits - 1; bits > 0; bits--) {
+			if (lengthCounts[bits] > 0) {
+				lengthCounts[bits]--;
+				lengthCounts[bits + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
+
+	/* The most frequent symbols (at the end) get the shortest codes */
+	int index = used;
+	for (unsigned bits = 1; bits <= maxBits; bits++) {
+		for (unsigned n = lengthCounts[bits]; n > 0; n--) {
+			lengths[entries[--index].symbol] = (uint8_t)bits;
+		}
+	}
+}
+
+/* Canonical codes for `lengths`, bit-reversed for writing LSB first. */
+static void buildHuffmanCodes(const uint8_t *lengths, int count, uint16_t *codes)
+{
+	unsigned lengthCounts[DEFLATE_MAX_BITS + 1] = {0};
+	unsigned nextCode[DEFLATE_MAX_BITS + 1];
+	for (int i = 0; i < count; i++) lengthCounts[lengths[i]]++;
+	lengthCounts[0] = 0;
+	unsigned code = 0;
+	for (unsigned bits = 1; bits <= DEFLATE_MAX_BITS; bits++) {
+		code = (code + lengthCounts[bits - 1]) << 1;
+		nextCode[bits] = code;
+	}
+	for (int i = 0; i < count; i++) {
+		const unsigned bits = lengths[i];
+		if (bits == 0) continue;
+		unsigned forward = nextCode[bits]++, reversed = 0;
+		for (unsigned b = 0; b < bits; b++) {
+			reversed = (reversed << 1) | (forward & 1);
+			forward >>= 1;
+		}
+		codes[i] = (uint16_t)reversed;
+	}
+}
+
+typedef struct {
+	uint32_t *head;            /* 1 + latest position per hash, 0 for none */
+	DeflateSymbol *symbols;
+	size_t symbolCount;
+	uint32_t literalFreq[DEFLATE_LITERALS];
+	uint32_t distanceFreq[DEFLATE_DISTANCES];
+} Deflater;
+
+/* The code length sequence of the two trees, run-length coded: symbols
+ * 16-18 repeat, with their extra bits in the high byte. */
+static size_t encodeCodeLengths(const uint8_t *lengths, size_t count, uint16_t *runs,
+                                uint32_t *freq)
+{
+	size_t out = 0;
+	for (size_t i = 0; i < count;) {
+		const uint8_t length = lengths[i];
+		size_t run = 1;
+		while (i + run < count && lengths[i + run] == length) run++;
+		i += run;
+
+		if (length == 0) {
+			while (run >= 11) {
+				const size_t n = run < 138 ? run : 138;
+				runs[out++] = (uint16_t)(18 | ((n - 11) << 8));
+				freq[18]++;
+				run -= n;
+			}
+			if (run >= 3) {
+				runs[out++] = (uint16_t)(17 | ((run - 3) << 8));
+				freq[17]++;
+				run = 0;
+			}
+		} else {
+			runs[out++] = length;
+			freq[length]++;
+			run--;
+			while (run >= 3) {
+				const size_t n = run < 6 ? run : 6;
+				runs[out++] = (uint16_t)(16 | ((n - 3) << 8));
+				freq[16]++;
+				run -= n;
+			}
+		}
+		while (run > 0) {
+			runs[out++] = length;
+			freq[length]++;
+			run--;
+		}
+	}
+	return out;
+}
+
+static bool writeStoredBlocks(BitWriter *writer, const uint8_t *data, size_t size, bool last)
+{
+	if (!reservePngBuffer(writer->out, size + 12 * (size / 65535 + 1) + 16)) return false;
+	do {
+		const size_t length = size < 65535 ? size : 65535;
+		putBits(writer, last && length == size, 1);
+		putBits(writer, 0, 2);
+		flushBits(writer);
+		PngBuffer *out = writer->out;
+		out->data[out->size++] = (uint8_t)length;
+		out->data[out->size++] = (uint8_t)(length >> 8);
+		out->data[out->size++] = (uint8_t)~length;
+		out->data[out->size++] = (uint8_t)(~length >> 8);
+		memcpy(out->data + out->size, data, length);
+		out->size += length;
+		data += length;
+		size -= length;
+	} while (size > 0);
+	return true;
+}
+
+/* Writes the pending symbols, which encode `data`, as one dynamic Huffman
+ * block, or as stored blocks if that is smaller. */
+static bool writeDeflateBlock(Deflater *deflater, BitWriter *writer,
+                              const uint8_t *data, size_t size, bool last)
+{
+	uint8_t lengths[DEFLATE_LITERALS + DEFLATE_DISTANCES];
+	uint8_t *literalLengths = lengths;
+	uint8_t distanceLengths[DEFLATE_DISTANCES];
+	deflater->literalFreq[DEFLATE_END_OF_BLOCK]++;
+	buildHuffmanLengths(deflater->literalFreq, DEFLATE_LITERALS, DEFLATE_MAX_BITS, literalLengths);
+	buildHuffmanLengths(deflater->distanceFreq, DEFLATE_DISTANCES, DEFLATE_MAX_BITS, distanceLengths);
+
+	unsigned literalCount = DEFLATE_LITERALS;
+	while (literalCount > 257 && literalLengths[literalCount - 1] == 0) literalCount--;
+	unsigned distanceCount = DEFLATE_DISTANCES;
+	while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) distanceCount--;
+	memmove(lengths + literalCount, distanceLengths, distanceCount);
+
+	uint16_t runs[DEFLATE_LITERALS + DEFLATE_DISTANCES];
+	uint32_t codeLengthFreq[DEFLATE_CODE_LENGTHS] = {0};
+	const size_t runCount = encodeCodeLengths(lengths, literalCount + distanceCount, runs,
+	                                          codeLengthFreq);
+	uint8_t codeLengthLengths[DEFLATE_CODE_LENGTHS];
+	buildHuffmanLengths(codeLengthFreq, DEFLATE_CODE_LENGTHS, 7, codeLengthLengths);
+	unsigned codeLengthCount = DEFLATE_CODE_LENGTHS;
+	while (codeLengthCount > 4 && codeLengthLengths[codeLengthOrder[codeLengthCount - 1]] == 0) {
+		codeLengthCount--;
+	}
+
+	/* Size of the block in bits, to compare with storing it */
+	uint64_t bits = 3 + 5 + 5 + 4 + 3 * codeLengthCount;
+	for (int i = 0; i < DEFLATE_CODE_LENGTHS; i++) {
+		bits += (uint64_t)codeLengthFreq[i] * codeLengthLengths[i];
+	}
+	bits += 2ull * codeLengthFreq[16] + 3ull * codeLengthFreq[17] + 7ull * codeLengthFreq[18];
+	for (unsigned i = 0; i < literalCount; i++) {
+		const unsigned extra = i > 256 ? lengthExtraBits[i - 257] : 0;
+		bits += (uint64_t)deflater->literalFreq[i] * (literalLengths[i] + extra);
+	}
+	for (unsigned i = 0; i < distanceCount; i++) {
+		bits += (uint64_t)deflater->distanceFreq[i] * (distanceLengths[i] + distanceExtraBits[i]);
+	}
+
+	bool ok;
+	if (bits / 8 > size + 5 * (size / 65535 + 1)) {
+		ok = writeStoredBlocks(writer, data, size, last);
+	} else if ((ok = reservePngBuffer(writer->out, (size_t)(bits / 8) + 16))) {
+		uint16_t literalCodes[DEFLATE_LITERALS];
+		uint16_t distanceCodes[DEFLATE_DISTANCES];
+		uint16_t codeLengthCodes[DEFLATE_CODE_LENGTHS];
+		buildHuffmanCodes(literalLengths, (int)literalCount, literalCodes);
+		buildHuffmanCodes(lengths + literalCount, (int)distanceCount, distanceCodes);
+		buildHuffmanCodes(codeLengthLengths, DEFLATE_CODE_LENGTHS, codeLengthCodes);
+		const uint8_t *distanceLengthsUsed = lengths + literalCount;
+
+		putBits(writer, last, 1);
+		putBits(writer, 2, 2);
+		putBits(writer, literalCount - 257, 5);
+		putBits(writer, distanceCount - 1, 5);
+		putBits(writer, codeLengthCount - 4, 4);
+		for (unsigned i = 0; i < codeLengthCount; i++) {
+			putBits(writer, codeLengthLengths[codeLengthOrder[i]], 3);
+		}
+		for (size_t i = 0; i < runCount; i++) {
+			const unsigned symbol = runs[i] & 0xFF, extra = runs[i] >> 8;
+			putBits(writer, codeLengthCodes[symbol], codeLengthLengths[symbol]);
+			if (symbol == 16) putBits(writer, extra, 2);
+			else if (symbol == 17) putBits(writer, extra, 3);
+			else if (symbol == 18) putBits(writer, extra, 7);
+		}
+
+		for (size_t i = 0; i < deflater->symbolCount; i++) {
+			const DeflateSymbol symbol = deflater->symbols[i];
+			if (symbol.distance == 0) {
+				putBits(writer, literalCodes[symbol.length], literalLengths[symbol.length]);
+				continue;
+			}
+			unsigned extraBits, extra;
+			const unsigned lengthCode = lengthSymbol(symbol.length, &extraBits, &extra);
+			putBits(writer, literalCodes[lengthCode], literalLengths[lengthCode]);
+			if (extraBits > 0) putBits(writer, extra, extraBits);
+			const unsigned distanceCode = distanceSymbol(symbol.distance, &extraBits, &extra);
+			putBits(writer, distanceCodes[distanceCode], distanceLengthsUsed[distanceCode]);
+			if (extraBits > 0) putBits(writer, extra, extraBits);
+		}
+		putBits(writer, literalCodes[DEFLATE_END_OF_BLOCK], literalLengths[DEFLATE_END_OF_BLOCK]);
+	}
+
+	deflater->symbolCount = 0;
+	memset(deflater->literalFreq, 0, sizeof(deflater->literalFreq));
+	memset(deflater->distanceFreq, 0, sizeof(deflater->distanceFreq));
+	return ok;
+}
+
+static uint32_t hashBytes(const uint8_t *data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return (value * 0x9E3779B1u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+/* Bytes `a` and `b` have in common, up to `limit`. */
+static size_t matchLength(const uint8_t *a, const uint8_t *b, size_t limit)
+{
+	size_t n = 0;
+	while (n + 8 <= limit) {
+		uint64_t x, y;
+		memcpy(&x, a + n, 8);
+		memcpy(&y, b + n, 8);
+		if (x != y) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return n + (size_t)(__builtin_ctzll(x ^ y) >> 3);
+#else
+			break;
+#endif
+		}
+		n += 8;
+	}
+	while (n < limit && a[n] == b[n]) n++;
+	return n;
+}
+
+/* Appends `data` to `out` as a zlib stream (RFC 1950). One hash probe per
+ * position, no lazy matching, and positions inside a match aren't hashed:
+ * screen content is mostly long runs and repeats, which this still finds,
+ * at a fraction of the cost of a thorough search. Long stretches without a
+ * match are stepped over progressively faster. */
+static bool deflateBytes(PngBuffer *out, const uint8_t *data, size_t size)
+{
+	if (size >= UINT32_MAX || !reservePngBuffer(out, 2)) return false;
+	out->data[out->size++] = 0x78;
+	out->data[out->size++] = 0x01;
+
+	Deflater deflater;
+	memset(&deflater, 0, sizeof(deflater));
+	deflater.head = calloc((size_t)1 << DEFLATE_HASH_BITS, sizeof(uint32_t));
+	deflater.symbols = malloc(DEFLATE_BLOCK_SYMBOLS * sizeof(DeflateSymbol));
+	BitWriter writer = { out, 0, 0 };
+	bool ok = deflater.head != NULL && deflater.symbols != NULL;
+
+	size_t pos = 0, blockStart = 0, misses = 0;
+	while (ok && pos < size) {
+		size_t length = 0, distance = 0;
+		if (pos + DEFLATE_MIN_MATCH <= size) {
+			const uint32_t hash = hashBytes(data + pos);
+			const uint32_t candidate = deflater.head[hash];
+			deflater.head[hash] = (uint32_t)pos + 1;
+			if (candidate > 0 && pos - (candidate - 1) <= DEFLATE_WINDOW) {
+				const size_t from = candidate - 1;
+				const size_t limit = size - pos < DEFLATE_MAX_MATCH ? size - pos : DEFLATE_MAX_MATCH;
+				length = matchLength(data + from, data + pos, limit);
+				distance = pos - from;
+			}
+		}
+
+		if (length >= DEFLATE_MIN_MATCH) {
+			unsigned extraBits, extra;
+			deflater.literalFreq[lengthSymbol((unsigned)length, &extraBits, &extra)]++;
+			deflater.distanceFreq[distanceSymbol((unsigned)distance, &extraBits, &extra)]++;
+			deflater.symbols[deflater.symbolCount].length = (uint16_t)length;
+			deflater.symbols[deflater.symbolCount].distance = (uint16_t)distance;
+			deflater.symbolCount++;
+			pos += length;
+			misses = 0;
+		} else {
+			size_t step = 1 + (misses++ >> 5);
+			if (step > size - pos) step = size - pos;
+			if (step > DEFLATE_BLOCK_SYMBOLS - deflater.symbolCount) {
+				step = DEFLATE_BLOCK_SYMBOLS - deflater.symbolCount;
+			}
+			for (size_t i = 0; i < step; i++) {
+				deflater.literalFreq[data[pos]]++;
+				deflater.symbols[deflater.symbolCount].length = data[pos];
+				deflater.symbols[deflater.symbolCount].distance = 0;
+				deflater.symbolCount++;
+				pos++;
+			}
+		}
+
+		if (deflater.symbolCount == DEFLATE_BLOCK_SYMBOLS) {
+			ok = writeDeflateBlock(&deflater, &writer, data + blockStart, pos - blockStart,
+			                       pos == size);
+			blockStart = pos;
+		}
+	}
+	if (ok && (deflater.symbolCount > 0 || size == 0)) {
+		ok = writeDeflateBlock(&deflater, &writer, data + blockStart, pos - blockStart, true);
+	}
+	ok = ok && reservePngBuffer(out, 16);
+	if (ok) {
+		flushBits(&writer);
+		putPngU32(out, computeAdler32(data, size));
+	}
+
+	free(deflater.head);
+	free(deflater.symbols);
+	return ok;
+}
+
+/* PNG ---------------------------------------------------------------------- */
+
+#define PNG_PALETTE_SLOTS 1024   /* Open addressing; at most 256 used */
+#define PNG_SLOT_USED 0x80000000u
+
+typedef struct {
+	uint32_t slots[PNG_PALETTE_SLOTS];    /* PNG_SLOT_USED | 0xRRGGBB */
+	uint8_t indices[PNG_PALETTE_SLOTS];
+	uint32_t colors[256];
+	unsigned count;
+} PngPalette;
+
+H_INLINE uint32_t pixelColor(const uint8_t *pixel)
+{
+	/* MMBitmaps are BGR(X) */
+	return ((uint32_t)pixel[2] << 16) | ((uint32_t)pixel[1] << 8) | pixel[0];
+}
+
+/* The index of `color`, which is added if new. Returns -1 if that would
+ * make more than 256 colours. */
+static int paletteIndex(PngPalette *palette, uint32_t color)
+{
+	const uint32_t key = color | PNG_SLOT_USED;
+	unsigned slot = ((color + 1) * 0x9E3779B1u) >> 22;
+	while (palette->slots[slot] != key) {
+		if (palette->slots[slot] == 0) {
+			if (palette->count == 256) return -1;
+			palette->slots[slot] = key;
+			palette->indices[slot] = (uint8_t)palette->count;
+			palette->colors[palette->count++] = color;
+			break;
+		}
+		slot = (slot + 1) & (PNG_PALETTE_SLOTS - 1);
+	}
+	return palette->indices[slot];
+}
+
+/* Writes the palette index of every pixel to `indices`, a byte each with
+ * rows packed. Returns false as soon as there are more than 256 colours.
+ * A run of one colour is looked up once, and a row equal to the one above
+ * not at all. */
+static bool indexPixels(MMBitmapRef bitmap, PngPalette *palette, uint8_t *indices)
+{
+	memset(palette->slots, 0, sizeof(palette->slots));
+	palette->count = 0;
+	const size_t width = bitmap->width;
+	const size_t rowBytes = width * bitmap->bytesPerPixel;
+	uint32_t last = PNG_SLOT_USED;   /* Not a colour */
+	int index = 0;
+	for (size_t y = 0; y < bitmap->height; y++) {
+		const uint8_t *pixel = bitmap->imageBuffer + y * bitmap->bytewidth;
+		uint8_t *out = indices + y * width;
+		if (y > 0 && memcmp(pixel, pixel - bitmap->bytewidth, rowBytes) == 0) {
+			memcpy(out, out - width, width);
+			continue;
+		}
+		if (bitmap->bytesPerPixel == 4) {
+			/* Compare whole pixels first; most equal their left neighbour */
+			uint32_t lastWord = 0;
+			for (size_t x = 0; x < width; x++, pixel += 4) {
+				uint32_t word;
+				memcpy(&word, pixel, sizeof(word));
+				if (word != lastWord || x == 0) {
+					lastWord = word;
+					const uint32_t color = pixelColor(pixel);
+					if (color != last) {
+						last = color;
+						index = paletteIndex(palette, color);
+						if (index < 0) return false;
+					}
+				}
+				out[x] = (uint8_t)index;
+			}
+			continue;
+		}
+		for (size_t x = 0; x < width; x++, pixel += bitmap->bytesPerPixel) {
+			const uint32_t color = pixelColor(pixel);
+			if (color != last) {
+				last = color;
+				index = paletteIndex(palette, color);
+				if (index < 0) return false;
+			}
+			out[x] = (uint8_t)index;
+		}
+	}
+	return true;
+}
+
+/* Packs a row of 8-bit indices into `depth` bits each, leftmost pixel in
+ * the high bits. */
+static void packIndices(const uint8_t *indices, size_t width, unsigned depth, uint8_t *out)
+{
+	if (depth == 8) {
+		memcpy(out, indices, width);
+		return;
+	}
+	const size_t perByte = 8 / depth;
+	size_t x = 0;
+	if (depth == 4) {
+		for (; x + 2 <= width; x += 2) *out++ = (uint8_t)((indices[x] << 4) | indices[x + 1]);
+	}
+	for (; x + perByte <= width; x += perByte) {
+		unsigned byte = 0;
+		for (size_t k = 0; k < perByte; k++) byte = (byte << depth) | indices[x + k];
+		*out++ = (uint8_t)byte;
+	}
+	if (x < width) {
+		unsigned byte = 0, filled = 0;
+		for (; x < width; x++, filled += depth) byte = (byte << depth) | indices[x];
+		*out = (uint8_t)(byte << (8 - filled));
+	}
+}
+
+H_INLINE unsigned absResidual(uint8_t value)
+{
+	return value < 128 ? value : 256u - value;
+}
+
+H_INLINE uint8_t paethPredictor(int a, int b, int c)
+{
+	const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+	return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+/* Writes RGB row `row` (after `previous`, which is all zero for the first
+ * row) filtered with whichever of None, Sub, Up and Paeth leaves the
+ * smallest sum of absolute residuals, filter type first. `scratch` holds
+ * 3 * `length` bytes. The main loop has no branches, so compilers can
+ * vectorize it. */
+static void filterRgbRow(const uint8_t *row, const uint8_t *previous, size_t length,
+                         uint8_t *scratch, uint8_t *out)
+{
+	/* A row equal to the one above is all zeros with Up */
+	if (memcmp(row, previous, length) == 0) {
+		out[0] = 2;
+		memset(out + 1, 0, length);
+		return;
+	}
+
+	uint8_t *sub = scratch, *up = scratch + length, *paeth = scratch + 2 * length;
+	unsigned costs[4] = {0, 0, 0, 0};
+	for (size_t i = 0; i < 3 && i < length; i++) {
+		sub[i] = row[i];
+		up[i] = (uint8_t)(row[i] - previous[i]);
+		paeth[i] = up[i];
+		costs[0] += absResidual(row[i]);
+		costs[1] += absResidual(sub[i]);
+		costs[2] += absResidual(up[i]);
+		costs[3] += absResidual(paeth[i]);
+	}
+	unsigned noneCost = 0, subCost = 0, upCost = 0, paethCost = 0;
+	for (size_t i = 3; i < length; i++) {
+		const int a = row[i - 3], b = previous[i], c = previous[i - 3];
+		sub[i] = (uint8_t)(row[i] - a);
+		up[i] = (uint8_t)(row[i] - b);
+		paeth[i] = (uint8_t)(row[i] - paethPredictor(a, b, c));
+		noneCost += absResidual(row[i]);
+		subCost += absResidual(sub[i]);
+		upCost += absResidual(up[i]);
+		paethCost += absResidual(paeth[i]);
+	}
+	costs[0] += noneCost;
+	costs[1] += subCost;
+	costs[2] += upCost;
+	costs[3] += paethCost;
+
+	int best = 0;
+	for (int f = 1; f < 4; f++) {
+		if (costs[f] < costs[best]) best = f;
+	}
+	static const uint8_t types[4] = { 0, 1, 2, 4 };
+	const uint8_t *chosen[4] = { row, sub, up, paeth };
+	out[0] = types[best];
+	memcpy(out + 1, chosen[best], length);
+}
+
+/* The scanlines of `bitmap`, each led by its filter type: from `indices`
+ * with a palette, where rows are left unfiltered as the PNG spec advises,
+ * and from the pixels otherwise. */
+static uint8_t *buildScanlines(MMBitmapRef bitmap, const uint8_t *indices, unsigned depth,
+                               size_t *outSize)
+{
+	const size_t width = bitmap->width;
+	const size_t rowBytes = indices != NULL ? (width * depth + 7) / 8 : width * 3;
+	const size_t stride = rowBytes + 1;
+	uint8_t *lines = malloc(stride * bitmap->height);
+	uint8_t *rgb = indices == NULL ? calloc(5, rowBytes) : NULL;
+	if (lines == NULL || (indices == NULL && rgb == NULL)) {
+		free(lines);
+		free(rgb);
+		return NULL;
+	}
+
+	uint8_t *row = rgb, *previous = rgb != NULL ? rgb + rowBytes : NULL;
+	for (size_t y = 0; y < bitmap->height; y++) {
+		uint8_t *line = lines + y * stride;
+		if (indices != NULL) {
+			line[0] = 0;
+			packIndices(indices + y * width, width, depth, line + 1);
+			continue;
+		}
+		const uint8_t *pixel = bitmap->imageBuffer + y * bitmap->bytewidth;
+		for (size_t x = 0; x < width; x++, pixel += bitmap->bytesPerPixel) {
+			row[3 * x] = pixel[2];
+			row[3 * x + 1] = pixel[1];
+			row[3 * x + 2] = pixel[0];
+		}
+		filterRgbRow(row, previous, rowBytes, rgb + 2 * rowBytes, line);
+		uint8_t *swap = row;
+		row = previous;
+		previous = swap;
+	}
+
+	free(rgb);
+	*outSize = stride * bitmap->height;
+	return lines;
+}
+
+static uint8_t *encodePng(MMBitmapRef bitmap, int64_t *outSize)
+{
+	PngPalette *palette = malloc(sizeof(PngPalette));
+	uint8_t *indices = malloc(bitmap->width * bitmap->height);
+	unsigned depth = 8;
+	if (palette != NULL && indices != NULL && indexPixels(bitmap, palette, indices)) {
+		depth = palette->count <= 2 ? 1 : palette->count <= 4 ? 2 : palette->count <= 16 ? 4 : 8;
+	} else {
+		free(palette);
+		free(indices);
+		palette = NULL;
+		indices = NULL;
+	}
+
+	size_t linesSize = 0;
+	uint8_t *lines = buildScanlines(bitmap, indices, depth, &linesSize);
+	free(indices);
+	PngBuffer out = { NULL, 0, 0 };
+	bool ok = lines != NULL && reservePngBuffer(&out, linesSize / 8 + 1024);
+	if (ok) {
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		memcpy(out.data, signature, sizeof(signature));
+		out.size = sizeof(signature);
+
+		uint8_t header[13];
+		const uint32_t width = (uint32_t)bitmap->width, height = (uint32_t)bitmap->height;
+		for (int i = 0; i < 4; i++) {
+			header[i] = (uint8_t)(width >> (24 - 8 * i));
+			header[4 + i] = (uint8_t)(height >> (24 - 8 * i));
+		}
+		header[8] = (uint8_t)depth;
+		header[9] = palette != NULL ? 3 : 2;   /* Indexed or RGB */
+		header[10] = 0;
+		header[11] = 0;
+		header[12] = 0;
+		ok = putPngChunk(&out, "IHDR", header, sizeof(header));
+	}
+	if (ok && palette != NULL) {
+		uint8_t entries[256 * 3];
+		for (unsigned i = 0; i < palette->count; i++) {
+			entries[3 * i] = (uint8_t)(palette->colors[i] >> 16);
+			entries[3 * i + 1] = (uint8_t)(palette->colors[i] >> 8);
+			entries[3 * i + 2] = (uint8_t)palette->colors[i];
+		}
+		ok = putPngChunk(&out, "PLTE", entries, 3 * (size_t)palette->count);
+	}
+	if (ok && (ok = reservePngBuffer(&out, 8))) {
+		const size_t start = out.size;
+		memcpy(out.data + start + 4, "IDAT", 4);
+		out.size += 8;
+		ok = deflateBytes(&out, lines, linesSize) && reservePngBuffer(&out, 4);
+		if (ok) finishPngChunk(&out, start);
+	}
+	ok = ok && putPngChunk(&out, "IEND", NULL, 0);
+
+	free(lines);
+	free(palette);
+	if (!ok) {
+		free(out.data);
+		return NULL;
+	}
+	*outSize = (int64_t)out.size;
+	return out.data;
+}
+
+uint8_t *encodeMMBitmapPng(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                           int32_t filter, int64_t *outSize)
+{
+	if (outSize != NULL) *outSize = 0;
+	if (bitmap == NULL || bitmap->imageBuffer == NULL || outSize == NULL ||
+	    (bitmap->bytesPerPixel != 3 && bitmap->bytesPerPixel != 4) ||
+	    bitmap->width == 0 || bitmap->height == 0) {
+		return NULL;
+	}
+
+	int64_t width, height;
+	calculateResizedDimensions((int64_t)bitmap->width, (int64_t)bitmap->height,
+	                           maxSmallDim, maxLargeDim, &width, &height);
+	MMBitmapRef resized = NULL;
+	if (width != (int64_t)bitmap->width || height != (int64_t)bitmap->height) {
+		resized = resampleMMBitmap(bitmap, (size_t)width, (size_t)height, (MMResampleFilter)filter);
+		if (resized == NULL) return NULL;
+		bitmap = resized;
+	}
+
+	uint8_t *png = encodePng(bitmap, outSize);
+	if (resized != NULL) destroyMMBitmap(resized);
+	return png;
+}
@@ -0,0 +1,91 @@
+#include "rectmerge.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+bool MMRectsIntersect(MMRect a, MMRect b)
+{
+	return a.origin.x < b.origin.x + b.size.width &&
+	       b.origin.x < a.origin.x + a.size.width &&
+	       a.origin.y < b.origin.y + b.size.height &&
+	       b.origin.y < a.origin.y + a.size.height;
+}
+
+static bool rectsTouch(MMRect a, MMRect b)
+{
+	return a.origin.x <= b.origin.x + b.size.width &&
+	       b.origin.x <= a.origin.x + a.size.width &&
+	       a.origin.y <= b.origin.y + b.size.height &&
+	       b.origin.y <= a.origin.y + a.size.height;
+}
+
+MMRect MMRectUnion(MMRect a, MMRect b)
+{
+	const int64_t x1 = a.origin.x < b.origin.x ? a.origin.x : b.origin.x;
+	const int64_t y1 = a.origin.y < b.origin.y ? a.origin.y : b.origin.y;
+	const int64_t ax2 = a.origin.x + a.size.width, bx2 = b.origin.x + b.size.width;
+	const int64_t ay2 = a.origin.y + a.size.height, by2 = b.origin.y + b.size.height;
+	return MMRectMake(x1, y1, (ax2 > bx2 ? ax2 : bx2) - x1, (ay2 > by2 ? ay2 : by2) - y1);
+}
+
+static int64_t rectArea(MMRect r)
+{
+	return r.size.width * r.size.height;
+}
+
+static int compareRectOrigins(const void *a, const void *b)
+{
+	const MMRect *ra = (const MMRect *)a;
+	const MMRect *rb = (const MMRect *)b;
+	if (ra->origin.y != rb->origin.y) return ra->origin.y < rb->origin.y ? -1 : 1;
+	if (ra->origin.x != rb->origin.x) return ra->origin.x < rb->origin.x ? -1 : 1;
+	return 0;
+}
+
+size_t mergeMMRects(MMRect *rects, size_t count, size_t maxRects)
+{
+	/* Large sets are first halved by pairing neighbours in reading order,
+	 * which keeps the quadratic passes below cheap. */
+	while (count > 64 && count > maxRects) {
+		qsort(rects, count, sizeof(MMRect), compareRectOrigins);
+		size_t out = 0;
+		for (size_t i = 0; i < count; i += 2) {
+			rects[out++] = (i + 1 < count) ? MMRectUnion(rects[i], rects[i + 1]) : rects[i];
+		}
+		count = out;
+	}
+
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < count; i++) {
+			for (size_t j = i + 1; j < count; j++) {
+				if (rectsTouch(rects[i], rects[j])) {
+					rects[i] = MMRectUnion(rects[i], rects[j]);
+					rects[j] = rects[--count];
+					merged = true;
+					j = i;
+				}
+			}
+		}
+	}
+
+	while (count > maxRects && count > 1) {
+		size_t bestI = 0, bestJ = 1;
+		int64_t bestWaste = INT64_MAX;
+		for (size_t i = 0; i < count; i++) {
+			for (size_t j = i + 1; j < count; j++) {
+				const int64_t waste = rectArea(MMRectUnion(rects[i], rects[j])) -
+				                      rectArea(rects[i]) - rectArea(rects[j]);
+				if (waste < bestWaste) {
+					bestWaste = waste;
+					bestI = i;
+					bestJ = j;
+				}
+			}
+		}
+		rects[bestI] = MMRectUnion(rects[bestI], rects[bestJ]);
+		rects[bestJ] = rects[--count];
+	}
+
+	return count;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef RECTMERGE_H
+#define RECTMERGE_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Returns whether the two rectangles overlap (sharing only an edge doesn't
+ * count). */
+bool MMRectsIntersect(MMRect a, MMRect b);
+
+/* Returns the bounding box of both rectangles. */
+MMRect MMRectUnion(MMRect a, MMRect b);
+
+/* Merges overlapping or touching rectangles in place, then keeps merging the
+ * pair whose union wastes the least area until at most `maxRects` remain.
+ * Returns the new count. */
+size_t mergeMMRects(MMRect *rects, size_t count, size_t maxRects);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RECTMERGE_H */
@@ -0,0 +1,930 @@
+#include "resample.h"
+#include "cpufeatures.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define RESAMPLE_X86 1
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define RESAMPLE_TARGET_AVX2
+	#else
+		#define RESAMPLE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define RESAMPLE_SSE2 1
+	#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define RESAMPLE_NEON 1
+	#include <arm_neon.h>
+#endif
+
+/* Weights are fixed point with this many fractional bits, so one is 16384
+ * and a weighted sum of 8-bit samples fits comfortably in 32 bits. */
+#define RESAMPLE_WEIGHT_BITS 14
+#define RESAMPLE_WEIGHT_ONE (1 << RESAMPLE_WEIGHT_BITS)
+#define RESAMPLE_WEIGHT_ROUND (1 << (RESAMPLE_WEIGHT_BITS - 1))
+
+/* Filter taps along one axis. Destination sample i is the sum of
+ * count[i] source samples from start[i] on, weighted by
+ * weights[i * maxTaps ...]. */
+typedef struct _MMResampleAxis {
+	size_t size;
+	int32_t maxTaps;
+	int32_t *start;
+	int32_t *count;
+	int16_t *weights;
+	bool identity;           /* Same size, nothing to do. */
+} MMResampleAxis;
+
+typedef void (*ResampleHorizontalFunc)(const MMResampleAxis *axis, const uint8_t *src,
+                                       uint8_t *dst, uint8_t bytesPerPixel);
+typedef void (*ResampleVerticalFunc)(const uint8_t *const *rows, const int16_t *weights,
+                                     int32_t count, uint8_t *dst, size_t begin, size_t length);
+typedef void (*ResampleBoxFunc)(const uint8_t *src, size_t srcBytewidth, size_t factorX,
+                                size_t factorY, size_t dstWidth, uint8_t bytesPerPixel,
+                                uint16_t *columnSums, uint8_t *dst);
+
+struct _MMResampler {
+	size_t srcWidth;
+	size_t srcHeight;
+	uint8_t bytesPerPixel;
+	MMResampleAxis horizontal;
+	MMResampleAxis vertical;
+
+	MMResampleBackend backend;
+	ResampleHorizontalFunc horizontalPass;
+	ResampleVerticalFunc verticalPass;
+	ResampleBoxFunc boxPass;
+
+	/* Horizontally resized source rows, in a ring indexed by source row. */
+	uint8_t *rowCache;
+	int64_t *rowCacheTags;   /* Source row held by each slot, -1 for none. */
+	size_t rowCacheSize;
+	size_t rowCacheBytewidth;
+	const uint8_t *cachedSource;
+	size_t nextRow;          /* Where the last call stopped. */
+
+	const uint8_t **taps;    /* Scratch: rows feeding one output row. */
+
+	/* Whole-factor area reduction, or 0 to use the tables. */
+	size_t boxFactorX;
+	size_t boxFactorY;
+	uint16_t *boxSums;
+};
+
+static uint8_t resampleClamp(int32_t value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+static void freeResampleAxis(MMResampleAxis *axis)
+{
+	free(axis->start);
+	free(axis->count);
+	free(axis->weights);
+}
+
+static bool allocResampleAxis(MMResampleAxis *axis, size_t size, int32_t maxTaps)
+{
+	axis->size = size;
+	axis->maxTaps = maxTaps;
+	axis->start = calloc(size, sizeof(int32_t));
+	axis->count = calloc(size, sizeof(int32_t));
+	axis->weights = calloc(size * (size_t)maxTaps, sizeof(int16_t));
+	return axis->start != NULL && axis->count != NULL && axis->weights != NULL;
+}
+
+/* Bilinear taps: destination sample i reads source position i * ratio and
+ * its right (or lower) neighbour. */
+static bool buildBilinearAxis(MMResampleAxis *axis, size_t srcSize, size_t dstSize)
+{
+	if (!allocResampleAxis(axis, dstSize, 2)) return false;
+
+	const double ratio = (double)srcSize / (double)dstSize;
+	for (size_t i = 0; i < dstSize; i++) {
+		const double position = (double)i * ratio;
+		size_t first = (size_t)position;
+		if (first > srcSize - 1) first = srcSize - 1;
+
+		const int32_t fraction = (int32_t)lround((position - (double)first) * RESAMPLE_WEIGHT_ONE);
+		int16_t *weights = axis->weights + i * 2;
+		axis->start[i] = (int32_t)first;
+		if (fraction <= 0 || first + 1 >= srcSize) {
+			axis->count[i] = 1;
+			weights[0] = RESAMPLE_WEIGHT_ONE;
+		} else if (fraction >= RESAMPLE_WEIGHT_ONE) {
+			axis->start[i] = (int32_t)first + 1;
+			axis->count[i] = 1;
+			weights[0] = RESAMPLE_WEIGHT_ONE;
+		} else {
+			axis->count[i] = 2;
+			weights[0] = (int16_t)(RESAMPLE_WEIGHT_ONE - fraction);
+			weights[1] = (int16_t)fraction;
+		}
+	}
+	return true;
+}
+
+/* Converts one destination sample's weights to fixed point. The rounding
+ * error goes to the largest tap so they still sum to exactly one, and zero
+ * taps at either end are dropped. */
+static void quantizeResampleTaps(MMResampleAxis *axis, size_t i, int32_t first,
+                                 const double *values, int32_t count)
+{
+	double total = 0;
+	for (int32_t t = 0; t < count; t++) total += values[t];
+
+	int32_t lead = 0;
+	while (lead < count - 1 && values[lead] == 0) lead++;
+	while (count > lead + 1 && values[count - 1] == 0) count--;
+
+	int16_t *weights = axis->weights + i * (size_t)axis->maxTaps;
+	int32_t sum = 0;
+	int32_t largest = 0;
+	for (int32_t t = lead; t < count; t++) {
+		const int32_t weight = (int32_t)lround(values[t] / total * RESAMPLE_WEIGHT_ONE);
+		weights[t - lead] = (int16_t)weight;
+		sum += weight;
+		if (weight > weights[largest]) largest = t - lead;
+	}
+	weights[largest] = (int16_t)(weights[largest] + (RESAMPLE_WEIGHT_ONE - sum));
+
+	axis->start[i] = first + lead;
+	axis->count[i] = count - lead;
+}
+
+/* Area taps: destination sample i covers source interval
+ * [i * ratio, (i + 1) * ratio), and each source sample is weighted by how
+ * much of it lies inside. */
+static bool buildAreaAxis(MMResampleAxis *axis, size_t srcSize, size_t dstSize)
+{
+	const double ratio = (double)srcSize / (double)dstSize;
+	if (!allocResampleAxis(axis, dstSize, (int32_t)ceil(ratio) + 1)) return false;
+
+	double *values = malloc((size_t)axis->maxTaps * sizeof(double));
+	if (values == NULL) return false;
+
+	for (size_t i = 0; i < dstSize; i++) {
+		const double begin = (double)i * ratio;
+		const double end = (double)(i + 1) * ratio;
+		const int32_t first = (int32_t)floor(begin);
+		int32_t last = (int32_t)ceil(end);
+		if (last > (int32_t)srcSize) last = (int32_t)srcSize;
+		if (last - first > axis->maxTaps) last = first + axis->maxTaps;
+
+		for (int32_t j = first; j < last; j++) {
+			const double low = j > begin ? j : begin;
+			const double high = j + 1 < end ? j + 1 : end;
+			values[j - first] = high > low ? high - low : 0;
+		}
+		quantizeResampleTaps(axis, i, first, values, last - first);
+	}
+
+	free(values);
+	return true;
+}
+
+static double resampleSinc(double x)
+{
+	if (x == 0) return 1;
+	x *= 3.14159265358979323846;
+	return sin(x) / x;
+}
+
+/* Lanczos-3 taps, centred on each destination sample. When shrinking, the
+ * kernel is stretched by the ratio so every source sample contributes. */
+static bool buildLanczosAxis(MMResampleAxis *axis, size_t srcSize, size_t dstSize)
+{
+	const double ratio = (double)srcSize / (double)dstSize;
+	const double scale = ratio > 1 ? ratio : 1;
+	const double radius = 3 * scale;
+	if (!allocResampleAxis(axis, dstSize, (int32_t)ceil(radius) * 2 + 1)) return false;
+
+	double *values = malloc((size_t)axis->maxTaps * sizeof(double));
+	if (values == NULL) return false;
+
+	for (size_t i = 0; i < dstSize; i++) {
+		const double center = ((double)i + 0.5) * ratio;
+		int32_t first = (int32_t)floor(center - radius);
+		int32_t last = (int32_t)ceil(center + radius);
+		if (first < 0) first = 0;
+		if (last > (int32_t)srcSize) last = (int32_t)srcSize;
+		if (last - first > axis->maxTaps) last = first + axis->maxTaps;
+
+		for (int32_t j = first; j < last; j++) {
+			const double x = ((double)j + 0.5 - center) / scale;
+			values[j - first] = x > -3 && x < 3 ? resampleSinc(x) * resampleSinc(x / 3) : 0;
+		}
+		quantizeResampleTaps(axis, i, first, values, last - first);
+	}
+
+	free(values);
+	return true;
+}
+
+static bool buildResampleAxis(MMResampleAxis *axis, size_t srcSize, size_t dstSize,
+                              MMResampleFilter filter)
+{
+	memset(axis, 0, sizeof(*axis));
+	axis->identity = srcSize == dstSize;
+
+	switch (filter) {
+	case MMResampleArea:
+		return buildAreaAxis(axis, srcSize, dstSize);
+	case MMResampleLanczos3:
+		return buildLanczosAxis(axis, srcSize, dstSize);
+	case MMResampleBilinear:
+	default:
+		return buildBilinearAxis(axis, srcSize, dstSize);
+	}
+}
+
+/* Whole reduction factor (1 to 4) from srcSize to dstSize, or 0 if there is
+ * none. */
+static size_t resampleBoxFactor(size_t srcSize, size_t dstSize)
+{
+	if (srcSize % dstSize != 0) return 0;
+	const size_t factor = srcSize / dstSize;
+	return factor <= 4 ? factor : 0;
+}
+
+/* One destination row of an exact factorX x factorY block average, the
+ * reference for the SIMD versions. `columnSums` holds a source row's worth
+ * of 16-bit sums. Division multiplies by a 16-bit reciprocal; for blocks of
+ * at most 16 pixels that rounds exactly like (sum + area / 2) / area. */
+static void resampleBoxRow(const uint8_t *src, size_t srcBytewidth, size_t factorX,
+                           size_t factorY, size_t dstWidth, uint8_t bytesPerPixel,
+                           uint16_t *columnSums, uint8_t *dst)
+{
+	const size_t length = dstWidth * factorX * bytesPerPixel;
+	for (size_t i = 0; i < length; i++) columnSums[i] = src[i];
+	for (size_t r = 1; r < factorY; r++) {
+		const uint8_t *row = src + r * srcBytewidth;
+		for (size_t i = 0; i < length; i++) columnSums[i] = (uint16_t)(columnSums[i] + row[i]);
+	}
+
+	const uint32_t area = (uint32_t)(factorX * factorY);
+	const uint32_t reciprocal = (65536 + area - 1) / area;
+	const size_t step = factorX * bytesPerPixel;
+	for (size_t x = 0; x < dstWidth; x++) {
+		const uint16_t *sums = columnSums + x * step;
+		for (uint8_t c = 0; c < bytesPerPixel; c++) {
+			uint32_t sum = area / 2;
+			for (size_t k = 0; k < factorX; k++) sum += sums[k * bytesPerPixel + c];
+			dst[x * bytesPerPixel + c] = (uint8_t)((sum * reciprocal) >> 16);
+		}
+	}
+}
+
+/* Scalar kernels: the reference every SIMD version must match exactly. */
+
+static void resampleHorizontalScalar(const MMResampleAxis *axis, const uint8_t *src,
+                                     uint8_t *dst, uint8_t bytesPerPixel)
+{
+	for (size_t x = 0; x < axis->size; x++) {
+		const uint8_t *in = src + (size_t)axis->start[x] * bytesPerPixel;
+		const int16_t *weights = axis->weights + x * (size_t)axis->maxTaps;
+		const int32_t count = axis->count[x];
+
+		for (uint8_t c = 0; c < bytesPerPixel; c++) {
+			int32_t sum = RESAMPLE_WEIGHT_ROUND;
+			for (int32_t t = 0; t < count; t++) {
+				sum += (int32_t)in[(size_t)t * bytesPerPixel + c] * weights[t];
+			}
+			dst[x * bytesPerPixel + c] = resampleClamp(sum >> RESAMPLE_WEIGHT_BITS);
+		}
+	}
+}
+
+static void resampleVerticalScalar(const uint8_t *const *rows, const int16_t *weights,
+                                   int32_t count, uint8_t *dst, size_t begin, size_t length)
+{
+	for (size_t i = begin; i < length; i++) {
+		int32_t sum = RESAMPLE_WEIGHT_ROUND;
+		for (int32_t t = 0; t < count; t++) {
+			sum += (int32_t)rows[t][i] * weights[t];
+		}
+		dst[i] = resampleClamp(sum >> RESAMPLE_WEIGHT_BITS);
+	}
+}
+
+/* x86 kernels. Both passes multiply 16-bit samples by 16-bit weights two
+ * taps at a time with madd, interleaving the samples of neighbouring taps so
+ * each 32-bit lane accumulates one output channel. Packing with saturation
+ * does the clamping. */
+
+#if defined(RESAMPLE_X86)
+
+static int32_t resampleWeightPair(int16_t first, int16_t second)
+{
+	return (int32_t)((uint32_t)(uint16_t)first | ((uint32_t)(uint16_t)second << 16));
+}
+
+static uint32_t resampleLoad32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+#if defined(RESAMPLE_SSE2)
+
+/* Adds taps [t, count) of a 4-byte pixel to `sum`. */
+static __m128i resamplePixelTailSSE2(__m128i sum, const uint8_t *in, const int16_t *weights,
+                                     int32_t t, int32_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	for (; t + 1 < count; t += 2) {
+		__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(in + (size_t)t * 4)), zero);
+		pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels,
+		                                        _mm_set1_epi32(resampleWeightPair(weights[t], weights[t + 1]))));
+	}
+	if (t < count) {
+		__m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)resampleLoad32(in + (size_t)t * 4)), zero);
+		pixel = _mm_unpacklo_epi16(pixel, zero);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel,
+		                                        _mm_set1_epi32(resampleWeightPair(weights[t], 0))));
+	}
+	return sum;
+}
+
+static void resampleStorePixelSSE2(uint8_t *dst, __m128i sum)
+{
+	sum = _mm_srai_epi32(sum, RESAMPLE_WEIGHT_BITS);
+	sum = _mm_packs_epi32(sum, sum);
+	sum = _mm_packus_epi16(sum, sum);
+	const uint32_t pixel = (uint32_t)_mm_cvtsi128_si32(sum);
+	memcpy(dst, &pixel, sizeof(pixel));
+}
+
+static void resampleHorizontalSSE2(const MMResampleAxis *axis, const uint8_t *src,
+                                   uint8_t *dst, uint8_t bytesPerPixel)
+{
+	if (bytesPerPixel != 4) {
+		resampleHorizontalScalar(axis, src, dst, bytesPerPixel);
+		return;
+	}
+
+	const __m128i round = _mm_set1_epi32(RESAMPLE_WEIGHT_ROUND);
+	const size_t maxTaps = (size_t)axis->maxTaps;
+	size_t x = 0;
+
+	/* Four pixels per store. */
+	for (; x + 4 <= axis->size; x += 4) {
+		__m128i sums[4];
+		for (size_t p = 0; p < 4; p++) {
+			sums[p] = resamplePixelTailSSE2(round, src + (size_t)axis->start[x + p] * 4,
+			                                axis->weights + (x + p) * maxTaps,
+			                                0, axis->count[x + p]);
+			sums[p] = _mm_srai_epi32(sums[p], RESAMPLE_WEIGHT_BITS);
+		}
+		const __m128i low = _mm_packs_epi32(sums[0], sums[1]);
+		const __m128i high = _mm_packs_epi32(sums[2], sums[3]);
+		_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(low, high));
+	}
+	for (; x < axis->size; x++) {
+		const __m128i sum = resamplePixelTailSSE2(round, src + (size_t)axis->start[x] * 4,
+		                                          axis->weights + x * maxTaps,
+		                                          0, axis->count[x]);
+		resampleStorePixelSSE2(dst + x * 4, sum);
+	}
+}
+
+static void resampleVerticalSSE2(const uint8_t *const *rows, const int16_t *weights,
+                                 int32_t count, uint8_t *dst, size_t begin, size_t length)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(RESAMPLE_WEIGHT_ROUND);
+	size_t i = begin;
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i sum0 = round, sum1 = round, sum2 = round, sum3 = round;
+		for (int32_t t = 0; t < count; t += 2) {
+			const bool pair = t + 1 < count;
+			const __m128i w = _mm_set1_epi32(resampleWeightPair(weights[t], pair ? weights[t + 1] : 0));
+			const __m128i a = _mm_loadu_si128((const __m128i *)(rows[t] + i));
+			const __m128i b = pair ? _mm_loadu_si128((const __m128i *)(rows[t + 1] + i)) : zero;
+			const __m128i aLow = _mm_unpacklo_epi8(a, zero), aHigh = _mm_unpackhi_epi8(a, zero);
+			const __m128i bLow = _mm_unpacklo_epi8(b, zero), bHigh = _mm_unpackhi_epi8(b, zero);
+			sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(aLow, bLow), w));
+			sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(aLow, bLow), w));
+			sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi16(aHigh, bHigh), w));
+			sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi16(aHigh, bHigh), w));
+		}
+		const __m128i low = _mm_packs_epi32(_mm_srai_epi32(sum0, RESAMPLE_WEIGHT_BITS),
+		                                    _mm_srai_epi32(sum1, RESAMPLE_WEIGHT_BITS));
+		const __m128i high = _mm_packs_epi32(_mm_srai_epi32(sum2, RESAMPLE_WEIGHT_BITS),
+		                                     _mm_srai_epi32(sum3, RESAMPLE_WEIGHT_BITS));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(low, high));
+	}
+	resampleVerticalScalar(rows, weights, count, dst, i, length);
+}
+
+/* Block averages of 4-byte pixels. Column sums are built 16 bytes at a
+ * time; then each output pixel adds factorX of them as four 16-bit lanes,
+ * two pixels per register, and mulhi divides by the reciprocal. */
+static void resampleBoxRowSSE2(const uint8_t *src, size_t srcBytewidth, size_t factorX,
+                               size_t factorY, size_t dstWidth, uint8_t bytesPerPixel,
+                               uint16_t *columnSums, uint8_t *dst)
+{
+	if (bytesPerPixel != 4) {
+		resampleBoxRow(src, srcBytewidth, factorX, factorY, dstWidth, bytesPerPixel,
+		               columnSums, dst);
+		return;
+	}
+
+	const __m128i zero = _mm_setzero_si128();
+	const size_t length = dstWidth * factorX * 4;
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i low = zero, high = zero;
+		for (size_t r = 0; r < factorY; r++) {
+			const __m128i bytes = _mm_loadu_si128((const __m128i *)(src + r * srcBytewidth + i));
+			low = _mm_add_epi16(low, _mm_unpacklo_epi8(bytes, zero));
+			high = _mm_add_epi16(high, _mm_unpackhi_epi8(bytes, zero));
+		}
+		_mm_storeu_si128((__m128i *)(columnSums + i), low);
+		_mm_storeu_si128((__m128i *)(columnSums + i + 8), high);
+	}
+	for (; i < length; i++) {
+		uint16_t sum = 0;
+		for (size_t r = 0; r < factorY; r++) sum = (uint16_t)(sum + src[r * srcBytewidth + i]);
+		columnSums[i] = sum;
+	}
+
+	const uint32_t area = (uint32_t)(factorX * factorY);
+	const __m128i half = _mm_set1_epi16((short)(area / 2));
+	const __m128i reciprocal = _mm_set1_epi16((short)((65536 + area - 1) / area));
+	const size_t step = factorX * 4;
+	size_t x = 0;
+	for (; x + 4 <= dstWidth; x += 4) {
+		const uint16_t *sums = columnSums + x * step;
+		__m128i first = half, second = half;
+		for (size_t k = 0; k < factorX; k++) {
+			const uint16_t *p = sums + k * 4;
+			first = _mm_add_epi16(first, _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)p),
+			                                                _mm_loadl_epi64((const __m128i *)(p + step))));
+			second = _mm_add_epi16(second, _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(p + 2 * step)),
+			                                                  _mm_loadl_epi64((const __m128i *)(p + 3 * step))));
+		}
+		first = _mm_mulhi_epu16(first, reciprocal);
+		second = _mm_mulhi_epu16(second, reciprocal);
+		_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(first, second));
+	}
+	for (; x < dstWidth; x++) {
+		const uint16_t *sums = columnSums + x * step;
+		__m128i sum = half;
+		for (size_t k = 0; k < factorX; k++) {
+			sum = _mm_add_epi16(sum, _mm_loadl_epi64((const __m128i *)(sums + k * 4)));
+		}
+		sum = _mm_mulhi_epu16(sum, reciprocal);
+		const uint32_t pixel = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+		memcpy(dst + x * 4, &pixel, sizeof(pixel));
+	}
+}
+
+#endif /* RESAMPLE_SSE2 */
+
+/* Weighted sum of one 4-byte pixel's taps, for the AVX2 horizontal pass.
+ * Four taps per step, each 128-bit lane holding a pair of neighbouring
+ * pixels; what is left over goes two taps or one at a time. */
+RESAMPLE_TARGET_AVX2
+static __m128i resamplePixelAVX2(const uint8_t *in, const int16_t *weights, int32_t count)
+{
+	/* Within each lane: b0 b1 g0 g1 r0 r1 a0 a1 from b0 g0 r0 a0 b1 g1 r1 a1. */
+	const __m256i interleave = _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+	                                            0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_set1_epi32(RESAMPLE_WEIGHT_ROUND);
+	int32_t t = 0;
+
+	if (count >= 4) {
+		__m256i wide = _mm256_setzero_si256();
+		for (; t + 3 < count; t += 4) {
+			__m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + (size_t)t * 4)));
+			pixels = _mm256_shuffle_epi8(pixels, interleave);
+			const int32_t low = resampleWeightPair(weights[t], weights[t + 1]);
+			const int32_t high = resampleWeightPair(weights[t + 2], weights[t + 3]);
+			wide = _mm256_add_epi32(wide, _mm256_madd_epi16(pixels,
+			                                                _mm256_set_epi32(high, high, high, high,
+			                                                                 low, low, low, low)));
+		}
+		sum = _mm_add_epi32(sum, _mm_add_epi32(_mm256_castsi256_si128(wide),
+		                                       _mm256_extracti128_si256(wide, 1)));
+	}
+	for (; t + 1 < count; t += 2) {
+		__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(in + (size_t)t * 4)), zero);
+		pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels,
+		                                        _mm_set1_epi32(resampleWeightPair(weights[t], weights[t + 1]))));
+	}
+	if (t < count) {
+		__m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)resampleLoad32(in + (size_t)t * 4)), zero);
+		pixel = _mm_unpacklo_epi16(pixel, zero);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel,
+		                                        _mm_set1_epi32(resampleWeightPair(weights[t], 0))));
+	}
+	return _mm_srai_epi32(sum, RESAMPLE_WEIGHT_BITS);
+}
+
+RESAMPLE_TARGET_AVX2
+static void resampleHorizontalAVX2(const MMResampleAxis *axis, const uint8_t *src,
+                                   uint8_t *dst, uint8_t bytesPerPixel)
+{
+	if (bytesPerPixel != 4) {
+		resampleHorizontalScalar(axis, src, dst, bytesPerPixel);
+		return;
+	}
+
+	const size_t maxTaps = (size_t)axis->maxTaps;
+	size_t x = 0;
+	for (; x + 4 <= axis->size; x += 4) {
+		__m128i sums[4];
+		for (size_t p = 0; p < 4; p++) {
+			sums[p] = resamplePixelAVX2(src + (size_t)axis->start[x + p] * 4,
+			                            axis->weights + (x + p) * maxTaps, axis->count[x + p]);
+		}
+		const __m128i low = _mm_packs_epi32(sums[0], sums[1]);
+		const __m128i high = _mm_packs_epi32(sums[2], sums[3]);
+		_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(low, high));
+	}
+	for (; x < axis->size; x++) {
+		__m128i sum = resamplePixelAVX2(src + (size_t)axis->start[x] * 4,
+		                                axis->weights + x * maxTaps, axis->count[x]);
+		sum = _mm_packs_epi32(sum, sum);
+		sum = _mm_packus_epi16(sum, sum);
+		const uint32_t pixel = (uint32_t)_mm_cvtsi128_si32(sum);
+		memcpy(dst + x * 4, &pixel, sizeof(pixel));
+	}
+}
+
+/* Same as the SSE2 vertical pass on 32 bytes at a time. Unpacking and
+ * packing both work within 128-bit lanes, so the byte order comes back
+ * unchanged. */
+RESAMPLE_TARGET_AVX2
+static void resampleVerticalAVX2(const uint8_t *const *rows, const int16_t *weights,
+                                 int32_t count, uint8_t *dst, size_t begin, size_t length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi32(RESAMPLE_WEIGHT_ROUND);
+	size_t i = begin;
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i sum0 = round, sum1 = round, sum2 = round, sum3 = round;
+		for (int32_t t = 0; t < count; t += 2) {
+			const bool pair = t + 1 < count;
+			const __m256i w = _mm256_set1_epi32(resampleWeightPair(weights[t], pair ? weights[t + 1] : 0));
+			const __m256i a = _mm256_loadu_si256((const __m256i *)(rows[t] + i));
+			const __m256i b = pair ? _mm256_loadu_si256((const __m256i *)(rows[t + 1] + i)) : zero;
+			const __m256i aLow = _mm256_unpacklo_epi8(a, zero), aHigh = _mm256_unpackhi_epi8(a, zero);
+			const __m256i bLow = _mm256_unpacklo_epi8(b, zero), bHigh = _mm256_unpackhi_epi8(b, zero);
+			sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(aLow, bLow), w));
+			sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(aLow, bLow), w));
+			sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_unpacklo_epi16(aHigh, bHigh), w));
+			sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_unpackhi_epi16(aHigh, bHigh), w));
+		}
+		const __m256i low = _mm256_packs_epi32(_mm256_srai_epi32(sum0, RESAMPLE_WEIGHT_BITS),
+		                                       _mm256_srai_epi32(sum1, RESAMPLE_WEIGHT_BITS));
+		const __m256i high = _mm256_packs_epi32(_mm256_srai_epi32(sum2, RESAMPLE_WEIGHT_BITS),
+		                                        _mm256_srai_epi32(sum3, RESAMPLE_WEIGHT_BITS));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(low, high));
+	}
+	resampleVerticalScalar(rows, weights, count, dst, i, length);
+}
+
+#endif /* RESAMPLE_X86 */
+
+/* NEON kernels, widening multiply-accumulate one tap at a time. */
+
+#if defined(RESAMPLE_NEON)
+
+static void resampleHorizontalNEON(const MMResampleAxis *axis, const uint8_t *src,
+                                   uint8_t *dst, uint8_t bytesPerPixel)
+{
+	if (bytesPerPixel != 4) {
+		resampleHorizontalScalar(axis, src, dst, bytesPerPixel);
+		return;
+	}
+
+	for (size_t x = 0; x < axis->size; x++) {
+		const uint8_t *in = src + (size_t)axis->start[x] * 4;
+		const int16_t *weights = axis->weights + x * (size_t)axis->maxTaps;
+		const int32_t count = axis->count[x];
+
+		int32x4_t sum = vdupq_n_s32(RESAMPLE_WEIGHT_ROUND);
+		for (int32_t t = 0; t < count; t++) {
+			uint32_t packed;
+			memcpy(&packed, in + (size_t)t * 4, sizeof(packed));
+			const int16x4_t pixel = vreinterpret_s16_u16(
+				vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)))));
+			sum = vmlal_n_s16(sum, pixel, weights[t]);
+		}
+		const int16x4_t narrowed = vqmovn_s32(vshrq_n_s32(sum, RESAMPLE_WEIGHT_BITS));
+		const uint8x8_t bytes = vqmovun_s16(vcombine_s16(narrowed, narrowed));
+		const uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+		memcpy(dst + x * 4, &pixel, sizeof(pixel));
+	}
+}
+
+static void resampleVerticalNEON(const uint8_t *const *rows, const int16_t *weights,
+                                 int32_t count, uint8_t *dst, size_t begin, size_t length)
+{
+	const int32x4_t round = vdupq_n_s32(RESAMPLE_WEIGHT_ROUND);
+	size_t i = begin;
+
+	for (; i + 16 <= length; i += 16) {
+		int32x4_t sum0 = round, sum1 = round, sum2 = round, sum3 = round;
+		for (int32_t t = 0; t < count; t++) {
+			const uint8x16_t row = vld1q_u8(rows[t] + i);
+			const int16x8_t low = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(row)));
+			const int16x8_t high = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(row)));
+			sum0 = vmlal_n_s16(sum0, vget_low_s16(low), weights[t]);
+			sum1 = vmlal_n_s16(sum1, vget_high_s16(low), weights[t]);
+			sum2 = vmlal_n_s16(sum2, vget_low_s16(high), weights[t]);
+			sum3 = vmlal_n_s16(sum3, vget_high_s16(high), weights[t]);
+		}
+		const int16x8_t low = vcombine_s16(vqmovn_s32(vshrq_n_s32(sum0, RESAMPLE_WEIGHT_BITS)),
+		                                   vqmovn_s32(vshrq_n_s32(sum1, RESAMPLE_WEIGHT_BITS)));
+		const int16x8_t high = vcombine_s16(vqmovn_s32(vshrq_n_s32(sum2, RESAMPLE_WEIGHT_BITS)),
+		                                    vqmovn_s32(vshrq_n_s32(sum3, RESAMPLE_WEIGHT_BITS)));
+		vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+	}
+	resampleVerticalScalar(rows, weights, count, dst, i, length);
+}
+
+#endif /* RESAMPLE_NEON */
+
+static bool resampleBackendSupported(MMResampleBackend backend)
+{
+	switch (backend) {
+	case MMResampleBackendScalar:
+		return true;
+#if defined(RESAMPLE_SSE2)
+	case MMResampleBackendSSE2:
+		return true;
+#endif
+#if defined(RESAMPLE_X86)
+	case MMResampleBackendAVX2:
+		return MMCPUHasAVX2();
+#endif
+#if defined(RESAMPLE_NEON)
+	case MMResampleBackendNEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static MMResampleBackend resampleBestBackend(void)
+{
+	if (resampleBackendSupported(MMResampleBackendAVX2)) return MMResampleBackendAVX2;
+	if (resampleBackendSupported(MMResampleBackendSSE2)) return MMResampleBackendSSE2;
+	if (resampleBackendSupported(MMResampleBackendNEON)) return MMResampleBackendNEON;
+	return MMResampleBackendScalar;
+}
+
+bool setMMResamplerBackend(MMResamplerRef resampler, MMResampleBackend backend)
+{
+	if (resampler == NULL) return false;
+	if (backend == MMResampleBackendAuto) backend = resampleBestBackend();
+	if (!resampleBackendSupported(backend)) return false;
+
+	resampler->backend = backend;
+	resampler->horizontalPass = resampleHorizontalScalar;
+	resampler->verticalPass = resampleVerticalScalar;
+	resampler->boxPass = resampleBoxRow;
+	switch (backend) {
+#if defined(RESAMPLE_SSE2)
+	case MMResampleBackendSSE2:
+		resampler->horizontalPass = resampleHorizontalSSE2;
+		resampler->verticalPass = resampleVerticalSSE2;
+		resampler->boxPass = resampleBoxRowSSE2;
+		break;
+#endif
+#if defined(RESAMPLE_X86)
+	case MMResampleBackendAVX2:
+		resampler->horizontalPass = resampleHorizontalAVX2;
+		resampler->verticalPass = resampleVerticalAVX2;
+#if defined(RESAMPLE_SSE2)
+		resampler->boxPass = resampleBoxRowSSE2;
+		/* The wide horizontal kernel only pays off with four or more taps. */
+		if (resampler->horizontal.maxTaps < 4) {
+			resampler->horizontalPass = resampleHorizontalSSE2;
+		}
+#endif
+		break;
+#endif
+#if defined(RESAMPLE_NEON)
+	case MMResampleBackendNEON:
+		resampler->horizontalPass = resampleHorizontalNEON;
+		resampler->verticalPass = resampleVerticalNEON;
+		break;
+#endif
+	default:
+		break;
+	}
+
+	/* Cached rows stay valid: every backend produces the same bytes. */
+	return true;
+}
+
+MMResampleBackend getMMResamplerBackend(MMResamplerRef resampler)
+{
+	return resampler != NULL ? resampler->backend : MMResampleBackendScalar;
+}
+
+MMResamplerRef createMMResampler(size_t srcWidth, size_t srcHeight,
+                                 size_t dstWidth, size_t dstHeight,
+                                 uint8_t bytesPerPixel, MMResampleFilter filter)
+{
+	if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0 ||
+	    bytesPerPixel == 0 || srcWidth > INT32_MAX || srcHeight > INT32_MAX) {
+		return NULL;
+	}
+
+	MMResamplerRef resampler = calloc(1, sizeof(MMResampler));
+	if (resampler == NULL) return NULL;
+
+	resampler->srcWidth = srcWidth;
+	resampler->srcHeight = srcHeight;
+	resampler->bytesPerPixel = bytesPerPixel;
+	bool ok = buildResampleAxis(&resampler->horizontal, srcWidth, dstWidth, filter) &&
+	          buildResampleAxis(&resampler->vertical, srcHeight, dstHeight, filter);
+
+	if (ok) {
+		/* Enough rows for the widest vertical window. */
+		resampler->rowCacheSize = (size_t)resampler->vertical.maxTaps;
+		resampler->rowCacheBytewidth = dstWidth * bytesPerPixel;
+		resampler->rowCache = malloc(resampler->rowCacheSize * resampler->rowCacheBytewidth);
+		resampler->rowCacheTags = malloc(resampler->rowCacheSize * sizeof(int64_t));
+		resampler->taps = malloc((size_t)resampler->vertical.maxTaps * sizeof(uint8_t *));
+		ok = resampler->rowCache != NULL && resampler->rowCacheTags != NULL &&
+		     resampler->taps != NULL;
+	}
+	if (ok && filter == MMResampleArea) {
+		const size_t factorX = resampleBoxFactor(srcWidth, dstWidth);
+		const size_t factorY = resampleBoxFactor(srcHeight, dstHeight);
+		if (factorX > 0 && factorY > 0 && factorX * factorY > 1) {
+			resampler->boxFactorX = factorX;
+			resampler->boxFactorY = factorY;
+			resampler->boxSums = malloc(srcWidth * bytesPerPixel * sizeof(uint16_t));
+			ok = resampler->boxSums != NULL;
+		}
+	}
+	if (!ok) {
+		destroyMMResampler(resampler);
+		return NULL;
+	}
+
+	setMMResamplerBackend(resampler, MMResampleBackendAuto);
+	return resampler;
+}
+
+void destroyMMResampler(MMResamplerRef resampler)
+{
+	if (resampler == NULL) return;
+
+	freeResampleAxis(&resampler->horizontal);
+	freeResampleAxis(&resampler->vertical);
+	free(resampler->rowCache);
+	free(resampler->rowCacheTags);
+	free(resampler->taps);
+	free(resampler->boxSums);
+	free(resampler);
+}
+
+/* Returns source row `row` resized horizontally. */
+static const uint8_t *resampledSourceRow(MMResamplerRef resampler, const uint8_t *src,
+                                         size_t srcBytewidth, size_t row)
+{
+	const uint8_t *in = src + row * srcBytewidth;
+	if (resampler->horizontal.identity) return in;
+
+	const size_t slot = row % resampler->rowCacheSize;
+	uint8_t *cached = resampler->rowCache + slot * resampler->rowCacheBytewidth;
+	if (resampler->rowCacheTags[slot] != (int64_t)row) {
+		resampler->horizontalPass(&resampler->horizontal, in, cached, resampler->bytesPerPixel);
+		resampler->rowCacheTags[slot] = (int64_t)row;
+	}
+	return cached;
+}
+
+bool resampleMMRows(MMResamplerRef resampler, const uint8_t *src, size_t srcBytewidth,
+                    size_t firstRow, size_t rowCount, uint8_t *dst, size_t dstBytewidth)
+{
+	if (resampler == NULL || src == NULL || dst == NULL ||
+	    firstRow + rowCount > resampler->vertical.size) {
+		return false;
+	}
+
+	if (resampler->boxFactorX > 0) {
+		for (size_t y = firstRow; y < firstRow + rowCount; y++) {
+			resampler->boxPass(src + y * resampler->boxFactorY * srcBytewidth, srcBytewidth,
+			                   resampler->boxFactorX, resampler->boxFactorY,
+			                   resampler->horizontal.size, resampler->bytesPerPixel,
+			                   resampler->boxSums, dst + (y - firstRow) * dstBytewidth);
+		}
+		return true;
+	}
+
+	/* Only a continuation of the previous call on the same frame may reuse
+	 * cached rows; a new frame can arrive in the same buffer. */
+	if (src != resampler->cachedSource || firstRow != resampler->nextRow) {
+		for (size_t i = 0; i < resampler->rowCacheSize; i++) {
+			resampler->rowCacheTags[i] = -1;
+		}
+		resampler->cachedSource = src;
+	}
+
+	const MMResampleAxis *vertical = &resampler->vertical;
+	const size_t length = resampler->horizontal.size * resampler->bytesPerPixel;
+	for (size_t y = firstRow; y < firstRow + rowCount; y++) {
+		const int32_t count = vertical->count[y];
+		const int16_t *weights = vertical->weights + y * (size_t)vertical->maxTaps;
+		uint8_t *out = dst + (y - firstRow) * dstBytewidth;
+
+		for (int32_t t = 0; t < count; t++) {
+			resampler->taps[t] = resampledSourceRow(resampler, src, srcBytewidth,
+			                                        (size_t)vertical->start[y] + (size_t)t);
+		}
+		if (count == 1 && weights[0] == RESAMPLE_WEIGHT_ONE) {
+			memcpy(out, resampler->taps[0], length);
+		} else {
+			resampler->verticalPass(resampler->taps, weights, count, out, 0, length);
+		}
+	}
+
+	resampler->nextRow = firstRow + rowCount;
+	return true;
+}
+
+MMBitmapRef resampleMMBitmap(MMBitmapRef bitmap, size_t width, size_t height,
+                             MMResampleFilter filter)
+{
+	if (bitmap == NULL || bitmap->imageBuffer == NULL) return NULL;
+
+	MMResamplerRef resampler = createMMResampler(bitmap->width, bitmap->height, width, height,
+	                                             bitmap->bytesPerPixel, filter);
+	if (resampler == NULL) return NULL;
+
+	const size_t bytewidth = width * bitmap->bytesPerPixel;
+	uint8_t *buffer = malloc(bytewidth * height);
+	MMBitmapRef resized = NULL;
+	if (buffer != NULL &&
+	    resampleMMRows(resampler, bitmap->imageBuffer, bitmap->bytewidth, 0, height,
+	                   buffer, bytewidth)) {
+		resized = createMMBitmap(buffer, width, height, bytewidth,
+		                         bitmap->bitsPerPixel, bitmap->bytesPerPixel);
+	}
+	if (resized == NULL) free(buffer);
+
+	destroyMMResampler(resampler);
+	return resized;
+}
+
+void calculateResizedDimensions(int64_t originalWidth, int64_t originalHeight,
+                                int32_t maxSmallDim, int32_t maxLargeDim,
+                                int64_t *newWidth, int64_t *newHeight)
+{
+	/* Validate input parameters */
+	if (!newWidth || !newHeight || originalWidth <= 0 || originalHeight <= 0) {
+		if (newWidth) *newWidth = 1;
+		if (newHeight) *newHeight = 1;
+		return;
+	}
+
+	*newWidth = originalWidth;
+	*newHeight = originalHeight;
+
+	/* If no constraints, return original size */
+	if (maxSmallDim <= 0 && maxLargeDim <= 0) {
+		return;
+	}
+
+	int64_t smallDim = (originalWidth < originalHeight) ? originalWidth : originalHeight;
+	int64_t largeDim = (originalWidth > originalHeight) ? originalWidth : originalHeight;
+
+	double scale = 1.0;
+
+	/* Apply small dimension constraint */
+	if (maxSmallDim > 0 && smallDim > maxSmallDim) {
+		scale = (double)maxSmallDim / (double)smallDim;
+	}
+
+	/* Apply large dimension constraint */
+	if (maxLargeDim > 0 && largeDim * scale > maxLargeDim) {
+		scale = (double)maxLargeDim / (double)largeDim;
+	}
+
+	if (scale < 1.0) {
+		*newWidth = (int64_t)(originalWidth * scale);
+		*newHeight = (int64_t)(originalHeight * scale);
+
+		/* Ensure minimum size of 1x1 */
+		if (*newWidth < 1) *newWidth = 1;
+		if (*newHeight < 1) *newHeight = 1;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Image resampler shared by the JPEG encoders. Weights are computed once per
+ * geometry into fixed-point tables, and each frame is resized in two
+ * separable passes: horizontally, one source row at a time, then vertically
+ * across the resized rows. The passes run on SSE2, AVX2 or NEON kernels,
+ * picked for the running CPU, with a scalar version as the reference they
+ * must match bit for bit.
+ *
+ * Area reductions by a whole factor of up to 4 on each axis skip the tables
+ * and average each block exactly.
+ *
+ * Rows can be produced a band at a time, so a caller streaming into an
+ * encoder never needs a full-size intermediate image.
+ *
+ * A resampler is not thread-safe; give each thread its own. */
+
+typedef enum {
+	MMResampleBilinear = 0,  /* Two taps per axis; fast, aliases when shrinking a lot. */
+	MMResampleArea = 1,      /* Averages every source pixel an output pixel covers. */
+	MMResampleLanczos3 = 2   /* Sharpest; three lobes, stretched when shrinking. */
+} MMResampleFilter;
+
+typedef enum {
+	MMResampleBackendAuto = 0,  /* Fastest one this CPU supports. */
+	MMResampleBackendScalar,
+	MMResampleBackendSSE2,
+	MMResampleBackendAVX2,
+	MMResampleBackendNEON
+} MMResampleBackend;
+
+typedef struct _MMResampler MMResampler;
+typedef MMResampler *MMResamplerRef;
+
+/* Creates a resampler from `srcWidth` x `srcHeight` to `dstWidth` x
+ * `dstHeight` for pixels of `bytesPerPixel` bytes, every channel of which is
+ * filtered alike. Follows the Create Rule (caller is responsible for
+ * destroy()'ing object). Returns NULL on error. */
+MMResamplerRef createMMResampler(size_t srcWidth, size_t srcHeight,
+                                 size_t dstWidth, size_t dstHeight,
+                                 uint8_t bytesPerPixel, MMResampleFilter filter);
+
+void destroyMMResampler(MMResamplerRef resampler);
+
+/* Forces a kernel set, mostly for comparing them. Returns false, leaving the
+ * resampler unchanged, if this build or CPU doesn't support `backend`. */
+bool setMMResamplerBackend(MMResamplerRef resampler, MMResampleBackend backend);
+
+MMResampleBackend getMMResamplerBackend(MMResamplerRef resampler);
+
+/* Writes destination rows [firstRow, firstRow + rowCount) of the resized
+ * `src` to `dst`. Horizontally resized source rows are kept between calls
+ * that continue where the last one stopped on the same `src`, so a frame
+ * requested band by band in order is resized exactly once. Returns false if
+ * the rows are out of range. */
+bool resampleMMRows(MMResamplerRef resampler, const uint8_t *src, size_t srcBytewidth,
+                    size_t firstRow, size_t rowCount, uint8_t *dst, size_t dstBytewidth);
+
+/* Returns a resized copy of `bitmap` with tightly packed rows, or NULL on
+ * error. Follows the Create Rule. */
+MMBitmapRef resampleMMBitmap(MMBitmapRef bitmap, size_t width, size_t height,
+                             MMResampleFilter filter);
+
+/* Scales `originalWidth` x `originalHeight` down, keeping the aspect ratio,
+ * until the smaller side fits `maxSmallDim` and the larger one `maxLargeDim`
+ * (either <= 0 for no limit). Never scales up. */
+void calculateResizedDimensions(int64_t originalWidth, int64_t originalHeight,
+                                int32_t maxSmallDim, int32_t maxLargeDim,
+                                int64_t *newWidth, int64_t *newHeight);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESAMPLE_H */
@@ -18,6 +18,17 @@ extern "C"
 /* Returns the size of the main display. */
 MMSize getMainDisplaySize(void);
 
+/* A physical monitor, in the coordinates used for capture. */
+typedef struct _MMMonitor {
+	MMRect bounds;
+	bool primary;
+} MMMonitor;
+
+/* Writes up to `maxMonitors` monitors to `monitors`, the primary one first,
+ * and returns how many there are in total (which may exceed `maxMonitors`).
+ * Returns -1 on error. */
+int32_t getMonitors(MMMonitor *monitors, int32_t maxMonitors);
+
 /* Convenience function that returns whether the given point is in the bounds
  * of the main screen. */
 bool pointVisibleOnMainDisplay(MMPoint point);
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SCREENDAMAGE_H
+#define SCREENDAMAGE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Screen damage tracking. A background thread with its own display
+ * connection listens for damage notifications and records the damaged
+ * rectangles, tagging each batch with an increasing frame sequence number.
+ *
+ * Only implemented on X11 (XDamage); elsewhere startDamageTracking() returns
+ * false and callers should fall back to comparing captures. */
+
+/* Starts the tracker if it isn't running. Returns whether tracking is
+ * active. Sequence numbers keep increasing across a stop and restart; any
+ * sequence from before the restart gets the whole screen as damage. */
+bool startDamageTracking(void);
+
+/* Stops the tracker and forgets all recorded damage. */
+void stopDamageTracking(void);
+
+/* Returns the current frame sequence number, or -1 if not tracking. */
+int64_t getDamageSequence(void);
+
+/* Writes the damage recorded after `sinceSequence`, merged into at most
+ * `maxRects` rectangles, to `rects` and returns how many were written. If the
+ * history no longer reaches back that far, the whole screen is reported.
+ * With no output buffer (`maxRects` 0) nothing is written and 1 is returned
+ * if anything changed. `outSequence` (optional) receives the sequence the
+ * result is current to. Returns -1 if not tracking. */
+int32_t copyDamageSince(int64_t sinceSequence, MMRect *rects, int32_t maxRects,
+                        int64_t *outSequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCREENDAMAGE_H */
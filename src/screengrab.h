@@ -4,6 +4,7 @@
 
 #include "types.h"
 #include "MMBitmap.h"
+#include <stdbool.h>
 
 #if defined(USE_X11)
 #include "xdisplay.h"
@@ -18,6 +19,13 @@ extern "C"
  * caller), or NULL on error. */
 MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect);
 
+/* Grabs `rect` into the existing buffer of `bitmap`, which holds `capacity`
+ * bytes, and updates the bitmap's geometry. Returns false without touching
+ * the bitmap if the grab fails, the pixels don't fit or the backend can't
+ * grab into a caller's buffer; copyMMBitmapFromDisplayInRect() is the
+ * fallback. */
+bool copyMMBitmapFromDisplayInRectInto(MMRect rect, MMBitmapRef bitmap, size_t capacity);
+
 #ifdef __cplusplus
 }
 #endif
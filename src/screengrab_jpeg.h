@@ -0,0 +1,68 @@
+#pragma once
+#ifndef SCREENGRAB_JPEG_H
+#define SCREENGRAB_JPEG_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Encodes `bitmap` as JPEG, first scaling it down with `filter` (an
+ * MMResampleFilter) to fit `maxSmallDim` and `maxLargeDim` (-1 for no
+ * limit). Returns the encoded bytes (to be free()'d by the caller) and their
+ * length in `outSize`, or NULL on error.
+ *
+ * Implemented by each platform's screengrab_jpeg; macOS encodes through
+ * ScreenCaptureKit instead and always returns NULL here. */
+uint8_t *encodeMMBitmapJpeg(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                            int32_t quality, int32_t filter, int64_t *outSize);
+
+/* Encoder state kept from one encode to the next, so a steady stream of
+ * similar frames stops allocating: on Linux the libjpeg compressor and its
+ * tables, the resize buffers and an output buffer that only grows. Not for
+ * use from several threads at once. */
+typedef struct _MMJpegEncoder MMJpegEncoder;
+typedef MMJpegEncoder *MMJpegEncoderRef;
+
+/* Follows the Create Rule (caller is responsible for destroy()'ing object).
+ * Returns NULL on error, and always on macOS. */
+MMJpegEncoderRef createMMJpegEncoder(void);
+
+void destroyMMJpegEncoder(MMJpegEncoderRef encoder);
+
+/* Same as encodeMMBitmapJpeg(), but with `encoder`'s state. The JPEG is
+ * written into `buffer` if it fits in `capacity` bytes (`buffer` may be
+ * NULL), and otherwise into memory that belongs to `encoder` and stays valid
+ * until its next encode or its destruction. Returns wherever the JPEG ended
+ * up, or NULL on error. */
+const uint8_t *encodeMMBitmapJpegWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t quality, int32_t filter,
+                                      uint8_t *buffer, size_t capacity, int64_t *outSize);
+
+/* Encodes `bitmap`, scaled as in encodeMMBitmapJpeg(), at the highest
+ * quality whose JPEG fits in `maxBytes` (see jpegbudget.h), and writes that
+ * quality to `outQuality`. The frame is resized once and only re-encoded.
+ * Returns NULL, with quality -1, on error or if nothing fits.
+ *
+ * The one-off variant learns from every earlier one-off call and returns
+ * bytes to be free()'d by the caller; the other learns from `encoder`'s
+ * earlier calls and returns bytes that belong to it, as with
+ * encodeMMBitmapJpegWith(). Both return NULL on macOS. */
+uint8_t *encodeMMBitmapJpegBudget(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                                  int64_t maxBytes, int32_t filter,
+                                  int32_t *outQuality, int64_t *outSize);
+const uint8_t *encodeMMBitmapJpegBudgetWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int64_t maxBytes, int32_t filter,
+                                            int32_t *outQuality, int64_t *outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCREENGRAB_JPEG_H */
@@ -0,0 +1,133 @@
+#include "screenwait.h"
+#include "os.h"
+#include "framediff.h"
+#include "screengrab.h"
+#include "microsleep.h"
+#include "monotonic.h"
+#include "rectmerge.h"
+#include <stdbool.h>
+#if defined(USE_X11)
+	#include "screendamage.h"
+#endif
+
+/* How often to look again. Damage checks are nearly free; captures are not,
+ * so they back off further for long quiet periods. */
+#define DAMAGE_POLL_MIN_MS 2.0
+#define CAPTURE_POLL_MIN_MS 10.0
+#define POLL_MAX_MS 50.0
+
+static double pollInterval(int64_t quietMs, double minimum)
+{
+	double interval = (double)quietMs / 4.0;
+	if (interval < minimum) interval = minimum;
+	if (interval > POLL_MAX_MS) interval = POLL_MAX_MS;
+	return interval;
+}
+
+#if defined(USE_X11)
+
+/* Returns 1 if damage recorded after `*sequence` touches `region` and
+ * advances `*sequence`, 0 if not, -1 if tracking stopped. */
+static int regionDamagedSince(MMRect region, int64_t *sequence)
+{
+	MMRect rects[64];
+	int64_t current;
+	const int32_t count = copyDamageSince(*sequence, rects, 64, &current);
+	if (count < 0) return -1;
+
+	*sequence = current;
+	for (int32_t i = 0; i < count; i++) {
+		if (MMRectsIntersect(rects[i], region)) return 1;
+	}
+	return 0;
+}
+
+/* Damage-driven wait. Returns -2 if tracking isn't running (or stops), so
+ * the caller can fall back to captures. */
+static int32_t waitWithDamage(MMRect region, int64_t quietMs, int64_t timeoutMs,
+                              double start)
+{
+	int64_t sequence = getDamageSequence();
+	if (sequence < 0) return -2;
+
+	const double interval = pollInterval(quietMs, DAMAGE_POLL_MIN_MS);
+	double lastChange = start;
+	for (;;) {
+		const int damaged = regionDamagedSince(region, &sequence);
+		const double now = monotonicMilliseconds();
+		if (damaged < 0) return -2;
+		if (damaged) lastChange = now;
+
+		if (now - lastChange >= (double)quietMs) return 1;
+		if (now - start >= (double)timeoutMs) return 0;
+		microsleep(interval);
+	}
+}
+
+#endif /* USE_X11 */
+
+/* Capture-driven wait, comparing successive grabs tile by tile. */
+static int32_t waitWithCaptures(MMRect region, int64_t quietMs, int64_t timeoutMs,
+                                double start)
+{
+	MMFrameDifferRef differ = createMMFrameDiffer(0);
+	if (differ == NULL) return -1;
+
+	const double interval = pollInterval(quietMs, CAPTURE_POLL_MIN_MS);
+	double lastChange = start;
+	bool first = true;
+	int32_t result;
+	for (;;) {
+		MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(region);
+		if (bitmap == NULL) {
+			result = -1;
+			break;
+		}
+		const int32_t changed = diffMMFrame(differ, bitmap, NULL, 0, NULL);
+		destroyMMBitmap(bitmap);
+		if (changed < 0) {
+			result = -1;
+			break;
+		}
+
+		/* The first grab only sets the baseline. */
+		const double now = monotonicMilliseconds();
+		if (changed > 0 && !first) lastChange = now;
+		first = false;
+
+		if (now - lastChange >= (double)quietMs) {
+			result = 1;
+			break;
+		}
+		if (now - start >= (double)timeoutMs) {
+			result = 0;
+			break;
+		}
+		microsleep(interval);
+	}
+
+	destroyMMFrameDiffer(differ);
+	return result;
+}
+
+int32_t waitForStableRegion(MMRect region, int64_t quietMs, int64_t timeoutMs,
+                            int64_t *outElapsedMs)
+{
+	const double start = monotonicMilliseconds();
+	int32_t result = -2;
+
+	if (quietMs < 0) quietMs = 0;
+	if (timeoutMs < 0) timeoutMs = 0;
+
+#if defined(USE_X11)
+	result = waitWithDamage(region, quietMs, timeoutMs, start);
+#endif
+	if (result == -2) {
+		result = waitWithCaptures(region, quietMs, timeoutMs, start);
+	}
+
+	if (outElapsedMs != NULL) {
+		*outElapsedMs = (int64_t)(monotonicMilliseconds() - start);
+	}
+	return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef SCREENWAIT_H
+#define SCREENWAIT_H
+
+#include "types.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Blocks until nothing in `region` has changed for `quietMs` milliseconds,
+ * or until `timeoutMs` have passed. The region counts as just changed when
+ * the wait starts.
+ *
+ * Uses damage tracking when it is running (see screendamage.h), which costs
+ * no captures; otherwise the region is captured repeatedly and compared tile
+ * by tile.
+ *
+ * Returns 1 once the region is stable, 0 on timeout and -1 if the region
+ * can't be captured. `outElapsedMs` (optional) receives the time spent
+ * waiting. */
+int32_t waitForStableRegion(MMRect region, int64_t quietMs, int64_t timeoutMs,
+                            int64_t *outElapsedMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCREENWAIT_H */
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef WEBPENCODE_H
+#define WEBPENCODE_H
+
+#include "types.h"
+#include "MMBitmap.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* WebP encoding through libwebp, which is optional: it is only used when the
+ * build finds it (HAVE_WEBP), and otherwise every encode returns NULL. Lossy
+ * WebP keeps text legible at a fraction of a JPEG's size; lossless WebP is
+ * usually smaller than PNG, at a much higher encode cost. Alpha is dropped. */
+
+/* Returns whether this build can encode WebP. */
+bool MMWebpAvailable(void);
+
+/* Encodes `bitmap` as WebP, first scaling it down with `filter` (an
+ * MMResampleFilter) to fit `maxSmallDim` and `maxLargeDim` (-1 for no
+ * limit). For lossy output `quality` (0-100) trades size for fidelity as
+ * with JPEG; for lossless output it is the compression effort, 0 fastest and
+ * 100 smallest. A negative `quality` means 85, the JPEG default. Returns the encoded bytes (to be free()'d by the caller) and
+ * their length in `outSize`, or NULL on error or without libwebp. */
+uint8_t *encodeMMBitmapWebp(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                            int32_t quality, bool lossless, int32_t filter, int64_t *outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEBPENCODE_H */
@@ -8,6 +8,47 @@ MMSize getMainDisplaySize(void)
 	                  (size_t)GetSystemMetrics(SM_CYSCREEN));
 }
 
+typedef struct {
+	MMMonitor *monitors;
+	int32_t maxMonitors;
+	int32_t count;
+} MonitorEnumState;
+
+static BOOL CALLBACK enumMonitor(HMONITOR monitor, HDC hdc, LPRECT rect, LPARAM data)
+{
+	MonitorEnumState *state = (MonitorEnumState *)data;
+	MONITORINFO info;
+	(void)hdc;
+	(void)rect;
+
+	info.cbSize = sizeof(info);
+	if (!GetMonitorInfo(monitor, &info)) return TRUE;
+
+	if (state->monitors != NULL && state->count < state->maxMonitors) {
+		MMMonitor *entry = &state->monitors[state->count];
+		entry->bounds = MMRectMake(info.rcMonitor.left, info.rcMonitor.top,
+		                           info.rcMonitor.right - info.rcMonitor.left,
+		                           info.rcMonitor.bottom - info.rcMonitor.top);
+		entry->primary = (info.dwFlags & MONITORINFOF_PRIMARY) != 0;
+
+		/* Keep the primary monitor first. */
+		if (entry->primary && state->count > 0) {
+			MMMonitor first = state->monitors[0];
+			state->monitors[0] = *entry;
+			*entry = first;
+		}
+	}
+	state->count++;
+	return TRUE;
+}
+
+int32_t getMonitors(MMMonitor *monitors, int32_t maxMonitors)
+{
+	MonitorEnumState state = {monitors, maxMonitors, 0};
+	if (!EnumDisplayMonitors(NULL, NULL, enumMonitor, (LPARAM)&state)) return -1;
+	return state.count;
+}
+
 bool pointVisibleOnMainDisplay(MMPoint point)
 {
 	MMSize displaySize = getMainDisplaySize();
@@ -31,17 +31,16 @@ MMRect getScaledRect(MMRect input)
 	);
 }
 
-MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
+/* Blits `scaledRect` off the screen into a new 32-bit DIB section, whose
+ * pixels are returned through `data`. The caller DeleteObject()s the result.
+ * Returns NULL on error. */
+static HBITMAP grabScreenDIB(MMRect scaledRect, void **data)
 {
-	MMBitmapRef bitmap;
-	void *data;
 	HDC screen = NULL, screenMem = NULL;
 	HBITMAP dib;
 	BITMAPINFO bi;
 
 	screen = GetWindowDC(NULL); /* Get entire screen */
-	MMRect scaledRect = getScaledRect(rect);
-
 	if (screen == NULL) {
 		return NULL;
 	}
@@ -60,10 +59,11 @@ MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
 	bi.bmiHeader.biClrImportant = 0;
 
 	/* Get screen data in display device context. */
-	dib = CreateDIBSection(screen, &bi, DIB_RGB_COLORS, &data, NULL, 0);
+	dib = CreateDIBSection(screen, &bi, DIB_RGB_COLORS, data, NULL, 0);
 
 	/* Copy the data into a bitmap struct. */
-	if ((screenMem = CreateCompatibleDC(screen)) == NULL ||
+	if (dib == NULL ||
+	    (screenMem = CreateCompatibleDC(screen)) == NULL ||
 	    SelectObject(screenMem, dib) == NULL ||
 	    !BitBlt(screenMem,
 		    (int)0,
@@ -78,7 +78,9 @@ MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
 
 		/* Error copying data. */
 		ReleaseDC(NULL, screen);
-		DeleteObject(dib);
+		if (dib != NULL) {
+			DeleteObject(dib);
+		}
 		if (screenMem != NULL) {
 			DeleteDC(screenMem);
 		}
@@ -86,23 +88,71 @@ MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
 		return NULL;
 	}
 
+	ReleaseDC(NULL, screen);
+	DeleteDC(screenMem);
+	GdiFlush();
+
+	return dib;
+}
+
+MMBitmapRef copyMMBitmapFromDisplayInRect(MMRect rect)
+{
+	MMBitmapRef bitmap;
+	void *data;
+	MMRect scaledRect = getScaledRect(rect);
+	HBITMAP dib = grabScreenDIB(scaledRect, &data);
+
+	if (dib == NULL) {
+		return NULL;
+	}
+
 	bitmap = createMMBitmap(NULL,
 				scaledRect.size.width,
 				scaledRect.size.height,
 				4 * scaledRect.size.width,
-				(uint8_t)bi.bmiHeader.biBitCount,
+				32,
 				4);
 
 	/* Copy the data to our pixel buffer. */
 	if (bitmap != NULL)
 	{
 		bitmap->imageBuffer = malloc(bitmap->bytewidth * bitmap->height);
-		memcpy(bitmap->imageBuffer, data, bitmap->bytewidth * bitmap->height);
+		if (bitmap->imageBuffer == NULL) {
+			destroyMMBitmap(bitmap);
+			bitmap = NULL;
+		} else {
+			memcpy(bitmap->imageBuffer, data, bitmap->bytewidth * bitmap->height);
+		}
 	}
 
-	ReleaseDC(NULL, screen);
 	DeleteObject(dib);
-	DeleteDC(screenMem);
 
 	return bitmap;
 }
+
+bool copyMMBitmapFromDisplayInRectInto(MMRect rect, MMBitmapRef bitmap, size_t capacity)
+{
+	void *data;
+	MMRect scaledRect = getScaledRect(rect);
+	const size_t bytewidth = 4 * (size_t)scaledRect.size.width;
+	const size_t size = bytewidth * (size_t)scaledRect.size.height;
+
+	if (bitmap == NULL || bitmap->imageBuffer == NULL || size > capacity) {
+		return false;
+	}
+
+	HBITMAP dib = grabScreenDIB(scaledRect, &data);
+	if (dib == NULL) {
+		return false;
+	}
+
+	memcpy(bitmap->imageBuffer, data, size);
+	bitmap->width = (size_t)scaledRect.size.width;
+	bitmap->height = (size_t)scaledRect.size.height;
+	bitmap->bytewidth = bytewidth;
+	bitmap->bitsPerPixel = 32;
+	bitmap->bytesPerPixel = 4;
+
+	DeleteObject(dib);
+	return true;
+}
@@ -1,11 +1,15 @@
 #include "../screengrab.h"
+#include "../screengrab_jpeg.h"
 #include "../screen.h"
 #include "../MMBitmap.h"
+#include "../resample.h"
+#include "../jpegbudget.h"
 #include <windows.h>
 #include <wincodec.h>
 #include <objbase.h>
 #include <propvarutil.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <windows.h>
 #include <wincodec.h>
@@ -22,9 +26,14 @@ DEFINE_GUID(GUID_WICPixelFormat32bppBGRA, 0x6fddc324, 0x4e03, 0x4bfe, 0xb1, 0x85
 DEFINE_GUID(GUID_WICPixelFormat24bppBGR, 0x6fddc324, 0x4e03, 0x4bfe, 0xb1, 0x85, 0x3d, 0x77, 0x76, 0x8d, 0xc9, 0x0c);
 #endif
 
-// COM initialization helper
+// COM initialization helper. COM is initialized per thread, and encoding
+// may run on worker threads, so the flag is thread-local.
 static HRESULT initializeCOM() {
-    static int initialized = 0;
+#if defined(_MSC_VER)
+    static __declspec(thread) int initialized = 0;
+#else
+    static __thread int initialized = 0;
+#endif
     if (!initialized) {
         HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
         if (SUCCEEDED(hr) || hr == RPC_E_CHANGED_MODE) {
@@ -36,54 +45,10 @@ static HRESULT initializeCOM() {
     return S_OK;
 }
 
-// Calculate new dimensions based on constraints
-static void calculateResizedDimensions(int64_t originalWidth, int64_t originalHeight,
-                                     int32_t maxSmallDim, int32_t maxLargeDim,
-                                     int64_t* newWidth, int64_t* newHeight) {
-    // Validate input parameters
-    if (!newWidth || !newHeight || originalWidth <= 0 || originalHeight <= 0) {
-        if (newWidth) *newWidth = 1;
-        if (newHeight) *newHeight = 1;
-        return;
-    }
-    
-    *newWidth = originalWidth;
-    *newHeight = originalHeight;
-    
-    // If no constraints, return original size
-    if (maxSmallDim <= 0 && maxLargeDim <= 0) {
-        return;
-    }
-    
-    int64_t smallDim = (originalWidth < originalHeight) ? originalWidth : originalHeight;
-    int64_t largeDim = (originalWidth > originalHeight) ? originalWidth : originalHeight;
-    
-    double scale = 1.0;
-    
-    // Apply small dimension constraint
-    if (maxSmallDim > 0 && smallDim > maxSmallDim) {
-        scale = (double)maxSmallDim / (double)smallDim;
-    }
-    
-    // Apply large dimension constraint
-    if (maxLargeDim > 0 && largeDim * scale > maxLargeDim) {
-        scale = (double)maxLargeDim / (double)largeDim;
-    }
-    
-    if (scale < 1.0) {
-        *newWidth = (int64_t)(originalWidth * scale);
-        *newHeight = (int64_t)(originalHeight * scale);
-        
-        // Ensure minimum size of 1x1
-        if (*newWidth < 1) *newWidth = 1;
-        if (*newHeight < 1) *newHeight = 1;
-    }
-}
-
 // Convert MMBitmap to JPEG using Windows Imaging Component
 static uint8_t* convertBitmapToJpeg(MMBitmapRef bitmap, int32_t quality, 
                                    int64_t resizeWidth, int64_t resizeHeight,
-                                   int64_t* outSize) {
+                                   MMResampleFilter filter, int64_t* outSize) {
     if (!bitmap || !outSize) {
         return NULL;
     }
@@ -97,7 +62,7 @@ static uint8_t* convertBitmapToJpeg(MMBitmapRef bitmap, int32_t quality,
     
     IWICImagingFactory* factory = NULL;
     IWICBitmap* wicBitmap = NULL;
-    IWICBitmapScaler* scaler = NULL;
+    MMBitmapRef resized = NULL;
     IWICStream* stream = NULL;
     IWICBitmapEncoder* encoder = NULL;
     IWICBitmapFrameEncode* frameEncode = NULL;
@@ -111,14 +76,24 @@ static uint8_t* convertBitmapToJpeg(MMBitmapRef bitmap, int32_t quality,
         goto cleanup;
     }
     
+    // Resize with the shared resampler, the same as on Linux
+    MMBitmapRef source = bitmap;
+    if (resizeWidth != bitmap->width || resizeHeight != bitmap->height) {
+        resized = resampleMMBitmap(bitmap, (size_t)resizeWidth, (size_t)resizeHeight, filter);
+        if (!resized) {
+            goto cleanup;
+        }
+        source = resized;
+    }
+    
     // Create WIC bitmap from our bitmap data
     // Note: MMBitmap uses BGRA format (32-bit) on Windows
     hr = IWICImagingFactory_CreateBitmapFromMemory(factory,
-        (UINT)bitmap->width, (UINT)bitmap->height,
+        (UINT)source->width, (UINT)source->height,
         &GUID_WICPixelFormat32bppBGRA,
-        (UINT)bitmap->bytewidth,
-        (UINT)(bitmap->bytewidth * bitmap->height),
-        bitmap->imageBuffer,
+        (UINT)source->bytewidth,
+        (UINT)(source->bytewidth * source->height),
+        source->imageBuffer,
         &wicBitmap);
     if (FAILED(hr)) {
         goto cleanup;
@@ -126,23 +101,6 @@ static uint8_t* convertBitmapToJpeg(MMBitmapRef bitmap, int32_t quality,
     
     IWICBitmapSource* bitmapSource = (IWICBitmapSource*)wicBitmap;
     
-    // If resizing is needed, create a scaler
-    if (resizeWidth != bitmap->width || resizeHeight != bitmap->height) {
-        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
-        if (FAILED(hr)) {
-            goto cleanup;
-        }
-        
-        hr = IWICBitmapScaler_Initialize(scaler, bitmapSource,
-            (UINT)resizeWidth, (UINT)resizeHeight,
-            WICBitmapInterpolationModeLinear);
-        if (FAILED(hr)) {
-            goto cleanup;
-        }
-        
-        bitmapSource = (IWICBitmapSource*)scaler;
-    }
-    
     // Create memory stream for in-memory JPEG encoding
     IStream* memoryStream = NULL;
     hr = CreateStreamOnHGlobal(NULL, TRUE, &memoryStream);
@@ -280,18 +238,183 @@ cleanup:
     if (frameEncode) IWICBitmapFrameEncode_Release(frameEncode);
     if (encoder) IWICBitmapEncoder_Release(encoder);
     if (stream) IWICStream_Release(stream);
-    if (scaler) IWICBitmapScaler_Release(scaler);
     if (wicBitmap) IWICBitmap_Release(wicBitmap);
     if (factory) IWICImagingFactory_Release(factory);
+    if (resized) destroyMMBitmap(resized);
 
     
     return result;
 }
 
+uint8_t* encodeMMBitmapJpeg(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                            int32_t quality, int32_t filter, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    if (!bitmap) {
+        return NULL;
+    }
+
+    // Calculate resize dimensions
+    int64_t newWidth, newHeight;
+    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim, 
+                              &newWidth, &newHeight);
+    
+    return convertBitmapToJpeg(bitmap, quality, newWidth, newHeight,
+                               (MMResampleFilter)filter, outSize);
+}
+
+// WIC builds its encoder per image, so all an encoder keeps here is the last
+// JPEG, which saves the caller taking ownership of it, and what byte-budget
+// encodes need from one frame to the next
+struct _MMJpegEncoder {
+    uint8_t* jpeg;
+    MMJpegQualityModel model;
+    MMJpegBudgetResult budget;
+};
+
+MMJpegEncoderRef createMMJpegEncoder(void) {
+    return (MMJpegEncoderRef)calloc(1, sizeof(MMJpegEncoder));
+}
+
+void destroyMMJpegEncoder(MMJpegEncoderRef encoder) {
+    if (!encoder) {
+        return;
+    }
+    free(encoder->jpeg);
+    free(encoder->budget.data);
+    free(encoder);
+}
+
+const uint8_t* encodeMMBitmapJpegWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                      int32_t maxSmallDim, int32_t maxLargeDim,
+                                      int32_t quality, int32_t filter,
+                                      uint8_t* buffer, size_t capacity, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    if (!encoder) {
+        return NULL;
+    }
+    free(encoder->jpeg);
+    int64_t size = 0;
+    encoder->jpeg = encodeMMBitmapJpeg(bitmap, maxSmallDim, maxLargeDim, quality, filter, &size);
+    if (!encoder->jpeg) {
+        return NULL;
+    }
+    if (outSize) *outSize = size;
+    if (buffer && (size_t)size <= capacity) {
+        memcpy(buffer, encoder->jpeg, (size_t)size);
+        return buffer;
+    }
+    return encoder->jpeg;
+}
+
+// Byte-budget encoding (see jpegbudget.h). The frame is resized once, and
+// every pass encodes those pixels as they are.
+
+// Quality model for one-off budget encodes, shared by all of them
+static SRWLOCK jpegModelLock = SRWLOCK_INIT;
+static MMJpegQualityModel jpegModel;
+
+typedef struct {
+    MMJpegEncoderRef encoder;
+    MMBitmapRef frame;
+} JpegBudgetPass;
+
+static const uint8_t* encodeJpegBudgetPass(void* context, int32_t quality, int64_t* outSize) {
+    JpegBudgetPass* pass = (JpegBudgetPass*)context;
+    free(pass->encoder->jpeg);
+    pass->encoder->jpeg = convertBitmapToJpeg(pass->frame, quality,
+                                              (int64_t)pass->frame->width,
+                                              (int64_t)pass->frame->height,
+                                              MMResampleBilinear, outSize);
+    return pass->encoder->jpeg;
+}
+
+static MMJpegBudgetResult* encodeBitmapJpegBudget(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                                  int32_t maxSmallDim, int32_t maxLargeDim,
+                                                  int64_t maxBytes, int32_t filter,
+                                                  int32_t* outQuality) {
+    if (outQuality) *outQuality = -1;
+    if (!encoder || !bitmap || !bitmap->imageBuffer) {
+        return NULL;
+    }
+
+    int64_t newWidth, newHeight;
+    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim,
+                              &newWidth, &newHeight);
+    MMBitmapRef resized = NULL;
+    JpegBudgetPass pass;
+    pass.encoder = encoder;
+    pass.frame = bitmap;
+    if (newWidth != (int64_t)bitmap->width || newHeight != (int64_t)bitmap->height) {
+        resized = resampleMMBitmap(bitmap, (size_t)newWidth, (size_t)newHeight,
+                                   (MMResampleFilter)filter);
+        if (!resized) {
+            return NULL;
+        }
+        pass.frame = resized;
+    }
+
+    const int32_t quality = searchMMJpegBudget(&encoder->model,
+                                               pass.frame->width * pass.frame->height,
+                                               maxBytes, encodeJpegBudgetPass, &pass,
+                                               &encoder->budget);
+    if (resized) destroyMMBitmap(resized);
+    if (outQuality) *outQuality = quality;
+    return quality >= 0 ? &encoder->budget : NULL;
+}
+
+const uint8_t* encodeMMBitmapJpegBudgetWith(MMJpegEncoderRef encoder, MMBitmapRef bitmap,
+                                            int32_t maxSmallDim, int32_t maxLargeDim,
+                                            int64_t maxBytes, int32_t filter,
+                                            int32_t* outQuality, int64_t* outSize) {
+    if (outSize) *outSize = 0;
+    MMJpegBudgetResult* result = encodeBitmapJpegBudget(encoder, bitmap, maxSmallDim,
+                                                        maxLargeDim, maxBytes, filter,
+                                                        outQuality);
+    if (!result) {
+        return NULL;
+    }
+    if (outSize) *outSize = result->size;
+    return result->data;
+}
+
+uint8_t* encodeMMBitmapJpegBudget(MMBitmapRef bitmap, int32_t maxSmallDim, int32_t maxLargeDim,
+                                  int64_t maxBytes, int32_t filter,
+                                  int32_t* outQuality, int64_t* outSize) {
+    if (outQuality) *outQuality = -1;
+    if (outSize) *outSize = 0;
+    MMJpegEncoderRef encoder = createMMJpegEncoder();
+    if (!encoder) {
+        return NULL;
+    }
+
+    AcquireSRWLockExclusive(&jpegModelLock);
+    encoder->model = jpegModel;
+    ReleaseSRWLockExclusive(&jpegModelLock);
+
+    MMJpegBudgetResult* result = encodeBitmapJpegBudget(encoder, bitmap, maxSmallDim,
+                                                        maxLargeDim, maxBytes, filter,
+                                                        outQuality);
+
+    AcquireSRWLockExclusive(&jpegModelLock);
+    jpegModel = encoder->model;
+    ReleaseSRWLockExclusive(&jpegModelLock);
+
+    // Hand the best pass's buffer to the caller
+    uint8_t* jpeg = NULL;
+    if (result) {
+        jpeg = result->data;
+        if (outSize) *outSize = result->size;
+        result->data = NULL;
+        result->capacity = 0;
+    }
+    destroyMMJpegEncoder(encoder);
+    return jpeg;
+}
+
 // Windows implementation for region JPEG capture
 uint8_t* copyBitmapRegionJpeg_WIN32(int64_t x, int64_t y, int64_t width, int64_t height, 
                                     int32_t maxSmallDim, int32_t maxLargeDim, 
-                                    int32_t quality, int64_t* outSize) {
+                                    int32_t quality, int32_t filter, int64_t* outSize) {
     if (outSize) *outSize = 0;
     // Capture the region as bitmap first
     MMBitmapRef bitmap = copyMMBitmapFromDisplayInRect(MMRectMake(x, y, width, height));
@@ -299,13 +422,8 @@ uint8_t* copyBitmapRegionJpeg_WIN32(int64_t x, int64_t y, int64_t width, int64_t
         return NULL;
     }
     
-    // Calculate resize dimensions
-    int64_t newWidth, newHeight;
-    calculateResizedDimensions(bitmap->width, bitmap->height, maxSmallDim, maxLargeDim, 
-                              &newWidth, &newHeight);
-    
     // Convert to JPEG
-    uint8_t* result = convertBitmapToJpeg(bitmap, quality, newWidth, newHeight, outSize);
+    uint8_t* result = encodeMMBitmapJpeg(bitmap, maxSmallDim, maxLargeDim, quality, filter, outSize);
     
     // Clean up bitmap
     destroyMMBitmap(bitmap);
@@ -315,7 +433,7 @@ uint8_t* copyBitmapRegionJpeg_WIN32(int64_t x, int64_t y, int64_t width, int64_t
 
 // Windows implementation for full screen JPEG capture
 uint8_t* copyBitmapFullJpeg_WIN32(int32_t maxSmallDim, int32_t maxLargeDim, 
-                                  int32_t quality, int64_t* outSize) {
+                                  int32_t quality, int32_t filter, int64_t* outSize) {
     if (outSize) *outSize = 0;
 
     // Get screen size
@@ -323,7 +441,7 @@ uint8_t* copyBitmapFullJpeg_WIN32(int32_t maxSmallDim, int32_t maxLargeDim,
     
     // Use region capture for full screen
     return copyBitmapRegionJpeg_WIN32(0, 0, screenSize.width, screenSize.height,
-                                     maxSmallDim, maxLargeDim, quality, outSize);
+                                     maxSmallDim, maxLargeDim, quality, filter, outSize);
 }
 
 // Free JPEG data allocated by Windows implementation
@@ -0,0 +1,126 @@
+#include "workpool.h"
+#include "mmthread.h"
+#include <stdlib.h>
+
+struct _MMWorkPool {
+	MMThread *helpers;
+	size_t helperCount;
+
+	MMMutex runLock;       /* Held for the whole of a batch. */
+	MMMutex lock;          /* Guards everything below. */
+	MMCond wake;           /* A batch started, or the pool is stopping. */
+	MMCond finished;       /* The last job of a batch finished. */
+	bool stopping;
+
+	MMWorkFunc func;
+	void *context;
+	size_t jobCount;
+	size_t nextJob;
+	size_t doneJobs;
+};
+
+/* Takes and runs jobs until none are left. Called with `lock` held, and
+ * returns with it held. */
+static void runWorkPoolJobs(MMWorkPoolRef pool)
+{
+	while (pool->nextJob < pool->jobCount) {
+		const size_t index = pool->nextJob++;
+		MMMutexUnlock(&pool->lock);
+		pool->func(pool->context, index);
+		MMMutexLock(&pool->lock);
+		if (++pool->doneJobs == pool->jobCount) MMCondBroadcast(&pool->finished);
+	}
+}
+
+static MM_THREAD_FUNC(workPoolHelper)
+{
+	MMWorkPoolRef pool = arg;
+	MMMutexLock(&pool->lock);
+	while (!pool->stopping) {
+		if (pool->nextJob < pool->jobCount) {
+			runWorkPoolJobs(pool);
+		} else {
+			MMCondWait(&pool->wake, &pool->lock);
+		}
+	}
+	MMMutexUnlock(&pool->lock);
+	return MM_THREAD_RESULT;
+}
+
+MMWorkPoolRef createMMWorkPool(size_t threadCount)
+{
+	MMWorkPoolRef pool = calloc(1, sizeof(MMWorkPool));
+	if (pool == NULL) return NULL;
+
+	MMMutexInit(&pool->runLock);
+	MMMutexInit(&pool->lock);
+	MMCondInit(&pool->wake);
+	MMCondInit(&pool->finished);
+
+	if (threadCount > 1) {
+		pool->helpers = calloc(threadCount - 1, sizeof(MMThread));
+		if (pool->helpers == NULL) {
+			destroyMMWorkPool(pool);
+			return NULL;
+		}
+		while (pool->helperCount < threadCount - 1 &&
+		       MMThreadCreate(&pool->helpers[pool->helperCount], workPoolHelper, pool)) {
+			pool->helperCount++;
+		}
+	}
+	return pool;
+}
+
+void destroyMMWorkPool(MMWorkPoolRef pool)
+{
+	if (pool == NULL) return;
+
+	MMMutexLock(&pool->lock);
+	pool->stopping = true;
+	MMCondBroadcast(&pool->wake);
+	MMMutexUnlock(&pool->lock);
+	for (size_t i = 0; i < pool->helperCount; i++) {
+		MMThreadJoin(pool->helpers[i]);
+	}
+
+	MMCondDestroy(&pool->finished);
+	MMCondDestroy(&pool->wake);
+	MMMutexDestroy(&pool->lock);
+	MMMutexDestroy(&pool->runLock);
+	free(pool->helpers);
+	free(pool);
+}
+
+size_t getMMWorkPoolThreadCount(MMWorkPoolRef pool)
+{
+	return pool != NULL ? pool->helperCount + 1 : 1;
+}
+
+void runMMWorkPool(MMWorkPoolRef pool, size_t jobCount, MMWorkFunc func, void *context)
+{
+	if (jobCount == 0) return;
+	if (pool == NULL || pool->helperCount == 0 || jobCount == 1) {
+		for (size_t i = 0; i < jobCount; i++) func(context, i);
+		return;
+	}
+
+	MMMutexLock(&pool->runLock);
+	MMMutexLock(&pool->lock);
+	pool->func = func;
+	pool->context = context;
+	pool->jobCount = jobCount;
+	pool->nextJob = 0;
+	pool->doneJobs = 0;
+	MMCondBroadcast(&pool->wake);
+
+	runWorkPoolJobs(pool);
+	while (pool->doneJobs < pool->jobCount) {
+		MMCondWait(&pool->finished, &pool->lock);
+	}
+
+	/* Leave nothing for helpers to pick up until the next batch. */
+	pool->jobCount = 0;
+	pool->nextJob = 0;
+	MMMutexUnlock(&pool->lock);
+	MMMutexUnlock(&pool->runLock);
+}
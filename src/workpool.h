@@ -0,0 +1,44 @@
+#pragma once
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Persistent worker threads for splitting one piece of work (e.g. the rows
+ * of an image) into independent jobs. The thread that runs a batch takes
+ * jobs too, so a pool of N threads starts N - 1 helpers, and a pool of one
+ * runs everything inline. */
+
+typedef struct _MMWorkPool MMWorkPool;
+typedef MMWorkPool *MMWorkPoolRef;
+
+/* Called once per job, with `index` in [0, jobCount). */
+typedef void (*MMWorkFunc)(void *context, size_t index);
+
+/* Creates a pool of `threadCount` threads, counting the caller. Follows the
+ * Create Rule (caller is responsible for destroy()'ing object). Returns NULL
+ * on error; if only some helpers could be started, the pool is smaller. */
+MMWorkPoolRef createMMWorkPool(size_t threadCount);
+
+/* Stops and joins the helpers. Must not be called while a batch runs. */
+void destroyMMWorkPool(MMWorkPoolRef pool);
+
+/* Threads working on a batch, counting the caller. */
+size_t getMMWorkPoolThreadCount(MMWorkPoolRef pool);
+
+/* Runs `func(context, i)` for every i in [0, jobCount), in no particular
+ * order, and returns once all of them have finished. One batch runs at a
+ * time; other callers wait for it. */
+void runMMWorkPool(MMWorkPoolRef pool, size_t jobCount, MMWorkFunc func, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORKPOOL_H */
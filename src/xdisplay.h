@@ -14,6 +14,34 @@ Display *XGetMainDisplay(void);
 /* Closes the main display if it is open, or does nothing if not. */
 void XCloseMainDisplay(void);
 
+/* Returns the connection used for screen capture. It is separate from the
+ * main display so grabs and input don't share a request queue, follows
+ * setXDisplay() changes, and is reopened if the server drops it.
+ *
+ * Like the main display it is not thread safe; callers serialize access. */
+Display *XGetCaptureDisplay(void);
+
+/* Incremented every time the capture connection is (re)opened, so state tied
+ * to the connection (e.g. shared memory segments) can tell it went stale. */
+unsigned long XGetCaptureDisplayGeneration(void);
+
+/* Closes the capture display if it is open, or does nothing if not. */
+void XCloseCaptureDisplay(void);
+
+/* Makes an I/O error on `display` call `handler` and carry on, instead of
+ * exiting the process. Xlib's default I/O error handler exits before the
+ * per-display exit handler gets a say, so a process-wide handler is
+ * installed once that returns for displays set up here and passes every
+ * other display to the handler it replaced. Does nothing without
+ * XSetIOErrorExitHandler() (libX11 1.7). */
+void XSetRecoverableIOErrorExit(Display *display, void (*handler)(Display *, void *),
+                                void *userData);
+
+/* Closes a display set up with XSetRecoverableIOErrorExit(). If `broken`,
+ * its connection is dead and nothing is sent on it: only the socket is
+ * closed and Xlib's state freed. */
+void XCloseRecoverableDisplay(Display *display, int broken);
+
 #ifdef __cplusplus
 extern "C"
 {
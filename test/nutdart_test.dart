@@ -1,3 +1,4 @@
+import 'dart:convert';
 import 'dart:typed_data';
 
 import 'package:flutter_test/flutter_test.dart';
@@ -53,6 +54,84 @@ void main() {
       expect(c1.toString(), equals('Color(255, 128, 64)'));
     });
 
+    test('Rect equality and hash', () {
+      const r1 = Rect(10, 20, 300, 400);
+      const r2 = Rect(10, 20, 300, 400);
+      const r3 = Rect(10, 20, 300, 401);
+
+      expect(r1, equals(r2));
+      expect(r1.hashCode, equals(r2.hashCode));
+      expect(r1, isNot(equals(r3)));
+      expect(r1.toString(), equals('Rect(10, 20, 300, 400)'));
+    });
+
+    test('Screen change tracking reports sequences or null', () {
+      final tracking = Screen.startChangeTracking();
+      final sequence = Screen.frameSequence;
+      if (tracking) {
+        expect(sequence, isNotNull);
+        final changes = Screen.changesSince(sequence!);
+        expect(changes, isNotNull);
+        expect(changes!.sequence, greaterThanOrEqualTo(sequence));
+      } else {
+        expect(sequence, isNull);
+        expect(Screen.changesSince(0), isNull);
+      }
+      Screen.stopChangeTracking();
+    });
+
+    test('FrameDiffer reports the first capture whole', () {
+      final differ = FrameDiffer();
+      final first = differ.captureRegion(0, 0, 64, 64);
+      if (first != null) {
+        expect(first.rects, equals([const Rect(0, 0, 64, 64)]));
+        expect(first.changedPixels, equals(64 * 64));
+        differ.reset();
+        expect(differ.captureRegion(0, 0, 64, 64)!.isEmpty, isFalse);
+      }
+      differ.dispose();
+    });
+
+    test('Screen.waitUntilStable respects the timeout', () {
+      final result = Screen.waitUntilStable(
+        region: const Rect(0, 0, 64, 64),
+        quiet: const Duration(milliseconds: 20),
+        timeout: const Duration(milliseconds: 500),
+      );
+      if (result != null) {
+        expect(result.elapsed, lessThan(const Duration(seconds: 2)));
+        if (result.stable) {
+          expect(result.elapsed, greaterThanOrEqualTo(const Duration(milliseconds: 20)));
+        }
+      }
+    });
+
+    test('CaptureSession delivers increasing frames', () {
+      final session = CaptureSession.start(
+        region: const Rect(0, 0, 64, 64),
+        interval: const Duration(milliseconds: 10),
+        encodeJpeg: false,
+      );
+      if (session == null) return;
+      final first = session.next();
+      if (first != null) {
+        expect(first.width, equals(64));
+        expect(first.pixels, isNotNull);
+        final second = session.next();
+        expect(second?.sequence, greaterThan(first.sequence));
+      }
+      session.stop();
+      expect(session.latest(), isNull);
+    });
+
+    test('Monitors list the primary first', () {
+      final monitors = Screen.getMonitors();
+      if (monitors.isNotEmpty) {
+        expect(monitors.first.primary, isTrue);
+        expect(monitors.where((m) => m.primary).length, equals(1));
+      }
+    });
+
     test('MouseButton enum values', () {
       expect(MouseButton.left.index, equals(0));
       expect(MouseButton.middle.index, equals(1));
@@ -66,6 +145,168 @@ void main() {
       expect(data, anyOf(isNull, isA<Uint8List>()));
     });
 
+    test('Every resize filter captures', () {
+      for (final filter in ResizeFilter.values) {
+        final data = Screen.capture(maxSmallDimension: 100, quality: 50, filter: filter);
+        expect(data, anyOf(isNull, isA<Uint8List>()));
+      }
+    });
+
+    test('A repeated capture is served from the cache', () {
+      Screen.clearCaptureCache();
+      // Not the default filter, so Wayland captures don't go through grim,
+      // whose JPEGs can only be matched by damage tracking
+      const filter = ResizeFilter.bilinear;
+      final first = Screen.capture(maxSmallDimension: 100, quality: 50, filter: filter);
+      final afterFirst = Screen.captureCacheStats;
+      // Only captures that went through the cache count a miss; other
+      // platforms return data without caching it
+      if (first == null || afterFirst.misses == 0) return;
+
+      final second = Screen.capture(maxSmallDimension: 100, quality: 50, filter: filter);
+      final afterSecond = Screen.captureCacheStats;
+      expect(second, equals(first));
+      expect(afterSecond.hits, equals(afterFirst.hits + 1));
+      expect(afterSecond.misses, equals(afterFirst.misses));
+    });
+
+    test('Encoding threads can be changed and restored', () {
+      final before = Screen.encodeThreads;
+      Screen.encodeThreads = 2;
+      final data = Screen.capture(maxSmallDimension: 100, quality: 50);
+      expect(data, anyOf(isNull, isA<Uint8List>()));
+      expect(Screen.encodeThreads, anyOf(equals(1), equals(2)));
+      Screen.encodeThreads = before;
+      expect(Screen.encodeThreads, equals(before));
+    });
+
+    test('JpegEncoder captures repeatedly', () {
+      final encoder = JpegEncoder.create();
+      if (encoder == null) return;
+      for (var i = 0; i < 3; i++) {
+        final data = encoder.capture(maxSmallDimension: 100, quality: 50);
+        expect(data, anyOf(isNull, isA<Uint8List>()));
+      }
+      encoder.dispose();
+      expect(encoder.capture(), isNull);
+    });
+
+    test('Captures into a small JpegBuffer grow it', () {
+      final buffer = JpegBuffer(16);
+      final data = Screen.captureInto(buffer, maxSmallDimension: 100, quality: 50);
+      if (data != null) {
+        expect(data.length, lessThanOrEqualTo(buffer.capacity));
+        expect(data.sublist(0, 2), equals([0xFF, 0xD8]));
+      }
+      final encoder = JpegEncoder.create();
+      final again = encoder?.captureInto(buffer, maxSmallDimension: 100, quality: 50);
+      expect(again, anyOf(isNull, isA<Uint8List>()));
+      encoder?.dispose();
+      buffer.dispose();
+      expect(buffer.bytes, isEmpty);
+    });
+
+    test('Budget captures stay within the budget', () {
+      const budget = 20 * 1024;
+      final capture = Screen.captureWithinBudget(budget, maxSmallDimension: 200);
+      if (capture != null) {
+        expect(capture.jpeg.length, lessThanOrEqualTo(budget));
+        expect(capture.quality, inInclusiveRange(10, 95));
+      }
+      final encoder = JpegEncoder.create();
+      for (var i = 0; i < 2; i++) {
+        final frame = encoder?.captureWithinBudget(budget, maxSmallDimension: 200);
+        if (frame != null) expect(frame.jpeg.length, lessThanOrEqualTo(budget));
+      }
+      encoder?.dispose();
+    });
+
+    test('PNG captures are PNGs', () {
+      final png = Screen.capturePng(maxSmallDimension: 100);
+      if (png != null) {
+        expect(png.sublist(0, 8), equals([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]));
+      }
+      final region = Screen.capturePng(region: const Rect(0, 0, 32, 16));
+      expect(region, anyOf(isNull, isA<Uint8List>()));
+    });
+
+    test('WebP captures are WebPs when available', () {
+      final webp = Screen.captureWebp(maxSmallDimension: 100);
+      if (!Screen.isWebpAvailable) {
+        expect(webp, isNull);
+      } else if (webp != null) {
+        expect(String.fromCharCodes(webp.sublist(0, 4)), equals('RIFF'));
+        expect(String.fromCharCodes(webp.sublist(8, 12)), equals('WEBP'));
+      }
+      final lossless = Screen.captureWebp(region: const Rect(0, 0, 32, 16), lossless: true);
+      expect(lossless, anyOf(isNull, isA<Uint8List>()));
+    });
+
+    test('One grab gives every requested output', () {
+      const specs = [
+        CaptureOutputSpec(CaptureFormat.png),
+        CaptureOutputSpec(CaptureFormat.jpeg, maxSmallDimension: 100, quality: 70),
+        CaptureOutputSpec(CaptureFormat.png, maxSmallDimension: 50),
+      ];
+      final outputs = Screen.captureOutputs(specs);
+      if (outputs != null) {
+        expect(outputs, hasLength(specs.length));
+        final full = outputs[0];
+        final small = outputs[2];
+        expect(full.data, isNotNull);
+        expect(small.data, isNotNull);
+        expect(small.width, lessThanOrEqualTo(full.width));
+        expect(small.height, lessThanOrEqualTo(full.height));
+      }
+    });
+
+    test('Base64 captures decode to the image', () {
+      final jpeg = Screen.captureBase64(maxSmallDimension: 100);
+      if (jpeg != null) {
+        expect(base64Decode(jpeg).sublist(0, 2), equals([0xFF, 0xD8]));
+      }
+      final png = Screen.captureBase64(
+        region: const Rect(0, 0, 32, 16),
+        format: CaptureFormat.png,
+        dataUri: true,
+      );
+      if (png != null) {
+        expect(png, startsWith('data:image/png;base64,'));
+        final bytes = base64Decode(png.substring('data:image/png;base64,'.length));
+        expect(bytes.sublist(1, 4), equals('PNG'.codeUnits));
+      }
+    });
+
+    test('CapturedFrame views native pixels until disposed', () {
+      final frame = Screen.captureFrame(region: const Rect(0, 0, 32, 16));
+      if (frame == null) return;
+      expect(frame.width, greaterThan(0));
+      expect(frame.bytesPerRow, greaterThanOrEqualTo(frame.width * frame.bytesPerPixel));
+      expect(frame.pixels.length, equals(frame.bytesPerRow * frame.height));
+      frame.dispose();
+      expect(frame.isDisposed, isTrue);
+      expect(frame.pixels, isEmpty);
+      frame.dispose();
+    });
+
+    test('CapturePlan keeps its size and maps points both ways', () {
+      const transform = CoordinateTransform(0.5, 0.5, 100, 50);
+      expect(transform.toImage(100, 50), equals(const Point(0, 0)));
+      expect(transform.toScreen(10, 20), equals(const Point(121, 91)));
+      expect(transform.toImage(121, 91), equals(const Point(10, 20)));
+
+      final plan = CapturePlan.create(region: const Rect(0, 0, 64, 32), maxLargeDimension: 32);
+      if (plan == null) return;
+      expect(plan.imageSize, equals(const Size(32, 16)));
+      expect(plan.transform.toScreen(31, 15), equals(const Point(63, 31)));
+      for (var i = 0; i < 2; i++) {
+        final png = plan.capture(format: CaptureFormat.png);
+        if (png != null) expect(png.sublist(1, 4), equals('PNG'.codeUnits));
+      }
+      plan.dispose();
+      expect(plan.capture(), isNull);
+    });
+
     test('ComputerUse.sleep delays execution', () async {
       final start = DateTime.now();
       await ComputerUse.sleep(100);